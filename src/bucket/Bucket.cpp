@@ -8,6 +8,7 @@
 #include "util/asio.h"
 #include "bucket/Bucket.h"
 #include "bucket/BucketApplicator.h"
+#include "bucket/BucketInputIterator.h"
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "bucket/BucketOutputIterator.h"
@@ -20,9 +21,9 @@
 #include "ledger/DataFrame.h"
 #include "ledger/EntryFrame.h"
 #include "ledger/LedgerDelta.h"
+#include "ledger/LedgerStore.h"
 #include "ledger/OfferFrame.h"
 #include "ledger/TrustFrame.h"
-#include "lib/util/format.h"
 #include "main/Application.h"
 #include "medida/medida.h"
 #include "util/Fs.h"
@@ -31,7 +32,10 @@
 #include "util/XDRStream.h"
 #include "util/make_unique.h"
 #include "xdrpp/message.h"
+#include "xdrpp/printer.h"
+#include <algorithm>
 #include <cassert>
+#include <functional>
 #include <future>
 
 namespace stellar
@@ -69,15 +73,9 @@ Bucket::containsBucketIdentity(BucketEntry const& id) const
 {
     BucketEntryIdCmp cmp;
     BucketInputIterator iter(shared_from_this());
-    while (iter)
-    {
-        if (!(cmp(*iter, id) || cmp(id, *iter)))
-        {
-            return true;
-        }
-        ++iter;
-    }
-    return false;
+    iter.seek(id.type() == LIVEENTRY ? LedgerEntryKey(id.liveEntry())
+                                     : id.deadEntry());
+    return iter && !cmp(id, *iter);
 }
 
 std::pair<size_t, size_t>
@@ -139,8 +137,10 @@ Bucket::fresh(BucketManager& bucketManager,
 
     std::sort(dead.begin(), dead.end(), BucketEntryIdCmp());
 
-    BucketOutputIterator liveOut(bucketManager.getTmpDir(), true);
-    BucketOutputIterator deadOut(bucketManager.getTmpDir(), true);
+    BucketOutputIterator liveOut(bucketManager.getTmpDir(), true,
+                                 bucketManager.useBlockFormat());
+    BucketOutputIterator deadOut(bucketManager.getTmpDir(), true,
+                                 bucketManager.useBlockFormat());
     for (auto const& e : live)
     {
         liveOut.put(e);
@@ -204,7 +204,8 @@ Bucket::merge(BucketManager& bucketManager,
                                                      shadows.end());
 
     auto timer = bucketManager.getMergeTimer().TimeScope();
-    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries);
+    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries,
+                             bucketManager.useBlockFormat());
 
     BucketEntryIdCmp cmp;
     while (oi || ni)
@@ -244,22 +245,157 @@ Bucket::merge(BucketManager& bucketManager,
     return out.getBucket(bucketManager);
 }
 
-static void
-compareSizes(std::string const& objType, uint64_t inDatabase,
-             uint64_t inBucketlist)
+std::shared_ptr<Bucket>
+Bucket::mergeAll(BucketManager& bucketManager,
+                 std::vector<std::shared_ptr<Bucket const>> const& buckets,
+                 bool keepDeadEntries)
 {
-    if (inDatabase != inBucketlist)
+    std::vector<BucketInputIterator> iters(buckets.begin(), buckets.end());
+
+    auto timer = bucketManager.getMergeTimer().TimeScope();
+    BucketOutputIterator out(bucketManager.getTmpDir(), keepDeadEntries,
+                             bucketManager.useBlockFormat());
+
+    BucketEntryIdCmp cmp;
+    while (true)
+    {
+        // Find the smallest key; on ties, the first (newest) iterator wins.
+        BucketInputIterator* next = nullptr;
+        for (auto& i : iters)
+        {
+            if (i && (!next || cmp(*i, **next)))
+            {
+                next = &i;
+            }
+        }
+        if (!next)
+        {
+            break;
+        }
+
+        out.put(**next);
+
+        // Skip the older versions of that key.
+        for (auto& i : iters)
+        {
+            if (&i != next && i && !cmp(**next, *i))
+            {
+                ++i;
+            }
+        }
+        ++*next;
+    }
+    return out.getBucket(bucketManager);
+}
+
+// Entries of a database snapshot are sorted in memory by runs of this many,
+// then the runs are merged.
+static const size_t SNAPSHOT_RUN_SIZE = 100000;
+
+using EntryProcessor = std::function<void(LedgerEntry const&)>;
+
+static std::shared_ptr<Bucket>
+writeSortedRun(BucketManager& bucketManager, std::vector<LedgerEntry>& entries)
+{
+    LedgerEntryIdCmp cmp;
+    std::sort(entries.begin(), entries.end(),
+              [&cmp](LedgerEntry const& a, LedgerEntry const& b) {
+                  return cmp(a.data, b.data);
+              });
+
+    BucketOutputIterator out(bucketManager.getTmpDir(), true,
+                             bucketManager.useBlockFormat());
+    BucketEntry e;
+    e.type(LIVEENTRY);
+    for (auto const& le : entries)
+    {
+        e.liveEntry() = le;
+        out.put(e);
+    }
+    return out.getBucket(bucketManager);
+}
+
+static std::shared_ptr<Bucket>
+snapshotTable(BucketManager& bucketManager,
+              std::function<void(EntryProcessor const&)> const& scan)
+{
+    std::vector<std::shared_ptr<Bucket const>> runs;
+    std::vector<LedgerEntry> entries;
+    scan([&](LedgerEntry const& le) {
+        entries.push_back(le);
+        if (entries.size() == SNAPSHOT_RUN_SIZE)
+        {
+            runs.push_back(writeSortedRun(bucketManager, entries));
+            entries.clear();
+        }
+    });
+
+    if (runs.empty())
+    {
+        return writeSortedRun(bucketManager, entries);
+    }
+    if (!entries.empty())
     {
-        throw std::runtime_error(fmt::format(
-            "{} object count mismatch: DB has {}, BucketList has {}", objType,
-            inDatabase, inBucketlist));
+        runs.push_back(writeSortedRun(bucketManager, entries));
     }
+    return Bucket::mergeAll(bucketManager, runs);
 }
 
-// FIXME issue NNN: this should be refactored to run in a read-transaction on a
-// background thread and take a soci::session& rather than Database&. For now we
-// code it to run on main thread because there's a bunch of code to move around
-// in the ledger frames and db layer to make that work.
+std::vector<std::shared_ptr<Bucket>>
+snapshotDatabase(BucketManager& bucketManager, Database& db, bool parallel)
+{
+    std::vector<LedgerEntryType> const types{ACCOUNT, TRUSTLINE, OFFER, DATA};
+    std::vector<std::function<void(soci::session&, EntryProcessor)>> const
+        tables{&AccountFrame::loadAllAccounts, &TrustFrame::loadAllLines,
+               &OfferFrame::loadAllOffers, &DataFrame::loadAllData};
+    std::vector<std::shared_ptr<Bucket>> snapshot(types.size());
+
+    if (auto store = db.getLedgerStore())
+    {
+        // the store only reads through the main connection
+        for (size_t i = 0; i < types.size(); i++)
+        {
+            snapshot[i] =
+                snapshotTable(bucketManager, [&](EntryProcessor const& f) {
+                    store->forEach(types[i], nullptr,
+                                   [&f](LedgerEntry const& le) {
+                                       f(le);
+                                       return true;
+                                   });
+                });
+        }
+    }
+    else if (parallel && db.canUsePool())
+    {
+        auto& pool = db.getPool();
+        std::vector<std::future<void>> done;
+        for (size_t i = 0; i < tables.size(); i++)
+        {
+            done.emplace_back(std::async(std::launch::async, [&, i]() {
+                soci::session sess(pool);
+                snapshot[i] =
+                    snapshotTable(bucketManager, [&](EntryProcessor const& f) {
+                        tables[i](sess, f);
+                    });
+            }));
+        }
+        for (auto& f : done)
+        {
+            f.get();
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < tables.size(); i++)
+        {
+            snapshot[i] =
+                snapshotTable(bucketManager, [&](EntryProcessor const& f) {
+                    tables[i](db.getSession(), f);
+                });
+        }
+    }
+    return snapshot;
+}
 
 void
 checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
@@ -270,8 +406,8 @@ checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
     auto execTimer =
         metrics.NewTimer({"bucket", "checkdb", "execute"}).TimeScope();
 
-    // Step 1: Collect all buckets to merge.
-    std::vector<std::shared_ptr<Bucket>> buckets;
+    // Step 1: Collect all buckets to merge, newest first.
+    std::vector<std::shared_ptr<Bucket const>> buckets;
     for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
     {
         CLOG(INFO, "Bucket") << "CheckDB collecting buckets from level " << i;
@@ -287,76 +423,77 @@ checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
         buckets.push_back(level.getSnap());
     }
 
-    if (buckets.empty())
+    // Step 2: merge all buckets into a single super-bucket of live entries.
+    std::shared_ptr<Bucket> superBucket;
     {
-        CLOG(INFO, "Bucket") << "CheckDB found no buckets, returning";
-        return;
+        auto mergeTimer =
+            metrics.NewTimer({"bucket", "checkdb", "merge"}).TimeScope();
+        superBucket = Bucket::mergeAll(bucketManager, buckets, false);
     }
 
-    // Step 2: merge all buckets into a single super-bucket.
-    auto i = buckets.begin();
-    assert(i != buckets.end());
-    std::shared_ptr<Bucket> superBucket = *i;
-    while (++i != buckets.end())
+    // Step 3: write the database to buckets sorted the same way.
+    std::vector<std::shared_ptr<Bucket>> snapshot;
     {
-        auto mergeTimer =
-            metrics.NewTimer({"bucket", "checkdb", "merge"}).TimeScope();
-        assert(superBucket);
-        assert(*i);
-        superBucket = Bucket::merge(bucketManager, *i, superBucket);
-        assert(superBucket);
+        auto snapshotTimer =
+            metrics.NewTimer({"bucket", "checkdb", "snapshot"}).TimeScope();
+        snapshot = snapshotDatabase(bucketManager, db, true);
     }
 
     CLOG(INFO, "Bucket") << "CheckDB starting object comparison";
 
-    // Step 3: scan the superbucket, checking each object against the DB and
-    // counting objects along the way.
-    uint64_t nAccounts = 0, nTrustLines = 0, nOffers = 0, nData = 0;
+    // Step 4: scan the superbucket and the snapshot together, in key order,
+    // comparing their entries.
+    auto& meter = metrics.NewMeter({"bucket", "checkdb", "object-compare"},
+                                   "comparison");
+    auto compareTimer =
+        metrics.NewTimer({"bucket", "checkdb", "compare"}).TimeScope();
+
+    auto table = snapshot.begin();
+    std::unique_ptr<BucketInputIterator> inDb;
+    // moves on to the next table once one is exhausted
+    auto skipExhausted = [&]() {
+        while ((!inDb || !*inDb) && table != snapshot.end())
+        {
+            inDb = make_unique<BucketInputIterator>(*table++);
+        }
+    };
+    skipExhausted();
+
+    BucketEntryIdCmp cmp;
+    BucketInputIterator live(superBucket);
+    while (live || *inDb)
     {
-        auto& meter = metrics.NewMeter({"bucket", "checkdb", "object-compare"},
-                                       "comparison");
-        auto compareTimer =
-            metrics.NewTimer({"bucket", "checkdb", "compare"}).TimeScope();
-        for (BucketInputIterator iter(superBucket); iter; ++iter)
+        meter.Mark();
+        if (*inDb && (!live || cmp(**inDb, *live)))
         {
-            meter.Mark();
-            auto& e = *iter;
-            if (e.type() == LIVEENTRY)
-            {
-                switch (e.liveEntry().data.type())
-                {
-                case ACCOUNT:
-                    ++nAccounts;
-                    break;
-                case TRUSTLINE:
-                    ++nTrustLines;
-                    break;
-                case OFFER:
-                    ++nOffers;
-                    break;
-                case DATA:
-                    ++nData;
-                    break;
-                }
-                auto s = EntryFrame::checkAgainstDatabase(e.liveEntry(), db);
-                if (!s.empty())
-                {
-                    throw std::runtime_error{s};
-                }
-                if (meter.count() % 100 == 0)
-                {
-                    CLOG(INFO, "Bucket")
-                        << "CheckDB compared " << meter.count() << " objects";
-                }
-            }
+            std::string s{"Inconsistent state between objects (not found in "
+                          "bucket list): "};
+            s += xdr::xdr_to_string((**inDb).liveEntry(), "db");
+            throw std::runtime_error{s};
+        }
+        if (!*inDb || cmp(*live, **inDb))
+        {
+            std::string s{
+                "Inconsistent state between objects (not found in database): "};
+            s += xdr::xdr_to_string((*live).liveEntry(), "live");
+            throw std::runtime_error{s};
+        }
+        if (!((**inDb).liveEntry() == (*live).liveEntry()))
+        {
+            std::string s{"Inconsistent state between objects: "};
+            s += xdr::xdr_to_string((**inDb).liveEntry(), "db");
+            s += xdr::xdr_to_string((*live).liveEntry(), "live");
+            throw std::runtime_error{s};
         }
-    }
 
-    // Step 4: confirm size of datasets matches size of datasets in DB.
-    soci::session& sess = db.getSession();
-    compareSizes("account", AccountFrame::countObjects(sess), nAccounts);
-    compareSizes("trustline", TrustFrame::countObjects(sess), nTrustLines);
-    compareSizes("offer", OfferFrame::countObjects(sess), nOffers);
-    compareSizes("data", DataFrame::countObjects(sess), nData);
+        ++live;
+        ++*inDb;
+        skipExhausted();
+        if (meter.count() % 100000 == 0)
+        {
+            CLOG(INFO, "Bucket")
+                << "CheckDB compared " << meter.count() << " objects";
+        }
+    }
 }
 }
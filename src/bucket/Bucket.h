@@ -87,8 +87,28 @@ class Bucket : public std::enable_shared_from_this<Bucket>,
           std::vector<std::shared_ptr<Bucket>> const& shadows =
               std::vector<std::shared_ptr<Bucket>>(),
           bool keepDeadEntries = true);
+
+    // Merge any number of buckets together in a single pass, producing a
+    // fresh one. `buckets` go from newest to oldest: entries are overridden
+    // in the fresh bucket by keywise-equal entries in any earlier bucket.
+    static std::shared_ptr<Bucket>
+    mergeAll(BucketManager& bucketManager,
+             std::vector<std::shared_ptr<Bucket const>> const& buckets,
+             bool keepDeadEntries = true);
 };
 
+// Writes the ledger entries of the database (its SQL tables, or its ledger
+// store) to one bucket per entry type, in LedgerEntryType order, each sorted
+// like the buckets of the bucket list. Entries are sorted by runs of bounded
+// size that are then merged, so memory use does not grow with the ledger.
+// With `parallel`, the SQL tables are read concurrently on the connection
+// pool, which does not see uncommitted changes of the main session.
+std::vector<std::shared_ptr<Bucket>>
+snapshotDatabase(BucketManager& bucketManager, Database& db, bool parallel);
+
+// Checks that the entries of the database are exactly the live entries of
+// the bucket list, by scanning a snapshot of the database and the merged
+// bucket list together, in key order. Throws on the first difference.
 void checkDBAgainstBuckets(medida::MetricsRegistry& metrics,
                            BucketManager& bucketManager, Database& db,
                            BucketList& bl);
@@ -8,13 +8,20 @@
 #include "ledger/LedgerDelta.h"
 #include "util/Logging.h"
 
+#include <cassert>
+
 namespace stellar
 {
 
 BucketApplicator::BucketApplicator(Database& db,
-                                   std::shared_ptr<const Bucket> bucket)
-    : mDb(db), mBucketIter(bucket)
+                                   std::shared_ptr<const Bucket> bucket,
+                                   size_t batchSize, bool insertOnly)
+    : mDb(db)
+    , mBucketIter(bucket)
+    , mBatchSize(batchSize)
+    , mInsertOnly(insertOnly)
 {
+    assert(mBatchSize > 0);
 }
 
 BucketApplicator::operator bool() const
@@ -26,6 +33,7 @@ void
 BucketApplicator::advance()
 {
     soci::transaction sqlTx(mDb.getSession());
+    size_t batch = 0;
     for (; mBucketIter; ++mBucketIter)
     {
         LedgerHeader lh;
@@ -35,7 +43,14 @@ BucketApplicator::advance()
         if (entry.type() == LIVEENTRY)
         {
             EntryFrame::pointer ep = EntryFrame::FromXDR(entry.liveEntry());
-            ep->storeAddOrChange(delta, mDb);
+            if (mInsertOnly)
+            {
+                ep->storeAdd(delta, mDb);
+            }
+            else
+            {
+                ep->storeAddOrChange(delta, mDb);
+            }
         }
         else
         {
@@ -43,15 +58,17 @@ BucketApplicator::advance()
         }
         // No-op, just to avoid needless rollback.
         delta.commit();
-        if ((++mSize & 0xff) == 0xff)
+        ++mSize;
+        if (++batch == mBatchSize)
         {
+            ++mBucketIter;
             break;
         }
     }
     sqlTx.commit();
-    mDb.clearPreparedStatementCache();
 
-    if (!mBucketIter || (mSize & 0xfff) == 0xfff)
+    // log when done, and about every 4096 entries
+    if (!mBucketIter || (mSize / 0x1000) != ((mSize - batch) / 0x1000))
     {
         CLOG(INFO, "Bucket")
             << "Bucket-apply: committed " << mSize << " entries";
@@ -23,10 +23,16 @@ class BucketApplicator
 {
     Database& mDb;
     BucketInputIterator mBucketIter;
+    size_t mBatchSize;
+    bool mInsertOnly;
     size_t mSize{0};
 
   public:
-    BucketApplicator(Database& db, std::shared_ptr<const Bucket> bucket);
+    // Each call to advance() applies up to @p batchSize entries. With
+    // @p insertOnly, live entries are known not to be in the database yet and
+    // are inserted without looking them up first.
+    BucketApplicator(Database& db, std::shared_ptr<const Bucket> bucket,
+                     size_t batchSize = 0x100, bool insertOnly = false);
     operator bool() const;
     void advance();
 };
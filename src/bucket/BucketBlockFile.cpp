@@ -0,0 +1,421 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "bucket/BucketBlockFile.h"
+#include "bucket/LedgerCmp.h"
+#include "crypto/ByteSlice.h"
+#include "crypto/SHA.h"
+#include "ledger/EntryFrame.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+#include "xdrpp/marshal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <zlib.h>
+
+namespace stellar
+{
+
+namespace
+{
+char const MAGIC[4] = {'S', 'B', 'K', '2'};
+size_t const BLOCK_HEADER_SIZE = 16;
+size_t const FOOTER_SIZE = 8 + 4 + 4 + sizeof(MAGIC);
+// favor speed: level 0 buckets are written while closing ledgers
+int const COMPRESSION_LEVEL = 3;
+
+void
+putUint32(char* p, uint32_t v)
+{
+    p[0] = static_cast<char>((v >> 24) & 0xFF);
+    p[1] = static_cast<char>((v >> 16) & 0xFF);
+    p[2] = static_cast<char>((v >> 8) & 0xFF);
+    p[3] = static_cast<char>(v & 0xFF);
+}
+
+void
+appendUint32(std::vector<char>& buf, uint32_t v)
+{
+    buf.resize(buf.size() + 4);
+    putUint32(buf.data() + buf.size() - 4, v);
+}
+
+void
+appendUint64(std::vector<char>& buf, uint64_t v)
+{
+    appendUint32(buf, static_cast<uint32_t>(v >> 32));
+    appendUint32(buf, static_cast<uint32_t>(v));
+}
+
+uint32_t
+getUint32(char const* p)
+{
+    return (static_cast<uint32_t>(static_cast<uint8_t>(p[0])) << 24) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(p[1])) << 16) |
+           (static_cast<uint32_t>(static_cast<uint8_t>(p[2])) << 8) |
+           static_cast<uint32_t>(static_cast<uint8_t>(p[3]));
+}
+
+uint64_t
+getUint64(char const* p)
+{
+    return (static_cast<uint64_t>(getUint32(p)) << 32) | getUint32(p + 4);
+}
+
+uint32_t
+checksum(char const* data, size_t size)
+{
+    return static_cast<uint32_t>(crc32(0, reinterpret_cast<Bytef const*>(data),
+                                       static_cast<uInt>(size)));
+}
+
+LedgerKey
+bucketEntryKey(BucketEntry const& entry)
+{
+    return entry.type() == LIVEENTRY ? LedgerEntryKey(entry.liveEntry())
+                                     : entry.deadEntry();
+}
+}
+
+size_t const BucketBlockWriter::BLOCK_SIZE = 64 * 1024;
+
+bool
+isBucketBlockFile(std::string const& filename)
+{
+    std::ifstream in(filename, std::ifstream::binary);
+    char magic[sizeof(MAGIC)];
+    return in.read(magic, sizeof(magic)) &&
+           std::equal(magic, magic + sizeof(magic), MAGIC);
+}
+
+void
+convertToBucketBlockFile(std::string const& filename)
+{
+    auto tmp = filename + ".blk";
+    {
+        XDRInputFileStream in;
+        in.open(filename);
+        BucketBlockWriter out;
+        out.open(tmp);
+        BucketEntry entry;
+        while (in && in.readOne(entry))
+        {
+            out.writeOne(entry);
+        }
+        out.close();
+    }
+    if (std::rename(tmp.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tmp.c_str());
+        throw std::runtime_error("failed to rename " + tmp + " to " +
+                                 filename);
+    }
+}
+
+void
+BucketBlockWriter::open(std::string const& filename)
+{
+    mFilename = filename;
+    mOut.open(filename, std::ofstream::binary | std::ofstream::trunc);
+    if (!mOut)
+    {
+        throw std::runtime_error("failed to open bucket file " + filename);
+    }
+    mOffset = 0;
+    mBlocks = 0;
+    mBlock.clear();
+    mBlockEntries = 0;
+    mIndex.clear();
+    write(MAGIC, sizeof(MAGIC));
+}
+
+void
+BucketBlockWriter::write(char const* data, size_t size)
+{
+    if (!mOut.write(data, size))
+    {
+        throw std::runtime_error("failed to write bucket file " + mFilename);
+    }
+    mOffset += size;
+}
+
+void
+BucketBlockWriter::writeOne(BucketEntry const& entry, SHA256* hasher,
+                            size_t* bytesPut)
+{
+    if (mBlockEntries == 0)
+    {
+        auto key = xdr::xdr_to_opaque(bucketEntryKey(entry));
+        appendUint64(mIndex, mOffset);
+        appendUint32(mIndex, static_cast<uint32_t>(key.size()));
+        mIndex.insert(mIndex.end(), key.begin(), key.end());
+    }
+
+    uint32_t sz = static_cast<uint32_t>(xdr::xdr_size(entry));
+    assert(sz < 0x80000000);
+    auto start = mBlock.size();
+    mBlock.resize(start + 4 + sz);
+    char* record = mBlock.data() + start;
+    // same record as in legacy files: size with the continuation bit set
+    putUint32(record, sz | 0x80000000);
+    xdr::xdr_put put(record + 4, record + 4 + sz);
+    xdr::xdr_argpack_archive(put, entry);
+    mBlockEntries++;
+
+    if (hasher)
+    {
+        hasher->add(ByteSlice(record, sz + 4));
+    }
+    if (bytesPut)
+    {
+        *bytesPut += sz + 4;
+    }
+
+    if (mBlock.size() >= BLOCK_SIZE)
+    {
+        flushBlock();
+    }
+}
+
+void
+BucketBlockWriter::flushBlock()
+{
+    if (mBlockEntries == 0)
+    {
+        return;
+    }
+
+    uLongf size = compressBound(static_cast<uLong>(mBlock.size()));
+    mCompressed.resize(BLOCK_HEADER_SIZE + size);
+    auto data =
+        reinterpret_cast<Bytef*>(mCompressed.data()) + BLOCK_HEADER_SIZE;
+    if (compress2(data, &size, reinterpret_cast<Bytef const*>(mBlock.data()),
+                  static_cast<uLong>(mBlock.size()),
+                  COMPRESSION_LEVEL) != Z_OK)
+    {
+        throw std::runtime_error("failed to compress block of " + mFilename);
+    }
+    putUint32(mCompressed.data(), static_cast<uint32_t>(size));
+    putUint32(mCompressed.data() + 4, static_cast<uint32_t>(mBlock.size()));
+    putUint32(mCompressed.data() + 8, mBlockEntries);
+    putUint32(mCompressed.data() + 12,
+              checksum(mBlock.data(), mBlock.size()));
+    write(mCompressed.data(), BLOCK_HEADER_SIZE + size);
+
+    mBlocks++;
+    mBlock.clear();
+    mBlockEntries = 0;
+}
+
+void
+BucketBlockWriter::close()
+{
+    if (!mOut.is_open())
+    {
+        return;
+    }
+    flushBlock();
+
+    std::vector<char> footer;
+    appendUint64(footer, mOffset);
+    appendUint32(footer, mBlocks);
+    appendUint32(footer, checksum(mIndex.data(), mIndex.size()));
+    footer.insert(footer.end(), MAGIC, MAGIC + sizeof(MAGIC));
+    write(mIndex.data(), mIndex.size());
+    write(footer.data(), footer.size());
+
+    mOut.close();
+    if (!mOut)
+    {
+        throw std::runtime_error("failed to write bucket file " + mFilename);
+    }
+}
+
+void
+BucketBlockReader::open(std::string const& filename)
+{
+    mFilename = filename;
+    mIn.open(filename, std::ifstream::binary);
+    if (!mIn)
+    {
+        throw std::runtime_error("failed to open bucket file " + filename);
+    }
+
+    char footer[FOOTER_SIZE];
+    mIn.seekg(0, std::ifstream::end);
+    auto size = static_cast<uint64_t>(mIn.tellg());
+    if (size < sizeof(MAGIC) + FOOTER_SIZE)
+    {
+        corrupt("truncated file");
+    }
+    mIn.seekg(size - FOOTER_SIZE);
+    if (!mIn.read(footer, FOOTER_SIZE) ||
+        !std::equal(MAGIC, MAGIC + sizeof(MAGIC), footer + 16))
+    {
+        corrupt("bad footer");
+    }
+    mIndexOffset = getUint64(footer);
+    mBlocks = getUint32(footer + 8);
+    mIndexCRC = getUint32(footer + 12);
+    if (mIndexOffset < sizeof(MAGIC) || mIndexOffset > size - FOOTER_SIZE)
+    {
+        corrupt("bad index offset");
+    }
+    mIndexSize = size - FOOTER_SIZE - mIndexOffset;
+
+    mIn.seekg(sizeof(MAGIC));
+    mOffset = sizeof(MAGIC);
+    mBlock.clear();
+    mBlockPos = 0;
+    mIndex.clear();
+}
+
+void
+BucketBlockReader::close()
+{
+    mIn.close();
+}
+
+void
+BucketBlockReader::corrupt(std::string const& what)
+{
+    std::string msg = "corrupt bucket file " + mFilename + ": " + what;
+    CLOG(ERROR, "Bucket") << msg;
+    throw std::runtime_error(msg);
+}
+
+bool
+BucketBlockReader::readBlock()
+{
+    if (mOffset >= mIndexOffset)
+    {
+        return false;
+    }
+
+    char header[BLOCK_HEADER_SIZE];
+    if (!mIn.read(header, BLOCK_HEADER_SIZE))
+    {
+        corrupt("truncated block");
+    }
+    auto compressedSize = getUint32(header);
+    auto size = getUint32(header + 4);
+    auto crc = getUint32(header + 12);
+    if (compressedSize > mIndexOffset - mOffset - BLOCK_HEADER_SIZE)
+    {
+        corrupt("bad block size");
+    }
+
+    mCompressed.resize(compressedSize);
+    if (!mIn.read(mCompressed.data(), compressedSize))
+    {
+        corrupt("truncated block");
+    }
+    mBlock.resize(size);
+    uLongf len = size;
+    if (uncompress(reinterpret_cast<Bytef*>(mBlock.data()), &len,
+                   reinterpret_cast<Bytef const*>(mCompressed.data()),
+                   compressedSize) != Z_OK ||
+        len != size)
+    {
+        corrupt("bad block data");
+    }
+    if (checksum(mBlock.data(), mBlock.size()) != crc)
+    {
+        corrupt("block checksum mismatch");
+    }
+
+    mOffset += BLOCK_HEADER_SIZE + compressedSize;
+    mBlockPos = 0;
+    return true;
+}
+
+bool
+BucketBlockReader::readOne(BucketEntry& entry)
+{
+    while (mBlockPos >= mBlock.size())
+    {
+        if (!readBlock())
+        {
+            return false;
+        }
+    }
+
+    if (mBlock.size() - mBlockPos < 4)
+    {
+        corrupt("truncated record");
+    }
+    char const* record = mBlock.data() + mBlockPos;
+    uint32_t sz = getUint32(record) & 0x7fffffff;
+    if (mBlock.size() - mBlockPos - 4 < sz)
+    {
+        corrupt("truncated record");
+    }
+    // records are multiples of 4 bytes, so this decodes from aligned memory
+    xdr::xdr_get get(record + 4, record + 4 + sz);
+    xdr::xdr_argpack_archive(get, entry);
+    mBlockPos += 4 + sz;
+    return true;
+}
+
+void
+BucketBlockReader::loadIndex()
+{
+    std::vector<char> index(mIndexSize);
+    mIn.clear();
+    mIn.seekg(mIndexOffset);
+    if (!mIn.read(index.data(), index.size()))
+    {
+        corrupt("truncated index");
+    }
+    if (checksum(index.data(), index.size()) != mIndexCRC)
+    {
+        corrupt("index checksum mismatch");
+    }
+
+    size_t pos = 0;
+    for (uint32_t i = 0; i < mBlocks; ++i)
+    {
+        if (index.size() - pos < 12)
+        {
+            corrupt("truncated index");
+        }
+        auto offset = getUint64(index.data() + pos);
+        auto keySize = getUint32(index.data() + pos + 8);
+        pos += 12;
+        if (index.size() - pos < keySize)
+        {
+            corrupt("truncated index");
+        }
+        LedgerKey key;
+        xdr::xdr_get get(index.data() + pos, index.data() + pos + keySize);
+        xdr::xdr_argpack_archive(get, key);
+        pos += keySize;
+        mIndex.emplace_back(offset, key);
+    }
+}
+
+void
+BucketBlockReader::seek(LedgerKey const& key)
+{
+    if (mIndex.empty() && mBlocks != 0)
+    {
+        loadIndex();
+    }
+
+    // last block whose first key is not after key
+    LedgerEntryIdCmp cmp;
+    auto next =
+        std::upper_bound(mIndex.begin(), mIndex.end(), key,
+                         [&](LedgerKey const& k,
+                             std::pair<uint64_t, LedgerKey> const& block) {
+                             return cmp(k, block.second);
+                         });
+    mOffset = next == mIndex.begin() ? sizeof(MAGIC) : (next - 1)->first;
+    mIn.clear();
+    mIn.seekg(mOffset);
+    mBlock.clear();
+    mBlockPos = 0;
+}
+}
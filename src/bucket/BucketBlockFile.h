@@ -0,0 +1,109 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "xdr/Stellar-ledger.h"
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace stellar
+{
+
+class SHA256;
+
+/**
+ * Block-structured encoding of bucket files, used for the buckets we write
+ * when BUCKET_BLOCK_COMPRESSION is set.
+ *
+ * Logically a bucket is the stream of its entries as length-prefixed XDR
+ * records: that stream defines the hash of the bucket, and is what history
+ * archives hold. The block format cuts it into blocks of whole records, of
+ * about BLOCK_SIZE bytes, and compresses each block on its own (zlib):
+ *
+ *   "SBK2"
+ *   for each block:
+ *     compressed size, size, number of entries, CRC-32 of the uncompressed
+ *     bytes (4 bytes each, big-endian), compressed bytes
+ *   index, for each block:
+ *     offset of the block (8 bytes), size and XDR of the key of its first
+ *     entry
+ *   index offset (8 bytes), number of blocks, CRC-32 of the index, "SBK2"
+ *
+ * A legacy bucket file starts with a record size, which has the XDR
+ * continuation bit set, so it never starts with the magic.
+ */
+
+// Whether @p filename holds a bucket in the block format.
+bool isBucketBlockFile(std::string const& filename);
+
+// Rewrites the legacy bucket file @p filename in the block format, in place.
+void convertToBucketBlockFile(std::string const& filename);
+
+class BucketBlockWriter
+{
+    std::ofstream mOut;
+    std::string mFilename;
+    // records of the current block
+    std::vector<char> mBlock;
+    uint32_t mBlockEntries{0};
+    std::vector<char> mCompressed;
+    uint64_t mOffset{0};
+    // encoded index entries
+    std::vector<char> mIndex;
+    uint32_t mBlocks{0};
+
+    void write(char const* data, size_t size);
+    void flushBlock();
+
+  public:
+    static size_t const BLOCK_SIZE;
+
+    void open(std::string const& filename);
+
+    // Same as XDROutputFileStream::writeOne: @p hasher and @p bytesPut see
+    // the legacy encoding of @p entry.
+    void writeOne(BucketEntry const& entry, SHA256* hasher = nullptr,
+                  size_t* bytesPut = nullptr);
+
+    // Writes the last block and the index. Raises on I/O errors.
+    void close();
+};
+
+class BucketBlockReader
+{
+    std::ifstream mIn;
+    std::string mFilename;
+    uint64_t mIndexOffset{0};
+    uint32_t mBlocks{0};
+    uint64_t mIndexSize{0};
+    uint32_t mIndexCRC{0};
+    // offset of the next block to read
+    uint64_t mOffset{0};
+    // offset and first key of each block, loaded on the first seek
+    std::vector<std::pair<uint64_t, LedgerKey>> mIndex;
+    // uncompressed records of the current block
+    std::vector<char> mBlock;
+    size_t mBlockPos{0};
+    std::vector<char> mCompressed;
+
+    bool readBlock();
+    void loadIndex();
+    void corrupt(std::string const& what);
+
+  public:
+    void open(std::string const& filename);
+    void close();
+
+    // Reads the next entry, false at the end of the bucket. Raises if the
+    // file is corrupt.
+    bool readOne(BucketEntry& entry);
+
+    // Moves to the block that would hold @p key, using the index: entries
+    // read afterwards are the ones from that block on.
+    void seek(LedgerKey const& key);
+};
+}
@@ -4,6 +4,7 @@
 
 #include "bucket/BucketInputIterator.h"
 #include "bucket/Bucket.h"
+#include "util/make_unique.h"
 
 namespace stellar
 {
@@ -14,7 +15,7 @@ namespace stellar
 void
 BucketInputIterator::loadEntry()
 {
-    if (mIn.readOne(mEntry))
+    if (mBlockIn ? mBlockIn->readOne(mEntry) : mIn.readOne(mEntry))
     {
         mEntryPtr = &mEntry;
     }
@@ -41,19 +42,31 @@ BucketInputIterator::BucketInputIterator(std::shared_ptr<Bucket const> bucket)
     {
         CLOG(TRACE, "Bucket") << "BucketInputIterator opening file to read: "
                               << mBucket->getFilename();
-        mIn.open(mBucket->getFilename());
+        if (isBucketBlockFile(mBucket->getFilename()))
+        {
+            mBlockIn = make_unique<BucketBlockReader>();
+            mBlockIn->open(mBucket->getFilename());
+        }
+        else
+        {
+            mIn.open(mBucket->getFilename());
+        }
         loadEntry();
     }
 }
 
 BucketInputIterator::~BucketInputIterator()
 {
+    if (mBlockIn)
+    {
+        mBlockIn->close();
+    }
     mIn.close();
 }
 
 BucketInputIterator& BucketInputIterator::operator++()
 {
-    if (mIn)
+    if (mBlockIn || mIn)
     {
         loadEntry();
     }
@@ -63,4 +76,29 @@ BucketInputIterator& BucketInputIterator::operator++()
     }
     return *this;
 }
+
+void
+BucketInputIterator::seek(LedgerKey const& key)
+{
+    LedgerEntryIdCmp cmp;
+    auto before = [&]() {
+        auto const& e = *mEntryPtr;
+        return e.type() == LIVEENTRY ? cmp(e.liveEntry().data, key)
+                                     : cmp(e.deadEntry(), key);
+    };
+    if (!mEntryPtr || !before())
+    {
+        return;
+    }
+    if (mBlockIn)
+    {
+        // skip the blocks that can't hold the key
+        mBlockIn->seek(key);
+        loadEntry();
+    }
+    while (mEntryPtr && before())
+    {
+        ++(*this);
+    }
+}
 }
@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/BucketBlockFile.h"
 #include "bucket/LedgerCmp.h"
 #include "util/XDRStream.h"
 #include "xdr/Stellar-ledger.h"
@@ -25,6 +26,8 @@ class BucketInputIterator
     // non-null, it points to mEntry.
     BucketEntry const* mEntryPtr;
     XDRInputFileStream mIn;
+    // set instead of mIn for files in the block format
+    std::unique_ptr<BucketBlockReader> mBlockIn;
     BucketEntry mEntry;
 
     void loadEntry();
@@ -39,5 +42,8 @@ class BucketInputIterator
     ~BucketInputIterator();
 
     BucketInputIterator& operator++();
+
+    // Moves forward to the first entry not before @p key.
+    void seek(LedgerKey const& key);
 };
 }
@@ -52,6 +52,10 @@ class BucketManager : NonMovableOrCopyable
     }
     virtual std::string const& getTmpDir() = 0;
     virtual std::string const& getBucketDir() = 0;
+
+    // Whether new bucket files are written in the block format (see
+    // BucketBlockFile.h) rather than as a plain XDR stream.
+    virtual bool useBlockFormat() const = 0;
     virtual BucketList& getBucketList() = 0;
 
     virtual medida::Timer& getMergeTimer() = 0;
@@ -120,6 +120,12 @@ BucketManagerImpl::getBucketDir()
     return *(mLockedBucketDir);
 }
 
+bool
+BucketManagerImpl::useBlockFormat() const
+{
+    return mApp.getConfig().BUCKET_BLOCK_COMPRESSION;
+}
+
 BucketManagerImpl::~BucketManagerImpl()
 {
     if (mLockedBucketDir)
@@ -34,15 +34,39 @@ randomBucketName(std::string const& tmpDir)
  * hashes them while writing to either destination. Produces a Bucket when done.
  */
 BucketOutputIterator::BucketOutputIterator(std::string const& tmpDir,
-                                           bool keepDeadEntries)
+                                           bool keepDeadEntries,
+                                           bool blockFormat, size_t bufferSize)
     : mFilename(randomBucketName(tmpDir))
+    , mOut(bufferSize)
     , mBuf(nullptr)
     , mHasher(SHA256::create())
     , mKeepDeadEntries(keepDeadEntries)
 {
     CLOG(TRACE, "Bucket") << "BucketOutputIterator opening file to write: "
                           << mFilename;
-    mOut.open(mFilename);
+    if (blockFormat)
+    {
+        mBlockOut = make_unique<BucketBlockWriter>();
+        mBlockOut->open(mFilename);
+    }
+    else
+    {
+        mOut.open(mFilename);
+    }
+}
+
+void
+BucketOutputIterator::writeOne(BucketEntry const& e)
+{
+    if (mBlockOut)
+    {
+        mBlockOut->writeOne(e, mHasher.get(), &mBytesPut);
+    }
+    else
+    {
+        mOut.writeOne(e, mHasher.get(), &mBytesPut);
+    }
+    mObjectsPut++;
 }
 
 void
@@ -64,8 +88,7 @@ BucketOutputIterator::put(BucketEntry const& e)
         // merely replace (same identity), the buffered entry.
         if (mCmp(*mBuf, e))
         {
-            mOut.writeOne(*mBuf, mHasher.get(), &mBytesPut);
-            mObjectsPut++;
+            writeOne(*mBuf);
         }
     }
     else
@@ -80,15 +103,21 @@ BucketOutputIterator::put(BucketEntry const& e)
 std::shared_ptr<Bucket>
 BucketOutputIterator::getBucket(BucketManager& bucketManager)
 {
-    assert(mOut);
+    assert(mBlockOut || mOut);
     if (mBuf)
     {
-        mOut.writeOne(*mBuf, mHasher.get(), &mBytesPut);
-        mObjectsPut++;
+        writeOne(*mBuf);
         mBuf.reset();
     }
 
-    mOut.close();
+    if (mBlockOut)
+    {
+        mBlockOut->close();
+    }
+    else
+    {
+        mOut.close();
+    }
     if (mObjectsPut == 0 || mBytesPut == 0)
     {
         assert(mObjectsPut == 0);
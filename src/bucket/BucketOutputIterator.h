@@ -4,6 +4,7 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/BucketBlockFile.h"
 #include "bucket/LedgerCmp.h"
 #include "util/XDRStream.h"
 #include "xdr/Stellar-ledger.h"
@@ -23,6 +24,8 @@ class BucketOutputIterator
 {
     std::string mFilename;
     XDROutputFileStream mOut;
+    // set instead of mOut when writing the block format
+    std::unique_ptr<BucketBlockWriter> mBlockOut;
     BucketEntryIdCmp mCmp;
     std::unique_ptr<BucketEntry> mBuf;
     std::unique_ptr<SHA256> mHasher;
@@ -30,8 +33,12 @@ class BucketOutputIterator
     size_t mObjectsPut{0};
     bool mKeepDeadEntries{true};
 
+    void writeOne(BucketEntry const& e);
+
   public:
-    BucketOutputIterator(std::string const& tmpDir, bool keepDeadEntries);
+    BucketOutputIterator(std::string const& tmpDir, bool keepDeadEntries,
+                         bool blockFormat = false,
+                         size_t bufferSize = XDR_FILE_BUFFER_SIZE);
 
     void put(BucketEntry const& e);
 
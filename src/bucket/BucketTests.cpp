@@ -7,6 +7,7 @@
 // else.
 #include "util/asio.h"
 #include "bucket/Bucket.h"
+#include "bucket/BucketBlockFile.h"
 #include "bucket/BucketInputIterator.h"
 #include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
@@ -15,6 +16,8 @@
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "herder/LedgerCloseData.h"
+#include "ledger/AccountFrame.h"
+#include "ledger/LedgerDelta.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerTestUtils.h"
 #include "lib/catch.hpp"
@@ -31,6 +34,8 @@
 #include "util/types.h"
 #include "xdrpp/autocheck.h"
 #include <algorithm>
+#include <chrono>
+#include <fstream>
 #include <future>
 
 using namespace stellar;
@@ -493,6 +498,126 @@ TEST_CASE("file-backed buckets", "[bucket][bucketbench]")
     CLOG(DEBUG, "Bucket") << "Spill file size: " << fileSize(b1->getFilename());
 }
 
+TEST_CASE("bucket files read with any buffer size", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    std::vector<LedgerEntry> live(1000);
+    std::vector<LedgerKey> noDead;
+    for (auto& e : live)
+        e = LedgerTestUtils::generateValidLedgerEntry(3);
+    std::shared_ptr<Bucket> b =
+        Bucket::fresh(app->getBucketManager(), live, noDead);
+
+    std::vector<BucketEntry> expected;
+    for (BucketInputIterator iter(b); iter; ++iter)
+    {
+        expected.push_back(*iter);
+    }
+    REQUIRE(expected.size() == live.size());
+
+    // smaller than a single entry, not a multiple of 4, default
+    for (size_t bufferSize : {4, 67, 4096, 0})
+    {
+        XDRInputFileStream in(
+            0, bufferSize == 0 ? XDR_FILE_BUFFER_SIZE : bufferSize);
+        in.open(b->getFilename());
+        BucketEntry e;
+        size_t i = 0;
+        while (in && in.readOne(e))
+        {
+            REQUIRE(i < expected.size());
+            REQUIRE(xdr::xdr_to_opaque(e) ==
+                    xdr::xdr_to_opaque(expected[i]));
+            ++i;
+        }
+        REQUIRE(i == expected.size());
+        REQUIRE(!in);
+    }
+}
+
+TEST_CASE("block-format buckets", "[bucket]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    Application::pointer app = createTestApplication(clock, cfg);
+    Config cfg2(getTestConfig(1));
+    cfg2.BUCKET_BLOCK_COMPRESSION = true;
+    Application::pointer blockApp = createTestApplication(clock, cfg2);
+
+    autocheck::generator<LedgerKey> deadGen;
+    std::vector<LedgerEntry> live(10000);
+    std::vector<LedgerKey> dead(1000);
+    for (auto& e : live)
+        e = LedgerTestUtils::generateValidLedgerEntry(3);
+    for (auto& e : dead)
+        e = deadGen(3);
+
+    auto legacy = Bucket::fresh(app->getBucketManager(), live, dead);
+    auto blocks = Bucket::fresh(blockApp->getBucketManager(), live, dead);
+    REQUIRE(!isBucketBlockFile(legacy->getFilename()));
+    REQUIRE(isBucketBlockFile(blocks->getFilename()));
+
+    SECTION("same hash and entries as the legacy format")
+    {
+        REQUIRE(legacy->getHash() == blocks->getHash());
+        CHECK(fileSize(blocks->getFilename()) <
+              fileSize(legacy->getFilename()));
+        BucketInputIterator li(legacy), bi(blocks);
+        for (; li && bi; ++li, ++bi)
+        {
+            REQUIRE(xdr::xdr_to_opaque(*li) == xdr::xdr_to_opaque(*bi));
+        }
+        REQUIRE(!li);
+        REQUIRE(!bi);
+    }
+
+    SECTION("lookups go through the block index")
+    {
+        for (size_t i = 0; i < live.size(); i += 97)
+        {
+            BucketEntry e;
+            e.type(LIVEENTRY);
+            e.liveEntry() = live[i];
+            REQUIRE(blocks->containsBucketIdentity(e));
+            REQUIRE(legacy->containsBucketIdentity(e));
+        }
+    }
+
+    SECTION("legacy files convert in place")
+    {
+        auto filename = blockApp->getBucketManager().getTmpDir() + "/copy.xdr";
+        {
+            std::ifstream in(legacy->getFilename(), std::ifstream::binary);
+            std::ofstream out(filename, std::ofstream::binary);
+            out << in.rdbuf();
+        }
+        convertToBucketBlockFile(filename);
+        REQUIRE(isBucketBlockFile(filename));
+        auto b = std::make_shared<Bucket>(filename, legacy->getHash());
+        REQUIRE(countEntries(b) == countEntries(legacy));
+        REQUIRE(fileSize(filename) == fileSize(blocks->getFilename()));
+    }
+
+    SECTION("corrupt blocks are detected")
+    {
+        auto filename = blocks->getFilename();
+        {
+            std::fstream f(filename, std::fstream::binary | std::fstream::in |
+                                         std::fstream::out);
+            f.seekp(100);
+            char c = 0;
+            f.read(&c, 1);
+            c ^= 0x55;
+            f.seekp(100);
+            f.write(&c, 1);
+        }
+        REQUIRE_THROWS(countEntries(blocks));
+    }
+}
+
 TEST_CASE("merging bucket entries", "[bucket]")
 {
     VirtualClock clock;
@@ -635,6 +760,57 @@ clearFutures(Application::pointer app, BucketList& bl)
     }
 }
 
+TEST_CASE("merging many buckets at once", "[bucket]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& bm = app->getBucketManager();
+
+    // each bucket updates or deletes some of the entries of the previous one
+    autocheck::generator<bool> flip;
+    std::vector<std::shared_ptr<Bucket const>> newestFirst;
+    std::vector<LedgerEntry> entries(100);
+    for (auto& e : entries)
+    {
+        e = LedgerTestUtils::generateValidLedgerEntry(10);
+    }
+    for (int i = 0; i < 5; i++)
+    {
+        std::vector<LedgerEntry> live;
+        std::vector<LedgerKey> dead;
+        for (auto& e : entries)
+        {
+            if (i == 0 || flip())
+            {
+                e.lastModifiedLedgerSeq = i + 1;
+                live.push_back(e);
+            }
+            else if (flip())
+            {
+                dead.push_back(LedgerEntryKey(e));
+            }
+        }
+        newestFirst.insert(newestFirst.begin(), Bucket::fresh(bm, live, dead));
+    }
+
+    // same as merging them two at a time, oldest first
+    std::shared_ptr<Bucket> pairwise =
+        std::const_pointer_cast<Bucket>(newestFirst.back());
+    for (auto i = newestFirst.rbegin() + 1; i != newestFirst.rend(); ++i)
+    {
+        pairwise =
+            Bucket::merge(bm, pairwise, std::const_pointer_cast<Bucket>(*i));
+    }
+    auto merged = Bucket::mergeAll(bm, newestFirst);
+    CHECK(merged->getHash() == pairwise->getHash());
+
+    auto withoutDead = Bucket::mergeAll(bm, newestFirst, false);
+    auto counts = withoutDead->countLiveAndDeadEntries();
+    CHECK(counts.first == merged->countLiveAndDeadEntries().first);
+    CHECK(counts.second == 0);
+}
+
 TEST_CASE("bucketmanager ownership", "[bucket]")
 {
     VirtualClock clock;
@@ -1068,6 +1244,71 @@ TEST_CASE("checkdb succeeding", "[bucket][checkdb]")
     }
 }
 
+TEST_CASE("checkdb against database snapshot", "[bucket][checkdb]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    cfg.ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING = true;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+
+    app->generateLoad(100, 100, 100, false);
+    auto& m = app->getMetrics();
+    while (m.NewMeter({"loadgen", "run", "complete"}, "run").count() == 0)
+    {
+        clock.crank(false);
+    }
+
+    auto& db = app->getDatabase();
+    auto checkDB = [&]() {
+        checkDBAgainstBuckets(m, app->getBucketManager(), db,
+                              app->getBucketManager().getBucketList());
+    };
+
+    SECTION("consistent")
+    {
+        REQUIRE_NOTHROW(checkDB());
+        REQUIRE_NOTHROW(app->getLedgerManager().checkDbState());
+    }
+
+    SECTION("entry only in database")
+    {
+        LedgerEntry le;
+        le.data.type(ACCOUNT);
+        le.data.account() = LedgerTestUtils::generateValidAccountEntry(5);
+        LedgerDelta delta(app->getLedgerManager().getCurrentLedgerHeader(),
+                          db);
+        AccountFrame account(le);
+        account.storeAdd(delta, db);
+        REQUIRE_THROWS_AS(checkDB(), std::runtime_error);
+    }
+
+    SECTION("entry only in bucket list")
+    {
+        db.getSession()
+            << ("DELETE FROM accounts"
+                " WHERE accountid = (SELECT accountid FROM accounts LIMIT 1);");
+        REQUIRE_THROWS_AS(checkDB(), std::runtime_error);
+    }
+
+    SECTION("different entries")
+    {
+        db.getSession()
+            << ("UPDATE accounts SET balance = balance * 2"
+                " WHERE accountid = (SELECT accountid FROM accounts LIMIT 1);");
+        REQUIRE_THROWS_AS(checkDB(), std::runtime_error);
+    }
+
+    SECTION("wrong number of sub entries")
+    {
+        db.getSession()
+            << ("UPDATE accounts SET numsubentries = numsubentries + 1"
+                " WHERE accountid = (SELECT accountid FROM accounts LIMIT 1);");
+        REQUIRE_THROWS_AS(app->getLedgerManager().checkDbState(),
+                          std::runtime_error);
+    }
+}
+
 TEST_CASE("bucket apply", "[bucket]")
 {
     VirtualClock clock;
@@ -1094,21 +1335,111 @@ TEST_CASE("bucket apply", "[bucket]")
         Bucket::fresh(app->getBucketManager(), noLive, dead);
 
     auto& db = app->getDatabase();
-    auto& sess = db.getSession();
 
     CLOG(INFO, "Bucket") << "Applying bucket with " << live.size()
                          << " live entries";
     birth->apply(db);
-    auto count = AccountFrame::countObjects(sess);
+    auto count = AccountFrame::countObjects(db);
     REQUIRE(count == live.size() + 1 /* root account */);
 
     CLOG(INFO, "Bucket") << "Applying bucket with " << dead.size()
                          << " dead entries";
     death->apply(db);
-    count = AccountFrame::countObjects(sess);
+    count = AccountFrame::countObjects(db);
     REQUIRE(count == 1);
 }
 
+namespace
+{
+// How buckets used to be read: a read of the size, then one of the entry.
+size_t
+countEntriesWithIfstream(std::string const& filename)
+{
+    std::ifstream in(filename, std::ifstream::binary);
+    std::vector<char> buf;
+    char szBuf[4];
+    BucketEntry e;
+    size_t n = 0;
+    while (in.read(szBuf, 4))
+    {
+        uint32_t sz = ((static_cast<uint8_t>(szBuf[0]) & 0x7f) << 24) |
+                      (static_cast<uint8_t>(szBuf[1]) << 16) |
+                      (static_cast<uint8_t>(szBuf[2]) << 8) |
+                      static_cast<uint8_t>(szBuf[3]);
+        if (sz > buf.size())
+        {
+            buf.resize(sz);
+        }
+        REQUIRE(in.read(buf.data(), sz));
+        xdr::xdr_get g(buf.data(), buf.data() + sz);
+        xdr::xdr_argpack_archive(g, e);
+        ++n;
+    }
+    return n;
+}
+
+size_t
+countEntriesWithXDRStream(std::string const& filename, size_t bufferSize)
+{
+    XDRInputFileStream in(0, bufferSize);
+    in.open(filename);
+    BucketEntry e;
+    size_t n = 0;
+    while (in && in.readOne(e))
+    {
+        ++n;
+    }
+    return n;
+}
+}
+
+TEST_CASE("bucket iteration bench", "[bucketbench][hide]")
+{
+    VirtualClock clock;
+    Config const& cfg = getTestConfig();
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    std::vector<LedgerEntry> live(100000);
+    std::vector<LedgerKey> noDead;
+    for (auto& e : live)
+        e = LedgerTestUtils::generateValidLedgerEntry(3);
+    std::shared_ptr<Bucket> b =
+        Bucket::fresh(app->getBucketManager(), live, noDead);
+    auto filename = b->getFilename();
+
+    auto bench = [&](std::string const& name, std::function<size_t()> read) {
+        auto start = std::chrono::steady_clock::now();
+        auto n = read();
+        std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+        REQUIRE(n == live.size());
+        LOG(INFO) << name << ": " << static_cast<uint64_t>(n / elapsed.count())
+                  << " entries/sec";
+    };
+
+    for (int round = 0; round < 3; ++round)
+    {
+        bench("std::ifstream, 2 reads per entry",
+              [&]() { return countEntriesWithIfstream(filename); });
+        for (size_t bufferSize : {4 * 1024, 64 * 1024, 256 * 1024, 4096 * 1024})
+        {
+            bench("XDRInputFileStream, " + std::to_string(bufferSize / 1024) +
+                      "KB buffer",
+                  [&]() {
+                      return countEntriesWithXDRStream(filename, bufferSize);
+                  });
+        }
+        bench("BucketInputIterator", [&]() {
+            size_t n = 0;
+            for (BucketInputIterator iter(b); iter; ++iter)
+            {
+                ++n;
+            }
+            return n;
+        });
+    }
+}
+
 #ifdef USE_POSTGRES
 TEST_CASE("bucket apply bench", "[bucketbench][hide]")
 {
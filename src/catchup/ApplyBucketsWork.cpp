@@ -2,6 +2,8 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "util/asio.h"
+
 #include "catchup/ApplyBucketsWork.h"
 #include "bucket/Bucket.h"
 #include "bucket/BucketApplicator.h"
@@ -18,14 +20,21 @@
 #include "ledger/OfferFrame.h"
 #include "ledger/TrustFrame.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "util/format.h"
 #include "util/make_unique.h"
 #include <medida/meter.h>
 #include <medida/metrics_registry.h>
 
+#include <algorithm>
+
 namespace stellar
 {
 
+// Entries applied per crank when applying merged buckets: each entry is only
+// written once, so there are far fewer of them in total.
+static size_t const MERGED_APPLY_BATCH_SIZE = 0x1000;
+
 ApplyBucketsWork::ApplyBucketsWork(
     Application& app, WorkParent& parent,
     std::map<std::string, std::shared_ptr<Bucket>> const& buckets,
@@ -35,6 +44,10 @@ ApplyBucketsWork::ApplyBucketsWork(
     , mApplyState(applyState)
     , mApplying(false)
     , mLevel(BucketList::kNumLevels - 1)
+    , mMergedApply(app.getConfig().MERGED_BUCKET_APPLY)
+    , mMerging(false)
+    , mGeneration(0)
+    , mMergedOldestLedger(0)
     , mBucketApplyStart(app.getMetrics().NewMeter(
           {"history", "bucket-apply", "start"}, "event"))
     , mBucketApplySuccess(app.getMetrics().NewMeter(
@@ -75,11 +88,187 @@ ApplyBucketsWork::onReset()
     mCurrBucket.reset();
     mSnapApplicator.reset();
     mCurrApplicator.reset();
+
+    ++mGeneration;
+    mMerging = false;
+    mMergeError.clear();
+    mMergedBucket.reset();
+    mMergedApplicator.reset();
+}
+
+void
+ApplyBucketsWork::deleteEntriesModifiedOnOrAfterLedger(uint32_t oldestLedger)
+{
+    AccountFrame::deleteAccountsModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                        oldestLedger);
+    TrustFrame::deleteTrustLinesModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                        oldestLedger);
+    OfferFrame::deleteOffersModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                    oldestLedger);
+    DataFrame::deleteDataModifiedOnOrAfterLedger(mApp.getDatabase(),
+                                                 oldestLedger);
+}
+
+void
+ApplyBucketsWork::startMerge()
+{
+    // Same buckets as applied level by level: from the deepest level that
+    // differs from our bucket list, everything up to level 0.
+    std::vector<std::shared_ptr<Bucket const>> buckets;
+    uint32_t oldestLedger = 0;
+    for (uint32_t i = BucketList::kNumLevels; i-- > 0;)
+    {
+        auto& level = getBucketLevel(i);
+        HistoryStateBucket const& hsb = mApplyState.currentBuckets.at(i);
+
+        bool applying = !buckets.empty();
+        bool applySnap =
+            applying || (hsb.snap != binToHex(level.getSnap()->getHash()));
+        bool applyCurr = applying || applySnap ||
+                         (hsb.curr != binToHex(level.getCurr()->getHash()));
+        if (!applying && applyCurr)
+        {
+            oldestLedger =
+                applySnap
+                    ? BucketList::oldestLedgerInSnap(mApplyState.currentLedger,
+                                                     i)
+                    : BucketList::oldestLedgerInCurr(mApplyState.currentLedger,
+                                                     i);
+        }
+        if (applySnap)
+        {
+            buckets.push_back(getBucket(hsb.snap));
+        }
+        if (applyCurr)
+        {
+            buckets.push_back(getBucket(hsb.curr));
+        }
+    }
+    if (buckets.empty())
+    {
+        return;
+    }
+
+    deleteEntriesModifiedOnOrAfterLedger(oldestLedger);
+    mMergedOldestLedger = oldestLedger;
+    mBucketApplyStart.Mark();
+
+    // newest first
+    std::reverse(buckets.begin(), buckets.end());
+    // Starting from the first ledger, the database is now empty: nothing to
+    // delete, nothing to update.
+    bool insertOnly = oldestLedger <= 1;
+    CLOG(INFO, "History") << "ApplyBuckets : merging " << buckets.size()
+                          << " buckets, from ledger " << oldestLedger;
+
+    std::weak_ptr<ApplyBucketsWork> weak(
+        std::static_pointer_cast<ApplyBucketsWork>(shared_from_this()));
+    auto generation = mGeneration;
+    auto& bucketManager = mApp.getBucketManager();
+    asio::io_service& mainIO = mApp.getClock().getIOService();
+    mMerging = true;
+    mApp.getWorkerIOService().post([weak, generation, buckets, insertOnly,
+                                    &bucketManager, &mainIO]() {
+        std::shared_ptr<Bucket const> merged;
+        std::string error;
+        try
+        {
+            merged = Bucket::mergeAll(bucketManager, buckets, !insertOnly);
+        }
+        catch (std::exception const& e)
+        {
+            error = e.what();
+        }
+        mainIO.post([weak, generation, merged, insertOnly, error]() {
+            auto self = weak.lock();
+            if (self)
+            {
+                self->mergeDone(generation, merged, insertOnly, error);
+            }
+        });
+    });
+}
+
+void
+ApplyBucketsWork::mergeDone(uint32_t generation,
+                            std::shared_ptr<Bucket const> merged,
+                            bool insertOnly, std::string const& error)
+{
+    if (generation != mGeneration)
+    {
+        return;
+    }
+    mMerging = false;
+    if (error.empty())
+    {
+        CLOG(DEBUG, "History") << "ApplyBuckets : applying merged bucket "
+                               << binToHex(merged->getHash());
+        mMergedBucket = merged;
+        mMergedApplicator = make_unique<BucketApplicator>(
+            mApp.getDatabase(), mMergedBucket, MERGED_APPLY_BATCH_SIZE,
+            insertOnly);
+    }
+    else
+    {
+        CLOG(ERROR, "History") << "ApplyBuckets : merge failed: " << error;
+        mMergeError = error;
+    }
+    if (mState == WORK_RUNNING)
+    {
+        scheduleRun();
+    }
+}
+
+void
+ApplyBucketsWork::runMerged()
+{
+    if (mMerging)
+    {
+        // mergeDone resumes us
+        return;
+    }
+    if (!mMergeError.empty())
+    {
+        scheduleFailure();
+        return;
+    }
+    if (mMergedApplicator && *mMergedApplicator)
+    {
+        mMergedApplicator->advance();
+    }
+    scheduleSuccess();
+}
+
+Work::State
+ApplyBucketsWork::mergedSuccess()
+{
+    if (mMergedApplicator)
+    {
+        if (*mMergedApplicator)
+        {
+            return WORK_RUNNING;
+        }
+        mApp.getInvariantManager().checkOnMergedBucketApply(
+            mMergedBucket, mApplyState.currentLedger, mMergedOldestLedger);
+        mMergedApplicator.reset();
+        mMergedBucket.reset();
+        mBucketApplySuccess.Mark();
+    }
+
+    CLOG(DEBUG, "History") << "ApplyBuckets : done, restarting merges";
+    mApp.getBucketManager().assumeState(mApplyState);
+    return WORK_SUCCESS;
 }
 
 void
 ApplyBucketsWork::onStart()
 {
+    if (mMergedApply)
+    {
+        startMerge();
+        return;
+    }
+
     auto& level = getBucketLevel(mLevel);
     HistoryStateBucket const& i = mApplyState.currentBuckets.at(mLevel);
 
@@ -92,14 +281,7 @@ ApplyBucketsWork::onStart()
                                           mApplyState.currentLedger, mLevel)
                                     : BucketList::oldestLedgerInCurr(
                                           mApplyState.currentLedger, mLevel);
-        AccountFrame::deleteAccountsModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                            oldestLedger);
-        TrustFrame::deleteTrustLinesModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                            oldestLedger);
-        OfferFrame::deleteOffersModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                        oldestLedger);
-        DataFrame::deleteDataModifiedOnOrAfterLedger(mApp.getDatabase(),
-                                                     oldestLedger);
+        deleteEntriesModifiedOnOrAfterLedger(oldestLedger);
     }
 
     if (mApplying || applySnap)
@@ -127,6 +309,12 @@ ApplyBucketsWork::onStart()
 void
 ApplyBucketsWork::onRun()
 {
+    if (mMergedApply)
+    {
+        runMerged();
+        return;
+    }
+
     // The structure of these if statements is motivated by the following:
     // 1. mCurrApplicator should never be advanced if mSnapApplicator is
     //    not false. Otherwise it is possible for curr to modify the
@@ -155,6 +343,11 @@ ApplyBucketsWork::onSuccess()
 {
     mApp.getCatchupManager().logAndUpdateCatchupStatus(true);
 
+    if (mMergedApply)
+    {
+        return mergedSuccess();
+    }
+
     if (mSnapApplicator)
     {
         if (*mSnapApplicator)
@@ -33,12 +33,28 @@ class ApplyBucketsWork : public Work
     std::unique_ptr<BucketApplicator> mSnapApplicator;
     std::unique_ptr<BucketApplicator> mCurrApplicator;
 
+    // MERGED_BUCKET_APPLY: all the buckets to apply are merged into one on a
+    // worker thread, which is then applied in one go
+    bool const mMergedApply;
+    bool mMerging;
+    uint32_t mGeneration;
+    uint32_t mMergedOldestLedger;
+    std::string mMergeError;
+    std::shared_ptr<Bucket const> mMergedBucket;
+    std::unique_ptr<BucketApplicator> mMergedApplicator;
+
     medida::Meter& mBucketApplyStart;
     medida::Meter& mBucketApplySuccess;
     medida::Meter& mBucketApplyFailure;
 
     std::shared_ptr<Bucket const> getBucket(std::string const& bucketHash);
     BucketLevel& getBucketLevel(uint32_t level);
+    void deleteEntriesModifiedOnOrAfterLedger(uint32_t oldestLedger);
+    void startMerge();
+    void mergeDone(uint32_t generation, std::shared_ptr<Bucket const> merged,
+                   bool insertOnly, std::string const& error);
+    void runMerged();
+    Work::State mergedSuccess();
 
   public:
     ApplyBucketsWork(
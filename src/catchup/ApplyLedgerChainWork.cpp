@@ -3,6 +3,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "catchup/ApplyLedgerChainWork.h"
+#include "crypto/SecretKey.h"
 #include "herder/LedgerCloseData.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryManager.h"
@@ -11,13 +12,57 @@
 #include "ledger/LedgerManager.h"
 #include "lib/xdrpp/xdrpp/printer.h"
 #include "main/Application.h"
+#include "transactions/SignatureUtils.h"
 #include "util/format.h"
 #include <medida/meter.h>
 #include <medida/metrics_registry.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace stellar
 {
 
+// Checks ahead of time the signatures of @p tx that can be attributed without
+// looking at the ledger: the ones made by the source accounts of the
+// transaction and of its operations. Results end up in the signature
+// verification cache, where SignatureChecker finds them when the transaction
+// is applied. Other signatures (additional signers) are left to the apply
+// step, as well as the ones past @p maxSignatures. Returns the number of
+// signatures checked.
+static size_t
+prevalidateSignatures(TransactionFrame const& tx, size_t maxSignatures)
+{
+    auto const& env = tx.getEnvelope();
+    std::vector<PublicKey const*> keys{&env.tx.sourceAccount};
+    for (auto const& op : env.tx.operations)
+    {
+        if (op.sourceAccount)
+        {
+            keys.push_back(op.sourceAccount.get());
+        }
+    }
+
+    size_t checked = 0;
+    auto const& contentsHash = tx.getContentsHash();
+    for (auto const& sig : env.signatures)
+    {
+        for (auto key : keys)
+        {
+            if (checked == maxSignatures)
+            {
+                return checked;
+            }
+            if (SignatureUtils::doesHintMatch(key->ed25519(), sig.hint))
+            {
+                PubKeyUtils::verifySig(*key, sig.signature, contentsHash);
+                checked++;
+            }
+        }
+    }
+    return checked;
+}
+
 ApplyLedgerChainWork::ApplyLedgerChainWork(
     Application& app, WorkParent& parent, TmpDir const& downloadDir,
     LedgerRange range, LedgerHeaderHistoryEntry& lastApplied)
@@ -26,6 +71,8 @@ ApplyLedgerChainWork::ApplyLedgerChainWork(
     , mRange(range)
     , mCurrSeq(
           mApp.getHistoryManager().checkpointContainingLedger(mRange.first()))
+    , mNextToPrepare(mCurrSeq)
+    , mGeneration(0)
     , mLastApplied(lastApplied)
     , mApplyLedgerStart(app.getMetrics().NewMeter(
           {"history", "apply-ledger", "start"}, "event"))
@@ -76,23 +123,108 @@ ApplyLedgerChainWork::onReset()
     mCurrSeq =
         mApp.getHistoryManager().checkpointContainingLedger(mRange.first());
     mHdrIn.close();
-    mTxIn.close();
+    mCurrTxSets.reset();
+    mNextToPrepare = mCurrSeq;
+    mGeneration++;
+    mPreparedCheckpoints.clear();
 }
 
 void
 ApplyLedgerChainWork::openCurrentInputFiles()
 {
     mHdrIn.close();
-    mTxIn.close();
     FileTransferInfo hi(mDownloadDir, HISTORY_FILE_TYPE_LEDGER, mCurrSeq);
-    FileTransferInfo ti(mDownloadDir, HISTORY_FILE_TYPE_TRANSACTIONS, mCurrSeq);
     CLOG(DEBUG, "History") << "Replaying ledger headers from "
                            << hi.localPath_nogz();
-    CLOG(DEBUG, "History") << "Replaying transactions from "
-                           << ti.localPath_nogz();
     mHdrIn.open(hi.localPath_nogz());
-    mTxIn.open(ti.localPath_nogz());
-    mTxHistoryEntry = TransactionHistoryEntry();
+}
+
+void
+ApplyLedgerChainWork::prepareCheckpoints()
+{
+    auto& hm = mApp.getHistoryManager();
+    auto const freq = hm.getCheckpointFrequency();
+    auto const lastCheckpoint = hm.checkpointContainingLedger(mRange.last());
+    // prepared transaction sets are held in memory and their signatures must
+    // still be in the verification cache when they get applied, so only a
+    // few checkpoints are read ahead
+    auto const window =
+        std::min(8u, std::max(2u, std::thread::hardware_concurrency()));
+    // the checkpoints of the window (including the one being applied) may
+    // not check more signatures than half of the cache holds, leaving room
+    // for the rest of the node; checking more would evict the first results
+    // before they get used
+    size_t const maxSignatures =
+        PubKeyUtils::VERIFY_SIG_CACHE_SIZE / 2 / window;
+
+    std::weak_ptr<ApplyLedgerChainWork> weak(
+        std::static_pointer_cast<ApplyLedgerChainWork>(shared_from_this()));
+    auto generation = mGeneration;
+    auto networkID = mApp.getNetworkID();
+    asio::io_service& mainIO = mApp.getClock().getIOService();
+
+    while (mNextToPrepare <= lastCheckpoint &&
+           mNextToPrepare < mCurrSeq + window * freq)
+    {
+        auto checkpoint = mNextToPrepare;
+        FileTransferInfo ti(mDownloadDir, HISTORY_FILE_TYPE_TRANSACTIONS,
+                            checkpoint);
+        auto filename = ti.localPath_nogz();
+        CLOG(DEBUG, "History") << "Replaying transactions from " << filename;
+        mApp.getWorkerIOService().post([weak, generation, checkpoint,
+                                        filename, networkID, maxSignatures,
+                                        &mainIO]() {
+            auto prepared = std::make_shared<PreparedCheckpoint>();
+            try
+            {
+                XDRInputFileStream txIn;
+                txIn.open(filename);
+                TransactionHistoryEntry entry;
+                size_t checked = 0;
+                while (txIn && txIn.readOne(entry))
+                {
+                    auto txSet =
+                        std::make_shared<TxSetFrame>(networkID, entry.txSet);
+                    txSet->getContentsHash();
+                    for (auto const& tx : txSet->mTransactions)
+                    {
+                        checked += prevalidateSignatures(
+                            *tx, maxSignatures - checked);
+                    }
+                    prepared->mTxSets.emplace(entry.ledgerSeq, txSet);
+                }
+            }
+            catch (std::exception const& e)
+            {
+                prepared->mError = e.what();
+            }
+            mainIO.post([weak, generation, checkpoint, prepared]() {
+                auto self = weak.lock();
+                if (self)
+                {
+                    self->checkpointPrepared(generation, checkpoint,
+                                             prepared);
+                }
+            });
+        });
+        mNextToPrepare += freq;
+    }
+}
+
+void
+ApplyLedgerChainWork::checkpointPrepared(
+    uint32_t generation, uint32_t checkpoint,
+    std::shared_ptr<PreparedCheckpoint> prepared)
+{
+    if (generation != mGeneration)
+    {
+        return;
+    }
+    mPreparedCheckpoints[checkpoint] = prepared;
+    if (checkpoint == mCurrSeq && !mCurrTxSets && mState == WORK_RUNNING)
+    {
+        scheduleRun();
+    }
 }
 
 TxSetFramePtr
@@ -101,25 +233,15 @@ ApplyLedgerChainWork::getCurrentTxSet()
     auto& lm = mApp.getLedgerManager();
     auto seq = lm.getCurrentLedgerHeader().ledgerSeq;
 
-    do
+    auto it = mCurrTxSets->mTxSets.find(seq);
+    if (it != mCurrTxSets->mTxSets.end())
     {
-        if (mTxHistoryEntry.ledgerSeq < seq)
-        {
-            CLOG(DEBUG, "History")
-                << "Skipping txset for ledger " << mTxHistoryEntry.ledgerSeq;
-        }
-        else if (mTxHistoryEntry.ledgerSeq > seq)
-        {
-            break;
-        }
-        else
-        {
-            assert(mTxHistoryEntry.ledgerSeq == seq);
-            CLOG(DEBUG, "History") << "Loaded txset for ledger " << seq;
-            return std::make_shared<TxSetFrame>(mApp.getNetworkID(),
-                                                mTxHistoryEntry.txSet);
-        }
-    } while (mTxIn && mTxIn.readOne(mTxHistoryEntry));
+        CLOG(DEBUG, "History") << "Loaded txset for ledger " << seq;
+        auto txSet = it->second;
+        mCurrTxSets->mTxSets.erase(mCurrTxSets->mTxSets.begin(),
+                                   std::next(it));
+        return txSet;
+    }
 
     CLOG(DEBUG, "History") << "Using empty txset for ledger " << seq;
     return std::make_shared<TxSetFrame>(lm.getLastClosedLedgerHeader().hash);
@@ -257,9 +379,28 @@ ApplyLedgerChainWork::onRun()
 {
     try
     {
+        prepareCheckpoints();
+        if (!mCurrTxSets)
+        {
+            auto it = mPreparedCheckpoints.find(mCurrSeq);
+            if (it == mPreparedCheckpoints.end())
+            {
+                // checkpointPrepared resumes us once the workers are done
+                // with mCurrSeq
+                return;
+            }
+            mCurrTxSets = it->second;
+            mPreparedCheckpoints.erase(it);
+            if (!mCurrTxSets->mError.empty())
+            {
+                throw std::runtime_error(mCurrTxSets->mError);
+            }
+        }
+
         if (!applyHistoryOfSingleLedger())
         {
             mCurrSeq += mApp.getHistoryManager().getCheckpointFrequency();
+            mCurrTxSets.reset();
             openCurrentInputFiles();
         }
         scheduleSuccess();
@@ -10,6 +10,8 @@
 #include "work/Work.h"
 #include "xdr/Stellar-SCP.h"
 #include "xdr/Stellar-ledger.h"
+#include <map>
+#include <memory>
 
 namespace medida
 {
@@ -36,6 +38,12 @@ struct LedgerHeaderHistoryEntry;
  * an apply ledger operation is performed. Then another check is made - if new
  * local ledger matches corresponding ledger from file.
  *
+ * Transaction files are read ahead of the apply loop: for a bounded window of
+ * upcoming checkpoints, worker threads decode the transaction sets, compute
+ * their hashes and check the signatures of their transactions (filling the
+ * signature verification cache), so that applying a ledger on the main thread
+ * only has to perform the state transitions.
+ *
  * Contructor of this class takes some important parameters:
  * * downloadDir - directory containing ledger and transaction files
  * * range - range of ledgers to apply (low boundary can overlap with local
@@ -44,12 +52,25 @@ struct LedgerHeaderHistoryEntry;
  */
 class ApplyLedgerChainWork : public Work
 {
+    // transaction sets of a checkpoint file, indexed by ledger sequence
+    struct PreparedCheckpoint
+    {
+        std::map<uint32_t, TxSetFramePtr> mTxSets;
+        std::string mError;
+    };
+
     TmpDir const& mDownloadDir;
     LedgerRange mRange;
     uint32_t mCurrSeq;
     XDRInputFileStream mHdrIn;
-    XDRInputFileStream mTxIn;
-    TransactionHistoryEntry mTxHistoryEntry;
+    // transaction sets of mCurrSeq checkpoint, null until they are prepared
+    std::shared_ptr<PreparedCheckpoint> mCurrTxSets;
+    // next checkpoint to send to the worker threads
+    uint32_t mNextToPrepare;
+    // bumped on reset, so that results of a previous run get ignored
+    uint32_t mGeneration;
+    std::map<uint32_t, std::shared_ptr<PreparedCheckpoint>>
+        mPreparedCheckpoints;
     LedgerHeaderHistoryEntry& mLastApplied;
 
     medida::Meter& mApplyLedgerStart;
@@ -63,6 +84,9 @@ class ApplyLedgerChainWork : public Work
 
     TxSetFramePtr getCurrentTxSet();
     void openCurrentInputFiles();
+    void prepareCheckpoints();
+    void checkpointPrepared(uint32_t generation, uint32_t checkpoint,
+                            std::shared_ptr<PreparedCheckpoint> prepared);
     bool applyHistoryOfSingleLedger();
 
   public:
@@ -35,6 +35,8 @@ CatchupWork::CatchupWork(Application& app, WorkParent& parent,
     , mManualCatchup{manualCatchup}
     , mProgressHandler{progressHandler}
 {
+    // catching up can take a while, don't get in the way of consensus
+    setPriority(WORK_PRIORITY_LOW);
 }
 
 CatchupWork::~CatchupWork()
@@ -54,11 +54,14 @@ DownloadBucketsWork::onReset()
     {
         FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
         // Each bucket gets its own work-chain of
-        // download->gunzip->verify
+        // download->(gunzip+verify), the bucket being decompressed and
+        // hashed in a single pass
 
         auto verify = addWork<VerifyBucketWork>(mBuckets, ft.localPath_nogz(),
-                                                hexToBin256(hash));
-        verify->addWork<GetAndUnzipRemoteFileWork>(ft);
+                                                hexToBin256(hash),
+                                                ft.localPath_gz());
+        verify->addWork<GetAndUnzipRemoteFileWork>(ft, nullptr, RETRY_A_LOT,
+                                                   false);
         mDownloadBucketStart.Mark();
     }
 }
@@ -12,14 +12,16 @@
 #include <medida/meter.h>
 #include <medida/metrics_registry.h>
 
+#include <algorithm>
+#include <thread>
+
 namespace stellar
 {
 
 static HistoryManager::VerifyHashStatus
-verifyLedgerHistoryEntry(LedgerHeaderHistoryEntry const& hhe)
+verifyLedgerHistoryEntry(LedgerHeaderHistoryEntry const& hhe,
+                         Hash const& calculated)
 {
-    LedgerHeaderFrame lFrame(hhe.header);
-    Hash calculated = lFrame.getHash();
     if (calculated != hhe.hash)
     {
         CLOG(ERROR, "History")
@@ -32,9 +34,11 @@ verifyLedgerHistoryEntry(LedgerHeaderHistoryEntry const& hhe)
 }
 
 static HistoryManager::VerifyHashStatus
-verifyLedgerHistoryLink(Hash const& prev, LedgerHeaderHistoryEntry const& curr)
+verifyLedgerHistoryLink(Hash const& prev, LedgerHeaderHistoryEntry const& curr,
+                        Hash const& calculated)
 {
-    if (verifyLedgerHistoryEntry(curr) != HistoryManager::VERIFY_HASH_OK)
+    if (verifyLedgerHistoryEntry(curr, calculated) !=
+        HistoryManager::VERIFY_HASH_OK)
     {
         return HistoryManager::VERIFY_HASH_BAD;
     }
@@ -59,6 +63,8 @@ VerifyLedgerChainWork::VerifyLedgerChainWork(
     , mRange(range)
     , mCurrCheckpoint(
           mApp.getHistoryManager().checkpointContainingLedger(mRange.first()))
+    , mNextToHash(mCurrCheckpoint)
+    , mGeneration(0)
     , mManualCatchup(manualCatchup)
     , mFirstVerified(firstVerified)
     , mLastVerified(lastVerified)
@@ -114,15 +120,102 @@ VerifyLedgerChainWork::onReset()
     }
     mCurrCheckpoint =
         mApp.getHistoryManager().checkpointContainingLedger(mRange.first());
+    mNextToHash = mCurrCheckpoint;
+    mGeneration++;
+    mHashedCheckpoints.clear();
+}
+
+void
+VerifyLedgerChainWork::hashCheckpoints()
+{
+    auto& hm = mApp.getHistoryManager();
+    auto const freq = hm.getCheckpointFrequency();
+    auto const lastCheckpoint = hm.checkpointContainingLedger(mRange.last());
+    // enough checkpoints in flight to keep all the workers busy, while
+    // bounding the number of decoded headers held in memory
+    auto const window = std::max(4u, 2 * std::thread::hardware_concurrency());
+
+    std::weak_ptr<VerifyLedgerChainWork> weak(
+        std::static_pointer_cast<VerifyLedgerChainWork>(shared_from_this()));
+    auto generation = mGeneration;
+    asio::io_service& mainIO = mApp.getClock().getIOService();
+
+    while (mNextToHash <= lastCheckpoint &&
+           mNextToHash < mCurrCheckpoint + window * freq)
+    {
+        auto checkpoint = mNextToHash;
+        FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_LEDGER,
+                            checkpoint);
+        auto filename = ft.localPath_nogz();
+        mApp.getWorkerIOService().post([weak, generation, checkpoint,
+                                        filename, &mainIO]() {
+            auto hashed = std::make_shared<HashedCheckpoint>();
+            try
+            {
+                XDRInputFileStream hdrIn;
+                hdrIn.open(filename);
+                LedgerHeaderHistoryEntry curr;
+                while (hdrIn && hdrIn.readOne(curr))
+                {
+                    hashed->mHashes.emplace_back(
+                        LedgerHeaderFrame(curr.header).getHash());
+                    hashed->mEntries.emplace_back(curr);
+                }
+            }
+            catch (std::exception const& e)
+            {
+                hashed->mError = e.what();
+            }
+            mainIO.post([weak, generation, checkpoint, hashed]() {
+                auto self = weak.lock();
+                if (self)
+                {
+                    self->checkpointHashed(generation, checkpoint, hashed);
+                }
+            });
+        });
+        mNextToHash += freq;
+    }
+}
+
+void
+VerifyLedgerChainWork::checkpointHashed(
+    uint32_t generation, uint32_t checkpoint,
+    std::shared_ptr<HashedCheckpoint> hashed)
+{
+    if (generation != mGeneration)
+    {
+        return;
+    }
+    mHashedCheckpoints[checkpoint] = hashed;
+    if (checkpoint == mCurrCheckpoint && mState == WORK_RUNNING)
+    {
+        scheduleSuccess();
+    }
+}
+
+void
+VerifyLedgerChainWork::onRun()
+{
+    hashCheckpoints();
+    if (mHashedCheckpoints.find(mCurrCheckpoint) != mHashedCheckpoints.end())
+    {
+        scheduleSuccess();
+    }
+    // otherwise checkpointHashed resumes us once the workers are done with
+    // mCurrCheckpoint
 }
 
 HistoryManager::VerifyHashStatus
-VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
+VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint(
+    HashedCheckpoint const& hashed)
 {
     FileTransferInfo ft(mDownloadDir, HISTORY_FILE_TYPE_LEDGER,
                         mCurrCheckpoint);
-    XDRInputFileStream hdrIn;
-    hdrIn.open(ft.localPath_nogz());
+    if (!hashed.mError.empty())
+    {
+        throw std::runtime_error(hashed.mError);
+    }
 
     LedgerHeaderHistoryEntry prev = mLastVerified;
     LedgerHeaderHistoryEntry curr;
@@ -131,8 +224,9 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
                            << ft.localPath_nogz() << " starting from ledger "
                            << LedgerManager::ledgerAbbrev(prev);
 
-    while (hdrIn && hdrIn.readOne(curr))
+    for (size_t i = 0; i < hashed.mEntries.size(); i++)
     {
+        curr = hashed.mEntries[i];
         if (prev.header.ledgerSeq == 0)
         {
             // When we have no previous state to connect up with
@@ -160,7 +254,7 @@ VerifyLedgerChainWork::verifyHistoryOfSingleCheckpoint()
             mVerifyLedgerFailureOvershot.Mark();
             return HistoryManager::VERIFY_HASH_BAD;
         }
-        if (verifyLedgerHistoryLink(prev.hash, curr) !=
+        if (verifyLedgerHistoryLink(prev.hash, curr, hashed.mHashes[i]) !=
             HistoryManager::VERIFY_HASH_OK)
         {
             mVerifyLedgerFailureLink.Mark();
@@ -226,8 +320,13 @@ VerifyLedgerChainWork::onSuccess()
         throw std::runtime_error("Verification overshot target ledger");
     }
 
+    auto it = mHashedCheckpoints.find(mCurrCheckpoint);
+    assert(it != mHashedCheckpoints.end());
+    auto hashed = it->second;
+    mHashedCheckpoints.erase(it);
+
     // This is in onSuccess rather than onRun, so we can force a FAILURE_RAISE.
-    switch (verifyHistoryOfSingleCheckpoint())
+    switch (verifyHistoryOfSingleCheckpoint(*hashed))
     {
     case HistoryManager::VERIFY_HASH_OK:
         if (mLastVerified.header.ledgerSeq == mRange.last())
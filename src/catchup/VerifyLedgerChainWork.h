@@ -7,6 +7,9 @@
 #include "history/HistoryManager.h"
 #include "ledger/LedgerRange.h"
 #include "work/Work.h"
+#include <map>
+#include <memory>
+#include <vector>
 
 namespace medida
 {
@@ -19,11 +22,33 @@ namespace stellar
 class TmpDir;
 struct LedgerHeaderHistoryEntry;
 
+/**
+ * Verifies the chain of downloaded ledger headers, checkpoint by checkpoint.
+ *
+ * Decoding the checkpoint files and hashing every header (the expensive part)
+ * is done ahead of time on the worker threads, for a bounded window of
+ * checkpoints. The main thread then walks the checkpoints in order, checking
+ * the links between headers against the precomputed hashes.
+ */
 class VerifyLedgerChainWork : public Work
 {
+    // decoded content of a checkpoint file, with the actual hash of each
+    // header
+    struct HashedCheckpoint
+    {
+        std::vector<LedgerHeaderHistoryEntry> mEntries;
+        std::vector<Hash> mHashes;
+        std::string mError;
+    };
+
     TmpDir const& mDownloadDir;
     LedgerRange mRange;
     uint32_t mCurrCheckpoint;
+    // next checkpoint to send to the worker threads
+    uint32_t mNextToHash;
+    // bumped on reset, so that results of a previous run get ignored
+    uint32_t mGeneration;
+    std::map<uint32_t, std::shared_ptr<HashedCheckpoint>> mHashedCheckpoints;
     bool mManualCatchup;
     LedgerHeaderHistoryEntry& mFirstVerified;
     LedgerHeaderHistoryEntry& mLastVerified;
@@ -36,7 +61,11 @@ class VerifyLedgerChainWork : public Work
     medida::Meter& mVerifyLedgerChainFailure;
     medida::Meter& mVerifyLedgerChainFailureEnd;
 
-    HistoryManager::VerifyHashStatus verifyHistoryOfSingleCheckpoint();
+    HistoryManager::VerifyHashStatus
+    verifyHistoryOfSingleCheckpoint(HashedCheckpoint const& hashed);
+    void hashCheckpoints();
+    void checkpointHashed(uint32_t generation, uint32_t checkpoint,
+                          std::shared_ptr<HashedCheckpoint> hashed);
 
   public:
     VerifyLedgerChainWork(Application& app, WorkParent& parent,
@@ -47,6 +76,7 @@ class VerifyLedgerChainWork : public Work
     ~VerifyLedgerChainWork();
     std::string getStatus() const override;
     void onReset() override;
+    void onRun() override;
     Work::State onSuccess() override;
 };
 }
@@ -325,6 +325,28 @@ TEST_CASE("StrKey tests", "[crypto]")
     REQUIRE(detectionRate > 98.0);
 }
 
+TEST_CASE("StrKey cache", "[crypto]")
+{
+    for (int i = 0; i < 100; ++i)
+    {
+        auto pk = SecretKey::random().getPublicKey();
+        auto s = KeyUtils::toStrKey(pk);
+        for (int j = 0; j < 2; ++j)
+        {
+            REQUIRE(KeyUtils::toStrKeyCached(pk) == s);
+            REQUIRE(KeyUtils::fromStrKeyCached(s) == pk);
+        }
+    }
+
+    auto s = KeyUtils::toStrKey(SecretKey::random().getPublicKey());
+    s[5] = s[5] == 'A' ? 'B' : 'A';
+    for (int j = 0; j < 2; ++j)
+    {
+        REQUIRE_THROWS_AS(KeyUtils::fromStrKeyCached(s),
+                          std::invalid_argument);
+    }
+}
+
 TEST_CASE("base64 tests", "[crypto]")
 {
     autocheck::generator<std::vector<uint8_t>> input;
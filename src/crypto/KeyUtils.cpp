@@ -4,11 +4,25 @@
 
 #include "KeyUtils.h"
 
+#include "crypto/SecretKey.h"
 #include "crypto/StrKey.h"
+#include "util/lrucache.hpp"
+
+#include <mutex>
 
 namespace stellar
 {
 
+namespace
+{
+// enough for the accounts touched by a few ledgers
+size_t const STRKEY_CACHE_SIZE = 0x4000;
+
+std::mutex gStrKeyCacheMutex;
+cache::lru_cache<PublicKey, std::string> gToStrKeyCache(STRKEY_CACHE_SIZE);
+cache::lru_cache<std::string, PublicKey> gFromStrKeyCache(STRKEY_CACHE_SIZE);
+}
+
 size_t
 KeyUtils::getKeyVersionSize(strKey::StrKeyVersionByte keyVersion)
 {
@@ -25,4 +39,37 @@ KeyUtils::getKeyVersionSize(strKey::StrKeyVersionByte keyVersion)
                                     std::to_string(keyVersion));
     }
 }
+
+std::string
+KeyUtils::toStrKeyCached(PublicKey const& key)
+{
+    {
+        std::lock_guard<std::mutex> lock(gStrKeyCacheMutex);
+        if (gToStrKeyCache.exists(key))
+        {
+            return gToStrKeyCache.get(key);
+        }
+    }
+    auto s = toStrKey(key);
+    std::lock_guard<std::mutex> lock(gStrKeyCacheMutex);
+    gToStrKeyCache.put(key, s);
+    return s;
+}
+
+PublicKey
+KeyUtils::fromStrKeyCached(std::string const& s)
+{
+    {
+        std::lock_guard<std::mutex> lock(gStrKeyCacheMutex);
+        if (gFromStrKeyCache.exists(s))
+        {
+            return gFromStrKeyCache.get(s);
+        }
+    }
+    // raises on invalid keys, which are not cached
+    auto key = fromStrKey<PublicKey>(s);
+    std::lock_guard<std::mutex> lock(gStrKeyCacheMutex);
+    gFromStrKeyCache.put(s, key);
+    return key;
+}
 }
@@ -96,6 +96,12 @@ fromStrKey(std::string const& s)
     return key;
 }
 
+// Same as toStrKey and fromStrKey<PublicKey>, but remembering the most
+// recently converted keys: the SQL code of the ledger converts the same
+// account IDs over and over. Thread safe.
+std::string toStrKeyCached(PublicKey const& key);
+PublicKey fromStrKeyCached(std::string const& s);
+
 template <typename T, typename F>
 bool
 canConvert(F const& fromKey)
@@ -28,8 +28,8 @@ namespace stellar
 // has no effect on correctness.
 
 static std::mutex gVerifySigCacheMutex;
-static cache::lru_cache<Hash, bool> gVerifySigCache(0xffff);
-static std::unique_ptr<SHA256> gHasher = SHA256::create();
+static cache::lru_cache<Hash, bool> gVerifySigCache(
+    PubKeyUtils::VERIFY_SIG_CACHE_SIZE);
 static uint64_t gVerifyCacheHit = 0;
 static uint64_t gVerifyCacheMiss = 0;
 
@@ -39,11 +39,13 @@ verifySigCacheKey(PublicKey const& key, Signature const& signature,
 {
     assert(key.type() == PUBLIC_KEY_TYPE_ED25519);
 
-    gHasher->reset();
-    gHasher->add(key.ed25519());
-    gHasher->add(signature);
-    gHasher->add(bin);
-    return gHasher->finish();
+    // signatures may be checked from worker threads (see EnvelopeIngress), so
+    // don't share a hasher
+    auto hasher = SHA256::create();
+    hasher->add(key.ed25519());
+    hasher->add(signature);
+    hasher->add(bin);
+    return hasher->finish();
 }
 
 SecretKey::SecretKey() : mKeyType(PUBLIC_KEY_TYPE_ED25519)
@@ -300,11 +302,11 @@ PubKeyUtils::verifySig(PublicKey const& key, Signature const& signature,
         }
     }
 
-    ++gVerifyCacheMiss;
     bool ok =
         (crypto_sign_verify_detached(signature.data(), bin.data(), bin.size(),
                                      key.ed25519().data()) == 0);
     std::lock_guard<std::mutex> guard(gVerifySigCacheMutex);
+    ++gVerifyCacheMiss;
     gVerifySigCache.put(cacheKey, ok);
     return ok;
 }
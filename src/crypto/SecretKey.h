@@ -101,6 +101,9 @@ namespace PubKeyUtils
 bool verifySig(PublicKey const& key, Signature const& signature,
                ByteSlice const& bin);
 
+// Number of results kept by the cache of verifySig.
+size_t const VERIFY_SIG_CACHE_SIZE = 0xffff;
+
 void clearVerifySigCache();
 void flushVerifySigCacheCounts(uint64_t& hits, uint64_t& misses);
 
@@ -18,6 +18,7 @@
 #include "herder/HerderPersistence.h"
 #include "ledger/AccountFrame.h"
 #include "ledger/DataFrame.h"
+#include "ledger/KeyValueLedgerStore.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/OfferFrame.h"
 #include "ledger/TrustFrame.h"
@@ -28,8 +29,10 @@
 #include "transactions/TransactionFrame.h"
 
 #include "medida/counter.h"
+#include "medida/meter.h"
 #include "medida/metrics_registry.h"
 #include "medida/timer.h"
+#include "soci-sqlite3.h"
 
 #include <sstream>
 #include <stdexcept>
@@ -53,7 +56,7 @@ using namespace std;
 
 bool Database::gDriversRegistered = false;
 
-static unsigned long const SCHEMA_VERSION = 5;
+static unsigned long const SCHEMA_VERSION = 8;
 
 static void
 setSerializable(soci::session& sess)
@@ -81,6 +84,10 @@ Database::Database(Application& app)
           app.getMetrics().NewMeter({"database", "query", "exec"}, "query"))
     , mStatementsSize(
           app.getMetrics().NewCounter({"database", "memory", "statements"}))
+    , mStatementsPrepared(app.getMetrics().NewMeter(
+          {"database", "statement", "prepare"}, "statement"))
+    , mStatementsReused(app.getMetrics().NewMeter(
+          {"database", "statement", "reuse"}, "statement"))
     , mEntryCache(4096)
     , mExcludedQueryTime(0)
     , mExcludedTotalTime(0)
@@ -106,6 +113,10 @@ Database::Database(Application& app)
     }
 }
 
+Database::~Database()
+{
+}
+
 void
 Database::applySchemaUpgrade(unsigned long vers)
 {
@@ -141,6 +152,25 @@ Database::applySchemaUpgrade(unsigned long vers)
         }
         break;
 
+    case 6:
+        // order books, walked in order by OfferFrame::loadBestOffers
+        mSession << "CREATE INDEX bestofferindex ON offers "
+                    "(sellingassetcode, sellingissuer, buyingassetcode, "
+                    "buyingissuer, price, offerid)";
+        break;
+
+    case 7:
+        AccountFrame::copySignersToAccounts(*this);
+        break;
+
+    case 8:
+        // tables of KeyValueLedgerStore, which only works on SQLite
+        if (isSqlite())
+        {
+            KeyValueLedgerStore::dropAll(*this);
+        }
+        break;
+
     default:
         throw std::runtime_error("Unknown DB schema version");
         break;
@@ -267,17 +297,34 @@ Database::canUsePool() const
     return !(mApp.getConfig().DATABASE.value == ("sqlite3://:memory:"));
 }
 
+StatementContext::~StatementContext()
+{
+    if (mStmt)
+    {
+        auto sqlite = dynamic_cast<soci::sqlite3_statement_backend*>(
+            mStmt->get_backend());
+        if (sqlite && sqlite->stmt_)
+        {
+            // don't leave the statement open until it runs again: releases
+            // the read lock it may hold, which would otherwise conflict with
+            // DROP TABLE and keep WAL checkpoints from completing
+            sqlite_api::sqlite3_reset(sqlite->stmt_);
+            sqlite->databaseReady_ = false;
+        }
+        mStmt->clean_up(false);
+    }
+}
+
 void
 Database::clearPreparedStatementCache()
 {
-    // Flush all prepared statements; in sqlite they represent open cursors
-    // and will conflict with any DROP TABLE commands issued below
     for (auto st : mStatements)
     {
         st.second->clean_up(true);
     }
     mStatements.clear();
     mStatementsSize.set_count(mStatements.size());
+    mLedgerStore.reset();
 }
 
 void
@@ -300,6 +347,8 @@ Database::initialize()
     HistoryManager::dropAll(*this);
     BucketManager::dropAll(mApp);
     putSchemaVersion(1);
+    mApp.getPersistentState().setState(PersistentState::kLedgerStateStore,
+                                       mApp.getConfig().LEDGER_STATE_STORE);
 }
 
 soci::session&
@@ -347,6 +396,16 @@ Database::getEntryCache()
     return mEntryCache;
 }
 
+LedgerStore*
+Database::getLedgerStore()
+{
+    if (!mLedgerStore && mApp.getConfig().LEDGER_STATE_STORE == "kv")
+    {
+        mLedgerStore = make_unique<KeyValueLedgerStore>(*this);
+    }
+    return mLedgerStore.get();
+}
+
 class SQLLogContext : NonCopyable
 {
     std::string mName;
@@ -395,10 +454,12 @@ Database::getPreparedStatement(std::string const& query)
         p->prepare(query);
         mStatements.insert(std::make_pair(query, p));
         mStatementsSize.set_count(mStatements.size());
+        mStatementsPrepared.Mark();
     }
     else
     {
         p = i->second;
+        mStatementsReused.Mark();
     }
     StatementContext sc(p);
     return sc;
@@ -23,12 +23,19 @@ class Counter;
 namespace stellar
 {
 class Application;
+class LedgerStore;
 class SQLLogContext;
 
 /**
  * Helper class for borrowing a SOCI prepared statement handle into a local
  * scope and cleaning it up once done with it. Returned by
  * Database::getPreparedStatement below.
+ *
+ * Cleaning up also resets the statement on SQLite, where a statement that
+ * returned rows otherwise stays open, holding a read transaction, until its
+ * next execution: a statement released by its context leaves no cursor
+ * behind, so that cached statements can be kept across SQL transactions and
+ * schema changes.
  */
 class StatementContext : NonCopyable
 {
@@ -44,13 +51,7 @@ class StatementContext : NonCopyable
         mStmt = other.mStmt;
         other.mStmt.reset();
     }
-    ~StatementContext()
-    {
-        if (mStmt)
-        {
-            mStmt->clean_up(false);
-        }
-    }
+    ~StatementContext();
     soci::statement&
     statement()
     {
@@ -91,10 +92,14 @@ class Database : NonMovableOrCopyable
 
     std::map<std::string, std::shared_ptr<soci::statement>> mStatements;
     medida::Counter& mStatementsSize;
+    medida::Meter& mStatementsPrepared;
+    medida::Meter& mStatementsReused;
 
     cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
         mEntryCache;
 
+    std::unique_ptr<LedgerStore> mLedgerStore;
+
     // Helpers for maintaining the total query time and calculating
     // idle percentage.
     std::set<std::string> mEntityTypes;
@@ -111,6 +116,7 @@ class Database : NonMovableOrCopyable
     // Instantiate object and connect to app.getConfig().DATABASE;
     // if there is a connection error, this will throw.
     Database(Application& app);
+    ~Database();
 
     // Return a crude meter of total queries to the db, for use in
     // overlay/LoadManager.
@@ -143,7 +149,8 @@ class Database : NonMovableOrCopyable
     StatementContext getPreparedStatement(std::string const& query);
 
     // Purge all cached prepared statements, closing their handles with the
-    // database.
+    // database, including those of the ledger store. Cached statements stay
+    // valid across transactions, this is only needed to free them.
     void clearPreparedStatementCache();
 
     // Return metric-gathering timers for various families of SQL operation.
@@ -195,6 +202,11 @@ class Database : NonMovableOrCopyable
     typedef cache::lru_cache<std::string, std::shared_ptr<LedgerEntry const>>
         EntryCache;
     EntryCache& getEntryCache();
+
+    // Access the store of ledger entries selected by LEDGER_STATE_STORE, or
+    // nullptr if they are kept in their SQL tables (the default). Created on
+    // first use.
+    LedgerStore* getLedgerStore();
 };
 
 class DBTimeExcluder : NonCopyable
@@ -340,3 +340,52 @@ TEST_CASE("schema test", "[db]")
     auto av = db.getAppSchemaVersion();
     REQUIRE(dbv == av);
 }
+
+TEST_CASE("prepared statements outlive transactions", "[db]")
+{
+    Config const& cfg = getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE);
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& db = app->getDatabase();
+    auto& session = db.getSession();
+    auto& prepared = app->getMetrics().NewMeter(
+        {"database", "statement", "prepare"}, "statement");
+    auto& reused = app->getMetrics().NewMeter(
+        {"database", "statement", "reuse"}, "statement");
+
+    session << "DROP TABLE IF EXISTS test";
+    session << "CREATE TABLE test (x INTEGER)";
+    for (int i = 0; i < 10; i++)
+    {
+        session << "INSERT INTO test (x) VALUES (:v)", soci::use(i);
+    }
+
+    // only reads the first of the rows returned
+    auto minimum = [&]() {
+        int x = -1;
+        auto prep = db.getPreparedStatement("SELECT x FROM test ORDER BY x");
+        auto& st = prep.statement();
+        st.exchange(soci::into(x));
+        st.define_and_bind();
+        st.execute(true);
+        return x;
+    };
+
+    auto prepared0 = prepared.count();
+    auto reused0 = reused.count();
+    REQUIRE(minimum() == 0);
+    for (int i = 1; i <= 3; i++)
+    {
+        soci::transaction tx(session);
+        session << "UPDATE test SET x = x + 1";
+        tx.commit();
+        REQUIRE(minimum() == i);
+    }
+    REQUIRE(prepared.count() == prepared0 + 1);
+    REQUIRE(reused.count() == reused0 + 3);
+
+    // would fail with "database table is locked" if the statement was left
+    // open
+    REQUIRE_NOTHROW(session << "DROP TABLE test");
+    db.clearPreparedStatementCache();
+}
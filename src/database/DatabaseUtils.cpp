@@ -0,0 +1,45 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "database/DatabaseUtils.h"
+#include <algorithm>
+
+namespace stellar
+{
+namespace DatabaseUtils
+{
+
+size_t
+deleteOldEntriesHelper(soci::session& sess, uint32_t ledgerSeq, uint32_t count,
+                       std::string const& tableName,
+                       std::string const& ledgerSeqColumn)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+
+    int oldest;
+    soci::indicator oldestIndicator;
+    soci::statement st =
+        (sess.prepare << "SELECT MIN(" << ledgerSeqColumn << ") FROM "
+                      << tableName,
+         soci::into(oldest, oldestIndicator));
+    st.execute(true);
+    if (!st.got_data() || oldestIndicator != soci::indicator::i_ok ||
+        static_cast<uint32_t>(oldest) > ledgerSeq)
+    {
+        return 0;
+    }
+
+    uint64_t last = std::min<uint64_t>(
+        ledgerSeq, static_cast<uint64_t>(oldest) + count - 1);
+    soci::statement del =
+        (sess.prepare << "DELETE FROM " << tableName << " WHERE "
+                      << ledgerSeqColumn << " <= " << last);
+    del.execute(true);
+    return static_cast<size_t>(del.get_affected_rows());
+}
+}
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/SociNoWarnings.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace stellar
+{
+namespace DatabaseUtils
+{
+
+// Deletes the rows of @p tableName whose @p ledgerSeqColumn is at most
+// @p ledgerSeq, for at most @p count ledgers starting from the oldest one in
+// the table. The range delete keeps each call bounded and lets the database
+// use the index on @p ledgerSeqColumn. Returns the number of rows deleted.
+size_t deleteOldEntriesHelper(soci::session& sess, uint32_t ledgerSeq,
+                              uint32_t count, std::string const& tableName,
+                              std::string const& ledgerSeqColumn);
+}
+}
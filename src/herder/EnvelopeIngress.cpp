@@ -0,0 +1,162 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "herder/EnvelopeIngress.h"
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "util/Logging.h"
+#include "xdrpp/marshal.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <atomic>
+
+namespace stellar
+{
+
+namespace
+{
+// number of recently seen envelopes remembered for duplicate detection
+size_t const RECENT_ENVELOPES_CACHE_SIZE = 10000;
+// number of signatures checked by a single worker task
+size_t const VERIFY_CHUNK_SIZE = 32;
+
+bool
+verifyEnvelopeSignature(Hash const& networkID, SCPEnvelope const& envelope)
+{
+    // this populates the process-wide signature cache, making the later
+    // SCPDriver::verifyEnvelope call on the main thread a lookup
+    return PubKeyUtils::verifySig(
+        envelope.statement.nodeID, envelope.signature,
+        xdr::xdr_to_opaque(networkID, ENVELOPE_TYPE_SCP, envelope.statement));
+}
+}
+
+EnvelopeIngress::EnvelopeIngress(Application& app, Handoff handoff)
+    : mApp(app)
+    , mHandoff(handoff)
+    , mBackgroundVerification(
+          app.getConfig().BACKGROUND_SCP_SIGNATURE_VERIFICATION)
+    , mRecentEnvelopes(RECENT_ENVELOPES_CACHE_SIZE)
+    , mInFlight(0)
+    , mEnvelopeUnique(
+          app.getMetrics().NewMeter({"scp", "envelope", "unique"}, "envelope"))
+    , mEnvelopeDuplicate(app.getMetrics().NewMeter(
+          {"scp", "envelope", "duplicate"}, "envelope"))
+    , mEnvelopeInvalidSig(app.getMetrics().NewMeter(
+          {"scp", "envelope", "invalidsig"}, "envelope"))
+    , mVerifyQueueLatency(
+          app.getMetrics().NewTimer({"scp", "verify", "queue-latency"}))
+{
+}
+
+void
+EnvelopeIngress::recvSCPEnvelope(SCPEnvelope const& envelope)
+{
+    auto h = sha256(xdr::xdr_to_opaque(envelope));
+    if (mRecentEnvelopes.exists(h))
+    {
+        mEnvelopeDuplicate.Mark();
+        return;
+    }
+    // remembered while queued, so that copies arriving in the meantime are
+    // dropped as well
+    mRecentEnvelopes.put(h, true);
+    mEnvelopeUnique.Mark();
+
+    if (!mBackgroundVerification)
+    {
+        // SCP checks the signature synchronously
+        handoff(envelope, h);
+        return;
+    }
+
+    mQueue.emplace_back(QueuedEnvelope{envelope, h, mApp.getClock().now()});
+    startBatch();
+}
+
+void
+EnvelopeIngress::handoff(SCPEnvelope const& envelope, Hash const& hash)
+{
+    if (!mHandoff(envelope))
+    {
+        // dropped by Herder (for example ahead of its ledger range), it may
+        // be processed if received again later
+        mRecentEnvelopes.erase_if_exists(hash);
+    }
+}
+
+void
+EnvelopeIngress::startBatch()
+{
+    if (mInFlight != 0 || mQueue.empty())
+    {
+        return;
+    }
+
+    auto batch = std::make_shared<std::vector<QueuedEnvelope>>();
+    batch->swap(mQueue);
+    mInFlight = batch->size();
+
+    // one slot per envelope, each written by exactly one worker task
+    auto valid = std::make_shared<std::vector<uint8_t>>(batch->size(), 0);
+    size_t nChunks =
+        (batch->size() + VERIFY_CHUNK_SIZE - 1) / VERIFY_CHUNK_SIZE;
+    auto remaining = std::make_shared<std::atomic<size_t>>(nChunks);
+
+    std::weak_ptr<EnvelopeIngress> weak = shared_from_this();
+    Hash networkID = mApp.getNetworkID();
+    asio::io_service& mainIO = mApp.getClock().getIOService();
+
+    for (size_t begin = 0; begin < batch->size(); begin += VERIFY_CHUNK_SIZE)
+    {
+        size_t end = std::min(begin + VERIFY_CHUNK_SIZE, batch->size());
+        mApp.getWorkerIOService().post(
+            [weak, batch, valid, remaining, networkID, begin, end, &mainIO]() {
+                for (size_t i = begin; i < end; i++)
+                {
+                    (*valid)[i] = verifyEnvelopeSignature(
+                        networkID, (*batch)[i].mEnvelope);
+                }
+                if (--(*remaining) == 0)
+                {
+                    mainIO.post([weak, batch, valid]() {
+                        auto self = weak.lock();
+                        if (self)
+                        {
+                            self->batchVerified(*batch, *valid);
+                        }
+                    });
+                }
+            });
+    }
+}
+
+void
+EnvelopeIngress::batchVerified(std::vector<QueuedEnvelope> const& batch,
+                               std::vector<uint8_t> const& valid)
+{
+    mInFlight = 0;
+    auto now = mApp.getClock().now();
+    for (size_t i = 0; i < batch.size(); i++)
+    {
+        mVerifyQueueLatency.Update(now - batch[i].mQueuedAt);
+        if (valid[i])
+        {
+            handoff(batch[i].mEnvelope, batch[i].mHash);
+        }
+        else
+        {
+            mEnvelopeInvalidSig.Mark();
+            CLOG(DEBUG, "Herder") << "EnvelopeIngress: dropping envelope with "
+                                     "invalid signature";
+        }
+    }
+    startBatch();
+}
+}
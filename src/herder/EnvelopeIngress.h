@@ -0,0 +1,86 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/util/lrucache.hpp"
+#include "util/Timer.h"
+#include "xdr/Stellar-SCP.h"
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace medida
+{
+class Meter;
+class Timer;
+}
+
+/*
+First stage for SCP envelopes flooded to us by peers, ahead of
+PendingEnvelopes: drops envelopes we have seen recently and checks
+signatures, possibly in batches on the worker threads, before handing
+envelopes over (in arrival order) to Herder::recvSCPEnvelope.
+*/
+
+namespace stellar
+{
+
+class Application;
+
+class EnvelopeIngress : public std::enable_shared_from_this<EnvelopeIngress>
+{
+  public:
+    // returns false if the envelope was not accepted for processing, it is
+    // then not remembered as seen and can be received again
+    using Handoff = std::function<bool(SCPEnvelope const&)>;
+
+    EnvelopeIngress(Application& app, Handoff handoff);
+
+    /**
+     * Queue @p envelope received from the network. Duplicates are dropped
+     * immediately, other envelopes are passed to the handoff function once
+     * their signature is known to be valid.
+     */
+    void recvSCPEnvelope(SCPEnvelope const& envelope);
+
+    size_t
+    getQueueSize() const
+    {
+        return mQueue.size() + mInFlight;
+    }
+
+  private:
+    struct QueuedEnvelope
+    {
+        SCPEnvelope mEnvelope;
+        Hash mHash;
+        VirtualClock::time_point mQueuedAt;
+    };
+
+    Application& mApp;
+    Handoff mHandoff;
+    bool mBackgroundVerification;
+
+    // hashes of envelopes recently queued or accepted by the handoff
+    // function
+    cache::lru_cache<Hash, bool> mRecentEnvelopes;
+
+    // envelopes waiting for the next batch
+    std::vector<QueuedEnvelope> mQueue;
+    // size of the batch being verified, at most one batch is in flight to
+    // preserve ordering
+    size_t mInFlight;
+
+    medida::Meter& mEnvelopeUnique;
+    medida::Meter& mEnvelopeDuplicate;
+    medida::Meter& mEnvelopeInvalidSig;
+    medida::Timer& mVerifyQueueLatency;
+
+    void handoff(SCPEnvelope const& envelope, Hash const& hash);
+    void startBatch();
+    void batchVerified(std::vector<QueuedEnvelope> const& batch,
+                       std::vector<uint8_t> const& valid);
+};
+}
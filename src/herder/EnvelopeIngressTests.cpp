@@ -0,0 +1,115 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SHA.h"
+#include "herder/EnvelopeIngress.h"
+#include "lib/catch.hpp"
+#include "main/Application.h"
+#include "test/TestUtils.h"
+#include "test/test.h"
+#include "xdrpp/marshal.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+
+using namespace stellar;
+using xdr::operator==;
+
+TEST_CASE("EnvelopeIngress", "[herder]")
+{
+    Config cfg(getTestConfig());
+    bool background = false;
+    SECTION("synchronous verification")
+    {
+    }
+    SECTION("background verification")
+    {
+        background = true;
+    }
+    cfg.BACKGROUND_SCP_SIGNATURE_VERIFICATION = background;
+
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    auto makeEnvelope = [&](int i, bool validSignature) {
+        auto key =
+            SecretKey::fromSeed(sha256("NODE_SEED_" + std::to_string(i)));
+        auto envelope = SCPEnvelope{};
+        envelope.statement.nodeID = key.getPublicKey();
+        envelope.statement.slotIndex = 2;
+        envelope.statement.pledges.type(SCP_ST_PREPARE);
+        envelope.statement.pledges.prepare().ballot.counter = 1;
+        envelope.signature = key.sign(xdr::xdr_to_opaque(
+            app->getNetworkID(), ENVELOPE_TYPE_SCP, envelope.statement));
+        if (!validSignature)
+        {
+            envelope.signature[0] ^= 1;
+        }
+        return envelope;
+    };
+
+    std::vector<SCPEnvelope> received;
+    bool accept = true;
+    auto ingress = std::make_shared<EnvelopeIngress>(
+        *app, [&](SCPEnvelope const& e) {
+            received.push_back(e);
+            return accept;
+        });
+    auto waitForQueue = [&]() {
+        while (ingress->getQueueSize() != 0 && !clock.getIOService().stopped())
+        {
+            clock.crank(true);
+        }
+    };
+
+    auto e1 = makeEnvelope(1, true);
+    auto e2 = makeEnvelope(2, false);
+    auto e3 = makeEnvelope(3, true);
+
+    ingress->recvSCPEnvelope(e1);
+    ingress->recvSCPEnvelope(e1);
+    ingress->recvSCPEnvelope(e2);
+    ingress->recvSCPEnvelope(e3);
+    ingress->recvSCPEnvelope(e3);
+
+    auto& duplicate = app->getMetrics().NewMeter(
+        {"scp", "envelope", "duplicate"}, "envelope");
+    REQUIRE(duplicate.count() == 2);
+
+    if (background)
+    {
+        // invalid signatures are dropped before reaching Herder
+        waitForQueue();
+        REQUIRE(received.size() == 2);
+        REQUIRE((received[0] == e1));
+        REQUIRE((received[1] == e3));
+    }
+    else
+    {
+        // SCP is in charge of rejecting e2
+        REQUIRE(received.size() == 3);
+        REQUIRE((received[0] == e1));
+        REQUIRE((received[1] == e2));
+        REQUIRE((received[2] == e3));
+    }
+
+    SECTION("envelopes dropped by the handoff can be received again")
+    {
+        auto e4 = makeEnvelope(4, true);
+        received.clear();
+        accept = false;
+        ingress->recvSCPEnvelope(e4);
+        waitForQueue();
+        accept = true;
+        ingress->recvSCPEnvelope(e4);
+        waitForQueue();
+        ingress->recvSCPEnvelope(e4);
+        waitForQueue();
+
+        REQUIRE(duplicate.count() == 3);
+        REQUIRE(received.size() == 2);
+        REQUIRE((received[0] == e4));
+        REQUIRE((received[1] == e4));
+    }
+}
@@ -111,6 +111,10 @@ class Herder
     // We are learning about a new envelope.
     virtual EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) = 0;
 
+    // We are learning about a new envelope from a peer: duplicates are
+    // dropped and the signature checked before it reaches recvSCPEnvelope.
+    virtual void recvSCPEnvelopeFromPeer(SCPEnvelope const& envelope) = 0;
+
     // We are learning about a new fully-fetched envelope.
     virtual EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
                                            const SCPQuorumSet& qset,
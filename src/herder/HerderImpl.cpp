@@ -72,6 +72,11 @@ HerderImpl::SCPMetrics::SCPMetrics(Application& app)
 HerderImpl::HerderImpl(Application& app)
     : mPendingTransactions(4)
     , mPendingEnvelopes(app, *this)
+    , mEnvelopeIngress(std::make_shared<EnvelopeIngress>(
+          app,
+          [this](SCPEnvelope const& e) {
+              return recvSCPEnvelope(e) != Herder::ENVELOPE_STATUS_DISCARDED;
+          }))
     , mHerderSCPDriver(app, *this, mUpgrades, mPendingEnvelopes)
     , mLastSlotSaved(0)
     , mTrackingTimer(app)
@@ -422,6 +427,12 @@ HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope)
     return status;
 }
 
+void
+HerderImpl::recvSCPEnvelopeFromPeer(SCPEnvelope const& envelope)
+{
+    mEnvelopeIngress->recvSCPEnvelope(envelope);
+}
+
 Herder::EnvelopeStatus
 HerderImpl::recvSCPEnvelope(SCPEnvelope const& envelope,
                             const SCPQuorumSet& qset, TxSetFrame txset)
@@ -5,6 +5,7 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "PendingEnvelopes.h"
+#include "herder/EnvelopeIngress.h"
 #include "herder/Herder.h"
 #include "herder/HerderSCPDriver.h"
 #include "herder/Upgrades.h"
@@ -62,6 +63,7 @@ class HerderImpl : public Herder
     TransactionSubmitStatus recvTransaction(TransactionFramePtr tx) override;
 
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope) override;
+    void recvSCPEnvelopeFromPeer(SCPEnvelope const& envelope) override;
     EnvelopeStatus recvSCPEnvelope(SCPEnvelope const& envelope,
                                    const SCPQuorumSet& qset,
                                    TxSetFrame txset) override;
@@ -124,6 +126,9 @@ class HerderImpl : public Herder
     updatePendingTransactions(std::vector<TransactionFramePtr> const& applied);
 
     PendingEnvelopes mPendingEnvelopes;
+    // duplicate filtering and signature checks ahead of recvSCPEnvelope for
+    // envelopes flooded by peers
+    std::shared_ptr<EnvelopeIngress> mEnvelopeIngress;
     Upgrades mUpgrades;
     HerderSCPDriver mHerderSCPDriver;
 
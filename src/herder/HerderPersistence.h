@@ -37,7 +37,7 @@ class HerderPersistence
                                          uint32_t ledgerCount,
                                          XDROutputFileStream& scpHistory);
     static void dropAll(Database& db);
-    static void deleteOldEntries(Database& db, uint32_t ledgerSeq,
-                                 uint32_t count);
+    static size_t deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
+                                   uint32_t count);
 };
 }
@@ -4,9 +4,14 @@
 
 #include "herder/HerderPersistenceImpl.h"
 #include "crypto/Hex.h"
+#include "crypto/KeyUtils.h"
 #include "database/Database.h"
+#include "database/DatabaseUtils.h"
 #include "herder/Herder.h"
+#include "history/CheckpointWriter.h"
+#include "history/HistoryManager.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "scp/Slot.h"
 #include "util/SociNoWarnings.h"
 #include "util/XDRStream.h"
@@ -14,6 +19,9 @@
 #include <lib/util/basen.h>
 #include <xdrpp/marshal.h>
 
+#include <algorithm>
+#include <map>
+
 namespace stellar
 {
 
@@ -41,6 +49,46 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
     }
 
     auto usedQSets = std::unordered_map<Hash, SCPQuorumSetPtr>{};
+    for (auto const& e : envs)
+    {
+        auto const& qHash =
+            Slot::getCompanionQuorumSetHashFromStatement(e.statement);
+        usedQSets.insert(
+            std::make_pair(qHash, mApp.getHerder().getQSet(qHash)));
+    }
+
+    auto& writer = mApp.getHistoryManager().getCheckpointWriter();
+    if (writer.isEnabled())
+    {
+        // same layout as copySCPHistoryToStream
+        SCPHistoryEntry hEntryV;
+        hEntryV.v(0);
+        auto& hEntry = hEntryV.v0();
+        hEntry.ledgerMessages.ledgerSeq = seq;
+        auto& curEnvs = hEntry.ledgerMessages.messages;
+        curEnvs.insert(curEnvs.end(), envs.begin(), envs.end());
+        std::sort(curEnvs.begin(), curEnvs.end(),
+                  [](SCPEnvelope const& l, SCPEnvelope const& r) {
+                      return KeyUtils::toStrKey(l.statement.nodeID) <
+                             KeyUtils::toStrKey(r.statement.nodeID);
+                  });
+        auto sortedQSets = std::map<Hash, SCPQuorumSetPtr>(usedQSets.begin(),
+                                                           usedQSets.end());
+        for (auto const& p : sortedQSets)
+        {
+            if (p.second)
+            {
+                hEntry.quorumSets.emplace_back(*p.second);
+            }
+        }
+        writer.addSCPMessages(hEntryV);
+    }
+
+    if (!mApp.getConfig().STORE_HISTORY_IN_DATABASE)
+    {
+        return;
+    }
+
     auto& db = mApp.getDatabase();
 
     soci::transaction txscope(db.getSession());
@@ -59,11 +107,6 @@ HerderPersistenceImpl::saveSCPHistory(uint32_t seq,
     }
     for (auto const& e : envs)
     {
-        auto const& qHash =
-            Slot::getCompanionQuorumSetHashFromStatement(e.statement);
-        usedQSets.insert(
-            std::make_pair(qHash, mApp.getHerder().getQSet(qHash)));
-
         std::string nodeIDStrKey = KeyUtils::toStrKey(e.statement.nodeID);
 
         auto envelopeBytes(xdr::xdr_to_opaque(e));
@@ -265,15 +308,13 @@ HerderPersistence::dropAll(Database& db)
                        ")";
 }
 
-void
-HerderPersistence::deleteOldEntries(Database& db, uint32_t ledgerSeq,
+size_t
+HerderPersistence::deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
                                     uint32_t count)
 {
-    db.getSession() << "DELETE FROM scphistory WHERE ledgerseq IN (SELECT "
-                       "ledgerseq FROM scphistory WHERE ledgerseq <= "
-                    << ledgerSeq << " LIMIT " << count << ")";
-    db.getSession() << "DELETE FROM scpquorums WHERE lastledgerseq IN (SELECT "
-                       "lastledgerseq FROM scpquorums WHERE lastledgerseq <= "
-                    << ledgerSeq << " LIMIT " << count << ")";
+    return DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
+                                                 "scphistory", "ledgerseq") +
+           DatabaseUtils::deleteOldEntriesHelper(
+               sess, ledgerSeq, count, "scpquorums", "lastledgerseq");
 }
 }
@@ -48,6 +48,10 @@ HerderSCPDriver::SCPMetrics::SCPMetrics(Application& app)
           {"scp", "ballot", "confirmed-prepared"}, "ballot"))
     , mAcceptedCommit(app.getMetrics().NewMeter(
           {"scp", "ballot", "accepted-commit"}, "ballot"))
+    , mNominationHashComputed(app.getMetrics().NewMeter(
+          {"scp", "nomination", "hash-computed"}, "hash"))
+    , mNominationHashAvoided(app.getMetrics().NewMeter(
+          {"scp", "nomination", "hash-avoided"}, "hash"))
 
     , mHerderStateCurrent(
           app.getMetrics().NewCounter({"herder", "state", "current"}))
@@ -722,4 +726,17 @@ HerderSCPDriver::acceptedCommit(uint64_t slotIndex, SCPBallot const& ballot)
 {
     mSCPMetrics.mAcceptedCommit.Mark();
 }
+
+void
+HerderSCPDriver::nominationHashLookup(uint64_t slotIndex, bool cached)
+{
+    if (cached)
+    {
+        mSCPMetrics.mNominationHashAvoided.Mark();
+    }
+    else
+    {
+        mSCPMetrics.mNominationHashComputed.Mark();
+    }
+}
 }
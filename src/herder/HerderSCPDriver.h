@@ -131,6 +131,7 @@ class HerderSCPDriver : public SCPDriver
     void confirmedBallotPrepared(uint64_t slotIndex,
                                  SCPBallot const& ballot) override;
     void acceptedCommit(uint64_t slotIndex, SCPBallot const& ballot) override;
+    void nominationHashLookup(uint64_t slotIndex, bool cached) override;
 
   private:
     Application& mApp;
@@ -160,6 +161,10 @@ class HerderSCPDriver : public SCPDriver
         medida::Meter& mConfirmedBallotPrepared;
         medida::Meter& mAcceptedCommit;
 
+        // nomination hashes computed vs served from the per slot cache
+        medida::Meter& mNominationHashComputed;
+        medida::Meter& mNominationHashAvoided;
+
         // State transition metrics
         medida::Counter& mHerderStateCurrent;
         medida::Timer& mHerderStateChanges;
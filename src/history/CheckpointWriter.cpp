@@ -0,0 +1,361 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/CheckpointWriter.h"
+#include "bucket/BucketManager.h"
+#include "crypto/SHA.h"
+#include "database/Database.h"
+#include "herder/HerderPersistence.h"
+#include "herder/TxSetFrame.h"
+#include "history/FileTransferInfo.h"
+#include "history/HistoryManager.h"
+#include "ledger/LedgerHeaderFrame.h"
+#include "ledger/LedgerManager.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "transactions/TransactionFrame.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace stellar
+{
+
+namespace
+{
+
+char const* const CHECKPOINT_FILE_TYPES[] = {
+    HISTORY_FILE_TYPE_LEDGER, HISTORY_FILE_TYPE_TRANSACTIONS,
+    HISTORY_FILE_TYPE_RESULTS, HISTORY_FILE_TYPE_SCP};
+
+void
+renameFile(std::string const& from, std::string const& to)
+{
+    if (std::rename(from.c_str(), to.c_str()) != 0)
+    {
+        throw std::runtime_error("failed to rename " + from + " to " + to);
+    }
+}
+
+// Rewrites @p path with only its entries of ledgers before @p ledgerSeq, and
+// returns the number of entries kept. A truncated last entry (crash while
+// writing) ends the file.
+template <typename T, typename GetSeq>
+size_t
+keepEntriesBefore(std::string const& path, uint32_t ledgerSeq, GetSeq getSeq,
+                  uint32_t& lastSeq)
+{
+    size_t kept = 0;
+    lastSeq = 0;
+    auto tmpPath = path + ".tmp";
+    {
+        XDROutputFileStream out;
+        out.open(tmpPath);
+        if (fs::exists(path))
+        {
+            XDRInputFileStream in;
+            in.open(path);
+            T entry;
+            try
+            {
+                while (in && in.readOne(entry))
+                {
+                    auto seq = getSeq(entry);
+                    if (seq < ledgerSeq)
+                    {
+                        out.writeOne(entry);
+                        lastSeq = seq;
+                        kept++;
+                    }
+                }
+            }
+            catch (xdr::xdr_runtime_error& e)
+            {
+                CLOG(WARNING, "History") << "Dropping end of " << path << ": "
+                                         << e.what();
+            }
+        }
+        out.close();
+    }
+    renameFile(tmpPath, path);
+    return kept;
+}
+
+// Hashes of the quorum sets in the SCP file at @p path.
+std::set<Hash>
+readQSetHashes(std::string const& path)
+{
+    std::set<Hash> hashes;
+    XDRInputFileStream in;
+    in.open(path);
+    SCPHistoryEntry entry;
+    while (in && in.readOne(entry))
+    {
+        for (auto const& q : entry.v0().quorumSets)
+        {
+            hashes.insert(sha256(xdr::xdr_to_opaque(q)));
+        }
+    }
+    return hashes;
+}
+}
+
+CheckpointWriter::CheckpointWriter(Application& app)
+    : mApp(app)
+    , mCheckpoint(0)
+    , mLastLedger(0)
+    , mSCPEntries(0)
+    , mComplete(false)
+{
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    closeFiles();
+}
+
+bool
+CheckpointWriter::isEnabled()
+{
+    return mApp.getConfig().STREAM_HISTORY_CHECKPOINTS &&
+           mApp.getHistoryManager().hasAnyWritableHistoryArchive();
+}
+
+std::string const&
+CheckpointWriter::getDir()
+{
+    if (mDir.empty())
+    {
+        auto dir = mApp.getBucketManager().getBucketDir() + "/checkpoints";
+        if (!fs::exists(dir) && !fs::mkpath(dir))
+        {
+            throw std::runtime_error("Unable to create checkpoint directory: " +
+                                     dir);
+        }
+        mDir = dir;
+    }
+    return mDir;
+}
+
+std::string
+CheckpointWriter::getPath(std::string const& type, uint32_t checkpoint,
+                          bool dirty)
+{
+    auto path =
+        getDir() + "/" + fs::baseName(type, fs::hexStr(checkpoint), "xdr");
+    return dirty ? path + ".dirty" : path;
+}
+
+void
+CheckpointWriter::closeFiles()
+{
+    mLedgerOut.close();
+    mTxOut.close();
+    mTxResultOut.close();
+    mSCPOut.close();
+    mCheckpoint = 0;
+}
+
+void
+CheckpointWriter::addSCPMessages(SCPHistoryEntry const& entry)
+{
+    mPendingSCP[entry.v0().ledgerMessages.ledgerSeq] = entry;
+}
+
+void
+CheckpointWriter::resync(uint32_t ledgerSeq)
+{
+    closeFiles();
+
+    auto& hm = mApp.getHistoryManager();
+    auto checkpoint = hm.checkpointContainingLedger(ledgerSeq);
+    // ledger 0 does not exist, the first checkpoint starts at ledger 1
+    auto first = std::max(1u, hm.prevCheckpointLedger(ledgerSeq));
+
+    auto ledgerPath = getPath(HISTORY_FILE_TYPE_LEDGER, checkpoint, true);
+    auto txPath = getPath(HISTORY_FILE_TYPE_TRANSACTIONS, checkpoint, true);
+    auto txResultPath = getPath(HISTORY_FILE_TYPE_RESULTS, checkpoint, true);
+    auto scpPath = getPath(HISTORY_FILE_TYPE_SCP, checkpoint, true);
+
+    uint32_t lastHeader, lastSeq;
+    auto nHeaders = keepEntriesBefore<LedgerHeaderHistoryEntry>(
+        ledgerPath, ledgerSeq,
+        [](LedgerHeaderHistoryEntry const& e) { return e.header.ledgerSeq; },
+        lastHeader);
+    keepEntriesBefore<TransactionHistoryEntry>(
+        txPath, ledgerSeq,
+        [](TransactionHistoryEntry const& e) { return e.ledgerSeq; }, lastSeq);
+    keepEntriesBefore<TransactionHistoryResultEntry>(
+        txResultPath, ledgerSeq,
+        [](TransactionHistoryResultEntry const& e) { return e.ledgerSeq; },
+        lastSeq);
+    mSCPEntries = keepEntriesBefore<SCPHistoryEntry>(
+        scpPath, ledgerSeq,
+        [](SCPHistoryEntry const& e) {
+            return e.v0().ledgerMessages.ledgerSeq;
+        },
+        lastSeq);
+
+    mComplete = true;
+    if (ledgerSeq > first &&
+        (lastHeader != ledgerSeq - 1 || nHeaders != ledgerSeq - first))
+    {
+        // the files are missing some of the ledgers closed so far
+        CLOG(INFO, "History") << "Restoring history of ledgers " << first
+                              << " to " << ledgerSeq - 1
+                              << " from the database";
+        auto& db = mApp.getDatabase();
+        auto& sess = db.getSession();
+        auto count = ledgerSeq - first;
+        mLedgerOut.open(ledgerPath);
+        mTxOut.open(txPath);
+        mTxResultOut.open(txResultPath);
+        mSCPOut.open(scpPath);
+        nHeaders = LedgerHeaderFrame::copyLedgerHeadersToStream(
+            db, sess, first, count, mLedgerOut);
+        TransactionFrame::copyTransactionsToStream(
+            mApp.getNetworkID(), db, sess, first, count, mTxOut, mTxResultOut);
+        mSCPEntries = HerderPersistence::copySCPHistoryToStream(
+            db, sess, first, count, mSCPOut);
+        closeFiles();
+        mComplete = nHeaders == count;
+        if (!mComplete)
+        {
+            CLOG(INFO, "History")
+                << "Only " << nHeaders << " of " << count
+                << " ledger headers found, checkpoint " << checkpoint
+                << " will be published from the database";
+        }
+        else if (!mApp.getConfig().STORE_HISTORY_IN_DATABASE &&
+                 ledgerSeq - 1 > LedgerManager::GENESIS_LEDGER_SEQ)
+        {
+            // only the headers could be restored, publishing the files would
+            // leave out the transactions and SCP messages of these ledgers
+            CLOG(ERROR, "History")
+                << "History tables are not kept in the database, checkpoint "
+                << checkpoint << " is missing the history of ledgers "
+                << first << " to " << ledgerSeq - 1
+                << " and will not be published";
+            mComplete = false;
+        }
+    }
+
+    mLedgerOut.open(ledgerPath, true);
+    mTxOut.open(txPath, true);
+    mTxResultOut.open(txResultPath, true);
+    mSCPOut.open(scpPath, true);
+    mWrittenQSets = readQSetHashes(scpPath);
+    mCheckpoint = checkpoint;
+    mLastLedger = ledgerSeq - 1;
+}
+
+void
+CheckpointWriter::appendLedger(LedgerHeaderHistoryEntry const& header,
+                               TxSetFrame& txSet,
+                               TransactionResultSet const& results)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+
+    auto seq = header.header.ledgerSeq;
+    auto checkpoint = mApp.getHistoryManager().checkpointContainingLedger(seq);
+    if (checkpoint != mCheckpoint || seq != mLastLedger + 1)
+    {
+        resync(seq);
+    }
+
+    mLedgerOut.writeOne(header);
+    if (!txSet.mTransactions.empty())
+    {
+        TransactionHistoryEntry txs;
+        txs.ledgerSeq = seq;
+        txSet.sortForHash();
+        txSet.toXDR(txs.txSet);
+        mTxOut.writeOne(txs);
+
+        TransactionHistoryResultEntry txResults;
+        txResults.ledgerSeq = seq;
+        txResults.txResultSet = results;
+        mTxResultOut.writeOne(txResults);
+    }
+    auto scp = mPendingSCP.find(seq);
+    if (scp != mPendingSCP.end())
+    {
+        auto& qSets = scp->second.v0().quorumSets;
+        qSets.erase(std::remove_if(qSets.begin(), qSets.end(),
+                                   [&](SCPQuorumSet const& q) {
+                                       auto h = sha256(xdr::xdr_to_opaque(q));
+                                       return !mWrittenQSets.insert(h).second;
+                                   }),
+                    qSets.end());
+        mSCPOut.writeOne(scp->second);
+        mSCPEntries++;
+    }
+    mPendingSCP.erase(mPendingSCP.begin(), mPendingSCP.upper_bound(seq));
+
+    if (!mLedgerOut.flush() || !mTxOut.flush() || !mTxResultOut.flush() ||
+        !mSCPOut.flush())
+    {
+        closeFiles();
+        throw std::runtime_error("failed to write history of ledger " +
+                                 std::to_string(seq));
+    }
+    mLastLedger = seq;
+
+    if (seq == checkpoint)
+    {
+        finishCheckpoint();
+    }
+}
+
+void
+CheckpointWriter::finishCheckpoint()
+{
+    auto checkpoint = mCheckpoint;
+    closeFiles();
+    for (auto type : CHECKPOINT_FILE_TYPES)
+    {
+        auto dirty = getPath(type, checkpoint, true);
+        if (!mComplete)
+        {
+            std::remove(dirty.c_str());
+            continue;
+        }
+        if (type == HISTORY_FILE_TYPE_SCP && mSCPEntries == 0)
+        {
+            // don't upload empty files
+            std::remove(dirty.c_str());
+            continue;
+        }
+        renameFile(dirty, getPath(type, checkpoint, false));
+    }
+    CLOG(DEBUG, "History") << "Wrote history files of checkpoint "
+                           << checkpoint;
+}
+
+bool
+CheckpointWriter::hasCheckpoint(uint32_t checkpoint)
+{
+    return fs::exists(getPath(HISTORY_FILE_TYPE_LEDGER, checkpoint, false));
+}
+
+void
+CheckpointWriter::forgetCheckpoint(uint32_t checkpoint)
+{
+    if (!isEnabled())
+    {
+        return;
+    }
+    for (auto type : CHECKPOINT_FILE_TYPES)
+    {
+        auto path = getPath(type, checkpoint, false);
+        std::remove(path.c_str());
+        std::remove((path + ".gz").c_str());
+    }
+}
+}
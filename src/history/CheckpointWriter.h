@@ -0,0 +1,89 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/XDRStream.h"
+#include "xdr/Stellar-ledger.h"
+#include <map>
+#include <set>
+#include <string>
+
+namespace stellar
+{
+
+class Application;
+class TxSetFrame;
+
+/**
+ * Writes the history files of the current checkpoint (ledger headers,
+ * transaction sets, transaction results and SCP messages) as ledgers close.
+ * Active when STREAM_HISTORY_CHECKPOINTS is set and we publish to at least
+ * one archive.
+ *
+ * Files of the checkpoint in progress carry a ".dirty" suffix and are renamed
+ * to their final name when the last ledger of the checkpoint closes.
+ * Publishing then uses them as they are (see StateSnapshot) instead of
+ * reading the history back from the database. They live in the bucket
+ * directory until the checkpoint is published.
+ *
+ * The entries of a ledger are flushed before the ledger is committed to the
+ * database. Whenever the files do not line up with the ledger being closed
+ * (first close after a restart or a catchup, crash between the write and the
+ * commit), entries of ledgers that did not commit are dropped and missing
+ * ones are restored from the database. If the database does not have them
+ * either (e.g. after catching up in the middle of a checkpoint), the files
+ * of that checkpoint are discarded and publishing falls back to the database.
+ * Without STORE_HISTORY_IN_DATABASE only ledger headers can be restored, so
+ * the files are discarded as well and the checkpoint is not published.
+ */
+class CheckpointWriter
+{
+    Application& mApp;
+    std::string mDir;
+    // checkpoint of the open files, 0 if none
+    uint32_t mCheckpoint;
+    uint32_t mLastLedger;
+    size_t mSCPEntries;
+    // false if some ledgers of the checkpoint could not be restored, in which
+    // case its files are dropped instead of published
+    bool mComplete;
+    XDROutputFileStream mLedgerOut;
+    XDROutputFileStream mTxOut;
+    XDROutputFileStream mTxResultOut;
+    XDROutputFileStream mSCPOut;
+    // SCP messages of externalized ledgers that did not close yet
+    std::map<uint32_t, SCPHistoryEntry> mPendingSCP;
+    // quorum sets already in the SCP file, which are not repeated
+    std::set<Hash> mWrittenQSets;
+
+    std::string getPath(std::string const& type, uint32_t checkpoint,
+                        bool dirty);
+    void closeFiles();
+    void resync(uint32_t ledgerSeq);
+    void finishCheckpoint();
+
+  public:
+    explicit CheckpointWriter(Application& app);
+    ~CheckpointWriter();
+
+    bool isEnabled();
+
+    // Keeps the SCP messages of @p entry until its ledger closes.
+    void addSCPMessages(SCPHistoryEntry const& entry);
+
+    // Appends the history of the ledger that just closed.
+    void appendLedger(LedgerHeaderHistoryEntry const& header,
+                      TxSetFrame& txSet, TransactionResultSet const& results);
+
+    // Directory holding the checkpoint files.
+    std::string const& getDir();
+
+    // Whether the files of @p checkpoint are complete.
+    bool hasCheckpoint(uint32_t checkpoint);
+
+    // Deletes the files of @p checkpoint, once published.
+    void forgetCheckpoint(uint32_t checkpoint);
+};
+}
@@ -43,6 +43,14 @@ class FileTransferInfo
     {
     }
 
+    FileTransferInfo(std::string const& snapDir, std::string const& snapType,
+                     uint32_t checkpointLedger)
+        : mType(snapType)
+        , mHexDigits(fs::hexStr(checkpointLedger))
+        , mLocalPath(snapDir + "/" + baseName_nogz())
+    {
+    }
+
     FileTransferInfo(TmpDir const& snapDir, std::string const& snapType,
                      std::string const& hexDigits)
         : mType(snapType)
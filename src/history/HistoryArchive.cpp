@@ -281,8 +281,13 @@ HistoryArchiveState::HistoryArchiveState(uint32_t ledgerSeq,
 HistoryArchive::HistoryArchive(std::string const& name,
                                std::string const& getCmd,
                                std::string const& putCmd,
-                               std::string const& mkdirCmd)
-    : mName(name), mGetCmd(getCmd), mPutCmd(putCmd), mMkdirCmd(mkdirCmd)
+                               std::string const& mkdirCmd,
+                               uint32_t maxConcurrency)
+    : mName(name)
+    , mGetCmd(getCmd)
+    , mPutCmd(putCmd)
+    , mMkdirCmd(mkdirCmd)
+    , mMaxConcurrency(maxConcurrency)
 {
 }
 
@@ -314,6 +319,12 @@ HistoryArchive::getName() const
     return mName;
 }
 
+uint32_t
+HistoryArchive::getMaxConcurrency() const
+{
+    return mMaxConcurrency;
+}
+
 std::string
 HistoryArchive::getFileCmd(std::string const& remote,
                            std::string const& local) const
@@ -132,15 +132,23 @@ class HistoryArchive : public std::enable_shared_from_this<HistoryArchive>
     std::string mGetCmd;
     std::string mPutCmd;
     std::string mMkdirCmd;
+    uint32_t mMaxConcurrency;
 
   public:
+    // Commands are either shell commands (templates where `{0}` and `{1}`
+    // stand for the files being transferred) or file:// URLs served by the
+    // built-in filesystem transport (see HistoryTransferScheduler).
+    // `maxConcurrency` caps the number of concurrent transfers to this
+    // archive, 0 meaning HISTORY_MAX_CONCURRENT_TRANSFERS.
     HistoryArchive(std::string const& name, std::string const& getCmd,
-                   std::string const& putCmd, std::string const& mkdirCmd);
+                   std::string const& putCmd, std::string const& mkdirCmd,
+                   uint32_t maxConcurrency = 0);
     ~HistoryArchive();
     bool hasGetCmd() const;
     bool hasPutCmd() const;
     bool hasMkdirCmd() const;
     std::string const& getName() const;
+    uint32_t getMaxConcurrency() const;
 
     std::string getFileCmd(std::string const& remote,
                            std::string const& local) const;
@@ -176,9 +176,11 @@ namespace stellar
 class Application;
 class Bucket;
 class BucketList;
+class CheckpointWriter;
 class Config;
 class Database;
 class HistoryArchive;
+class HistoryTransferScheduler;
 struct StateSnapshot;
 
 class HistoryManager
@@ -304,6 +306,12 @@ class HistoryManager
     // Infer a quorum set by reading SCP messages in history archives.
     virtual InferredQuorum inferQuorum() = 0;
 
+    // Return the scheduler running all transfers to and from history archives.
+    virtual HistoryTransferScheduler& getTransferScheduler() = 0;
+
+    // Return the writer of the history files of the current checkpoint.
+    virtual CheckpointWriter& getCheckpointWriter() = 0;
+
     // Return the name of the HistoryManager's tmpdir (used for storing files in
     // transit).
     virtual std::string const& getTmpDir() = 0;
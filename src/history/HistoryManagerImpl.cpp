@@ -12,8 +12,10 @@
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "herder/HerderImpl.h"
+#include "history/CheckpointWriter.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryManagerImpl.h"
+#include "history/HistoryTransferScheduler.h"
 #include "history/StateSnapshot.h"
 #include "historywork/FetchRecentQsetsWork.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
@@ -203,6 +205,8 @@ HistoryManager::checkSensibleConfig(Config const& cfg)
 HistoryManagerImpl::HistoryManagerImpl(Application& app)
     : mApp(app)
     , mWorkDir(nullptr)
+    , mTransferScheduler(make_unique<HistoryTransferScheduler>(app))
+    , mCheckpointWriter(make_unique<CheckpointWriter>(app))
     , mPublishWork(nullptr)
 
     , mPublishSkip(
@@ -317,6 +321,18 @@ HistoryManagerImpl::publishQueueLength() const
     return count;
 }
 
+HistoryTransferScheduler&
+HistoryManagerImpl::getTransferScheduler()
+{
+    return *mTransferScheduler;
+}
+
+CheckpointWriter&
+HistoryManagerImpl::getCheckpointWriter()
+{
+    return *mCheckpointWriter;
+}
+
 string const&
 HistoryManagerImpl::getTmpDir()
 {
@@ -516,6 +532,19 @@ HistoryManagerImpl::takeSnapshotAndPublish(HistoryArchiveState const& has)
         return;
     }
     auto ledgerSeq = has.currentLedger;
+    if (!mApp.getConfig().STORE_HISTORY_IN_DATABASE &&
+        !mCheckpointWriter->hasCheckpoint(ledgerSeq))
+    {
+        // without the history tables, the files written as ledgers closed are
+        // the only complete history of the checkpoint
+        CLOG(ERROR, "History") << "No history files for checkpoint "
+                               << ledgerSeq << ", skipping its publication";
+        mPublishSkip.Mark();
+        dequeueCheckpoint(ledgerSeq, has.allBuckets());
+        mApp.getClock().getIOService().post(
+            [this]() { this->publishQueuedHistory(); });
+        return;
+    }
     CLOG(DEBUG, "History") << "Activating publish for ledger " << ledgerSeq;
     auto snap = std::make_shared<StateSnapshot>(mApp, has);
 
@@ -613,6 +642,22 @@ HistoryManagerImpl::getMissingBucketsReferencedByPublishQueue()
     return std::vector<std::string>(buckets.begin(), buckets.end());
 }
 
+void
+HistoryManagerImpl::dequeueCheckpoint(uint32_t ledgerSeq,
+                                      std::vector<std::string> const& buckets)
+{
+    auto timer = mApp.getDatabase().getDeleteTimer("publishqueue");
+    auto prep = mApp.getDatabase().getPreparedStatement(
+        "DELETE FROM publishqueue WHERE ledger = :lg;");
+    auto& st = prep.statement();
+    st.exchange(soci::use(ledgerSeq));
+    st.define_and_bind();
+    st.execute(true);
+
+    mPublishQueueBuckets.removeBuckets(buckets);
+    mCheckpointWriter->forgetCheckpoint(ledgerSeq);
+}
+
 void
 HistoryManagerImpl::historyPublished(
     uint32_t ledgerSeq, std::vector<std::string> const& originalBuckets,
@@ -621,15 +666,7 @@ HistoryManagerImpl::historyPublished(
     if (success)
     {
         this->mPublishSuccess.Mark();
-        auto timer = mApp.getDatabase().getDeleteTimer("publishqueue");
-        auto prep = mApp.getDatabase().getPreparedStatement(
-            "DELETE FROM publishqueue WHERE ledger = :lg;");
-        auto& st = prep.statement();
-        st.exchange(soci::use(ledgerSeq));
-        st.define_and_bind();
-        st.execute(true);
-
-        mPublishQueueBuckets.removeBuckets(originalBuckets);
+        dequeueCheckpoint(ledgerSeq, originalBuckets);
     }
     else
     {
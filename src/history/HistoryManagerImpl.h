@@ -24,6 +24,8 @@ class HistoryManagerImpl : public HistoryManager
 {
     Application& mApp;
     std::unique_ptr<TmpDir> mWorkDir;
+    std::unique_ptr<HistoryTransferScheduler> mTransferScheduler;
+    std::unique_ptr<CheckpointWriter> mCheckpointWriter;
     std::shared_ptr<Work> mPublishWork;
     PublishQueueBuckets mPublishQueueBuckets;
     bool mPublishQueueBucketsFilled{false};
@@ -60,6 +62,10 @@ class HistoryManagerImpl : public HistoryManager
 
     void takeSnapshotAndPublish(HistoryArchiveState const& has);
 
+    // Removes @p ledgerSeq from the publish queue.
+    void dequeueCheckpoint(uint32_t ledgerSeq,
+                           std::vector<std::string> const& buckets);
+
     bool hasAnyWritableHistoryArchive() override;
 
     uint32_t getMinLedgerQueuedToPublish() override;
@@ -87,6 +93,10 @@ class HistoryManagerImpl : public HistoryManager
 
     InferredQuorum inferQuorum() override;
 
+    HistoryTransferScheduler& getTransferScheduler() override;
+
+    CheckpointWriter& getCheckpointWriter() override;
+
     std::string const& getTmpDir() override;
 
     std::string localFilename(std::string const& basename) override;
@@ -2,14 +2,23 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "bucket/Bucket.h"
+#include "bucket/BucketBlockFile.h"
+#include "bucket/BucketList.h"
 #include "bucket/BucketManager.h"
 #include "catchup/CatchupWorkTests.h"
+#include "crypto/SHA.h"
+#include "database/Database.h"
+#include "history/CheckpointWriter.h"
+#include "history/HistoryArchive.h"
 #include "history/HistoryManager.h"
 #include "history/HistoryTestsUtils.h"
+#include "history/HistoryTransferScheduler.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
 #include "historywork/GunzipFileWork.h"
 #include "historywork/GzipFileWork.h"
 #include "historywork/PutHistoryArchiveStateWork.h"
+#include "historywork/VerifyBucketWork.h"
 #include "ledger/LedgerManager.h"
 #include "main/ExternalQueue.h"
 #include "main/PersistentState.h"
@@ -17,8 +26,11 @@
 #include "test/TestUtils.h"
 #include "test/test.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
+#include "util/XDRStream.h"
 #include "work/WorkManager.h"
 
+#include <fstream>
 #include <lib/catch.hpp>
 #include <lib/util/format.h>
 
@@ -68,6 +80,202 @@ TEST_CASE("HistoryManager::compress", "[history]")
     REQUIRE(!fs::exists(compressed));
 }
 
+TEST_CASE("XDR streams on gzip files", "[history]")
+{
+    CatchupSimulation catchupSimulation{};
+
+    HistoryManager& hm = catchupSimulation.getApp().getHistoryManager();
+    std::string fname = hm.localFilename("streamme.xdr");
+    std::string compressed = fname + ".gz";
+
+    std::vector<LedgerHeader> headers(1000);
+    for (size_t i = 0; i < headers.size(); i++)
+    {
+        headers[i].ledgerSeq = static_cast<uint32>(i);
+        headers[i].scpValue.closeTime = i * 5;
+    }
+    {
+        XDROutputFileStream out;
+        out.open(compressed);
+        for (auto const& h : headers)
+        {
+            REQUIRE(out.writeOne(h));
+        }
+        out.close();
+    }
+
+    auto checkAll = [&](std::string const& filename) {
+        std::vector<LedgerHeader> res;
+        XDRInputFileStream in;
+        in.open(filename);
+        LedgerHeader h;
+        while (in.readOne(h))
+        {
+            res.push_back(h);
+        }
+        REQUIRE(res.size() == headers.size());
+        for (size_t i = 0; i < res.size(); i++)
+        {
+            REQUIRE(xdr::xdr_to_opaque(res[i]) ==
+                    xdr::xdr_to_opaque(headers[i]));
+        }
+    };
+
+    // the stream decompresses on the fly...
+    checkAll(compressed);
+
+    // ... and produces regular gzip files
+    auto& wm = catchupSimulation.getApp().getWorkManager();
+    auto u = wm.executeWork<GunzipFileWork>(true, compressed, true);
+    REQUIRE(u->getState() == Work::WORK_SUCCESS);
+    REQUIRE(fs::exists(compressed));
+    checkAll(fname);
+
+    SECTION("corrupt gzip file")
+    {
+        {
+            std::ofstream out(compressed, std::ofstream::binary |
+                                              std::ofstream::in);
+            out.seekp(100);
+            out.write("garbage", 7);
+        }
+        auto v = wm.executeWork<GunzipFileWork>(true, compressed, true);
+        REQUIRE(v->getState() == Work::WORK_FAILURE_RAISE);
+    }
+    SECTION("truncated gzip file")
+    {
+        std::string data;
+        {
+            std::ifstream in(compressed, std::ifstream::binary);
+            data.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>());
+        }
+        {
+            std::ofstream out(compressed,
+                              std::ofstream::binary | std::ofstream::trunc);
+            out.write(data.data(), data.size() / 2);
+        }
+        auto v = wm.executeWork<GunzipFileWork>(true, compressed, true);
+        REQUIRE(v->getState() == Work::WORK_FAILURE_RAISE);
+
+        XDRInputFileStream in;
+        in.open(compressed);
+        LedgerHeader h;
+        auto readAll = [&]() {
+            while (in.readOne(h))
+                ;
+        };
+        REQUIRE_THROWS_AS(readAll(), std::runtime_error);
+    }
+}
+
+namespace
+{
+// stands for the download of a compressed bucket: copies @p source to
+// @p target, truncated during the first @p nCorrupt runs
+class FakeBucketDownloadWork : public Work
+{
+    std::string mSource;
+    std::string mTarget;
+    size_t& mRuns;
+    size_t mCorrupt;
+
+  public:
+    FakeBucketDownloadWork(Application& app, WorkParent& parent,
+                           std::string const& source,
+                           std::string const& target, size_t& runs,
+                           size_t nCorrupt)
+        : Work(app, parent, "fake-bucket-download", RETRY_NEVER)
+        , mSource(source)
+        , mTarget(target)
+        , mRuns(runs)
+        , mCorrupt(nCorrupt)
+    {
+    }
+
+    void
+    onRun() override
+    {
+        std::string data;
+        {
+            std::ifstream in(mSource, std::ifstream::binary);
+            data.assign(std::istreambuf_iterator<char>(in),
+                        std::istreambuf_iterator<char>());
+        }
+        if (mRuns++ < mCorrupt)
+        {
+            data.resize(data.size() / 2);
+        }
+        std::ofstream out(mTarget,
+                          std::ofstream::binary | std::ofstream::trunc);
+        out.write(data.data(), data.size());
+        scheduleSuccess();
+    }
+};
+}
+
+TEST_CASE("VerifyBucketWork decompresses and verifies in one pass",
+          "[history]")
+{
+    CatchupSimulation catchupSimulation{};
+    auto& app = catchupSimulation.getApp();
+
+    // contents don't need to be a valid bucket to be verified
+    std::string contents(3 * 1024 * 1024, 'x');
+    for (size_t i = 0; i < contents.size(); i += 7)
+    {
+        contents[i] = static_cast<char>(i);
+    }
+    auto hash = sha256(contents);
+
+    std::string fname = app.getHistoryManager().localFilename("bucket.xdr");
+    std::string compressed = fname + ".gz";
+    {
+        std::ofstream out(fname + ".raw", std::ofstream::binary);
+        out.write(contents.data(), contents.size());
+    }
+    gzipFile(fname + ".raw", compressed);
+
+    std::map<std::string, std::shared_ptr<Bucket>> buckets;
+    auto& wm = app.getWorkManager();
+
+    SECTION("matching hash")
+    {
+        auto w = wm.executeWork<VerifyBucketWork>(true, buckets, fname, hash,
+                                                  compressed);
+        REQUIRE(w->getState() == Work::WORK_SUCCESS);
+        REQUIRE(!fs::exists(compressed));
+        REQUIRE(buckets.size() == 1);
+        REQUIRE(buckets.begin()->second->getHash() == hash);
+    }
+    SECTION("mismatched hash")
+    {
+        auto w = wm.executeWork<VerifyBucketWork>(
+            true, buckets, fname, sha256("something else"), compressed);
+        REQUIRE(w->getState() == Work::WORK_FAILURE_RAISE);
+        REQUIRE(buckets.empty());
+    }
+    SECTION("corrupt download is fetched again")
+    {
+        std::string source = fname + ".source.gz";
+        REQUIRE(std::rename(compressed.c_str(), source.c_str()) == 0);
+
+        size_t runs = 0;
+        auto w = wm.addWork<VerifyBucketWork>(buckets, fname, hash, compressed);
+        w->addWork<FakeBucketDownloadWork>(source, compressed, runs, 2);
+        wm.advanceChildren();
+        auto& clock = app.getClock();
+        while (!clock.getIOService().stopped() && !wm.allChildrenDone())
+        {
+            clock.crank(true);
+        }
+        REQUIRE(w->getState() == Work::WORK_SUCCESS);
+        REQUIRE(runs == 3);
+        REQUIRE(buckets.size() == 1);
+        REQUIRE(buckets.begin()->second->getHash() == hash);
+    }
+}
+
 TEST_CASE("HistoryArchiveState::get_put", "[history]")
 {
     CatchupSimulation catchupSimulation{};
@@ -380,6 +588,194 @@ TEST_CASE("Repair missing buckets fails", "[history][historybucketrepair]")
     }
 }
 
+TEST_CASE("Publish/catchup via file:// archive", "[history][historycatchup]")
+{
+    CatchupSimulation catchupSimulation{
+        std::make_shared<FileURLHistoryConfigurator>()};
+
+    catchupSimulation.generateAndPublishInitialHistory(3);
+    auto app2 = catchupSimulation.catchupNewApplication(
+        catchupSimulation.getApp()
+            .getLedgerManager()
+            .getCurrentLedgerHeader()
+            .ledgerSeq,
+        std::numeric_limits<uint32_t>::max(), false,
+        Config::TESTDB_IN_MEMORY_SQLITE, "file");
+
+    auto& written = catchupSimulation.getApp().getMetrics().NewMeter(
+        {"history", "transfer-test", "bytes-written"}, "byte");
+    auto& read = app2->getMetrics().NewMeter(
+        {"history", "transfer-test", "bytes-read"}, "byte");
+    CHECK(written.count() > 0);
+    CHECK(read.count() > 0);
+}
+
+TEST_CASE("Publish/catchup with streamed checkpoints",
+          "[history][historycatchup]")
+{
+    CatchupSimulation catchupSimulation{
+        std::make_shared<CheckpointStreamingHistoryConfigurator>()};
+
+    auto& app = catchupSimulation.getApp();
+    auto& writer = app.getHistoryManager().getCheckpointWriter();
+    REQUIRE(writer.isEnabled());
+
+    catchupSimulation.generateAndPublishInitialHistory(3);
+    auto app2 = catchupSimulation.catchupNewApplication(
+        app.getLedgerManager().getCurrentLedgerHeader().ledgerSeq,
+        std::numeric_limits<uint32_t>::max(), false,
+        Config::TESTDB_IN_MEMORY_SQLITE, "streamed");
+
+    // nothing went through the history tables of the publisher
+    size_t nTxs, nSCP;
+    app.getDatabase().getSession() << "SELECT COUNT(*) FROM txhistory",
+        soci::into(nTxs);
+    app.getDatabase().getSession() << "SELECT COUNT(*) FROM scphistory",
+        soci::into(nSCP);
+    CHECK(nTxs == 0);
+    CHECK(nSCP == 0);
+
+    // files of published checkpoints are gone
+    auto& hm = app.getHistoryManager();
+    REQUIRE(hm.getPublishSuccessCount() > 0);
+    for (uint64_t i = 0; i < hm.getPublishSuccessCount(); i++)
+    {
+        auto checkpoint =
+            static_cast<uint32_t>((i + 1) * hm.getCheckpointFrequency() - 1);
+        CHECK(!writer.hasCheckpoint(checkpoint));
+    }
+
+    size_t replayedTxs;
+    app2->getDatabase().getSession() << "SELECT COUNT(*) FROM txhistory",
+        soci::into(replayedTxs);
+    CHECK(replayedTxs > 0);
+}
+
+TEST_CASE("Publish/catchup with block-compressed buckets",
+          "[history][historycatchup]")
+{
+    CatchupSimulation catchupSimulation{
+        std::make_shared<BlockBucketHistoryConfigurator>()};
+
+    auto& app = catchupSimulation.getApp();
+    catchupSimulation.generateAndPublishInitialHistory(3);
+
+    auto checkBlockFormat = [](Application& a) {
+        auto& bl = a.getBucketManager().getBucketList();
+        size_t n = 0;
+        for (uint32_t i = 0; i < BucketList::kNumLevels; ++i)
+        {
+            for (auto const& b :
+                 {bl.getLevel(i).getCurr(), bl.getLevel(i).getSnap()})
+            {
+                if (!b->getFilename().empty())
+                {
+                    CHECK(isBucketBlockFile(b->getFilename()));
+                    ++n;
+                }
+            }
+        }
+        REQUIRE(n > 0);
+    };
+
+    // the publisher writes its buckets in the block format, and publishes
+    // them as plain XDR streams, which catching up checks against their hash
+    checkBlockFormat(app);
+    auto app2 = catchupSimulation.catchupNewApplication(
+        app.getLedgerManager().getCurrentLedgerHeader().ledgerSeq, 0, false,
+        Config::TESTDB_IN_MEMORY_SQLITE, "blocks");
+
+    // downloaded buckets were converted
+    checkBlockFormat(*app2);
+    REQUIRE(app2->getMetrics()
+                .NewMeter({"history", "verify-bucket", "success"}, "event")
+                .count() > 0);
+}
+
+TEST_CASE("HistoryTransferScheduler", "[history]")
+{
+    VirtualClock clock;
+    FileURLHistoryConfigurator tcfg;
+    Config cfg(getTestConfig());
+    cfg.HISTORY_MAX_CONCURRENT_TRANSFERS = 8;
+    cfg.MAX_CONCURRENT_SUBPROCESSES = 4;
+    cfg = tcfg.configure(cfg, true);
+    Application::pointer app = createTestApplication(clock, cfg);
+    auto& hm = app->getHistoryManager();
+    auto& scheduler = hm.getTransferScheduler();
+    auto archive = cfg.HISTORY["test"];
+
+    auto transfer = [&](HistoryTransferType type, std::string const& remote,
+                        std::string const& local) {
+        bool done = false;
+        asio::error_code result;
+        scheduler.schedule(archive, type, remote, local,
+                           [&](asio::error_code const& ec) {
+                               done = true;
+                               result = ec;
+                           });
+        while (!done && !clock.getIOService().stopped())
+        {
+            clock.crank(true);
+        }
+        return !result;
+    };
+
+    // starts at MAX_CONCURRENT_SUBPROCESSES
+    REQUIRE(scheduler.getConcurrencyLimit(archive) == 4);
+
+    SECTION("files are copied to and from the archive")
+    {
+        auto local = hm.localFilename("transfer-test");
+        {
+            std::ofstream out(local);
+            out << "some history";
+        }
+        REQUIRE(transfer(HISTORY_TRANSFER_PUT, "a/b/transfer-test", local));
+        REQUIRE(fs::exists(tcfg.getArchiveDirName() + "/a/b/transfer-test"));
+
+        auto copy = hm.localFilename("transfer-test-copy");
+        REQUIRE(transfer(HISTORY_TRANSFER_GET, "a/b/transfer-test", copy));
+        std::ifstream in(copy);
+        std::string contents;
+        std::getline(in, contents);
+        REQUIRE(contents == "some history");
+
+        auto& written = app->getMetrics().NewMeter(
+            {"history", "transfer-test", "bytes-written"}, "byte");
+        auto& read = app->getMetrics().NewMeter(
+            {"history", "transfer-test", "bytes-read"}, "byte");
+        REQUIRE(written.count() == contents.size());
+        REQUIRE(read.count() == contents.size());
+    }
+
+    SECTION("failures reduce the concurrency limit")
+    {
+        REQUIRE(!transfer(HISTORY_TRANSFER_GET, "does/not/exist",
+                          hm.localFilename("missing")));
+        REQUIRE(scheduler.getConcurrencyLimit(archive) == 2);
+        REQUIRE(!transfer(HISTORY_TRANSFER_GET, "does/not/exist",
+                          hm.localFilename("missing")));
+        REQUIRE(scheduler.getConcurrencyLimit(archive) == 1);
+        REQUIRE(!transfer(HISTORY_TRANSFER_GET, "does/not/exist",
+                          hm.localFilename("missing")));
+        REQUIRE(scheduler.getConcurrencyLimit(archive) == 1);
+    }
+
+    SECTION("never starts above the archive maximum")
+    {
+        Config cfg2(getTestConfig(1));
+        cfg2.HISTORY_MAX_CONCURRENT_TRANSFERS = 2;
+        cfg2.MAX_CONCURRENT_SUBPROCESSES = 16;
+        cfg2 = tcfg.configure(cfg2, false);
+        VirtualClock clock2;
+        auto app2 = createTestApplication(clock2, cfg2);
+        REQUIRE(app2->getHistoryManager()
+                    .getTransferScheduler()
+                    .getConcurrencyLimit(cfg2.HISTORY["test"]) == 2);
+    }
+}
+
 TEST_CASE("Publish/catchup via s3", "[hide][s3]")
 {
     CatchupSimulation catchupSimulation{
@@ -558,6 +954,44 @@ TEST_CASE("Catchup recent", "[history][catchuprecent]")
     }
 }
 
+TEST_CASE("Catchup recent with merged bucket apply",
+          "[history][catchuprecent]")
+{
+    CatchupSimulation catchupSimulation{
+        std::make_shared<MergedBucketApplyHistoryConfigurator>()};
+
+    auto dbMode = Config::TESTDB_IN_MEMORY_SQLITE;
+    std::vector<Application::pointer> apps;
+
+    catchupSimulation.generateAndPublishInitialHistory(3);
+    uint32_t initLedger =
+        catchupSimulation.getApp().getLedgerManager().getLastClosedLedgerNum();
+
+    for (auto r : {0, 63, 64})
+    {
+        auto name = std::string("merged-apply-") + std::to_string(r);
+        auto app = catchupSimulation.catchupNewApplication(initLedger, r, false,
+                                                           dbMode, name);
+        auto& applied = app->getMetrics().NewMeter(
+            {"history", "bucket-apply", "success"}, "event");
+        CHECK(applied.count() == 1);
+        apps.push_back(app);
+    }
+
+    // catching up again merges buckets on top of the entries already applied
+    catchupSimulation.generateAndPublishHistory(25);
+    initLedger =
+        catchupSimulation.getApp().getLedgerManager().getLastClosedLedgerNum();
+
+    for (auto a : apps)
+    {
+        catchupSimulation.catchupApplication(initLedger, 80, false, a);
+        auto& applied = a->getMetrics().NewMeter(
+            {"history", "bucket-apply", "success"}, "event");
+        CHECK(applied.count() == 2);
+    }
+}
+
 /*
  * Test a variety of LCL/initLedger/count modes.
  */
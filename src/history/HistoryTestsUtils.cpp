@@ -61,6 +61,55 @@ TmpDirHistoryConfigurator::configure(Config& mCfg, bool writable) const
     return mCfg;
 }
 
+Config&
+FileURLHistoryConfigurator::configure(Config& mCfg, bool writable) const
+{
+    std::string d = "file://" + getArchiveDirName();
+    std::string getCmd = d + "/{0}";
+    std::string putCmd = "";
+    std::string mkdirCmd = "";
+
+    if (writable)
+    {
+        putCmd = d + "/{1}";
+        mkdirCmd = d + "/{0}";
+    }
+
+    mCfg.HISTORY["test"] =
+        std::make_shared<HistoryArchive>("test", getCmd, putCmd, mkdirCmd);
+    return mCfg;
+}
+
+Config&
+MergedBucketApplyHistoryConfigurator::configure(Config& mCfg,
+                                                bool writable) const
+{
+    TmpDirHistoryConfigurator::configure(mCfg, writable);
+    mCfg.MERGED_BUCKET_APPLY = !writable;
+    return mCfg;
+}
+
+Config&
+CheckpointStreamingHistoryConfigurator::configure(Config& mCfg,
+                                                  bool writable) const
+{
+    TmpDirHistoryConfigurator::configure(mCfg, writable);
+    if (writable)
+    {
+        mCfg.STREAM_HISTORY_CHECKPOINTS = true;
+        mCfg.STORE_HISTORY_IN_DATABASE = false;
+    }
+    return mCfg;
+}
+
+Config&
+BlockBucketHistoryConfigurator::configure(Config& mCfg, bool writable) const
+{
+    TmpDirHistoryConfigurator::configure(mCfg, writable);
+    mCfg.BUCKET_BLOCK_COMPRESSION = true;
+    return mCfg;
+}
+
 Config&
 S3HistoryConfigurator::configure(Config& mCfg, bool writable) const
 {
@@ -51,6 +51,36 @@ class TmpDirHistoryConfigurator : public HistoryConfigurator
     Config& configure(Config& cfg, bool writable) const override;
 };
 
+// Same archive directory as TmpDirHistoryConfigurator, accessed through the
+// built-in file:// transport.
+class FileURLHistoryConfigurator : public TmpDirHistoryConfigurator
+{
+  public:
+    Config& configure(Config& cfg, bool writable) const override;
+};
+
+// Nodes catching up merge all buckets before applying them.
+class MergedBucketApplyHistoryConfigurator : public TmpDirHistoryConfigurator
+{
+  public:
+    Config& configure(Config& cfg, bool writable) const override;
+};
+
+// Publishing nodes write checkpoints as ledgers close, and keep no
+// transaction or SCP history in their database.
+class CheckpointStreamingHistoryConfigurator : public TmpDirHistoryConfigurator
+{
+  public:
+    Config& configure(Config& cfg, bool writable) const override;
+};
+
+// All nodes keep their buckets in the block format.
+class BlockBucketHistoryConfigurator : public TmpDirHistoryConfigurator
+{
+  public:
+    Config& configure(Config& cfg, bool writable) const override;
+};
+
 struct CatchupMetrics
 {
     uint64_t mHistoryArchiveStatesDownloaded;
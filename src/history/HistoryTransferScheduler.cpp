@@ -0,0 +1,279 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+
+#include "history/HistoryTransferScheduler.h"
+#include "history/HistoryArchive.h"
+#include "main/Application.h"
+#include "main/Config.h"
+#include "util/Logging.h"
+#include "util/make_unique.h"
+
+#include "medida/counter.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace stellar
+{
+
+namespace
+{
+// relative change of throughput between two rounds below which the
+// concurrency limit is left alone
+double const THROUGHPUT_TOLERANCE = 0.1;
+
+uint64_t
+fileSize(std::string const& filename)
+{
+    std::ifstream in(filename, std::ifstream::binary | std::ifstream::ate);
+    if (!in)
+    {
+        return 0;
+    }
+    auto size = in.tellg();
+    return size < 0 ? 0 : static_cast<uint64_t>(size);
+}
+
+size_t
+maxLimit(Application& app, HistoryArchive const& archive)
+{
+    auto limit = archive.getMaxConcurrency();
+    if (limit == 0)
+    {
+        limit = app.getConfig().HISTORY_MAX_CONCURRENT_TRANSFERS;
+    }
+    return std::max<size_t>(1, limit);
+}
+}
+
+HistoryTransferScheduler::ArchiveState::ArchiveState(
+    Application& app, HistoryArchive const& archive)
+    : mMaxLimit(maxLimit(app, archive))
+    // start where the fixed limit used to be, then adapt
+    , mLimit(std::max<size_t>(
+          1, std::min<size_t>(mMaxLimit,
+                              app.getConfig().MAX_CONCURRENT_SUBPROCESSES)))
+    , mBytesRead(app.getMetrics().NewMeter(
+          {"history", "transfer-" + archive.getName(), "bytes-read"}, "byte"))
+    , mBytesWritten(app.getMetrics().NewMeter(
+          {"history", "transfer-" + archive.getName(), "bytes-written"},
+          "byte"))
+    , mFailure(app.getMetrics().NewMeter(
+          {"history", "transfer-" + archive.getName(), "failure"}, "transfer"))
+    , mTransferTime(app.getMetrics().NewTimer(
+          {"history", "transfer-" + archive.getName(), "time"}))
+    , mConcurrency(app.getMetrics().NewCounter(
+          {"history", "transfer-" + archive.getName(), "concurrency"}))
+{
+    mConcurrency.set_count(mLimit);
+}
+
+HistoryTransferScheduler::HistoryTransferScheduler(Application& app)
+    : mApp(app)
+{
+    addTransport(make_unique<ShellHistoryTransport>(app));
+    addTransport(make_unique<FileHistoryTransport>(app));
+}
+
+HistoryTransferScheduler::~HistoryTransferScheduler()
+{
+}
+
+void
+HistoryTransferScheduler::addTransport(
+    std::unique_ptr<HistoryTransport> transport)
+{
+    mTransports.emplace_back(std::move(transport));
+}
+
+std::shared_ptr<HistoryTransferScheduler::ArchiveState> const&
+HistoryTransferScheduler::getArchiveState(HistoryArchive const& archive)
+{
+    auto& state = mArchives[archive.getName()];
+    if (!state)
+    {
+        state = std::make_shared<ArchiveState>(mApp, archive);
+    }
+    return state;
+}
+
+void
+HistoryTransferScheduler::schedule(
+    std::shared_ptr<HistoryArchive const> archive, HistoryTransferType type,
+    std::string const& remote, std::string const& local, Handler handler)
+{
+    assert(archive);
+    std::string command;
+    switch (type)
+    {
+    case HISTORY_TRANSFER_GET:
+        command = archive->getFileCmd(remote, local);
+        break;
+    case HISTORY_TRANSFER_PUT:
+        command = archive->putFileCmd(local, remote);
+        break;
+    case HISTORY_TRANSFER_MKDIR:
+        command = archive->mkdirCmd(remote);
+        break;
+    }
+
+    if (command.empty())
+    {
+        mApp.getClock().getIOService().post(
+            [handler]() { handler(asio::error_code()); });
+        return;
+    }
+
+    auto state = getArchiveState(*archive);
+    state->mQueue.emplace_back(Transfer{type, command, local, handler});
+    startTransfers(state);
+}
+
+void
+HistoryTransferScheduler::startTransfers(
+    std::shared_ptr<ArchiveState> const& state)
+{
+    while (state->mRunning < state->mLimit && !state->mQueue.empty())
+    {
+        auto transfer = std::move(state->mQueue.front());
+        state->mQueue.pop_front();
+
+        auto start = clock::now();
+        if (state->mRunning == 0)
+        {
+            // the archive was idle, don't count that time against its
+            // throughput
+            state->mRoundStart = start;
+            state->mRoundTransfers = 0;
+            state->mRoundBytes = 0;
+        }
+        state->mRunning++;
+
+        auto transport =
+            std::find_if(mTransports.rbegin(), mTransports.rend(),
+                         [&](std::unique_ptr<HistoryTransport> const& t) {
+                             return t->accepts(transfer.mCommand);
+                         });
+        assert(transport != mTransports.rend());
+
+        std::weak_ptr<ArchiveState> weak(state);
+        auto type = transfer.mType;
+        auto local = transfer.mLocal;
+        auto handler = transfer.mHandler;
+        (*transport)
+            ->run(transfer.mType, transfer.mCommand, transfer.mLocal,
+                  [this, weak, type, local, start,
+                   handler](asio::error_code const& ec) {
+                      auto self = weak.lock();
+                      if (!self)
+                      {
+                          return;
+                      }
+                      transferDone(*self, type, local, start, ec);
+                      handler(ec);
+                      startTransfers(self);
+                  });
+    }
+}
+
+void
+HistoryTransferScheduler::transferDone(ArchiveState& state,
+                                       HistoryTransferType type,
+                                       std::string const& local,
+                                       clock::time_point start,
+                                       asio::error_code const& ec)
+{
+    assert(state.mRunning > 0);
+    state.mRunning--;
+    state.mTransferTime.Update(clock::now() - start);
+
+    if (ec)
+    {
+        state.mFailure.Mark();
+        state.mLimit = std::max<size_t>(1, state.mLimit / 2);
+        state.mConcurrency.set_count(state.mLimit);
+        state.mRoundStart = clock::now();
+        state.mRoundTransfers = 0;
+        state.mRoundBytes = 0;
+        return;
+    }
+
+    if (type == HISTORY_TRANSFER_MKDIR)
+    {
+        return;
+    }
+
+    auto bytes = fileSize(local);
+    if (type == HISTORY_TRANSFER_GET)
+    {
+        state.mBytesRead.Mark(bytes);
+    }
+    else
+    {
+        state.mBytesWritten.Mark(bytes);
+    }
+    adaptConcurrency(state, bytes);
+}
+
+void
+HistoryTransferScheduler::adaptConcurrency(ArchiveState& state,
+                                           uint64_t bytes)
+{
+    state.mRoundBytes += bytes;
+    state.mRoundTransfers++;
+    if (state.mRoundTransfers < state.mLimit)
+    {
+        return;
+    }
+
+    auto now = clock::now();
+    auto elapsed =
+        std::chrono::duration<double>(now - state.mRoundStart).count();
+    if (elapsed > 0)
+    {
+        auto throughput = state.mRoundBytes / elapsed;
+        if (throughput > state.mLastThroughput * (1 + THROUGHPUT_TOLERANCE))
+        {
+            state.mLimit = std::min(state.mMaxLimit, state.mLimit + 1);
+        }
+        else if (throughput <
+                 state.mLastThroughput * (1 - THROUGHPUT_TOLERANCE))
+        {
+            state.mLimit = std::max<size_t>(1, state.mLimit - 1);
+        }
+        state.mLastThroughput = throughput;
+        state.mConcurrency.set_count(state.mLimit);
+    }
+
+    state.mRoundStart = now;
+    state.mRoundTransfers = 0;
+    state.mRoundBytes = 0;
+}
+
+size_t
+HistoryTransferScheduler::getReadConcurrency()
+{
+    size_t result = 0;
+    for (auto const& archive : mApp.getConfig().HISTORY)
+    {
+        if (archive.second->hasGetCmd())
+        {
+            result += getArchiveState(*archive.second)->mLimit;
+        }
+    }
+    return result;
+}
+
+size_t
+HistoryTransferScheduler::getConcurrencyLimit(
+    std::shared_ptr<HistoryArchive const> archive)
+{
+    return getArchiveState(*archive)->mLimit;
+}
+}
@@ -0,0 +1,117 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "history/HistoryTransport.h"
+#include <chrono>
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+namespace medida
+{
+class Counter;
+class Meter;
+class Timer;
+}
+
+namespace stellar
+{
+
+class Application;
+class HistoryArchive;
+
+/**
+ * Runs all the file transfers between this node and its history archives.
+ *
+ * Transfers are queued per archive, and each archive has a concurrency limit:
+ * at most that many transfers to the archive are running at a time. The limit
+ * starts at MAX_CONCURRENT_SUBPROCESSES, the fixed limit of previous versions
+ * (capped by the maximum below), and adapts to the throughput observed for
+ * the archive: after
+ * every round of transfers (as many as the current limit), it grows by one if
+ * the throughput improved, and shrinks by one if the throughput went down.
+ * It is halved on failures. The limit never exceeds the archive's
+ * `max_concurrency`, or HISTORY_MAX_CONCURRENT_TRANSFERS.
+ *
+ * Transfers are run by the first transport accepting their command: the
+ * built-in file:// transport, then subprocesses.
+ *
+ * Per-archive metrics are named "history.transfer-<archive>.*".
+ */
+class HistoryTransferScheduler
+{
+  public:
+    using Handler = HistoryTransport::Handler;
+
+    explicit HistoryTransferScheduler(Application& app);
+    ~HistoryTransferScheduler();
+
+    // transports are tried in reverse order of addition
+    void addTransport(std::unique_ptr<HistoryTransport> transport);
+
+    // Queues a transfer to @p archive. For gets and puts, @p remote and
+    // @p local are the names of the files on each side; for mkdir, @p remote
+    // is the directory to create. @p handler is called on the main thread
+    // once done (right away if the archive has no command for it).
+    void schedule(std::shared_ptr<HistoryArchive const> archive,
+                  HistoryTransferType type, std::string const& remote,
+                  std::string const& local, Handler handler);
+
+    // Sum of the current concurrency limits of the archives we read from:
+    // how many downloads it takes to keep them busy.
+    size_t getReadConcurrency();
+
+    // Current concurrency limit of @p archive.
+    size_t getConcurrencyLimit(std::shared_ptr<HistoryArchive const> archive);
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    struct Transfer
+    {
+        HistoryTransferType mType;
+        std::string mCommand;
+        std::string mLocal;
+        Handler mHandler;
+    };
+
+    struct ArchiveState
+    {
+        size_t mMaxLimit;
+        size_t mLimit;
+        size_t mRunning{0};
+        std::deque<Transfer> mQueue;
+
+        // current round of transfers
+        clock::time_point mRoundStart;
+        size_t mRoundTransfers{0};
+        uint64_t mRoundBytes{0};
+        // throughput of the previous round, in bytes per second
+        double mLastThroughput{0};
+
+        medida::Meter& mBytesRead;
+        medida::Meter& mBytesWritten;
+        medida::Meter& mFailure;
+        medida::Timer& mTransferTime;
+        medida::Counter& mConcurrency;
+
+        ArchiveState(Application& app, HistoryArchive const& archive);
+    };
+
+    Application& mApp;
+    std::vector<std::unique_ptr<HistoryTransport>> mTransports;
+    std::map<std::string, std::shared_ptr<ArchiveState>> mArchives;
+
+    std::shared_ptr<ArchiveState> const&
+    getArchiveState(HistoryArchive const& archive);
+    void startTransfers(std::shared_ptr<ArchiveState> const& state);
+    void transferDone(ArchiveState& state, HistoryTransferType type,
+                      std::string const& local, clock::time_point start,
+                      asio::error_code const& ec);
+    void adaptConcurrency(ArchiveState& state, uint64_t bytes);
+};
+}
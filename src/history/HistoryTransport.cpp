@@ -0,0 +1,141 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/asio.h"
+
+#include "history/HistoryTransport.h"
+#include "main/Application.h"
+#include "process/ProcessManager.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+
+#include <cstdio>
+#include <fstream>
+
+namespace stellar
+{
+
+namespace
+{
+
+void
+makeDirectory(std::string const& dir)
+{
+    // another thread (or node, on shared storage) can be creating the same
+    // directory
+    if (!fs::mkpath(dir) && !fs::exists(dir))
+    {
+        throw std::runtime_error("failed to create directory " + dir);
+    }
+}
+
+void
+copyFile(std::string const& from, std::string const& to)
+{
+    std::ifstream in(from, std::ifstream::binary);
+    if (!in)
+    {
+        throw std::runtime_error("failed to open " + from);
+    }
+    std::ofstream out(to, std::ofstream::binary | std::ofstream::trunc);
+    if (!out)
+    {
+        throw std::runtime_error("failed to open " + to);
+    }
+    out << in.rdbuf();
+    out.close();
+    if (!out || in.bad())
+    {
+        throw std::runtime_error("failed to copy " + from + " to " + to);
+    }
+}
+
+std::string
+parentDirectory(std::string const& path)
+{
+    auto pos = path.find_last_of('/');
+    return pos == std::string::npos || pos == 0 ? "" : path.substr(0, pos);
+}
+}
+
+ShellHistoryTransport::ShellHistoryTransport(Application& app) : mApp(app)
+{
+}
+
+bool
+ShellHistoryTransport::accepts(std::string const& command) const
+{
+    return true;
+}
+
+void
+ShellHistoryTransport::run(HistoryTransferType type,
+                           std::string const& command, std::string const& local,
+                           Handler handler)
+{
+    auto exit = mApp.getProcessManager().runProcess(command);
+    exit.async_wait(handler);
+}
+
+std::string const FileHistoryTransport::URL_PREFIX = "file://";
+
+FileHistoryTransport::FileHistoryTransport(Application& app) : mApp(app)
+{
+}
+
+bool
+FileHistoryTransport::accepts(std::string const& command) const
+{
+    return command.compare(0, URL_PREFIX.size(), URL_PREFIX) == 0;
+}
+
+void
+FileHistoryTransport::run(HistoryTransferType type,
+                          std::string const& command, std::string const& local,
+                          Handler handler)
+{
+    auto path = command.substr(URL_PREFIX.size());
+    auto tmpPath = path + ".tmp." + std::to_string(fs::getCurrentPid());
+    asio::io_service& mainIO = mApp.getClock().getIOService();
+
+    mApp.getWorkerIOService().post(
+        [type, path, tmpPath, local, handler, &mainIO]() {
+            asio::error_code ec;
+            try
+            {
+                switch (type)
+                {
+                case HISTORY_TRANSFER_GET:
+                    copyFile(path, local);
+                    break;
+                case HISTORY_TRANSFER_PUT:
+                {
+                    auto dir = parentDirectory(path);
+                    if (!dir.empty())
+                    {
+                        makeDirectory(dir);
+                    }
+                    copyFile(local, tmpPath);
+                    if (std::rename(tmpPath.c_str(), path.c_str()) != 0)
+                    {
+                        std::remove(tmpPath.c_str());
+                        throw std::runtime_error("failed to rename " +
+                                                 tmpPath + " to " + path);
+                    }
+                    break;
+                }
+                case HISTORY_TRANSFER_MKDIR:
+                    makeDirectory(path);
+                    break;
+                }
+            }
+            catch (std::exception const& e)
+            {
+                CLOG(WARNING, "History") << e.what();
+                ec = std::make_error_code(std::errc::io_error);
+            }
+            mainIO.post([handler, ec]() { handler(ec); });
+        });
+}
+}
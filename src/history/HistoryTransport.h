@@ -0,0 +1,85 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <functional>
+#include <string>
+#include <system_error>
+
+namespace asio
+{
+typedef std::error_code error_code;
+};
+
+namespace stellar
+{
+
+class Application;
+
+enum HistoryTransferType
+{
+    HISTORY_TRANSFER_GET,
+    HISTORY_TRANSFER_PUT,
+    HISTORY_TRANSFER_MKDIR
+};
+
+/**
+ * A way of moving files to and from history archives. The command of a
+ * transfer is the archive's get/put/mkdir template, already expanded with the
+ * names of the files involved; each transport claims the commands it knows
+ * how to run.
+ */
+class HistoryTransport
+{
+  public:
+    using Handler = std::function<void(asio::error_code const&)>;
+
+    virtual ~HistoryTransport()
+    {
+    }
+
+    virtual bool accepts(std::string const& command) const = 0;
+
+    // Runs @p command, @p local being the local file of a get or put.
+    // @p handler is called on the main thread once done.
+    virtual void run(HistoryTransferType type, std::string const& command,
+                     std::string const& local, Handler handler) = 0;
+};
+
+/**
+ * Runs commands as subprocesses (see ProcessManager). Accepts any command.
+ */
+class ShellHistoryTransport : public HistoryTransport
+{
+    Application& mApp;
+
+  public:
+    explicit ShellHistoryTransport(Application& app);
+
+    bool accepts(std::string const& command) const override;
+    void run(HistoryTransferType type, std::string const& command,
+             std::string const& local, Handler handler) override;
+};
+
+/**
+ * Copies files from/to an archive on a locally mounted file system, for
+ * commands of the form `file:///path/to/file`. Copies are done on the worker
+ * threads; files are put under a temporary name and renamed once complete,
+ * so that readers of a shared archive never see partial files.
+ */
+class FileHistoryTransport : public HistoryTransport
+{
+    Application& mApp;
+
+  public:
+    static std::string const URL_PREFIX;
+
+    explicit FileHistoryTransport(Application& app);
+
+    bool accepts(std::string const& command) const override;
+    void run(HistoryTransferType type, std::string const& command,
+             std::string const& local, Handler handler) override;
+};
+}
@@ -9,6 +9,7 @@
 #include "crypto/Hex.h"
 #include "database/Database.h"
 #include "herder/HerderPersistence.h"
+#include "history/CheckpointWriter.h"
 #include "history/FileTransferInfo.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryManager.h"
@@ -27,21 +28,49 @@
 namespace stellar
 {
 
+namespace
+{
+bool
+useCheckpointWriter(Application& app, uint32_t checkpoint)
+{
+    auto& writer = app.getHistoryManager().getCheckpointWriter();
+    return writer.isEnabled() && writer.hasCheckpoint(checkpoint);
+}
+
+std::shared_ptr<FileTransferInfo>
+snapFile(Application& app, TmpDir const& snapDir, bool fromCheckpointWriter,
+         std::string const& type, uint32_t checkpoint)
+{
+    if (fromCheckpointWriter)
+    {
+        return std::make_shared<FileTransferInfo>(
+            app.getHistoryManager().getCheckpointWriter().getDir(), type,
+            checkpoint);
+    }
+    return std::make_shared<FileTransferInfo>(snapDir, type, checkpoint);
+}
+}
+
 StateSnapshot::StateSnapshot(Application& app, HistoryArchiveState const& state)
     : mApp(app)
     , mLocalState(state)
     , mSnapDir(app.getTmpDirManager().tmpDir("snapshot"))
-    , mLedgerSnapFile(std::make_shared<FileTransferInfo>(
-          mSnapDir, HISTORY_FILE_TYPE_LEDGER, mLocalState.currentLedger))
+    , mFromCheckpointWriter(useCheckpointWriter(app, state.currentLedger))
+    , mLedgerSnapFile(snapFile(app, mSnapDir, mFromCheckpointWriter,
+                               HISTORY_FILE_TYPE_LEDGER,
+                               mLocalState.currentLedger))
 
-    , mTransactionSnapFile(std::make_shared<FileTransferInfo>(
-          mSnapDir, HISTORY_FILE_TYPE_TRANSACTIONS, mLocalState.currentLedger))
+    , mTransactionSnapFile(snapFile(app, mSnapDir, mFromCheckpointWriter,
+                                    HISTORY_FILE_TYPE_TRANSACTIONS,
+                                    mLocalState.currentLedger))
 
-    , mTransactionResultSnapFile(std::make_shared<FileTransferInfo>(
-          mSnapDir, HISTORY_FILE_TYPE_RESULTS, mLocalState.currentLedger))
+    , mTransactionResultSnapFile(snapFile(app, mSnapDir, mFromCheckpointWriter,
+                                          HISTORY_FILE_TYPE_RESULTS,
+                                          mLocalState.currentLedger))
 
-    , mSCPHistorySnapFile(std::make_shared<FileTransferInfo>(
-          mSnapDir, HISTORY_FILE_TYPE_SCP, mLocalState.currentLedger))
+    , mSCPHistorySnapFile(snapFile(app, mSnapDir, mFromCheckpointWriter,
+                                   HISTORY_FILE_TYPE_SCP,
+                                   mLocalState.currentLedger))
 
 {
     makeLive();
@@ -63,6 +92,14 @@ StateSnapshot::makeLive()
 bool
 StateSnapshot::writeHistoryBlocks() const
 {
+    if (mFromCheckpointWriter)
+    {
+        CLOG(DEBUG, "History") << "Using history files of checkpoint "
+                               << mLocalState.currentLedger
+                               << " written as ledgers closed";
+        return true;
+    }
+
     std::unique_ptr<soci::session> snapSess(
         mApp.getDatabase().canUsePool()
             ? make_unique<soci::session>(mApp.getDatabase().getPool())
@@ -22,6 +22,9 @@ struct StateSnapshot : public std::enable_shared_from_this<StateSnapshot>
     Application& mApp;
     HistoryArchiveState mLocalState;
     TmpDir mSnapDir;
+    // the history files were written by the CheckpointWriter as ledgers
+    // closed, and live in its directory rather than in mSnapDir
+    bool mFromCheckpointWriter;
     std::shared_ptr<FileTransferInfo> mLedgerSnapFile;
     std::shared_ptr<FileTransferInfo> mTransactionSnapFile;
     std::shared_ptr<FileTransferInfo> mTransactionResultSnapFile;
@@ -5,6 +5,7 @@
 #include "historywork/BatchDownloadWork.h"
 #include "catchup/CatchupManager.h"
 #include "history/HistoryManager.h"
+#include "history/HistoryTransferScheduler.h"
 #include "historywork/GetAndUnzipRemoteFileWork.h"
 #include "historywork/Progress.h"
 #include "lib/util/format.h"
@@ -12,6 +13,8 @@
 #include <medida/meter.h>
 #include <medida/metrics_registry.h>
 
+#include <algorithm>
+
 namespace stellar
 {
 
@@ -80,6 +83,22 @@ BatchDownloadWork::addNextDownloadWorker()
     mNext += mApp.getHistoryManager().getCheckpointFrequency();
 }
 
+void
+BatchDownloadWork::addDownloadWorkers()
+{
+    // Twice what the archives currently accept, so that the transfer
+    // scheduler always has downloads queued while we unzip the others. This
+    // follows the concurrency limits as they adapt.
+    size_t nChildren = std::max<size_t>(
+        1, 2 * mApp.getHistoryManager()
+                   .getTransferScheduler()
+                   .getReadConcurrency());
+    while (mChildren.size() < nChildren && mNext <= mRange.last())
+    {
+        addNextDownloadWorker();
+    }
+}
+
 void
 BatchDownloadWork::onReset()
 {
@@ -87,11 +106,7 @@ BatchDownloadWork::onReset()
     mRunning.clear();
     mFinished.clear();
     clearChildren();
-    size_t nChildren = mApp.getConfig().MAX_CONCURRENT_SUBPROCESSES;
-    while (mChildren.size() < nChildren && mNext <= mRange.last())
-    {
-        addNextDownloadWorker();
-    }
+    addDownloadWorkers();
 }
 
 void
@@ -138,8 +153,8 @@ BatchDownloadWork::notify(std::string const& child)
 
         mFinished.push_back(checkpoint->second);
         mRunning.erase(checkpoint);
-        addNextDownloadWorker();
     }
+    addDownloadWorkers();
     mApp.getCatchupManager().logAndUpdateCatchupStatus(true);
     advance();
 }
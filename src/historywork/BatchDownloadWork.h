@@ -22,11 +22,11 @@ class BatchDownloadWork : public Work
     // Specialized class for downloading _lots_ of files (thousands to
     // millions). Sets up N (small number) of parallel download-decompress
     // worker chains to nibble away at a set of files-to-download, stored
-    // as an integer deque. N is the subprocess-concurrency limit by default
-    // (though it's still enforced globally at the ProcessManager level,
-    // so you don't have to worry about making a few extra BatchDownloadWork
-    // classes -- they won't override the global limit, just schedule a small
-    // backlog in the ProcessManager).
+    // as an integer deque. N follows the concurrency limits of the
+    // HistoryTransferScheduler (which are enforced there, per archive, so
+    // you don't have to worry about making a few extra BatchDownloadWork
+    // classes -- they won't override the limits, just schedule a small
+    // backlog in the scheduler).
     std::deque<uint32_t> mFinished;
     std::map<std::string, uint32_t> mRunning;
     CheckpointRange mRange;
@@ -40,6 +40,7 @@ class BatchDownloadWork : public Work
     medida::Meter& mDownloadFailure;
 
     void addNextDownloadWorker();
+    void addDownloadWorkers();
 
   public:
     BatchDownloadWork(Application& app, WorkParent& parent,
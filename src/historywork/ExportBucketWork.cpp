@@ -0,0 +1,76 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "historywork/ExportBucketWork.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketInputIterator.h"
+#include "util/Fs.h"
+#include "util/Logging.h"
+#include "util/XDRStream.h"
+
+namespace stellar
+{
+
+ExportBucketWork::ExportBucketWork(Application& app, WorkParent& parent,
+                                   std::shared_ptr<Bucket const> bucket,
+                                   std::string const& filenameGz)
+    : Work(app, parent, std::string("export-bucket ") + filenameGz)
+    , mBucket(bucket)
+    , mFilenameGz(filenameGz)
+{
+    fs::checkGzipSuffix(mFilenameGz);
+}
+
+ExportBucketWork::~ExportBucketWork()
+{
+    clearChildren();
+}
+
+Work::ExecutionClass
+ExportBucketWork::getExecutionClass() const
+{
+    return WORK_EXECUTION_CPU_BOUND;
+}
+
+void
+ExportBucketWork::onReset()
+{
+    std::remove(mFilenameGz.c_str());
+}
+
+void
+ExportBucketWork::onStart()
+{
+    auto bucket = mBucket;
+    std::string filenameGz = mFilenameGz;
+    scheduleBackground([bucket, filenameGz]() {
+        asio::error_code ec;
+        try
+        {
+            XDROutputFileStream out;
+            out.open(filenameGz);
+            for (BucketInputIterator in(bucket); in; ++in)
+            {
+                if (!out.writeOne(*in))
+                {
+                    throw std::runtime_error("failed to write " + filenameGz);
+                }
+            }
+            out.close();
+        }
+        catch (std::exception const& e)
+        {
+            CLOG(WARNING, "History") << "exporting bucket failed: " << e.what();
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        return ec;
+    });
+}
+
+void
+ExportBucketWork::onRun()
+{
+    // Do nothing: we spawned the exporter in onStart().
+}
+}
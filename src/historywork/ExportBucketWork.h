@@ -0,0 +1,31 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#pragma once
+
+#include "work/Work.h"
+
+namespace stellar
+{
+
+class Bucket;
+
+// Writes a bucket as history archives hold it (gzipped stream of XDR
+// entries), whatever its format on disk, on a worker thread
+class ExportBucketWork : public Work
+{
+    std::shared_ptr<Bucket const> mBucket;
+    std::string mFilenameGz;
+
+  public:
+    ExportBucketWork(Application& app, WorkParent& parent,
+                     std::shared_ptr<Bucket const> bucket,
+                     std::string const& filenameGz);
+    ~ExportBucketWork();
+    ExecutionClass getExecutionClass() const override;
+    void onReset() override;
+    void onStart() override;
+    void onRun() override;
+};
+}
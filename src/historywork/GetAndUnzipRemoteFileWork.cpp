@@ -13,12 +13,14 @@ namespace stellar
 
 GetAndUnzipRemoteFileWork::GetAndUnzipRemoteFileWork(
     Application& app, WorkParent& parent, FileTransferInfo ft,
-    std::shared_ptr<HistoryArchive const> archive, size_t maxRetries)
+    std::shared_ptr<HistoryArchive const> archive, size_t maxRetries,
+    bool unzip)
     : Work(app, parent,
            std::string("get-and-unzip-remote-file ") + ft.remoteName(),
            maxRetries)
     , mFt(std::move(ft))
     , mArchive(archive)
+    , mUnzip(unzip)
 {
 }
 
@@ -109,6 +111,11 @@ GetAndUnzipRemoteFileWork::onSuccess()
         return WORK_FAILURE_RETRY;
     }
 
+    if (!mUnzip)
+    {
+        return WORK_SUCCESS;
+    }
+
     CLOG(DEBUG, "History") << "Downloading and unzipping " << mFt.remoteName()
                            << ": unzipping";
     mGunzipFileWork =
@@ -20,15 +20,18 @@ class GetAndUnzipRemoteFileWork : public Work
 
     FileTransferInfo mFt;
     std::shared_ptr<HistoryArchive const> mArchive;
+    bool mUnzip;
 
   public:
     // Passing `nullptr` for the archive argument will cause the work to
     // select a new readable history archive at random each time it runs /
     // retries.
+    // When `unzip` is false, the work stops once the compressed file is in
+    // place (ft.localPath_gz()), for consumers that decompress it on the fly.
     GetAndUnzipRemoteFileWork(
         Application& app, WorkParent& parent, FileTransferInfo ft,
         std::shared_ptr<HistoryArchive const> archive = nullptr,
-        size_t maxRetries = Work::RETRY_A_LOT);
+        size_t maxRetries = Work::RETRY_A_LOT, bool unzip = true);
     ~GetAndUnzipRemoteFileWork();
     std::string getStatus() const override;
     void onReset() override;
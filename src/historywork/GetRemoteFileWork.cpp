@@ -5,6 +5,7 @@
 #include "historywork/GetRemoteFileWork.h"
 #include "history/HistoryArchive.h"
 #include "history/HistoryManager.h"
+#include "history/HistoryTransferScheduler.h"
 #include "main/Application.h"
 
 namespace stellar
@@ -14,8 +15,7 @@ GetRemoteFileWork::GetRemoteFileWork(
     Application& app, WorkParent& parent, std::string const& remote,
     std::string const& local, std::shared_ptr<HistoryArchive const> archive,
     size_t maxRetries)
-    : RunCommandWork(app, parent, std::string("get-remote-file ") + remote,
-                     maxRetries)
+    : Work(app, parent, std::string("get-remote-file ") + remote, maxRetries)
     , mRemote(remote)
     , mLocal(local)
     , mArchive(archive)
@@ -28,7 +28,7 @@ GetRemoteFileWork::~GetRemoteFileWork()
 }
 
 void
-GetRemoteFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+GetRemoteFileWork::onStart()
 {
     auto archive = mArchive;
     if (!archive)
@@ -37,7 +37,14 @@ GetRemoteFileWork::getCommand(std::string& cmdLine, std::string& outFile)
     }
     assert(archive);
     assert(archive->hasGetCmd());
-    cmdLine = archive->getFileCmd(mRemote, mLocal);
+    mApp.getHistoryManager().getTransferScheduler().schedule(
+        archive, HISTORY_TRANSFER_GET, mRemote, mLocal, callComplete());
+}
+
+void
+GetRemoteFileWork::onRun()
+{
+    // Do nothing: we started the transfer in onStart().
 }
 
 void
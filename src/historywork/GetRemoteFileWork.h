@@ -4,19 +4,20 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "work/Work.h"
 
 namespace stellar
 {
 
 class HistoryArchive;
 
-class GetRemoteFileWork : public RunCommandWork
+// The transfer is handed to the HistoryTransferScheduler from onStart, and
+// onRun does nothing, so that it runs once per attempt (see RunCommandWork).
+class GetRemoteFileWork : public Work
 {
     std::string mRemote;
     std::string mLocal;
     std::shared_ptr<HistoryArchive const> mArchive;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     // Passing `nullptr` for the archive argument will cause the work to
@@ -27,6 +28,8 @@ class GetRemoteFileWork : public RunCommandWork
                       std::shared_ptr<HistoryArchive const> archive = nullptr,
                       size_t maxRetries = Work::RETRY_A_LOT);
     ~GetRemoteFileWork();
+    void onStart() override;
+    void onRun() override;
     void onReset() override;
 };
 }
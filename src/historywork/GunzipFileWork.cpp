@@ -3,7 +3,10 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/GunzipFileWork.h"
+#include "main/Application.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
+#include "util/Logging.h"
 
 namespace stellar
 {
@@ -11,8 +14,7 @@ namespace stellar
 GunzipFileWork::GunzipFileWork(Application& app, WorkParent& parent,
                                std::string const& filenameGz, bool keepExisting,
                                size_t maxRetries)
-    : RunCommandWork(app, parent, std::string("gunzip-file ") + filenameGz,
-                     maxRetries)
+    : Work(app, parent, std::string("gunzip-file ") + filenameGz, maxRetries)
     , mFilenameGz(filenameGz)
     , mKeepExisting(keepExisting)
 {
@@ -25,21 +27,46 @@ GunzipFileWork::~GunzipFileWork()
 }
 
 void
-GunzipFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+GunzipFileWork::onReset()
 {
-    cmdLine = "gzip -d ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    }
-    cmdLine += mFilenameGz;
+    std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
+    std::remove(filenameNoGz.c_str());
+}
+
+Work::ExecutionClass
+GunzipFileWork::getExecutionClass() const
+{
+    return WORK_EXECUTION_CPU_BOUND;
 }
 
 void
-GunzipFileWork::onReset()
+GunzipFileWork::onStart()
 {
-    std::string filenameNoGz = mFilenameGz.substr(0, mFilenameGz.size() - 3);
-    std::remove(filenameNoGz.c_str());
+    std::string filenameGz = mFilenameGz;
+    bool keepExisting = mKeepExisting;
+    scheduleBackground([filenameGz, keepExisting]() {
+        asio::error_code ec;
+        try
+        {
+            gunzipFile(filenameGz,
+                       filenameGz.substr(0, filenameGz.size() - 3));
+            if (!keepExisting)
+            {
+                std::remove(filenameGz.c_str());
+            }
+        }
+        catch (std::exception const& e)
+        {
+            CLOG(WARNING, "History") << "gunzip failed: " << e.what();
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        return ec;
+    });
+}
+
+void
+GunzipFileWork::onRun()
+{
+    // Do nothing: we spawned the decompressor in onStart().
 }
 }
@@ -4,22 +4,25 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "work/Work.h"
 
 namespace stellar
 {
 
-class GunzipFileWork : public RunCommandWork
+// Decompresses a file in-process (zlib) on a worker thread
+class GunzipFileWork : public Work
 {
     std::string mFilenameGz;
     bool mKeepExisting;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     GunzipFileWork(Application& app, WorkParent& parent,
                    std::string const& filenameGz, bool keepExisting = false,
                    size_t maxRetries = Work::RETRY_NEVER);
     ~GunzipFileWork();
+    ExecutionClass getExecutionClass() const override;
     void onReset() override;
+    void onStart() override;
+    void onRun() override;
 };
 }
@@ -3,14 +3,17 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/GzipFileWork.h"
+#include "main/Application.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
+#include "util/Logging.h"
 
 namespace stellar
 {
 
 GzipFileWork::GzipFileWork(Application& app, WorkParent& parent,
                            std::string const& filenameNoGz, bool keepExisting)
-    : RunCommandWork(app, parent, std::string("gzip-file ") + filenameNoGz)
+    : Work(app, parent, std::string("gzip-file ") + filenameNoGz)
     , mFilenameNoGz(filenameNoGz)
     , mKeepExisting(keepExisting)
 {
@@ -29,15 +32,39 @@ GzipFileWork::onReset()
     std::remove(filenameGz.c_str());
 }
 
+Work::ExecutionClass
+GzipFileWork::getExecutionClass() const
+{
+    return WORK_EXECUTION_CPU_BOUND;
+}
+
+void
+GzipFileWork::onStart()
+{
+    std::string filenameNoGz = mFilenameNoGz;
+    bool keepExisting = mKeepExisting;
+    scheduleBackground([filenameNoGz, keepExisting]() {
+        asio::error_code ec;
+        try
+        {
+            gzipFile(filenameNoGz, filenameNoGz + ".gz");
+            if (!keepExisting)
+            {
+                std::remove(filenameNoGz.c_str());
+            }
+        }
+        catch (std::exception const& e)
+        {
+            CLOG(WARNING, "History") << "gzip failed: " << e.what();
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        return ec;
+    });
+}
+
 void
-GzipFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+GzipFileWork::onRun()
 {
-    cmdLine = "gzip ";
-    if (mKeepExisting)
-    {
-        cmdLine += "-c ";
-        outFile = mFilenameNoGz + ".gz";
-    }
-    cmdLine += mFilenameNoGz;
+    // Do nothing: we spawned the compressor in onStart().
 }
 }
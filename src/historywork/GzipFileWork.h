@@ -4,21 +4,24 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "work/Work.h"
 
 namespace stellar
 {
 
-class GzipFileWork : public RunCommandWork
+// Compresses a file in-process (zlib) on a worker thread
+class GzipFileWork : public Work
 {
     std::string mFilenameNoGz;
     bool mKeepExisting;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     GzipFileWork(Application& app, WorkParent& parent,
                  std::string const& filenameNoGz, bool keepExisting = false);
     ~GzipFileWork();
+    ExecutionClass getExecutionClass() const override;
     void onReset() override;
+    void onStart() override;
+    void onRun() override;
 };
 }
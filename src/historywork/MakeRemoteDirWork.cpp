@@ -4,6 +4,9 @@
 
 #include "historywork/MakeRemoteDirWork.h"
 #include "history/HistoryArchive.h"
+#include "history/HistoryManager.h"
+#include "history/HistoryTransferScheduler.h"
+#include "main/Application.h"
 
 namespace stellar
 {
@@ -11,7 +14,7 @@ namespace stellar
 MakeRemoteDirWork::MakeRemoteDirWork(
     Application& app, WorkParent& parent, std::string const& dir,
     std::shared_ptr<HistoryArchive const> archive)
-    : RunCommandWork(app, parent, std::string("make-remote-dir ") + dir)
+    : Work(app, parent, std::string("make-remote-dir ") + dir)
     , mDir(dir)
     , mArchive(archive)
 {
@@ -24,11 +27,16 @@ MakeRemoteDirWork::~MakeRemoteDirWork()
 }
 
 void
-MakeRemoteDirWork::getCommand(std::string& cmdLine, std::string& outFile)
+MakeRemoteDirWork::onStart()
 {
-    if (mArchive->hasMkdirCmd())
-    {
-        cmdLine = mArchive->mkdirCmd(mDir);
-    }
+    // archives without a mkdir command complete right away
+    mApp.getHistoryManager().getTransferScheduler().schedule(
+        mArchive, HISTORY_TRANSFER_MKDIR, mDir, "", callComplete());
+}
+
+void
+MakeRemoteDirWork::onRun()
+{
+    // Do nothing: we started the transfer in onStart().
 }
 }
@@ -4,23 +4,24 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "work/Work.h"
 
 namespace stellar
 {
 
 class HistoryArchive;
 
-class MakeRemoteDirWork : public RunCommandWork
+class MakeRemoteDirWork : public Work
 {
     std::string mDir;
     std::shared_ptr<HistoryArchive const> mArchive;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     MakeRemoteDirWork(Application& app, WorkParent& parent,
                       std::string const& dir,
                       std::shared_ptr<HistoryArchive const> archive);
     ~MakeRemoteDirWork();
+    void onStart() override;
+    void onRun() override;
 };
 }
@@ -4,6 +4,9 @@
 
 #include "historywork/PutRemoteFileWork.h"
 #include "history/HistoryArchive.h"
+#include "history/HistoryManager.h"
+#include "history/HistoryTransferScheduler.h"
+#include "main/Application.h"
 
 namespace stellar
 {
@@ -11,7 +14,7 @@ namespace stellar
 PutRemoteFileWork::PutRemoteFileWork(
     Application& app, WorkParent& parent, std::string const& local,
     std::string const& remote, std::shared_ptr<HistoryArchive const> archive)
-    : RunCommandWork(app, parent, std::string("put-remote-file ") + remote)
+    : Work(app, parent, std::string("put-remote-file ") + remote)
     , mRemote(remote)
     , mLocal(local)
     , mArchive(archive)
@@ -26,8 +29,15 @@ PutRemoteFileWork::~PutRemoteFileWork()
 }
 
 void
-PutRemoteFileWork::getCommand(std::string& cmdLine, std::string& outFile)
+PutRemoteFileWork::onStart()
 {
-    cmdLine = mArchive->putFileCmd(mLocal, mRemote);
+    mApp.getHistoryManager().getTransferScheduler().schedule(
+        mArchive, HISTORY_TRANSFER_PUT, mRemote, mLocal, callComplete());
+}
+
+void
+PutRemoteFileWork::onRun()
+{
+    // Do nothing: we started the transfer in onStart().
 }
 }
@@ -4,24 +4,25 @@
 
 #pragma once
 
-#include "historywork/RunCommandWork.h"
+#include "work/Work.h"
 
 namespace stellar
 {
 
 class HistoryArchive;
 
-class PutRemoteFileWork : public RunCommandWork
+class PutRemoteFileWork : public Work
 {
     std::string mRemote;
     std::string mLocal;
     std::shared_ptr<HistoryArchive const> mArchive;
-    void getCommand(std::string& cmdLine, std::string& outFile) override;
 
   public:
     PutRemoteFileWork(Application& app, WorkParent& parent,
                       std::string const& remote, std::string const& local,
                       std::shared_ptr<HistoryArchive const> archive);
     ~PutRemoteFileWork();
+    void onStart() override;
+    void onRun() override;
 };
 }
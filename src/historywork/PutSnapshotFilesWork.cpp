@@ -3,9 +3,12 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/PutSnapshotFilesWork.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketBlockFile.h"
 #include "bucket/BucketManager.h"
 #include "history/FileTransferInfo.h"
 #include "history/StateSnapshot.h"
+#include "historywork/ExportBucketWork.h"
 #include "historywork/GetHistoryArchiveStateWork.h"
 #include "historywork/GzipFileWork.h"
 #include "historywork/MakeRemoteDirWork.h"
@@ -70,6 +73,19 @@ PutSnapshotFilesWork::onSuccess()
         {
             auto b = mApp.getBucketManager().getBucketByHash(hexToBin256(hash));
             assert(b);
+            if (isBucketBlockFile(b->getFilename()))
+            {
+                // archives get the legacy format, written to the snapshot
+                // directory
+                FileTransferInfo f(mSnapshot->mSnapDir,
+                                   HISTORY_FILE_TYPE_BUCKET, hash);
+                auto put = mPutFilesWork->addWork<PutRemoteFileWork>(
+                    f.localPath_gz(), f.remoteName(), mArchive);
+                auto mkdir =
+                    put->addWork<MakeRemoteDirWork>(f.remoteDir(), mArchive);
+                mkdir->addWork<ExportBucketWork>(b, f.localPath_gz());
+                continue;
+            }
             files.push_back(std::make_shared<FileTransferInfo>(*b));
         }
         for (auto f : files)
@@ -42,10 +42,12 @@ RepairMissingBucketsWork::onReset()
     for (auto const& hash : bucketsToFetch)
     {
         FileTransferInfo ft(*mDownloadDir, HISTORY_FILE_TYPE_BUCKET, hash);
-        // Each bucket gets its own work-chain of download->gunzip->verify
+        // Each bucket gets its own work-chain of download->(gunzip+verify)
         auto verify = addWork<VerifyBucketWork>(mBuckets, ft.localPath_nogz(),
-                                                hexToBin256(hash));
-        verify->addWork<GetAndUnzipRemoteFileWork>(ft);
+                                                hexToBin256(hash),
+                                                ft.localPath_gz());
+        verify->addWork<GetAndUnzipRemoteFileWork>(ft, nullptr, RETRY_A_LOT,
+                                                   false);
     }
 }
 
@@ -3,33 +3,113 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "historywork/VerifyBucketWork.h"
+#include "bucket/BucketBlockFile.h"
 #include "bucket/BucketManager.h"
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "main/Application.h"
 #include "util/Fs.h"
+#include "util/Gzip.h"
 #include "util/Logging.h"
+#include "util/format.h"
+#include "work/WorkManager.h"
 #include <medida/meter.h>
 #include <medida/metrics_registry.h>
+#include <medida/timer.h>
 
+#include <chrono>
 #include <fstream>
 
 namespace stellar
 {
 
+namespace
+{
+// size of the reads (and writes) done while hashing a bucket
+size_t const VERIFY_BUFFER_SIZE = 1024 * 1024;
+
+// Returns the hash of the contents of the bucket. When compressedFile is set
+// it gets decompressed into bucketFile on the way. Raises on I/O errors.
+uint256
+hashBucket(std::string const& bucketFile, std::string const& compressedFile,
+           std::atomic<uint64_t>& bytesDone)
+{
+    auto hasher = SHA256::create();
+    std::vector<char> buf(VERIFY_BUFFER_SIZE);
+    if (compressedFile.empty())
+    {
+        std::ifstream in(bucketFile, std::ifstream::binary);
+        if (!in)
+        {
+            throw std::runtime_error("failed to open " + bucketFile);
+        }
+        while (in)
+        {
+            in.read(buf.data(), buf.size());
+            hasher->add(ByteSlice(buf.data(), in.gcount()));
+            bytesDone += in.gcount();
+        }
+        if (in.bad())
+        {
+            throw std::runtime_error("failed to read " + bucketFile);
+        }
+    }
+    else
+    {
+        GzipInputFile in;
+        in.open(compressedFile);
+        std::ofstream out(bucketFile,
+                          std::ofstream::binary | std::ofstream::trunc);
+        if (!out)
+        {
+            throw std::runtime_error("failed to open " + bucketFile);
+        }
+        size_t n;
+        while ((n = in.readSome(buf.data(), buf.size())) != 0)
+        {
+            if (!in.isCompressed())
+            {
+                throw std::runtime_error("not in gzip format: " +
+                                         compressedFile);
+            }
+            hasher->add(ByteSlice(buf.data(), n));
+            if (!out.write(buf.data(), n))
+            {
+                throw std::runtime_error("failed to write " + bucketFile);
+            }
+            bytesDone += n;
+        }
+        in.close();
+        out.close();
+        if (!out)
+        {
+            throw std::runtime_error("failed to write " + bucketFile);
+        }
+    }
+    return hasher->finish();
+}
+}
+
 VerifyBucketWork::VerifyBucketWork(
     Application& app, WorkParent& parent,
     std::map<std::string, std::shared_ptr<Bucket>>& buckets,
-    std::string const& bucketFile, uint256 const& hash)
+    std::string const& bucketFile, uint256 const& hash,
+    std::string const& compressedFile)
     : Work(app, parent, std::string("verify-bucket-hash ") + bucketFile,
            RETRY_NEVER)
     , mBuckets(buckets)
     , mBucketFile(bucketFile)
+    , mCompressedFile(compressedFile)
     , mHash(hash)
+    , mBytesDone(std::make_shared<std::atomic<uint64_t>>(0))
     , mVerifyBucketSuccess{app.getMetrics().NewMeter(
           {"history", "verify-bucket", "success"}, "event")}
     , mVerifyBucketFailure{app.getMetrics().NewMeter(
           {"history", "verify-bucket", "failure"}, "event")}
+    , mVerifyBucketBytes{app.getMetrics().NewMeter(
+          {"history", "verify-bucket", "bytes"}, "byte")}
+    , mVerifyBucketTime{
+          app.getMetrics().NewTimer({"history", "verify-bucket", "time"})}
 {
     fs::checkNoGzipSuffix(mBucketFile);
 }
@@ -39,31 +119,75 @@ VerifyBucketWork::~VerifyBucketWork()
     clearChildren();
 }
 
+std::string
+VerifyBucketWork::getStatus() const
+{
+    if (mState == WORK_RUNNING)
+    {
+        return fmt::format("verifying bucket {:s}: {:d} MB processed",
+                           hexAbbrev(mHash), *mBytesDone / (1024 * 1024));
+    }
+    return Work::getStatus();
+}
+
+size_t
+VerifyBucketWork::getMaxRetries() const
+{
+    // verifying the same file again would fail the same way
+    return mChildren.empty() ? RETRY_NEVER : RETRY_A_FEW;
+}
+
+void
+VerifyBucketWork::onReset()
+{
+    *mBytesDone = 0;
+    // the file was corrupt or truncated, download it again
+    for (auto& c : mChildren)
+    {
+        c.second->reset();
+    }
+}
+
+Work::ExecutionClass
+VerifyBucketWork::getExecutionClass() const
+{
+    return WORK_EXECUTION_CPU_BOUND;
+}
+
 void
 VerifyBucketWork::onStart()
 {
     std::string filename = mBucketFile;
+    std::string compressedFile = mCompressedFile;
     uint256 hash = mHash;
-    Application& app = this->mApp;
+    auto bytesDone = mBytesDone;
+    auto elapsed = std::make_shared<std::chrono::nanoseconds>(0);
+    bool blockFormat = mApp.getBucketManager().useBlockFormat();
+    auto& timer = mVerifyBucketTime;
     auto handler = callComplete();
-    app.getWorkerIOService().post([&app, filename, handler, hash]() {
-        auto hasher = SHA256::create();
+    auto job = [filename, compressedFile, bytesDone, hash, elapsed,
+                blockFormat]() {
         asio::error_code ec;
-        char buf[4096];
+        auto start = std::chrono::steady_clock::now();
+        try
         {
-            // ensure that the stream gets its own scope to avoid race with
-            // main thread
-            std::ifstream in(filename, std::ifstream::binary);
-            while (in)
-            {
-                in.read(buf, sizeof(buf));
-                hasher->add(ByteSlice(buf, in.gcount()));
-            }
-            uint256 vHash = hasher->finish();
+            // hashBucket keeps the streams in its own scope to avoid race
+            // with main thread
+            uint256 vHash = hashBucket(filename, compressedFile, *bytesDone);
             if (vHash == hash)
             {
                 CLOG(DEBUG, "History") << "Verified hash (" << hexAbbrev(hash)
                                        << ") for " << filename;
+                if (!compressedFile.empty())
+                {
+                    std::remove(compressedFile.c_str());
+                }
+                if (blockFormat)
+                {
+                    // archives hold the legacy format, convert before the
+                    // bucket gets adopted
+                    convertToBucketBlockFile(filename);
+                }
             }
             else
             {
@@ -75,8 +199,21 @@ VerifyBucketWork::onStart()
                 ec = std::make_error_code(std::errc::io_error);
             }
         }
-        app.getClock().getIOService().post([ec, handler]() { handler(ec); });
-    });
+        catch (std::exception const& e)
+        {
+            CLOG(WARNING, "History")
+                << "FAILED reading bucket " << filename << ": " << e.what();
+            ec = std::make_error_code(std::errc::io_error);
+        }
+        *elapsed = std::chrono::steady_clock::now() - start;
+        return ec;
+    };
+    mApp.getWorkManager().runInBackground(
+        getExecutionClass(), getPriority(), job,
+        [handler, &timer, elapsed](asio::error_code const& ec) {
+            timer.Update(*elapsed);
+            handler(ec);
+        });
 }
 
 void
@@ -91,6 +228,7 @@ VerifyBucketWork::onSuccess()
     auto b = mApp.getBucketManager().adoptFileAsBucket(mBucketFile, mHash);
     mBuckets[binToHex(mHash)] = b;
     mVerifyBucketSuccess.Mark();
+    mVerifyBucketBytes.Mark(*mBytesDone);
     return WORK_SUCCESS;
 }
 
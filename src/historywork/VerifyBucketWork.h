@@ -7,9 +7,12 @@
 #include "work/Work.h"
 #include "xdr/Stellar-types.h"
 
+#include <atomic>
+
 namespace medida
 {
 class Meter;
+class Timer;
 }
 
 namespace stellar
@@ -21,16 +24,33 @@ class VerifyBucketWork : public Work
 {
     std::map<std::string, std::shared_ptr<Bucket>>& mBuckets;
     std::string mBucketFile;
+    std::string mCompressedFile;
     uint256 mHash;
 
+    // bytes hashed so far, updated from the worker thread
+    std::shared_ptr<std::atomic<uint64_t>> mBytesDone;
+
     medida::Meter& mVerifyBucketSuccess;
     medida::Meter& mVerifyBucketFailure;
+    medida::Meter& mVerifyBucketBytes;
+    medida::Timer& mVerifyBucketTime;
 
   public:
+    // If compressedFile is not empty, it is decompressed into bucketFile and
+    // hashed in a single pass (and removed once done), instead of reading
+    // back an already decompressed bucketFile.
+    //
+    // On failure, the work is retried if it has children, which are reset:
+    // these are expected to download compressedFile again.
     VerifyBucketWork(Application& app, WorkParent& parent,
                      std::map<std::string, std::shared_ptr<Bucket>>& buckets,
-                     std::string const& bucketFile, uint256 const& hash);
+                     std::string const& bucketFile, uint256 const& hash,
+                     std::string const& compressedFile = "");
     ~VerifyBucketWork();
+    std::string getStatus() const override;
+    size_t getMaxRetries() const override;
+    ExecutionClass getExecutionClass() const override;
+    void onReset() override;
     void onRun() override;
     void onStart() override;
     Work::State onSuccess() override;
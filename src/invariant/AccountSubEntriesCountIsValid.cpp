@@ -31,6 +31,12 @@ AccountSubEntriesCountIsValid::getName() const
     return "AccountSubEntriesCountIsValid";
 }
 
+bool
+AccountSubEntriesCountIsValid::isDeferrable() const
+{
+    return true;
+}
+
 std::string
 AccountSubEntriesCountIsValid::checkOnOperationApply(
     Operation const& operation, OperationResult const& result,
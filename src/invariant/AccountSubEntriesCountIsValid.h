@@ -26,6 +26,8 @@ class AccountSubEntriesCountIsValid : public Invariant
 
     virtual std::string getName() const override;
 
+    virtual bool isDeferrable() const override;
+
     virtual std::string
     checkOnOperationApply(Operation const& operation,
                           OperationResult const& result,
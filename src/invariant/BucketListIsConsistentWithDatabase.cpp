@@ -116,29 +116,28 @@ BucketListIsConsistentWithDatabase::checkOnBucketApply(
         }
     }
 
-    auto& sess = mDb.getSession();
     std::string countFormat = "Incorrect {} count: Bucket = {} Database = {}";
     uint64_t nAccountsInDb =
-        AccountFrame::countObjects(sess, {oldestLedger, newestLedger});
+        AccountFrame::countObjects(mDb, {oldestLedger, newestLedger});
     if (nAccountsInDb != nAccounts)
     {
         return fmt::format(countFormat, "Account", nAccounts, nAccountsInDb);
     }
     uint64_t nTrustLinesInDb =
-        TrustFrame::countObjects(sess, {oldestLedger, newestLedger});
+        TrustFrame::countObjects(mDb, {oldestLedger, newestLedger});
     if (nTrustLinesInDb != nTrustLines)
     {
         return fmt::format(countFormat, "TrustLine", nTrustLines,
                            nTrustLinesInDb);
     }
     uint64_t nOffersInDb =
-        OfferFrame::countObjects(sess, {oldestLedger, newestLedger});
+        OfferFrame::countObjects(mDb, {oldestLedger, newestLedger});
     if (nOffersInDb != nOffers)
     {
         return fmt::format(countFormat, "Offer", nOffers, nOffersInDb);
     }
     uint64_t nDataInDb =
-        DataFrame::countObjects(sess, {oldestLedger, newestLedger});
+        DataFrame::countObjects(mDb, {oldestLedger, newestLedger});
     if (nDataInDb != nData)
     {
         return fmt::format(countFormat, "Data", nData, nDataInDb);
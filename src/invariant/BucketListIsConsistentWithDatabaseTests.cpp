@@ -282,14 +282,13 @@ class ApplyBucketsWorkAddEntry : public ApplyBucketsWork
         if (!mAdded)
         {
             auto& db = mApp.getDatabase();
-            auto& sess = db.getSession();
             uint32_t minLedger = mFromLedgerSeq == 1 ? 2 : mFromLedgerSeq;
             uint32_t maxLedger = std::numeric_limits<int32_t>::max();
             size_t count =
-                AccountFrame::countObjects(sess, {minLedger, maxLedger}) +
-                TrustFrame::countObjects(sess, {minLedger, maxLedger}) +
-                OfferFrame::countObjects(sess, {minLedger, maxLedger}) +
-                DataFrame::countObjects(sess, {minLedger, maxLedger});
+                AccountFrame::countObjects(db, {minLedger, maxLedger}) +
+                TrustFrame::countObjects(db, {minLedger, maxLedger}) +
+                OfferFrame::countObjects(db, {minLedger, maxLedger}) +
+                DataFrame::countObjects(db, {minLedger, maxLedger});
 
             if (count > 0)
             {
@@ -39,6 +39,15 @@ class Invariant
         return mStrict;
     }
 
+    // Invariants whose checkOnOperationApply only depends on its arguments
+    // can be checked later, on a worker thread, with a snapshot of the delta
+    // (see DEFER_INVARIANT_CHECKS).
+    virtual bool
+    isDeferrable() const
+    {
+        return false;
+    }
+
     virtual std::string
     checkOnBucketApply(std::shared_ptr<Bucket const> bucket,
                        uint32_t oldestLedger, uint32_t newestLedger)
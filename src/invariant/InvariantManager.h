@@ -38,14 +38,38 @@ class InvariantManager
                                     uint32_t ledger, uint32_t level,
                                     bool isCurr) = 0;
 
+    // Same as checkOnBucketApply, for a bucket merging all the buckets
+    // holding the changes of ledgers @p oldestLedger to @p ledger.
+    virtual void
+    checkOnMergedBucketApply(std::shared_ptr<Bucket const> bucket,
+                             uint32_t ledger, uint32_t oldestLedger) = 0;
+
+    // With DEFER_INVARIANT_CHECKS, the deferrable invariants are not checked
+    // right away but with a snapshot of @p delta, see checkOnLedgerClose.
     virtual void checkOnOperationApply(Operation const& operation,
                                        OperationResult const& opres,
                                        LedgerDelta const& delta) = 0;
 
+    // Drops the deferred checks left by operations applied since the last
+    // ledger close (e.g. by a close that failed), which do not belong to the
+    // ledger about to close.
+    virtual void startLedgerClose() = 0;
+
+    // Starts checking, on a worker thread, the operations of ledger
+    // @p ledger whose checks were deferred. Ledgers are checked one at a
+    // time, in order; failures are handled on the main thread once the
+    // checks of the ledger are done.
+    virtual void checkOnLedgerClose(uint32_t ledger) = 0;
+
     virtual void registerInvariant(std::shared_ptr<Invariant> invariant) = 0;
 
     virtual void enableInvariant(std::string const& name) = 0;
 
+    // Only runs @p percent percent of the checks of the enabled invariant
+    // @p name, picked at random.
+    virtual void setSamplingPercent(std::string const& name,
+                                    uint32_t percent) = 0;
+
     template <typename T, typename... Args>
     std::shared_ptr<T>
     registerInvariant(Args&&... args)
@@ -12,48 +12,88 @@
 #include "ledger/LedgerDelta.h"
 #include "lib/util/format.h"
 #include "main/Application.h"
+#include "main/Config.h"
 #include "util/Logging.h"
+#include "util/Math.h"
+#include "work/WorkManager.h"
 #include "xdrpp/printer.h"
 
 #include "medida/counter.h"
+#include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
+#include <chrono>
 #include <memory>
 #include <numeric>
 
 namespace stellar
 {
 
+namespace
+{
+std::string
+operationFailureMessage(Invariant const& invariant, std::string const& result,
+                        Operation const& operation)
+{
+    return fmt::format(R"(Invariant "{}" does not hold on operation: {}{}{})",
+                       invariant.getName(), result, "\n",
+                       xdr::xdr_to_string(operation));
+}
+}
+
 std::unique_ptr<InvariantManager>
 InvariantManager::create(Application& app)
 {
-    return make_unique<InvariantManagerImpl>(app.getMetrics());
+    return make_unique<InvariantManagerImpl>(app);
 }
 
-InvariantManagerImpl::InvariantManagerImpl(medida::MetricsRegistry& registry)
-    : mMetricsRegistry(registry)
+InvariantManagerImpl::InvariantManagerImpl(Application& app)
+    : mApp(app)
+    , mMetricsRegistry(app.getMetrics())
+    , mCheckingDeferred(false)
+    , mSelf(std::make_shared<InvariantManagerImpl*>(this))
 {
 }
 
 Json::Value
 InvariantManagerImpl::getInformation()
 {
-    Json::Value failures;
+    Json::Value info;
+    for (auto const& invariant : mEnabled)
+    {
+        auto& timer = getCheckTimer(invariant);
+        auto& skipped = mMetricsRegistry.NewMeter(
+            {"invariant", "skipped", invariant->getName()}, "check");
+
+        auto& checks = info["checks"][invariant->getName()];
+        checks["count"] = (Json::Int64)timer.count();
+        checks["mean_ms"] = timer.mean();
+        checks["max_ms"] = timer.max();
+        checks["skipped"] = (Json::Int64)skipped.count();
+    }
+    if (mApp.getConfig().DEFER_INVARIANT_CHECKS)
+    {
+        info["deferred_ledgers"] = (Json::UInt64)(mDeferredLedgers.size() +
+                                                  (mCheckingDeferred ? 1 : 0));
+    }
+
+    auto& failures = info["failures"];
     for (auto const& invariant : mInvariants)
     {
         auto& counter = mMetricsRegistry.NewCounter(
             {"invariant", "does-not-hold", "count", invariant.first});
         if (counter.count() > 0)
         {
-            auto const& info = mFailureInformation.at(invariant.first);
+            auto const& failure = mFailureInformation.at(invariant.first);
 
             auto& fail = failures[invariant.first];
             fail["count"] = (Json::Int64)counter.count();
-            fail["last_failed_on_ledger"] = info.lastFailedOnLedger;
-            fail["last_failed_with_message"] = info.lastFailedWithMessage;
+            fail["last_failed_on_ledger"] = failure.lastFailedOnLedger;
+            fail["last_failed_with_message"] = failure.lastFailedWithMessage;
         }
     }
-    return failures;
+    return info;
 }
 
 void
@@ -67,19 +107,47 @@ InvariantManagerImpl::checkOnBucketApply(std::shared_ptr<Bucket const> bucket,
     uint32_t newestLedger = oldestLedger - 1 +
                             (isCurr ? BucketList::sizeOfCurr(ledger, level)
                                     : BucketList::sizeOfSnap(ledger, level));
+    checkBucket(bucket, ledger, oldestLedger, newestLedger,
+                fmt::format("{}[{}]", isCurr ? "Curr" : "Snap", level));
+}
+
+void
+InvariantManagerImpl::checkOnMergedBucketApply(
+    std::shared_ptr<Bucket const> bucket, uint32_t ledger,
+    uint32_t oldestLedger)
+{
+    checkBucket(bucket, ledger, oldestLedger, ledger,
+                fmt::format("merged[{}-{}]", oldestLedger, ledger));
+}
+
+void
+InvariantManagerImpl::checkBucket(std::shared_ptr<Bucket const> bucket,
+                                  uint32_t ledger, uint32_t oldestLedger,
+                                  uint32_t newestLedger,
+                                  std::string const& name)
+{
     for (auto invariant : mEnabled)
     {
-        auto result =
-            invariant->checkOnBucketApply(bucket, oldestLedger, newestLedger);
+        if (!isSampled(invariant))
+        {
+            continue;
+        }
+
+        std::string result;
+        {
+            auto timer = getCheckTimer(invariant).TimeScope();
+            result = invariant->checkOnBucketApply(bucket, oldestLedger,
+                                                   newestLedger);
+        }
         if (result.empty())
         {
             continue;
         }
 
-        auto message = fmt::format(
-            R"(invariant "{}" does not hold on bucket {}[{}] = {}: {})",
-            invariant->getName(), isCurr ? "Curr" : "Snap", level,
-            binToHex(bucket->getHash()), result);
+        auto message =
+            fmt::format(R"(invariant "{}" does not hold on bucket {} = {}: {})",
+                        invariant->getName(), name,
+                        binToHex(bucket->getHash()), result);
         onInvariantFailure(invariant, message, ledger);
     }
 }
@@ -94,19 +162,143 @@ InvariantManagerImpl::checkOnOperationApply(Operation const& operation,
         return;
     }
 
+    DeferredCheck deferred;
     for (auto invariant : mEnabled)
     {
-        auto result = invariant->checkOnOperationApply(operation, opres, delta);
+        if (!isSampled(invariant))
+        {
+            continue;
+        }
+        if (mApp.getConfig().DEFER_INVARIANT_CHECKS &&
+            invariant->isDeferrable())
+        {
+            deferred.mInvariants.push_back(invariant);
+            continue;
+        }
+
+        std::string result;
+        {
+            auto timer = getCheckTimer(invariant).TimeScope();
+            result = invariant->checkOnOperationApply(operation, opres, delta);
+        }
         if (result.empty())
         {
             continue;
         }
 
-        auto message = fmt::format(
-            R"(Invariant "{}" does not hold on operation: {}{}{})",
-            invariant->getName(), result, "\n", xdr::xdr_to_string(operation));
+        auto message = operationFailureMessage(*invariant, result, operation);
         onInvariantFailure(invariant, message, delta.getHeader().ledgerSeq);
     }
+
+    if (!deferred.mInvariants.empty())
+    {
+        deferred.mOperation = operation;
+        deferred.mResult = opres;
+        deferred.mDelta = delta.snapshot();
+        mDeferred.emplace_back(std::move(deferred));
+    }
+}
+
+void
+InvariantManagerImpl::startLedgerClose()
+{
+    if (!mDeferred.empty())
+    {
+        CLOG(DEBUG, "Invariant") << "Dropping " << mDeferred.size()
+                                 << " deferred checks of earlier operations";
+        mDeferred.clear();
+    }
+}
+
+void
+InvariantManagerImpl::checkOnLedgerClose(uint32_t ledger)
+{
+    if (mDeferred.empty())
+    {
+        return;
+    }
+    mDeferredLedgers.emplace_back(ledger, std::move(mDeferred));
+    mDeferred.clear();
+    checkNextDeferredLedger();
+}
+
+void
+InvariantManagerImpl::checkNextDeferredLedger()
+{
+    if (mCheckingDeferred || mDeferredLedgers.empty())
+    {
+        return;
+    }
+    mCheckingDeferred = true;
+
+    auto ledger = mDeferredLedgers.front().first;
+    auto checks = std::make_shared<std::vector<DeferredCheck>>(
+        std::move(mDeferredLedgers.front().second));
+    mDeferredLedgers.pop_front();
+
+    struct Outcome
+    {
+        std::shared_ptr<Invariant> mInvariant;
+        std::chrono::nanoseconds mElapsed;
+        std::string mMessage;
+    };
+    auto outcomes = std::make_shared<std::vector<Outcome>>();
+
+    // invariants and snapshots are only read by the job: the main thread
+    // does not touch them until it is done
+    auto job = [checks, outcomes]() {
+        for (auto const& check : *checks)
+        {
+            for (auto const& invariant : check.mInvariants)
+            {
+                auto start = std::chrono::steady_clock::now();
+                auto result = invariant->checkOnOperationApply(
+                    check.mOperation, check.mResult, *check.mDelta);
+                outcomes->push_back(
+                    {invariant, std::chrono::steady_clock::now() - start, ""});
+                if (!result.empty())
+                {
+                    outcomes->back().mMessage = operationFailureMessage(
+                        *invariant, result, check.mOperation);
+                }
+            }
+        }
+        return asio::error_code();
+    };
+
+    std::weak_ptr<InvariantManagerImpl*> weak(mSelf);
+    mApp.getWorkManager().runInBackground(
+        Work::WORK_EXECUTION_CPU_BOUND, WORK_PRIORITY_LOW, job,
+        [weak, ledger, outcomes](asio::error_code const& ec) {
+            // the work manager still runs handlers after we are gone
+            auto self = weak.lock();
+            if (!self)
+            {
+                return;
+            }
+            auto im = *self;
+            im->mCheckingDeferred = false;
+            if (ec)
+            {
+                CLOG(ERROR, "Invariant")
+                    << "Deferred invariant checks of ledger " << ledger
+                    << " failed: " << ec.message();
+            }
+            for (auto const& outcome : *outcomes)
+            {
+                im->getCheckTimer(outcome.mInvariant).Update(outcome.mElapsed);
+            }
+
+            im->checkNextDeferredLedger();
+            for (auto const& outcome : *outcomes)
+            {
+                if (!outcome.mMessage.empty())
+                {
+                    im->onInvariantFailure(outcome.mInvariant,
+                                           outcome.mMessage, ledger);
+                }
+            }
+        });
 }
 
 void
@@ -165,6 +357,47 @@ InvariantManagerImpl::enableInvariant(std::string const& name)
     }
 }
 
+void
+InvariantManagerImpl::setSamplingPercent(std::string const& name,
+                                         uint32_t percent)
+{
+    auto registryIter = mInvariants.find(name);
+    if (registryIter == mInvariants.end() ||
+        std::find(mEnabled.begin(), mEnabled.end(), registryIter->second) ==
+            mEnabled.end())
+    {
+        throw std::runtime_error{"Invariant " + name + " is not enabled"};
+    }
+    if (percent > 100)
+    {
+        throw std::runtime_error{"Invalid sampling percentage for invariant " +
+                                 name};
+    }
+    mSamplingPercent[name] = percent;
+}
+
+bool
+InvariantManagerImpl::isSampled(std::shared_ptr<Invariant> const& invariant)
+{
+    auto iter = mSamplingPercent.find(invariant->getName());
+    if (iter == mSamplingPercent.end() ||
+        rand_uniform<uint32_t>(1, 100) <= iter->second)
+    {
+        return true;
+    }
+    mMetricsRegistry
+        .NewMeter({"invariant", "skipped", invariant->getName()}, "check")
+        .Mark();
+    return false;
+}
+
+medida::Timer&
+InvariantManagerImpl::getCheckTimer(std::shared_ptr<Invariant> const& invariant)
+{
+    return mMetricsRegistry.NewTimer(
+        {"invariant", "check", invariant->getName()});
+}
+
 void
 InvariantManagerImpl::onInvariantFailure(std::shared_ptr<Invariant> invariant,
                                          std::string const& message,
@@ -6,12 +6,15 @@
 
 #include "invariant/InvariantManager.h"
 #include "util/make_unique.h"
+#include <deque>
 #include <map>
+#include <memory>
 #include <vector>
 
 namespace medida
 {
 class MetricsRegistry;
+class Timer;
 }
 
 namespace stellar
@@ -19,10 +22,30 @@ namespace stellar
 
 class InvariantManagerImpl : public InvariantManager
 {
+    Application& mApp;
     std::map<std::string, std::shared_ptr<Invariant>> mInvariants;
     std::vector<std::shared_ptr<Invariant>> mEnabled;
+    std::map<std::string, uint32_t> mSamplingPercent;
     medida::MetricsRegistry& mMetricsRegistry;
 
+    // the deferred checks of an operation
+    struct DeferredCheck
+    {
+        std::vector<std::shared_ptr<Invariant>> mInvariants;
+        Operation mOperation;
+        OperationResult mResult;
+        std::shared_ptr<LedgerDelta const> mDelta;
+    };
+    // checks of the ledger being closed
+    std::vector<DeferredCheck> mDeferred;
+    // checks of the closed ledgers, waiting for the one being checked
+    std::deque<std::pair<uint32_t, std::vector<DeferredCheck>>>
+        mDeferredLedgers;
+    bool mCheckingDeferred;
+    // handed as a weak pointer to the deferred checks, which must not call
+    // us back once we are destroyed
+    std::shared_ptr<InvariantManagerImpl*> mSelf;
+
     struct InvariantFailureInformation
     {
         uint32_t lastFailedOnLedger;
@@ -31,7 +54,7 @@ class InvariantManagerImpl : public InvariantManager
     std::map<std::string, InvariantFailureInformation> mFailureInformation;
 
   public:
-    InvariantManagerImpl(medida::MetricsRegistry& registry);
+    InvariantManagerImpl(Application& app);
 
     virtual Json::Value getInformation() override;
 
@@ -43,12 +66,33 @@ class InvariantManagerImpl : public InvariantManager
                                     uint32_t ledger, uint32_t level,
                                     bool isCurr) override;
 
+    virtual void checkOnMergedBucketApply(std::shared_ptr<Bucket const> bucket,
+                                          uint32_t ledger,
+                                          uint32_t oldestLedger) override;
+
+    virtual void startLedgerClose() override;
+
+    virtual void checkOnLedgerClose(uint32_t ledger) override;
+
     virtual void
     registerInvariant(std::shared_ptr<Invariant> invariant) override;
 
     virtual void enableInvariant(std::string const& name) override;
 
+    virtual void setSamplingPercent(std::string const& name,
+                                    uint32_t percent) override;
+
   private:
+    // false if the check is skipped by sampling
+    bool isSampled(std::shared_ptr<Invariant> const& invariant);
+    medida::Timer& getCheckTimer(std::shared_ptr<Invariant> const& invariant);
+
+    void checkNextDeferredLedger();
+
+    void checkBucket(std::shared_ptr<Bucket const> bucket, uint32_t ledger,
+                     uint32_t oldestLedger, uint32_t newestLedger,
+                     std::string const& name);
+
     void onInvariantFailure(std::shared_ptr<Invariant> invariant,
                             std::string const& message, uint32_t ledger);
 
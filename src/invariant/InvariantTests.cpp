@@ -14,6 +14,8 @@
 #include "ledger/LedgerTestUtils.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
 #include "test/TestUtils.h"
 #include "test/test.h"
 
@@ -25,7 +27,8 @@ namespace InvariantTests
 class TestInvariant : public Invariant
 {
   public:
-    TestInvariant(bool shouldFail) : Invariant(true), mShouldFail(shouldFail)
+    TestInvariant(bool shouldFail, bool deferrable = false)
+        : Invariant(true), mShouldFail(shouldFail), mDeferrable(deferrable)
     {
     }
 
@@ -35,6 +38,12 @@ class TestInvariant : public Invariant
         return mShouldFail ? "TestInvariant(Fail)" : "TestInvariant(Succeed)";
     }
 
+    virtual bool
+    isDeferrable() const override
+    {
+        return mDeferrable;
+    }
+
     virtual std::string
     checkOnBucketApply(std::shared_ptr<Bucket const> bucket,
                        uint32_t oldestLedger, uint32_t newestLedger) override
@@ -52,6 +61,7 @@ class TestInvariant : public Invariant
 
   private:
     bool mShouldFail;
+    bool mDeferrable;
 };
 }
 
@@ -161,3 +171,100 @@ TEST_CASE("onOperationApply fail/succeed", "[invariant]")
             app->getInvariantManager().checkOnOperationApply({}, res, ld));
     }
 }
+
+TEST_CASE("onOperationApply sampling", "[invariant]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.INVARIANT_CHECKS = {};
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    OperationResult res;
+    LedgerHeader lh(app->getLedgerManager().getCurrentLedgerHeader());
+    LedgerDelta ld(lh, app->getDatabase());
+
+    auto& im = app->getInvariantManager();
+    im.registerInvariant<TestInvariant>(true);
+    REQUIRE_THROWS_AS(im.setSamplingPercent("TestInvariant(Fail)", 0),
+                      std::runtime_error);
+    im.enableInvariant("TestInvariant(Fail)");
+
+    SECTION("never")
+    {
+        im.setSamplingPercent("TestInvariant(Fail)", 0);
+        for (int i = 0; i < 10; i++)
+        {
+            REQUIRE_NOTHROW(im.checkOnOperationApply({}, res, ld));
+        }
+        auto info = im.getInformation();
+        REQUIRE(info["checks"]["TestInvariant(Fail)"]["count"].asInt() == 0);
+        REQUIRE(info["checks"]["TestInvariant(Fail)"]["skipped"].asInt() == 10);
+    }
+    SECTION("always")
+    {
+        im.setSamplingPercent("TestInvariant(Fail)", 100);
+        REQUIRE_THROWS_AS(im.checkOnOperationApply({}, res, ld),
+                          InvariantDoesNotHold);
+        auto info = im.getInformation();
+        REQUIRE(info["checks"]["TestInvariant(Fail)"]["count"].asInt() == 1);
+    }
+}
+
+TEST_CASE("onOperationApply deferred", "[invariant]")
+{
+    VirtualClock clock;
+    Config cfg = getTestConfig();
+    cfg.INVARIANT_CHECKS = {};
+    cfg.DEFER_INVARIANT_CHECKS = true;
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    OperationResult res;
+    LedgerHeader lh(app->getLedgerManager().getCurrentLedgerHeader());
+    LedgerDelta ld(lh, app->getDatabase());
+
+    auto& im = app->getInvariantManager();
+    auto crankUntilChecked = [&](std::string const& name) {
+        auto& timer = app->getMetrics().NewTimer({"invariant", "check", name});
+        while (timer.count() == 0)
+        {
+            clock.crank(false);
+        }
+    };
+
+    SECTION("Fail")
+    {
+        im.registerInvariant<TestInvariant>(true, true);
+        im.enableInvariant("TestInvariant(Fail)");
+        REQUIRE_NOTHROW(im.checkOnOperationApply({}, res, ld));
+        im.checkOnLedgerClose(lh.ledgerSeq);
+        REQUIRE_THROWS_AS(crankUntilChecked("TestInvariant(Fail)"),
+                          InvariantDoesNotHold);
+    }
+    SECTION("Succeed")
+    {
+        im.registerInvariant<TestInvariant>(false, true);
+        im.enableInvariant("TestInvariant(Succeed)");
+        REQUIRE_NOTHROW(im.checkOnOperationApply({}, res, ld));
+        REQUIRE(im.getInformation()["deferred_ledgers"].asInt() == 0);
+        im.checkOnLedgerClose(lh.ledgerSeq);
+        REQUIRE(im.getInformation()["deferred_ledgers"].asInt() == 1);
+        REQUIRE_NOTHROW(crankUntilChecked("TestInvariant(Succeed)"));
+        REQUIRE(im.getInformation()["deferred_ledgers"].asInt() == 0);
+    }
+    SECTION("checks left before a close are dropped")
+    {
+        im.registerInvariant<TestInvariant>(true, true);
+        im.enableInvariant("TestInvariant(Fail)");
+        REQUIRE_NOTHROW(im.checkOnOperationApply({}, res, ld));
+        im.startLedgerClose();
+        im.checkOnLedgerClose(lh.ledgerSeq);
+        REQUIRE(im.getInformation()["deferred_ledgers"].asInt() == 0);
+    }
+    SECTION("not deferrable")
+    {
+        im.registerInvariant<TestInvariant>(true);
+        im.enableInvariant("TestInvariant(Fail)");
+        REQUIRE_THROWS_AS(im.checkOnOperationApply({}, res, ld),
+                          InvariantDoesNotHold);
+    }
+}
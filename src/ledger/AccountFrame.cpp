@@ -11,10 +11,13 @@
 #include "database/Database.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/LedgerRange.h"
+#include "ledger/LedgerStore.h"
 #include "lib/util/format.h"
 #include "util/basen.h"
 #include "util/types.h"
+#include "xdrpp/marshal.h"
 #include <algorithm>
+#include <map>
 
 using namespace soci;
 using namespace std;
@@ -53,6 +56,45 @@ const char* AccountFrame::kSQLCreateStatement4 = "CREATE INDEX accountbalances "
                                                  "ON accounts (balance) WHERE "
                                                  "balance >= 1000000000";
 
+static const char* accountColumnSelector =
+    "SELECT accountid, balance, seqnum, numsubentries, inflationdest, "
+    "homedomain, thresholds, flags, lastmodified, signers "
+    "FROM accounts";
+
+namespace
+{
+// signers are stored in the accounts row, as base64 encoded XDR (NULL if the
+// account has none)
+void
+encodeSigners(xdr::xvector<Signer, 20> const& signers, std::string& encoded,
+              soci::indicator& ind)
+{
+    if (signers.empty())
+    {
+        encoded.clear();
+        ind = soci::i_null;
+    }
+    else
+    {
+        encoded = bn::encode_b64(xdr::xdr_to_opaque(signers));
+        ind = soci::i_ok;
+    }
+}
+
+void
+decodeSigners(std::string const& encoded, soci::indicator ind,
+              xdr::xvector<Signer, 20>& signers)
+{
+    signers.clear();
+    if (ind == soci::i_ok)
+    {
+        std::vector<uint8_t> decoded;
+        bn::decode_b64(encoded, decoded);
+        xdr::xdr_from_opaque(decoded, signers);
+    }
+}
+}
+
 AccountFrame::AccountFrame()
     : EntryFrame(ACCOUNT), mAccountEntry(mEntry.data.account())
 {
@@ -216,24 +258,71 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     if (cachedEntryExists(key, db))
     {
         auto p = getCachedEntry(key, db);
-        return p ? std::make_shared<AccountFrame>(*p) : nullptr;
+        if (!p)
+        {
+            return nullptr;
+        }
+        // the cache holds the entry as it is in the database
+        auto res = std::make_shared<AccountFrame>(*p);
+        res->mUpdateSigners = false;
+        res->mLoadedSigners = res->mAccountEntry.signers;
+        return res;
     }
 
-    std::string actIDStrKey = KeyUtils::toStrKey(accountID);
+    AccountFrame::pointer res;
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = db.getSelectTimer("account");
+        auto entry = store->load(key);
+        if (entry)
+        {
+            res = make_shared<AccountFrame>(*entry);
+        }
+    }
+    else
+    {
+        std::string actIDStrKey = KeyUtils::toStrKeyCached(accountID);
 
-    std::string publicKey, inflationDest, creditAuthKey;
-    std::string homeDomain, thresholds;
-    soci::indicator inflationDestInd;
+        auto query = std::string(accountColumnSelector);
+        query += " WHERE accountid=:v1";
+        auto prep = db.getPreparedStatement(query);
+        auto& st = prep.statement();
+        st.exchange(use(actIDStrKey));
 
-    AccountFrame::pointer res = make_shared<AccountFrame>(accountID);
-    AccountEntry& account = res->getAccount();
+        auto timer = db.getSelectTimer("account");
+        loadAccounts(prep, [&res](LedgerEntry const& account) {
+            res = make_shared<AccountFrame>(account);
+        });
+    }
+
+    if (!res)
+    {
+        putCachedEntry(key, nullptr, db);
+        return nullptr;
+    }
+
+    res->normalize();
+    res->mUpdateSigners = false;
+    res->mLoadedSigners = res->mAccountEntry.signers;
+    res->mKeyCalculated = false;
+    res->putCachedEntry(db);
+    return res;
+}
+
+void
+AccountFrame::loadAccounts(
+    StatementContext& prep,
+    std::function<void(LedgerEntry const&)> accountProcessor)
+{
+    std::string actIDStrKey, inflationDest, homeDomain, thresholds, signers;
+    soci::indicator inflationDestInd, signersInd;
+
+    LedgerEntry le;
+    le.data.type(ACCOUNT);
+    AccountEntry& account = le.data.account();
 
-    auto prep =
-        db.getPreparedStatement("SELECT balance, seqnum, numsubentries, "
-                                "inflationdest, homedomain, thresholds, "
-                                "flags, lastmodified "
-                                "FROM accounts WHERE accountid=:v1");
     auto& st = prep.statement();
+    st.exchange(into(actIDStrKey));
     st.exchange(into(account.balance));
     st.exchange(into(account.seqNum));
     st.exchange(into(account.numSubEntries));
@@ -241,45 +330,60 @@ AccountFrame::loadAccount(AccountID const& accountID, Database& db)
     st.exchange(into(homeDomain));
     st.exchange(into(thresholds));
     st.exchange(into(account.flags));
-    st.exchange(into(res->getLastModified()));
-    st.exchange(use(actIDStrKey));
+    st.exchange(into(le.lastModifiedLedgerSeq));
+    st.exchange(into(signers, signersInd));
     st.define_and_bind();
-    {
-        auto timer = db.getSelectTimer("account");
-        st.execute(true);
-    }
 
-    if (!st.got_data())
+    st.execute(true);
+    while (st.got_data())
     {
-        putCachedEntry(key, nullptr, db);
-        return nullptr;
-    }
+        account.accountID = KeyUtils::fromStrKeyCached(actIDStrKey);
+        account.homeDomain = homeDomain;
+        bn::decode_b64(thresholds.begin(), thresholds.end(),
+                       account.thresholds.begin());
+        if (inflationDestInd == soci::i_ok)
+        {
+            account.inflationDest.activate() =
+                KeyUtils::fromStrKeyCached(inflationDest);
+        }
+        else
+        {
+            account.inflationDest.reset();
+        }
+        decodeSigners(signers, signersInd, account.signers);
 
-    account.homeDomain = homeDomain;
+        accountProcessor(le);
 
-    bn::decode_b64(thresholds.begin(), thresholds.end(),
-                   res->mAccountEntry.thresholds.begin());
+        st.fetch();
+    }
+}
 
-    if (inflationDestInd == soci::i_ok)
+void
+AccountFrame::loadAccounts(
+    soci::session& sess, std::vector<AccountID> const& accountIDs,
+    std::function<void(LedgerEntry const&)> accountProcessor)
+{
+    if (accountIDs.empty())
     {
-        account.inflationDest.activate() =
-            KeyUtils::fromStrKey<PublicKey>(inflationDest);
+        return;
     }
 
-    account.signers.clear();
-
-    if (account.numSubEntries != 0)
+    // StrKeys only hold base32 characters, so can be inlined
+    auto query = std::string(accountColumnSelector);
+    query += " WHERE accountid IN (";
+    for (size_t i = 0; i < accountIDs.size(); i++)
     {
-        auto signers = loadSigners(db, actIDStrKey);
-        account.signers.insert(account.signers.begin(), signers.begin(),
-                               signers.end());
+        query += i == 0 ? "'" : ",'";
+        query += KeyUtils::toStrKeyCached(accountIDs[i]);
+        query += "'";
     }
+    query += ")";
 
-    res->normalize();
-    res->mUpdateSigners = false;
-    res->mKeyCalculated = false;
-    res->putCachedEntry(db);
-    return res;
+    auto st = std::make_shared<soci::statement>(sess);
+    st->alloc();
+    st->prepare(query);
+    StatementContext prep(st);
+    loadAccounts(prep, accountProcessor);
 }
 
 std::vector<Signer>
@@ -320,7 +424,13 @@ AccountFrame::exists(Database& db, LedgerKey const& key)
         return true;
     }
 
-    std::string actIDStrKey = KeyUtils::toStrKey(key.account().accountID);
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = db.getSelectTimer("account-exists");
+        return store->exists(key);
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(key.account().accountID);
     int exists = 0;
     {
         auto timer = db.getSelectTimer("account-exists");
@@ -337,17 +447,26 @@ AccountFrame::exists(Database& db, LedgerKey const& key)
 }
 
 uint64_t
-AccountFrame::countObjects(soci::session& sess)
+AccountFrame::countObjects(Database& db)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(ACCOUNT);
+    }
     uint64_t count = 0;
-    sess << "SELECT COUNT(*) FROM accounts;", into(count);
+    db.getSession() << "SELECT COUNT(*) FROM accounts;", into(count);
     return count;
 }
 
 uint64_t
-AccountFrame::countObjects(soci::session& sess, LedgerRange const& ledgers)
+AccountFrame::countObjects(Database& db, LedgerRange const& ledgers)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(ACCOUNT, &ledgers);
+    }
     uint64_t count = 0;
+    auto& sess = db.getSession();
     sess << "SELECT COUNT(*) FROM accounts"
             " WHERE lastmodified >= :v1 AND lastmodified <= :v2;",
         into(count), use(ledgers.first()), use(ledgers.last());
@@ -364,6 +483,12 @@ AccountFrame::deleteAccountsModifiedOnOrAfterLedger(Database& db,
                    le->lastModifiedLedgerSeq >= oldestLedger;
         });
 
+    if (auto store = db.getLedgerStore())
+    {
+        store->eraseModifiedOnOrAfterLedger(ACCOUNT, oldestLedger);
+        return;
+    }
+
     {
         auto prep = db.getPreparedStatement(
             "DELETE FROM signers WHERE accountid IN"
@@ -395,7 +520,17 @@ AccountFrame::storeDelete(LedgerDelta& delta, Database& db,
 {
     flushCachedEntry(key, db);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(key.account().accountID);
+    if (auto store = db.getLedgerStore())
+    {
+        {
+            auto timer = db.getDeleteTimer("account");
+            store->erase(key);
+        }
+        delta.deleteEntry(key);
+        return;
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(key.account().accountID);
     {
         auto timer = db.getDeleteTimer("account");
         auto prep = db.getPreparedStatement(
@@ -424,7 +559,24 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 
     flushCachedEntry(db);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(mAccountEntry.accountID);
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = insert ? db.getInsertTimer("account")
+                            : db.getUpdateTimer("account");
+        if (insert)
+        {
+            store->insert(mEntry);
+            delta.addEntry(*this);
+        }
+        else
+        {
+            store->update(mEntry);
+            delta.modEntry(*this);
+        }
+        return;
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(mAccountEntry.accountID);
     std::string sql;
 
     if (insert)
@@ -432,8 +584,8 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
         sql = std::string(
             "INSERT INTO accounts ( accountid, balance, seqnum, "
             "numsubentries, inflationdest, homedomain, thresholds, flags, "
-            "lastmodified ) "
-            "VALUES ( :id, :v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8 )");
+            "lastmodified, signers ) "
+            "VALUES ( :id, :v1, :v2, :v3, :v4, :v5, :v6, :v7, :v8, :v9 )");
     }
     else
     {
@@ -441,7 +593,8 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
             "UPDATE accounts SET balance = :v1, seqnum = :v2, "
             "numsubentries = :v3, "
             "inflationdest = :v4, homedomain = :v5, thresholds = :v6, "
-            "flags = :v7, lastmodified = :v8 WHERE accountid = :id");
+            "flags = :v7, lastmodified = :v8, signers = :v9 "
+            "WHERE accountid = :id");
     }
 
     auto prep = db.getPreparedStatement(sql);
@@ -451,12 +604,17 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
 
     if (mAccountEntry.inflationDest)
     {
-        inflationDestStrKey = KeyUtils::toStrKey(*mAccountEntry.inflationDest);
+        inflationDestStrKey =
+            KeyUtils::toStrKeyCached(*mAccountEntry.inflationDest);
         inflation_ind = soci::i_ok;
     }
 
     string thresholds(bn::encode_b64(mAccountEntry.thresholds));
 
+    string signers;
+    soci::indicator signers_ind;
+    encodeSigners(mAccountEntry.signers, signers, signers_ind);
+
     {
         soci::statement& st = prep.statement();
         st.exchange(use(actIDStrKey, "id"));
@@ -469,6 +627,7 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
         st.exchange(use(thresholds, "v6"));
         st.exchange(use(mAccountEntry.flags, "v7"));
         st.exchange(use(getLastModified(), "v8"));
+        st.exchange(use(signers, signers_ind, "v9"));
         st.define_and_bind();
         {
             auto timer = insert ? db.getInsertTimer("account")
@@ -490,16 +649,20 @@ AccountFrame::storeUpdate(LedgerDelta& delta, Database& db, bool insert)
         }
     }
 
-    if (mUpdateSigners)
+    // the signers table is only read back and diffed if the signers changed
+    // since the account was loaded, or if that is not known
+    if (insert || mUpdateSigners || mAccountEntry.signers != mLoadedSigners)
     {
         applySigners(db, insert);
     }
+    mUpdateSigners = false;
+    mLoadedSigners = mAccountEntry.signers;
 }
 
 void
 AccountFrame::applySigners(Database& db, bool insert)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(mAccountEntry.accountID);
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(mAccountEntry.accountID);
 
     // generates a diff with the signers stored in the database
 
@@ -632,6 +795,12 @@ AccountFrame::processForInflation(
     std::function<bool(AccountFrame::InflationVotes const&)> inflationProcessor,
     int maxWinners, Database& db)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        processForInflation(inflationProcessor, maxWinners, *store);
+        return;
+    }
+
     soci::session& session = db.getSession();
 
     InflationVotes v;
@@ -650,7 +819,7 @@ AccountFrame::processForInflation(
 
     while (st.got_data())
     {
-        v.mInflationDest = KeyUtils::fromStrKey<PublicKey>(inflationDest);
+        v.mInflationDest = KeyUtils::fromStrKeyCached(inflationDest);
         if (!inflationProcessor(v))
         {
             break;
@@ -659,56 +828,103 @@ AccountFrame::processForInflation(
     }
 }
 
-std::unordered_map<AccountID, AccountFrame::pointer>
-AccountFrame::checkDB(Database& db)
-{
-    std::unordered_map<AccountID, AccountFrame::pointer> state;
-    {
-        std::string id;
-        soci::statement st =
-            (db.getSession().prepare << "select accountid from accounts",
-             soci::into(id));
-        st.execute(true);
-        while (st.got_data())
+void
+AccountFrame::processForInflation(
+    std::function<bool(AccountFrame::InflationVotes const&)> inflationProcessor,
+    int maxWinners, LedgerStore& store)
+{
+    // same as the query above: a full scan, as there is no index on
+    // inflation destinations
+    std::map<std::string, InflationVotes> votes;
+    store.forEach(ACCOUNT, nullptr, [&votes](LedgerEntry const& le) {
+        auto const& account = le.data.account();
+        if (account.inflationDest && account.balance >= 1000000000)
         {
-            state.insert(
-                std::make_pair(KeyUtils::fromStrKey<PublicKey>(id), nullptr));
-            st.fetch();
+            auto& v = votes[KeyUtils::toStrKeyCached(*account.inflationDest)];
+            v.mInflationDest = *account.inflationDest;
+            v.mVotes += account.balance;
         }
+        return true;
+    });
+
+    // by votes then inflation destination (as a StrKey), descending
+    using Candidate = std::pair<std::string, InflationVotes>;
+    std::vector<Candidate> winners(votes.begin(), votes.end());
+    std::sort(winners.begin(), winners.end(),
+              [](Candidate const& a, Candidate const& b) {
+                  if (a.second.mVotes != b.second.mVotes)
+                  {
+                      return a.second.mVotes > b.second.mVotes;
+                  }
+                  return a.first > b.first;
+              });
+    if (maxWinners >= 0 && winners.size() > size_t(maxWinners))
+    {
+        winners.resize(maxWinners);
     }
-    // load all accounts
-    for (auto& s : state)
+
+    for (auto const& w : winners)
     {
-        s.second = AccountFrame::loadAccount(s.first, db);
+        if (!inflationProcessor(w.second))
+        {
+            break;
+        }
     }
+}
+
+void
+AccountFrame::loadAllAccounts(
+    soci::session& sess,
+    std::function<void(LedgerEntry const&)> accountProcessor)
+{
+    auto st = std::make_shared<soci::statement>(sess);
+    st->alloc();
+    st->prepare(accountColumnSelector);
+    StatementContext prep(st);
+    loadAccounts(prep, [&accountProcessor](LedgerEntry const& le) {
+        // as normalize does for loadAccount
+        auto account = le;
+        auto& signers = account.data.account().signers;
+        std::sort(signers.begin(), signers.end(), &AccountFrame::signerCompare);
+        accountProcessor(account);
+    });
+}
+
+void
+AccountFrame::copySignersToAccounts(Database& db)
+{
+    auto& session = db.getSession();
+    session << "ALTER TABLE accounts ADD signers TEXT";
 
+    std::map<std::string, xdr::xvector<Signer, 20>> signersByAccount;
     {
-        std::string id;
-        size_t n;
-        // sanity check signers state
+        std::string id, pubKey;
+        Signer signer;
         soci::statement st =
-            (db.getSession().prepare << "select count(*), accountid from "
-                                        "signers group by accountid",
-             soci::into(n), soci::into(id));
+            (session.prepare
+                 << "SELECT accountid, publickey, weight FROM signers",
+             soci::into(id), soci::into(pubKey), soci::into(signer.weight));
         st.execute(true);
         while (st.got_data())
         {
-            AccountID aid(KeyUtils::fromStrKey<PublicKey>(id));
-            auto it = state.find(aid);
-            if (it == state.end())
-            {
-                throw std::runtime_error(fmt::format(
-                    "Found extra signers in database for account {}", id));
-            }
-            else if (n != it->second->mAccountEntry.signers.size())
-            {
-                throw std::runtime_error(
-                    fmt::format("Mismatch signers for account {}", id));
-            }
+            signer.key = KeyUtils::fromStrKey<SignerKey>(pubKey);
+            signersByAccount[id].push_back(signer);
             st.fetch();
         }
     }
-    return state;
+
+    for (auto& kv : signersByAccount)
+    {
+        std::sort(kv.second.begin(), kv.second.end(),
+                  &AccountFrame::signerCompare);
+        std::string signers;
+        soci::indicator signersInd;
+        encodeSigners(kv.second, signers, signersInd);
+        session << "UPDATE accounts SET signers = :v1 WHERE accountid = :id",
+            soci::use(signers, signersInd), soci::use(kv.first);
+    }
+
+    db.getEntryCache().clear();
 }
 
 void
@@ -22,11 +22,16 @@ namespace stellar
 {
 class LedgerManager;
 class LedgerRange;
+class LedgerStore;
+class StatementContext;
 
 class AccountFrame : public EntryFrame
 {
     void storeUpdate(LedgerDelta& delta, Database& db, bool insert);
+    // set when the signers table may not match mLoadedSigners, the signers
+    // of the account as last loaded from or stored to the database
     bool mUpdateSigners;
+    xdr::xvector<Signer, 20> mLoadedSigners;
 
     AccountEntry& mAccountEntry;
 
@@ -36,6 +41,10 @@ class AccountFrame : public EntryFrame
                                            std::string const& actIDStrKey);
     void applySigners(Database& db, bool insert);
 
+    static void
+    loadAccounts(StatementContext& prep,
+                 std::function<void(LedgerEntry const&)> accountProcessor);
+
   public:
     typedef std::shared_ptr<AccountFrame> pointer;
 
@@ -119,18 +128,29 @@ class AccountFrame : public EntryFrame
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
     static bool exists(Database& db, LedgerKey const& key);
-    static uint64_t countObjects(soci::session& sess);
-    static uint64_t countObjects(soci::session& sess,
-                                 LedgerRange const& ledgers);
+    static uint64_t countObjects(Database& db);
+    static uint64_t countObjects(Database& db, LedgerRange const& ledgers);
     static void deleteAccountsModifiedOnOrAfterLedger(Database& db,
                                                       uint32_t oldestLedger);
 
+    // Schema version 7: copies the signers table into the signers column of
+    // the accounts table, which accounts are loaded from. The signers table
+    // is still kept up to date for external readers (e.g. Horizon).
+    static void copySignersToAccounts(Database& db);
+
     // database utilities
     static AccountFrame::pointer
     loadAccount(LedgerDelta& delta, AccountID const& accountID, Database& db);
     static AccountFrame::pointer loadAccount(AccountID const& accountID,
                                              Database& db);
 
+    // Loads the accounts of @p accountIDs that exist with a single query on
+    // @p sess, which may be a session of the connection pool. Does not use
+    // the entry cache.
+    static void
+    loadAccounts(soci::session& sess, std::vector<AccountID> const& accountIDs,
+                 std::function<void(LedgerEntry const&)> accountProcessor);
+
     // compare signers, ignores weight
     static bool signerCompare(Signer const& s1, Signer const& s2);
 
@@ -147,13 +167,20 @@ class AccountFrame : public EntryFrame
         std::function<bool(InflationVotes const&)> inflationProcessor,
         int maxWinners, Database& db);
 
-    // loads all accounts from database and checks for consistency (slow!)
-    static std::unordered_map<AccountID, AccountFrame::pointer>
-    checkDB(Database& db);
+    // Loads all the accounts of the accounts table, in no particular order,
+    // on @p sess, which may be a session of the connection pool. Does not use
+    // the entry cache nor the ledger store.
+    static void
+    loadAllAccounts(soci::session& sess,
+                    std::function<void(LedgerEntry const&)> accountProcessor);
 
     static void dropAll(Database& db);
 
   private:
+    static void processForInflation(
+        std::function<bool(InflationVotes const&)> inflationProcessor,
+        int maxWinners, LedgerStore& store);
+
     static const char* kSQLCreateStatement1;
     static const char* kSQLCreateStatement2;
     static const char* kSQLCreateStatement3;
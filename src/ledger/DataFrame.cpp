@@ -9,6 +9,7 @@
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerRange.h"
+#include "ledger/LedgerStore.h"
 #include "transactions/ManageDataOpFrame.h"
 #include "util/basen.h"
 #include "util/types.h"
@@ -79,7 +80,22 @@ DataFrame::loadData(AccountID const& accountID, std::string dataName,
 {
     DataFrame::pointer retData;
 
-    std::string actIDStrKey = KeyUtils::toStrKey(accountID);
+    if (auto store = db.getLedgerStore())
+    {
+        LedgerKey key;
+        key.type(DATA);
+        key.data().accountID = accountID;
+        key.data().dataName = dataName;
+        auto timer = db.getSelectTimer("data");
+        auto entry = store->load(key);
+        if (entry)
+        {
+            retData = make_shared<DataFrame>(*entry);
+        }
+        return retData;
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(accountID);
 
     std::string sql = dataColumnSelector;
     sql += " WHERE accountid = :id AND dataname = :dataname";
@@ -119,7 +135,7 @@ DataFrame::loadData(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        oe.accountID = KeyUtils::fromStrKey<PublicKey>(actIDStrKey);
+        oe.accountID = KeyUtils::fromStrKeyCached(actIDStrKey);
 
         if ((dataNameIndicator != soci::i_ok) ||
             (dataValueIndicator != soci::i_ok))
@@ -134,26 +150,27 @@ DataFrame::loadData(StatementContext& prep,
     }
 }
 
-std::unordered_map<AccountID, std::vector<DataFrame::pointer>>
-DataFrame::loadAllData(Database& db)
+void
+DataFrame::loadAllData(soci::session& sess,
+                       std::function<void(LedgerEntry const&)> dataProcessor)
 {
-    std::unordered_map<AccountID, std::vector<DataFrame::pointer>> retData;
-    std::string sql = dataColumnSelector;
-    sql += " ORDER BY accountid";
-    auto prep = db.getPreparedStatement(sql);
-
-    auto timer = db.getSelectTimer("data");
-    loadData(prep, [&retData](LedgerEntry const& of) {
-        auto& thisUserData = retData[of.data.data().accountID];
-        thisUserData.emplace_back(make_shared<DataFrame>(of));
-    });
-    return retData;
+    auto st = std::make_shared<soci::statement>(sess);
+    st->alloc();
+    st->prepare(dataColumnSelector);
+    StatementContext prep(st);
+    loadData(prep, dataProcessor);
 }
 
 bool
 DataFrame::exists(Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(key.data().accountID);
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = db.getSelectTimer("data-exists");
+        return store->exists(key);
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(key.data().accountID);
     std::string dataName = key.data().dataName;
     int exists = 0;
     auto timer = db.getSelectTimer("data-exists");
@@ -170,17 +187,26 @@ DataFrame::exists(Database& db, LedgerKey const& key)
 }
 
 uint64_t
-DataFrame::countObjects(soci::session& sess)
+DataFrame::countObjects(Database& db)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(DATA);
+    }
     uint64_t count = 0;
-    sess << "SELECT COUNT(*) FROM accountdata;", into(count);
+    db.getSession() << "SELECT COUNT(*) FROM accountdata;", into(count);
     return count;
 }
 
 uint64_t
-DataFrame::countObjects(soci::session& sess, LedgerRange const& ledgers)
+DataFrame::countObjects(Database& db, LedgerRange const& ledgers)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(DATA, &ledgers);
+    }
     uint64_t count = 0;
+    auto& sess = db.getSession();
     sess << "SELECT COUNT(*) FROM accountdata"
             " WHERE lastmodified >= :v1 AND lastmodified <= :v2;",
         into(count), use(ledgers.first()), use(ledgers.last());
@@ -197,6 +223,11 @@ DataFrame::deleteDataModifiedOnOrAfterLedger(Database& db,
                    le->lastModifiedLedgerSeq >= oldestLedger;
         });
 
+    if (auto store = db.getLedgerStore())
+    {
+        store->eraseModifiedOnOrAfterLedger(DATA, oldestLedger);
+    }
+    else
     {
         auto prep = db.getPreparedStatement(
             "DELETE FROM accountdata WHERE lastmodified >= :v1");
@@ -216,7 +247,17 @@ DataFrame::storeDelete(LedgerDelta& delta, Database& db) const
 void
 DataFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(key.data().accountID);
+    if (auto store = db.getLedgerStore())
+    {
+        {
+            auto timer = db.getDeleteTimer("data");
+            store->erase(key);
+        }
+        delta.deleteEntry(key);
+        return;
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(key.data().accountID);
     std::string dataName = key.data().dataName;
     auto timer = db.getDeleteTimer("data");
     auto prep = db.getPreparedStatement(
@@ -246,7 +287,22 @@ DataFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 {
     touch(delta);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(mData.accountID);
+    if (auto store = db.getLedgerStore())
+    {
+        if (insert)
+        {
+            store->insert(mEntry);
+            delta.addEntry(*this);
+        }
+        else
+        {
+            store->update(mEntry);
+            delta.modEntry(*this);
+        }
+        return;
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(mData.accountID);
     std::string dataName = mData.dataName;
     std::string dataValue = bn::encode_b64(mData.dataValue);
 
@@ -68,9 +68,8 @@ class DataFrame : public EntryFrame
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
     static bool exists(Database& db, LedgerKey const& key);
-    static uint64_t countObjects(soci::session& sess);
-    static uint64_t countObjects(soci::session& sess,
-                                 LedgerRange const& ledgers);
+    static uint64_t countObjects(Database& db);
+    static uint64_t countObjects(Database& db, LedgerRange const& ledgers);
     static void deleteDataModifiedOnOrAfterLedger(Database& db,
                                                   uint32_t oldestLedger);
 
@@ -78,9 +77,11 @@ class DataFrame : public EntryFrame
     static pointer loadData(AccountID const& accountID, std::string dataName,
                             Database& db);
 
-    // load all data entries from the database (very slow)
-    static std::unordered_map<AccountID, std::vector<DataFrame::pointer>>
-    loadAllData(Database& db);
+    // Loads all the data entries of the accountdata table, in no particular
+    // order, on @p sess, which may be a session of the connection pool.
+    static void
+    loadAllData(soci::session& sess,
+                std::function<void(LedgerEntry const&)> dataProcessor);
 
     static void dropAll(Database& db);
 
@@ -0,0 +1,475 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/KeyValueLedgerStore.h"
+#include "database/Database.h"
+#include "ledger/EntryFrame.h"
+#include "ledger/LedgerRange.h"
+#include "util/make_unique.h"
+#include "xdrpp/marshal.h"
+
+#include "soci-sqlite3.h"
+
+#include <stdexcept>
+
+using namespace sqlite_api;
+
+namespace stellar
+{
+
+const char* KeyValueLedgerStore::kSQLCreateStatement1 =
+    "CREATE TABLE ledgerstate"
+    "("
+    "ledgerkey       BLOB PRIMARY KEY,"
+    "ledgerentry     BLOB NOT NULL,"
+    "entrytype       INT  NOT NULL,"
+    "lastmodified    INT  NOT NULL"
+    ") WITHOUT ROWID;";
+
+// book is the XDR of the selling asset followed by the XDR of the buying
+// asset, price is n/d as in the offers table
+const char* KeyValueLedgerStore::kSQLCreateStatement2 =
+    "CREATE TABLE ledgerstateoffers"
+    "("
+    "book            BLOB             NOT NULL,"
+    "price           DOUBLE PRECISION NOT NULL,"
+    "offerid         BIGINT           NOT NULL,"
+    "ledgerkey       BLOB             NOT NULL,"
+    "PRIMARY KEY (book, price, offerid)"
+    ") WITHOUT ROWID;";
+
+const char* KeyValueLedgerStore::kSQLCreateStatement3 =
+    "CREATE UNIQUE INDEX ledgerstateoffersbykey ON ledgerstateoffers "
+    "(ledgerkey);";
+
+const char* KeyValueLedgerStore::kSQLCreateStatement4 =
+    "CREATE INDEX ledgerstatebymodified ON ledgerstate "
+    "(entrytype, lastmodified);";
+
+namespace
+{
+void
+throwError(sqlite3* conn)
+{
+    throw std::runtime_error(std::string("ledger store: ") +
+                             sqlite3_errmsg(conn));
+}
+
+sqlite3*
+getConnection(Database& db)
+{
+    auto backend = dynamic_cast<soci::sqlite3_session_backend*>(
+        db.getSession().get_backend());
+    if (!backend)
+    {
+        throw std::runtime_error("ledger store: requires a SQLite database");
+    }
+    return backend->conn_;
+}
+
+// keys of the entries of @p type, of @p account if not nullptr, are the keys
+// starting with the returned bytes
+std::vector<uint8_t>
+keyPrefix(LedgerEntryType type, AccountID const* account)
+{
+    std::vector<uint8_t> prefix;
+    auto t = static_cast<uint32_t>(type);
+    for (int shift = 24; shift >= 0; shift -= 8)
+    {
+        prefix.push_back(static_cast<uint8_t>(t >> shift));
+    }
+    if (account)
+    {
+        auto id = xdr::xdr_to_opaque(*account);
+        prefix.insert(prefix.end(), id.begin(), id.end());
+    }
+    return prefix;
+}
+
+// first key after all the keys starting with @p prefix
+std::vector<uint8_t>
+prefixEnd(std::vector<uint8_t> prefix)
+{
+    while (!prefix.empty() && prefix.back() == 0xff)
+    {
+        prefix.pop_back();
+    }
+    if (prefix.empty())
+    {
+        throw std::runtime_error("ledger store: unbounded key prefix");
+    }
+    prefix.back()++;
+    return prefix;
+}
+
+std::vector<uint8_t>
+bookKey(Asset const& selling, Asset const& buying)
+{
+    std::vector<uint8_t> book = xdr::xdr_to_opaque(selling);
+    auto b = xdr::xdr_to_opaque(buying);
+    book.insert(book.end(), b.begin(), b.end());
+    return book;
+}
+}
+
+// A statement prepared on the store connection, reset after each use.
+class KeyValueLedgerStore::Statement
+{
+    sqlite3* mConn;
+    sqlite3_stmt* mStmt{nullptr};
+
+  public:
+    Statement(sqlite3* conn, char const* sql) : mConn(conn)
+    {
+        if (sqlite3_prepare_v2(conn, sql, -1, &mStmt, nullptr) != SQLITE_OK)
+        {
+            throwError(conn);
+        }
+    }
+
+    ~Statement()
+    {
+        sqlite3_finalize(mStmt);
+    }
+
+    void
+    bind(int i, std::vector<uint8_t> const& blob)
+    {
+        // the blobs outlive the statement execution
+        if (sqlite3_bind_blob(mStmt, i, blob.data(),
+                              static_cast<int>(blob.size()),
+                              SQLITE_STATIC) != SQLITE_OK)
+        {
+            throwError(mConn);
+        }
+    }
+
+    void
+    bind(int i, double value)
+    {
+        if (sqlite3_bind_double(mStmt, i, value) != SQLITE_OK)
+        {
+            throwError(mConn);
+        }
+    }
+
+    void
+    bind(int i, int64_t value)
+    {
+        if (sqlite3_bind_int64(mStmt, i, value) != SQLITE_OK)
+        {
+            throwError(mConn);
+        }
+    }
+
+    // Returns true if a row is available.
+    bool
+    step()
+    {
+        auto rc = sqlite3_step(mStmt);
+        if (rc == SQLITE_ROW)
+        {
+            return true;
+        }
+        if (rc != SQLITE_DONE)
+        {
+            throwError(mConn);
+        }
+        return false;
+    }
+
+    void
+    column(int i, std::vector<uint8_t>& blob)
+    {
+        auto data = static_cast<uint8_t const*>(sqlite3_column_blob(mStmt, i));
+        blob.assign(data, data + sqlite3_column_bytes(mStmt, i));
+    }
+
+    int64_t
+    columnInt(int i)
+    {
+        return sqlite3_column_int64(mStmt, i);
+    }
+
+    int
+    changes()
+    {
+        return sqlite3_changes(mConn);
+    }
+
+    void
+    reset()
+    {
+        sqlite3_reset(mStmt);
+        sqlite3_clear_bindings(mStmt);
+    }
+
+    // Resets the statement when going out of scope.
+    class Scope
+    {
+        Statement& mStatement;
+
+      public:
+        explicit Scope(Statement& st) : mStatement(st)
+        {
+        }
+        ~Scope()
+        {
+            mStatement.reset();
+        }
+    };
+};
+
+KeyValueLedgerStore::KeyValueLedgerStore(Database& db)
+    : mConn(getConnection(db))
+{
+    mLoad = prepare("SELECT ledgerentry FROM ledgerstate WHERE ledgerkey = ?1");
+    mExists = prepare("SELECT EXISTS (SELECT NULL FROM ledgerstate "
+                      "WHERE ledgerkey = ?1)");
+    mInsert = prepare("INSERT INTO ledgerstate "
+                      "(ledgerkey, ledgerentry, entrytype, lastmodified) "
+                      "VALUES (?1, ?2, ?3, ?4)");
+    mUpdate = prepare("UPDATE ledgerstate SET ledgerentry = ?2, "
+                      "lastmodified = ?3 WHERE ledgerkey = ?1");
+    mErase = prepare("DELETE FROM ledgerstate WHERE ledgerkey = ?1");
+    mInsertOffer = prepare("INSERT INTO ledgerstateoffers "
+                           "(book, price, offerid, ledgerkey) "
+                           "VALUES (?1, ?2, ?3, ?4)");
+    mEraseOffer = prepare("DELETE FROM ledgerstateoffers WHERE ledgerkey = ?1");
+    // same resume condition as OfferFrame::loadBestOffers
+    mBestOffers = prepare(
+        "SELECT e.ledgerentry FROM ledgerstateoffers o "
+        "JOIN ledgerstate e ON e.ledgerkey = o.ledgerkey "
+        "WHERE o.book = ?1 AND o.price >= ?2 "
+        "AND (o.price > ?2 OR o.offerid > ?3) "
+        "ORDER BY o.price, o.offerid LIMIT ?4");
+    mCount = prepare("SELECT COUNT(*) FROM ledgerstate WHERE entrytype = ?1");
+    mCountModified = prepare("SELECT COUNT(*) FROM ledgerstate "
+                             "WHERE entrytype = ?1 AND lastmodified >= ?2 "
+                             "AND lastmodified <= ?3");
+    mEraseModifiedOffers = prepare(
+        "DELETE FROM ledgerstateoffers WHERE ledgerkey IN "
+        "(SELECT ledgerkey FROM ledgerstate "
+        "WHERE entrytype = ?1 AND lastmodified >= ?2)");
+    mEraseModified = prepare("DELETE FROM ledgerstate "
+                             "WHERE entrytype = ?1 AND lastmodified >= ?2");
+}
+
+KeyValueLedgerStore::~KeyValueLedgerStore()
+{
+}
+
+std::unique_ptr<KeyValueLedgerStore::Statement>
+KeyValueLedgerStore::prepare(char const* sql)
+{
+    return make_unique<Statement>(mConn, sql);
+}
+
+std::shared_ptr<LedgerEntry>
+KeyValueLedgerStore::load(LedgerKey const& key)
+{
+    auto k = xdr::xdr_to_opaque(key);
+    Statement::Scope scope(*mLoad);
+    mLoad->bind(1, k);
+    if (!mLoad->step())
+    {
+        return nullptr;
+    }
+    mLoad->column(0, mBuffer);
+    auto entry = std::make_shared<LedgerEntry>();
+    xdr::xdr_from_opaque(mBuffer, *entry);
+    return entry;
+}
+
+bool
+KeyValueLedgerStore::exists(LedgerKey const& key)
+{
+    auto k = xdr::xdr_to_opaque(key);
+    Statement::Scope scope(*mExists);
+    mExists->bind(1, k);
+    return mExists->step() && mExists->columnInt(0) != 0;
+}
+
+void
+KeyValueLedgerStore::insertOffer(std::vector<uint8_t> const& key,
+                                 OfferEntry const& offer)
+{
+    auto book = bookKey(offer.selling, offer.buying);
+    // same as OfferFrame::computePrice
+    double price = double(offer.price.n) / double(offer.price.d);
+    Statement::Scope scope(*mInsertOffer);
+    mInsertOffer->bind(1, book);
+    mInsertOffer->bind(2, price);
+    mInsertOffer->bind(3, static_cast<int64_t>(offer.offerID));
+    mInsertOffer->bind(4, key);
+    mInsertOffer->step();
+}
+
+void
+KeyValueLedgerStore::eraseOffer(std::vector<uint8_t> const& key)
+{
+    Statement::Scope scope(*mEraseOffer);
+    mEraseOffer->bind(1, key);
+    mEraseOffer->step();
+}
+
+void
+KeyValueLedgerStore::insert(LedgerEntry const& entry)
+{
+    auto k = xdr::xdr_to_opaque(LedgerEntryKey(entry));
+    auto e = xdr::xdr_to_opaque(entry);
+    {
+        Statement::Scope scope(*mInsert);
+        mInsert->bind(1, k);
+        mInsert->bind(2, e);
+        mInsert->bind(3, static_cast<int64_t>(entry.data.type()));
+        mInsert->bind(4, static_cast<int64_t>(entry.lastModifiedLedgerSeq));
+        mInsert->step();
+    }
+    if (entry.data.type() == OFFER)
+    {
+        insertOffer(k, entry.data.offer());
+    }
+}
+
+void
+KeyValueLedgerStore::update(LedgerEntry const& entry)
+{
+    auto k = xdr::xdr_to_opaque(LedgerEntryKey(entry));
+    auto e = xdr::xdr_to_opaque(entry);
+    {
+        Statement::Scope scope(*mUpdate);
+        mUpdate->bind(1, k);
+        mUpdate->bind(2, e);
+        mUpdate->bind(3, static_cast<int64_t>(entry.lastModifiedLedgerSeq));
+        mUpdate->step();
+        if (mUpdate->changes() != 1)
+        {
+            throw std::runtime_error("ledger store: could not update entry");
+        }
+    }
+    if (entry.data.type() == OFFER)
+    {
+        // price and assets may have changed
+        eraseOffer(k);
+        insertOffer(k, entry.data.offer());
+    }
+}
+
+void
+KeyValueLedgerStore::erase(LedgerKey const& key)
+{
+    auto k = xdr::xdr_to_opaque(key);
+    {
+        Statement::Scope scope(*mErase);
+        mErase->bind(1, k);
+        mErase->step();
+    }
+    if (key.type() == OFFER)
+    {
+        eraseOffer(k);
+    }
+}
+
+void
+KeyValueLedgerStore::forEach(LedgerEntryType type, AccountID const* account,
+                             std::function<bool(LedgerEntry const&)> f)
+{
+    // scans are rare (inflation, checks, catchup) and may nest: each gets
+    // its own statement
+    Statement st(mConn, "SELECT ledgerentry FROM ledgerstate "
+                        "WHERE ledgerkey >= ?1 AND ledgerkey < ?2 "
+                        "ORDER BY ledgerkey");
+    auto begin = keyPrefix(type, account);
+    auto end = prefixEnd(begin);
+    st.bind(1, begin);
+    st.bind(2, end);
+
+    std::vector<uint8_t> buffer;
+    LedgerEntry entry;
+    while (st.step())
+    {
+        st.column(0, buffer);
+        xdr::xdr_from_opaque(buffer, entry);
+        if (!f(entry))
+        {
+            break;
+        }
+    }
+}
+
+void
+KeyValueLedgerStore::loadBestOffers(size_t numOffers, Asset const& selling,
+                                    Asset const& buying,
+                                    OfferEntry const* after,
+                                    std::function<void(LedgerEntry const&)> f)
+{
+    auto book = bookKey(selling, buying);
+    // prices are positive
+    double afterPrice = -1;
+    int64_t afterOfferID = 0;
+    if (after)
+    {
+        afterPrice = double(after->price.n) / double(after->price.d);
+        afterOfferID = static_cast<int64_t>(after->offerID);
+    }
+
+    // entries are decoded as they come: f must not load offers again
+    Statement::Scope scope(*mBestOffers);
+    mBestOffers->bind(1, book);
+    mBestOffers->bind(2, afterPrice);
+    mBestOffers->bind(3, afterOfferID);
+    mBestOffers->bind(4, static_cast<int64_t>(numOffers));
+    LedgerEntry entry;
+    while (mBestOffers->step())
+    {
+        mBestOffers->column(0, mBuffer);
+        xdr::xdr_from_opaque(mBuffer, entry);
+        f(entry);
+    }
+}
+
+uint64_t
+KeyValueLedgerStore::countEntries(LedgerEntryType type,
+                                  LedgerRange const* ledgers)
+{
+    auto& st = ledgers ? *mCountModified : *mCount;
+    Statement::Scope scope(st);
+    st.bind(1, static_cast<int64_t>(type));
+    if (ledgers)
+    {
+        st.bind(2, static_cast<int64_t>(ledgers->first()));
+        st.bind(3, static_cast<int64_t>(ledgers->last()));
+    }
+    return st.step() ? static_cast<uint64_t>(st.columnInt(0)) : 0;
+}
+
+void
+KeyValueLedgerStore::eraseModifiedOnOrAfterLedger(LedgerEntryType type,
+                                                  uint32_t oldestLedger)
+{
+    if (type == OFFER)
+    {
+        Statement::Scope scope(*mEraseModifiedOffers);
+        mEraseModifiedOffers->bind(1, static_cast<int64_t>(type));
+        mEraseModifiedOffers->bind(2, static_cast<int64_t>(oldestLedger));
+        mEraseModifiedOffers->step();
+    }
+    Statement::Scope scope(*mEraseModified);
+    mEraseModified->bind(1, static_cast<int64_t>(type));
+    mEraseModified->bind(2, static_cast<int64_t>(oldestLedger));
+    mEraseModified->step();
+}
+
+void
+KeyValueLedgerStore::dropAll(Database& db)
+{
+    db.getSession() << "DROP TABLE IF EXISTS ledgerstateoffers;";
+    db.getSession() << "DROP TABLE IF EXISTS ledgerstate;";
+    db.getSession() << kSQLCreateStatement1;
+    db.getSession() << kSQLCreateStatement2;
+    db.getSession() << kSQLCreateStatement3;
+    db.getSession() << kSQLCreateStatement4;
+}
+}
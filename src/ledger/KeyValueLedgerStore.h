@@ -0,0 +1,93 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerStore.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace sqlite_api
+{
+struct sqlite3;
+struct sqlite3_stmt;
+}
+
+namespace stellar
+{
+
+class Database;
+
+/**
+ * LedgerStore keeping the ledger entries in a single B-tree, the
+ * "ledgerstate" table of the SQLite database, which maps the XDR of each
+ * LedgerKey to the XDR of its LedgerEntry. Selected by
+ * LEDGER_STATE_STORE=kv, SQLite only.
+ *
+ * XDR keys start with the entry type then the account, so that the entries
+ * of a type, or of an account, are a range of keys. The type and last
+ * modified ledger of each entry are also kept in indexed columns, so that
+ * entries can be counted and rolled back without decoding them. Order books
+ * are kept in a second table, "ledgerstateoffers", indexed by (assets,
+ * price, offer id).
+ *
+ * The store talks to SQLite directly, through statements prepared once on
+ * the main connection: entries are read and written as whole blobs, without
+ * the column mapping (StrKeys, base64) of the SQL tables. As the connection
+ * is shared, writes are part of the current ledger close transaction.
+ */
+class KeyValueLedgerStore : public LedgerStore
+{
+    class Statement;
+
+    sqlite_api::sqlite3* mConn;
+    std::unique_ptr<Statement> mLoad;
+    std::unique_ptr<Statement> mExists;
+    std::unique_ptr<Statement> mInsert;
+    std::unique_ptr<Statement> mUpdate;
+    std::unique_ptr<Statement> mErase;
+    std::unique_ptr<Statement> mInsertOffer;
+    std::unique_ptr<Statement> mEraseOffer;
+    std::unique_ptr<Statement> mBestOffers;
+    std::unique_ptr<Statement> mCount;
+    std::unique_ptr<Statement> mCountModified;
+    std::unique_ptr<Statement> mEraseModifiedOffers;
+    std::unique_ptr<Statement> mEraseModified;
+    // entries are copied out of SQLite before decoding, as XDR decoding
+    // requires aligned data
+    std::vector<uint8_t> mBuffer;
+
+    std::unique_ptr<Statement> prepare(char const* sql);
+    void eraseOffer(std::vector<uint8_t> const& key);
+    void insertOffer(std::vector<uint8_t> const& key, OfferEntry const& offer);
+
+  public:
+    explicit KeyValueLedgerStore(Database& db);
+    ~KeyValueLedgerStore();
+
+    std::shared_ptr<LedgerEntry> load(LedgerKey const& key) override;
+    bool exists(LedgerKey const& key) override;
+    void insert(LedgerEntry const& entry) override;
+    void update(LedgerEntry const& entry) override;
+    void erase(LedgerKey const& key) override;
+    void forEach(LedgerEntryType type, AccountID const* account,
+                 std::function<bool(LedgerEntry const&)> f) override;
+    void loadBestOffers(size_t numOffers, Asset const& selling,
+                        Asset const& buying, OfferEntry const* after,
+                        std::function<void(LedgerEntry const&)> f) override;
+    uint64_t countEntries(LedgerEntryType type,
+                          LedgerRange const* ledgers = nullptr) override;
+    void eraseModifiedOnOrAfterLedger(LedgerEntryType type,
+                                      uint32_t oldestLedger) override;
+
+    static void dropAll(Database& db);
+
+  private:
+    static const char* kSQLCreateStatement1;
+    static const char* kSQLCreateStatement2;
+    static const char* kSQLCreateStatement3;
+    static const char* kSQLCreateStatement4;
+};
+}
@@ -0,0 +1,165 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerCloseTracer.h"
+#include "lib/json/json.h"
+#include "main/Application.h"
+#include "main/Config.h"
+
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+namespace stellar
+{
+
+namespace
+{
+bool
+isAccumulated(LedgerCloseTracer::Phase phase)
+{
+    return phase == LedgerCloseTracer::TX_META;
+}
+
+Json::Int64
+toMicroseconds(LedgerCloseTracer::clock::duration d)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+}
+}
+
+LedgerCloseTracer::Span::Span(LedgerCloseTracer& tracer, Phase phase)
+    : mTracer(tracer), mPhase(phase), mStart(clock::now())
+{
+}
+
+LedgerCloseTracer::Span::~Span()
+{
+    mTracer.endSpan(mPhase, mStart);
+}
+
+LedgerCloseTracer::LedgerCloseTracer(Application& app)
+    : mTraceSize(app.getConfig().LEDGER_CLOSE_TRACE_SIZE)
+    , mOrigin(clock::now())
+    , mInLedger(false)
+{
+    for (int i = 0; i < NUM_PHASES; i++)
+    {
+        mPhaseTimers.push_back(&app.getMetrics().NewTimer(
+            {"ledger", "close", getPhaseName(static_cast<Phase>(i))}));
+    }
+}
+
+char const*
+LedgerCloseTracer::getPhaseName(Phase phase)
+{
+    static char const* names[NUM_PHASES] = {"prefetch",
+                                            "fees",
+                                            "apply",
+                                            "tx-meta",
+                                            "upgrades",
+                                            "bucket-add",
+                                            "bucket-snapshot",
+                                            "header-store",
+                                            "has-serialize",
+                                            "checkpoint-write",
+                                            "history-queue",
+                                            "sql-commit",
+                                            "publish",
+                                            "bucket-gc"};
+    return names[phase];
+}
+
+void
+LedgerCloseTracer::startLedger(uint32_t ledgerSeq, size_t txCount)
+{
+    mInLedger = mTraceSize != 0;
+    if (!mInLedger)
+    {
+        return;
+    }
+    mCurrent.mLedgerSeq = ledgerSeq;
+    mCurrent.mTxCount = txCount;
+    mCurrent.mStart = clock::now();
+    mCurrent.mDuration = clock::duration::zero();
+    mCurrent.mEvents.clear();
+    mCurrent.mAccumulated.fill(clock::duration::zero());
+}
+
+void
+LedgerCloseTracer::finishLedger()
+{
+    if (!mInLedger)
+    {
+        return;
+    }
+    mInLedger = false;
+    mCurrent.mDuration = clock::now() - mCurrent.mStart;
+    mTraces.emplace_back(std::move(mCurrent));
+    while (mTraces.size() > mTraceSize)
+    {
+        mTraces.pop_front();
+    }
+}
+
+void
+LedgerCloseTracer::endSpan(Phase phase, clock::time_point start)
+{
+    auto duration = clock::now() - start;
+    mPhaseTimers[phase]->Update(duration);
+    if (!mInLedger)
+    {
+        return;
+    }
+    if (isAccumulated(phase))
+    {
+        mCurrent.mAccumulated[phase] += duration;
+    }
+    else
+    {
+        mCurrent.mEvents.emplace_back(Event{phase, start, duration});
+    }
+}
+
+void
+LedgerCloseTracer::dumpTrace(Json::Value& ret) const
+{
+    Json::Value& events = ret["traceEvents"];
+    events = Json::Value(Json::arrayValue);
+    for (auto const& l : mTraces)
+    {
+        Json::Value ledger;
+        ledger["name"] = "ledger";
+        ledger["ph"] = "X";
+        ledger["pid"] = 1;
+        ledger["tid"] = 1;
+        ledger["ts"] = toMicroseconds(l.mStart - mOrigin);
+        ledger["dur"] = toMicroseconds(l.mDuration);
+        ledger["args"]["ledger"] = l.mLedgerSeq;
+        ledger["args"]["txs"] = static_cast<Json::UInt64>(l.mTxCount);
+        for (int i = 0; i < NUM_PHASES; i++)
+        {
+            if (isAccumulated(static_cast<Phase>(i)))
+            {
+                auto name = std::string(getPhaseName(static_cast<Phase>(i)));
+                ledger["args"][name + "-us"] =
+                    toMicroseconds(l.mAccumulated[i]);
+            }
+        }
+        events.append(ledger);
+
+        for (auto const& e : l.mEvents)
+        {
+            Json::Value ev;
+            ev["name"] = getPhaseName(e.mPhase);
+            ev["ph"] = "X";
+            ev["pid"] = 1;
+            ev["tid"] = 1;
+            ev["ts"] = toMicroseconds(e.mStart - mOrigin);
+            ev["dur"] = toMicroseconds(e.mDuration);
+            ev["args"]["ledger"] = l.mLedgerSeq;
+            events.append(ev);
+        }
+    }
+}
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "lib/json/json-forwards.h"
+#include <array>
+#include <chrono>
+#include <deque>
+#include <vector>
+
+namespace medida
+{
+class Timer;
+}
+
+namespace stellar
+{
+class Application;
+
+/**
+ * Breaks down the time spent in LedgerManagerImpl::closeLedger by phase.
+ *
+ * Every phase has its own timer ("ledger.close.<phase>"). Optionally, the
+ * spans of the last LEDGER_CLOSE_TRACE_SIZE ledgers are kept in memory and
+ * can be exported in the Chrome trace event format (see the `ledgertrace`
+ * command).
+ *
+ * Phases marked as accumulated (such as tx-meta, which happens once per
+ * transaction) are summed per ledger instead of producing one trace event
+ * per call.
+ */
+class LedgerCloseTracer
+{
+  public:
+    enum Phase
+    {
+        PREFETCH,
+        FEES,
+        APPLY,
+        TX_META,
+        UPGRADES,
+        BUCKET_ADD,
+        BUCKET_SNAPSHOT,
+        HEADER_STORE,
+        HAS_SERIALIZE,
+        CHECKPOINT_WRITE,
+        HISTORY_QUEUE,
+        SQL_COMMIT,
+        PUBLISH,
+        BUCKET_GC,
+        NUM_PHASES
+    };
+
+    using clock = std::chrono::steady_clock;
+
+    // times a phase for the duration of its scope
+    class Span
+    {
+        LedgerCloseTracer& mTracer;
+        Phase mPhase;
+        clock::time_point mStart;
+
+      public:
+        Span(LedgerCloseTracer& tracer, Phase phase);
+        ~Span();
+
+        Span(Span const&) = delete;
+        Span& operator=(Span const&) = delete;
+    };
+
+    explicit LedgerCloseTracer(Application& app);
+
+    void startLedger(uint32_t ledgerSeq, size_t txCount);
+    void finishLedger();
+
+    // Chrome trace ("traceEvents") of the ledgers kept in memory
+    void dumpTrace(Json::Value& ret) const;
+
+    static char const* getPhaseName(Phase phase);
+
+  private:
+    struct Event
+    {
+        Phase mPhase;
+        clock::time_point mStart;
+        clock::duration mDuration;
+    };
+
+    struct LedgerTrace
+    {
+        uint32_t mLedgerSeq;
+        size_t mTxCount;
+        clock::time_point mStart;
+        clock::duration mDuration;
+        std::vector<Event> mEvents;
+        std::array<clock::duration, NUM_PHASES> mAccumulated;
+    };
+
+    std::vector<medida::Timer*> mPhaseTimers;
+    size_t const mTraceSize;
+    clock::time_point const mOrigin;
+
+    bool mInLedger;
+    LedgerTrace mCurrent;
+    std::deque<LedgerTrace> mTraces;
+
+    void endSpan(Phase phase, clock::time_point start);
+};
+}
@@ -80,109 +80,105 @@ LedgerDelta::checkState()
 void
 LedgerDelta::addEntry(EntryFrame const& entry)
 {
-    addEntry(entry.copy());
+    addEntry(entry.getKey(), LedgerEntry(entry.mEntry));
 }
 
 void
 LedgerDelta::deleteEntry(EntryFrame const& entry)
 {
-    deleteEntry(entry.copy());
+    deleteEntry(entry.getKey());
 }
 
 void
 LedgerDelta::modEntry(EntryFrame const& entry)
 {
-    modEntry(entry.copy());
+    modEntry(entry.getKey(), LedgerEntry(entry.mEntry));
 }
 
 void
 LedgerDelta::recordEntry(EntryFrame const& entry)
 {
-    recordEntry(entry.copy());
+    checkState();
+    auto& change = mChanges[entry.getKey()];
+    // keeps the old one around, copying it only the first time
+    if (!change.mHasPrevious)
+    {
+        change.mHasPrevious = true;
+        change.mPrevious = entry.mEntry;
+    }
 }
 
 void
-LedgerDelta::addEntry(EntryFrame::pointer entry)
+LedgerDelta::addEntry(LedgerKey const& k, LedgerEntry&& entry)
 {
     checkState();
-    auto k = entry->getKey();
-    auto del_it = mDelete.find(k);
-    if (del_it != mDelete.end())
+    auto& change = mChanges[k];
+    if (change.mState == EntryState::DELETED)
     {
         // delete + new is an update
-        mDelete.erase(del_it);
-        mMod[k] = entry;
+        change.mState = EntryState::MODIFIED;
     }
     else
     {
-        assert(mNew.find(k) == mNew.end()); // double new
-        assert(mMod.find(k) == mMod.end()); // mod + new is invalid
-        mNew[k] = entry;
+        // double new, or mod + new, is invalid
+        assert(change.mState == EntryState::RECORDED);
+        change.mState = EntryState::NEW;
     }
-}
-
-void
-LedgerDelta::deleteEntry(EntryFrame::pointer entry)
-{
-    auto k = entry->getKey();
-    deleteEntry(k);
+    change.mCurrent = std::move(entry);
 }
 
 void
 LedgerDelta::deleteEntry(LedgerKey const& k)
 {
     checkState();
-    auto new_it = mNew.find(k);
-    if (new_it != mNew.end())
+    auto& change = mChanges[k];
+    if (change.mState == EntryState::NEW)
     {
         // new + delete -> don't add it in the first place
-        mNew.erase(new_it);
+        if (!change.mHasPrevious)
+        {
+            mChanges.erase(k);
+            return;
+        }
+        change.mState = EntryState::RECORDED;
     }
     else
     {
         // double delete here means there is buggy code upstream
         // and we cannot keep going as this may corrupt the bucket list
-        assert(mDelete.find(k) == mDelete.end());
+        assert(change.mState != EntryState::DELETED);
 
         // mod + delete -> delete
-        mMod.erase(k);
-        mDelete.insert(k);
+        change.mState = EntryState::DELETED;
     }
+    change.mCurrent = LedgerEntry();
 }
 
 void
-LedgerDelta::modEntry(EntryFrame::pointer entry)
+LedgerDelta::modEntry(LedgerKey const& k, LedgerEntry&& entry)
 {
     checkState();
-    auto k = entry->getKey();
-    auto mod_it = mMod.find(k);
-    if (mod_it != mMod.end())
-    {
-        // collapse mod
-        mod_it->second = entry;
-    }
-    else
+    auto& change = mChanges[k];
+    // delete + mod is illegal
+    assert(change.mState != EntryState::DELETED);
+    if (change.mState == EntryState::RECORDED)
     {
-        auto new_it = mNew.find(k);
-        if (new_it != mNew.end())
-        {
-            // new + mod = new (with latest value)
-            new_it->second = entry;
-        }
-        else
-        {
-            assert(mDelete.find(k) == mDelete.end()); // delete + mod is illegal
-            mMod[k] = entry;
-        }
+        change.mState = EntryState::MODIFIED;
     }
+    // collapse mod, new + mod = new (with latest value)
+    change.mCurrent = std::move(entry);
 }
 
 void
-LedgerDelta::recordEntry(EntryFrame::pointer entry)
+LedgerDelta::recordEntry(LedgerKey const& k, LedgerEntry&& entry)
 {
     checkState();
-    // keeps the old one around
-    mPrevious.insert(std::make_pair(entry->getKey(), entry));
+    auto& change = mChanges[k];
+    if (!change.mHasPrevious)
+    {
+        change.mHasPrevious = true;
+        change.mPrevious = std::move(entry);
+    }
 }
 
 void
@@ -190,27 +186,47 @@ LedgerDelta::mergeEntries(LedgerDelta& other)
 {
     checkState();
 
-    // propagates mPrevious for deleted & modified entries
-    for (auto& d : other.mDelete)
+    if (mChanges.empty())
     {
-        deleteEntry(d);
-        auto it = other.mPrevious.find(d);
-        if (it != other.mPrevious.end())
+        // typically the first operation of a transaction: take over the
+        // entries of "other" rather than copying them one by one
+        std::swap(mChanges, other.mChanges);
+        for (auto it = mChanges.begin(); it != mChanges.end();)
         {
-            recordEntry(*it->second);
+            if (it->second.mState == EntryState::RECORDED)
+            {
+                it = mChanges.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
         }
+        return;
     }
-    for (auto& n : other.mNew)
-    {
-        addEntry(n.second);
-    }
-    for (auto& m : other.mMod)
+
+    // "other" is committed: its entries are moved, not copied
+    // propagates the previous value for deleted & modified entries
+    for (auto& c : other.mChanges)
     {
-        modEntry(m.second);
-        auto it = other.mPrevious.find(m.first);
-        if (it != other.mPrevious.end())
+        auto& change = c.second;
+        switch (change.mState)
+        {
+        case EntryState::RECORDED:
+            continue;
+        case EntryState::NEW:
+            addEntry(c.first, std::move(change.mCurrent));
+            continue;
+        case EntryState::MODIFIED:
+            modEntry(c.first, std::move(change.mCurrent));
+            break;
+        case EntryState::DELETED:
+            deleteEntry(c.first);
+            break;
+        }
+        if (change.mHasPrevious)
         {
-            recordEntry(*it->second);
+            recordEntry(c.first, std::move(change.mPrevious));
         }
     }
 }
@@ -241,30 +257,42 @@ LedgerDelta::rollback()
     checkState();
     mHeader = nullptr;
 
-    for (auto& d : mDelete)
+    for (auto const& c : mChanges)
     {
-        EntryFrame::flushCachedEntry(d, mDb);
-    }
-    for (auto& n : mNew)
-    {
-        EntryFrame::flushCachedEntry(n.first, mDb);
+        if (c.second.mState != EntryState::RECORDED)
+        {
+            EntryFrame::flushCachedEntry(c.first, mDb);
+        }
     }
-    for (auto& m : mMod)
+}
+
+std::shared_ptr<LedgerDelta const>
+LedgerDelta::snapshot() const
+{
+    LedgerHeader header = mPreviousHeaderValue;
+    auto res = std::make_shared<LedgerDelta>(header, mDb, mUpdateLastModified);
+    res->mCurrentHeader = mCurrentHeader;
+    // entries that were only loaded are of no use to the readers
+    for (auto const& c : mChanges)
     {
-        EntryFrame::flushCachedEntry(m.first, mDb);
+        if (c.second.mState != EntryState::RECORDED)
+        {
+            res->mChanges.emplace_hint(res->mChanges.end(), c);
+        }
     }
+    // committed, the copy never flushes the entry cache
+    res->commit();
+    return res;
 }
 
 void
 LedgerDelta::addCurrentMeta(LedgerEntryChanges& changes,
-                            LedgerKey const& key) const
+                            EntryChange const& change) const
 {
-    auto it = mPrevious.find(key);
-    if (it != mPrevious.end())
+    if (change.mHasPrevious)
     {
-        auto const& e = it->second->mEntry;
         changes.emplace_back(LEDGER_ENTRY_STATE);
-        changes.back().state() = e;
+        changes.back().state() = change.mPrevious;
     }
 }
 
@@ -273,23 +301,32 @@ LedgerDelta::getChanges() const
 {
     LedgerEntryChanges changes;
 
-    for (auto const& k : mNew)
+    // created, then updated, then removed entries
+    for (auto const& k : mChanges)
     {
-        changes.emplace_back(LEDGER_ENTRY_CREATED);
-        changes.back().created() = k.second->mEntry;
+        if (k.second.mState == EntryState::NEW)
+        {
+            changes.emplace_back(LEDGER_ENTRY_CREATED);
+            changes.back().created() = k.second.mCurrent;
+        }
     }
-    for (auto const& k : mMod)
+    for (auto const& k : mChanges)
     {
-        addCurrentMeta(changes, k.first);
-        changes.emplace_back(LEDGER_ENTRY_UPDATED);
-        changes.back().updated() = k.second->mEntry;
+        if (k.second.mState == EntryState::MODIFIED)
+        {
+            addCurrentMeta(changes, k.second);
+            changes.emplace_back(LEDGER_ENTRY_UPDATED);
+            changes.back().updated() = k.second.mCurrent;
+        }
     }
-
-    for (auto const& k : mDelete)
+    for (auto const& k : mChanges)
     {
-        addCurrentMeta(changes, k);
-        changes.emplace_back(LEDGER_ENTRY_REMOVED);
-        changes.back().removed() = k;
+        if (k.second.mState == EntryState::DELETED)
+        {
+            addCurrentMeta(changes, k.second);
+            changes.emplace_back(LEDGER_ENTRY_REMOVED);
+            changes.back().removed() = k.first;
+        }
     }
 
     return changes;
@@ -300,15 +337,21 @@ LedgerDelta::getLiveEntries() const
 {
     std::vector<LedgerEntry> live;
 
-    live.reserve(mNew.size() + mMod.size());
+    live.reserve(mChanges.size());
 
-    for (auto const& k : mNew)
+    for (auto const& k : mChanges)
     {
-        live.push_back(k.second->mEntry);
+        if (k.second.mState == EntryState::NEW)
+        {
+            live.push_back(k.second.mCurrent);
+        }
     }
-    for (auto const& k : mMod)
+    for (auto const& k : mChanges)
     {
-        live.push_back(k.second->mEntry);
+        if (k.second.mState == EntryState::MODIFIED)
+        {
+            live.push_back(k.second.mCurrent);
+        }
     }
 
     return live;
@@ -319,11 +362,12 @@ LedgerDelta::getDeadEntries() const
 {
     std::vector<LedgerKey> dead;
 
-    dead.reserve(mDelete.size());
-
-    for (auto const& k : mDelete)
+    for (auto const& k : mChanges)
     {
-        dead.push_back(k);
+        if (k.second.mState == EntryState::DELETED)
+        {
+            dead.push_back(k.first);
+        }
     }
     return dead;
 }
@@ -337,86 +381,52 @@ LedgerDelta::updateLastModified() const
 void
 LedgerDelta::markMeters(Application& app) const
 {
-    for (auto const& ke : mNew)
+    for (auto const& ke : mChanges)
     {
-        switch (ke.first.type())
+        char const* action = nullptr;
+        switch (ke.second.mState)
         {
-        case ACCOUNT:
-            app.getMetrics()
-                .NewMeter({"ledger", "account", "add"}, "entry")
-                .Mark();
+        case EntryState::NEW:
+            action = "add";
             break;
-        case TRUSTLINE:
-            app.getMetrics()
-                .NewMeter({"ledger", "trust", "add"}, "entry")
-                .Mark();
+        case EntryState::MODIFIED:
+            action = "modify";
             break;
-        case OFFER:
-            app.getMetrics()
-                .NewMeter({"ledger", "offer", "add"}, "entry")
-                .Mark();
-            break;
-        case DATA:
-            app.getMetrics()
-                .NewMeter({"ledger", "data", "add"}, "entry")
-                .Mark();
+        case EntryState::DELETED:
+            action = "delete";
             break;
+        default:
+            continue;
         }
-    }
 
-    for (auto const& ke : mMod)
-    {
+        char const* type = nullptr;
         switch (ke.first.type())
         {
         case ACCOUNT:
-            app.getMetrics()
-                .NewMeter({"ledger", "account", "modify"}, "entry")
-                .Mark();
+            type = "account";
             break;
         case TRUSTLINE:
-            app.getMetrics()
-                .NewMeter({"ledger", "trust", "modify"}, "entry")
-                .Mark();
+            type = "trust";
             break;
         case OFFER:
-            app.getMetrics()
-                .NewMeter({"ledger", "offer", "modify"}, "entry")
-                .Mark();
+            type = "offer";
             break;
         case DATA:
-            app.getMetrics()
-                .NewMeter({"ledger", "data", "modify"}, "entry")
-                .Mark();
+            type = "data";
             break;
         }
+        app.getMetrics().NewMeter({"ledger", type, action}, "entry").Mark();
     }
+}
 
-    for (auto const& ke : mDelete)
+LedgerEntry const&
+LedgerDelta::getPrevious(KeyEntryMap::value_type const& pair)
+{
+    if (!pair.second.mHasPrevious)
     {
-        switch (ke.type())
-        {
-        case ACCOUNT:
-            app.getMetrics()
-                .NewMeter({"ledger", "account", "delete"}, "entry")
-                .Mark();
-            break;
-        case TRUSTLINE:
-            app.getMetrics()
-                .NewMeter({"ledger", "trust", "delete"}, "entry")
-                .Mark();
-            break;
-        case OFFER:
-            app.getMetrics()
-                .NewMeter({"ledger", "offer", "delete"}, "entry")
-                .Mark();
-            break;
-        case DATA:
-            app.getMetrics()
-                .NewMeter({"ledger", "data", "delete"}, "entry")
-                .Mark();
-            break;
-        }
+        throw std::out_of_range("previous value of entry was not recorded");
     }
+    return pair.second.mPrevious;
 }
 
 template <typename IterType, typename ValueType>
@@ -429,11 +439,23 @@ LedgerDelta::Iterator<IterType, ValueType>::createValueIfNecessary() const
     }
 }
 
+template <typename IterType, typename ValueType>
+void
+LedgerDelta::Iterator<IterType, ValueType>::skipOtherStates()
+{
+    while (mIter != mEnd && mIter->second.mState != ValueType::STATE)
+    {
+        ++mIter;
+    }
+}
+
 template <typename IterType, typename ValueType>
 LedgerDelta::Iterator<IterType, ValueType>::Iterator(LedgerDelta const& delta,
-                                                     IterType const& iter)
-    : mDelta(delta), mIter(iter)
+                                                     IterType const& iter,
+                                                     IterType const& end)
+    : mDelta(delta), mIter(iter), mEnd(end)
 {
+    skipOtherStates();
 }
 
 template <typename IterType, typename ValueType>
@@ -455,6 +477,7 @@ LedgerDelta::Iterator<IterType, ValueType>&
     LedgerDelta::Iterator<IterType, ValueType>::operator++()
 {
     ++mIter;
+    skipOtherStates();
     mValue.reset();
     return *this;
 }
@@ -502,15 +525,17 @@ template class LedgerDelta::IteratorRange<LedgerDelta::AddedIterator>;
 
 LedgerDelta::AddedLedgerEntry::AddedLedgerEntry(
     LedgerDelta const& delta, KeyEntryMap::value_type const& pair)
-    : key(pair.first), current(pair.second)
+    : key(pair.first), current(EntryFrame::FromXDR(pair.second.mCurrent))
 {
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::AddedIterator>
 LedgerDelta::added() const
 {
-    return {LedgerDelta::AddedIterator(*this, mNew.cbegin()),
-            LedgerDelta::AddedIterator(*this, mNew.cend())};
+    return {LedgerDelta::AddedIterator(*this, mChanges.cbegin(),
+                                       mChanges.cend()),
+            LedgerDelta::AddedIterator(*this, mChanges.cend(),
+                                       mChanges.cend())};
 }
 
 template class LedgerDelta::Iterator<LedgerDelta::KeyEntryMap::const_iterator,
@@ -520,33 +545,36 @@ template class LedgerDelta::IteratorRange<LedgerDelta::ModifiedIterator>;
 LedgerDelta::ModifiedLedgerEntry::ModifiedLedgerEntry(
     LedgerDelta const& delta, KeyEntryMap::value_type const& pair)
     : key(pair.first)
-    , current(pair.second)
-    , previous(delta.mPrevious.at(pair.first))
+    , current(EntryFrame::FromXDR(pair.second.mCurrent))
+    , previous(EntryFrame::FromXDR(getPrevious(pair)))
 {
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::ModifiedIterator>
 LedgerDelta::modified() const
 {
-    return {LedgerDelta::ModifiedIterator(*this, mMod.cbegin()),
-            LedgerDelta::ModifiedIterator(*this, mMod.cend())};
+    return {LedgerDelta::ModifiedIterator(*this, mChanges.cbegin(),
+                                          mChanges.cend()),
+            LedgerDelta::ModifiedIterator(*this, mChanges.cend(),
+                                          mChanges.cend())};
 }
 
-template class LedgerDelta::Iterator<
-    std::set<LedgerKey, LedgerEntryIdCmp>::const_iterator,
-    LedgerDelta::DeletedLedgerEntry>;
+template class LedgerDelta::Iterator<LedgerDelta::KeyEntryMap::const_iterator,
+                                     LedgerDelta::DeletedLedgerEntry>;
 template class LedgerDelta::IteratorRange<LedgerDelta::DeletedIterator>;
 
-LedgerDelta::DeletedLedgerEntry::DeletedLedgerEntry(LedgerDelta const& delta,
-                                                    LedgerKey const& value)
-    : key(value), previous(delta.mPrevious.at(value))
+LedgerDelta::DeletedLedgerEntry::DeletedLedgerEntry(
+    LedgerDelta const& delta, KeyEntryMap::value_type const& pair)
+    : key(pair.first), previous(EntryFrame::FromXDR(getPrevious(pair)))
 {
 }
 
 LedgerDelta::IteratorRange<LedgerDelta::DeletedIterator>
 LedgerDelta::deleted() const
 {
-    return {LedgerDelta::DeletedIterator(*this, mDelete.cbegin()),
-            LedgerDelta::DeletedIterator(*this, mDelete.cend())};
+    return {LedgerDelta::DeletedIterator(*this, mChanges.cbegin(),
+                                         mChanges.cend()),
+            LedgerDelta::DeletedIterator(*this, mChanges.cend(),
+                                         mChanges.cend())};
 }
 }
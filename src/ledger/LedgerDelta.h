@@ -11,7 +11,6 @@
 #include <iterator>
 #include <map>
 #include <memory>
-#include <set>
 
 namespace stellar
 {
@@ -20,8 +19,27 @@ class Database;
 
 class LedgerDelta
 {
-    typedef std::map<LedgerKey, EntryFrame::pointer, LedgerEntryIdCmp>
-        KeyEntryMap;
+    // what this delta did to an entry
+    enum class EntryState
+    {
+        RECORDED, // unchanged, only its previous value is known
+        NEW,
+        MODIFIED,
+        DELETED
+    };
+
+    // one record per entry, holding both its current value (NEW and MODIFIED
+    // entries) and its value before this delta (if recorded), so that a
+    // change costs a single node and no EntryFrame
+    struct EntryChange
+    {
+        EntryState mState{EntryState::RECORDED};
+        bool mHasPrevious{false};
+        LedgerEntry mCurrent;
+        LedgerEntry mPrevious;
+    };
+
+    typedef std::map<LedgerKey, EntryChange, LedgerEntryIdCmp> KeyEntryMap;
 
     LedgerDelta*
         mOuterDelta;       // set when this delta is nested inside another delta
@@ -32,28 +50,26 @@ class LedgerDelta
     LedgerHeaderFrame mCurrentHeader;
     LedgerHeader mPreviousHeaderValue;
     // ledger entries
-    KeyEntryMap mNew;
-    KeyEntryMap mMod;
-    std::set<LedgerKey, LedgerEntryIdCmp> mDelete;
-    KeyEntryMap mPrevious;
+    KeyEntryMap mChanges;
 
     Database& mDb; // Used strictly for rollback of db entry cache.
 
     bool mUpdateLastModified;
 
     void checkState();
-    void addEntry(EntryFrame::pointer entry);
-    void deleteEntry(EntryFrame::pointer entry);
-    void modEntry(EntryFrame::pointer entry);
-    void recordEntry(EntryFrame::pointer entry);
+    void addEntry(LedgerKey const& key, LedgerEntry&& entry);
+    void modEntry(LedgerKey const& key, LedgerEntry&& entry);
+    void recordEntry(LedgerKey const& key, LedgerEntry&& entry);
 
-    // merge "other" into current ledgerDelta
+    // merge "other" into current ledgerDelta, moving its entries
     void mergeEntries(LedgerDelta& other);
 
     // helper method that adds a meta entry to "changes"
     // with the previous value of an entry if needed
     void addCurrentMeta(LedgerEntryChanges& changes,
-                        LedgerKey const& key) const;
+                        EntryChange const& change) const;
+
+    static LedgerEntry const& getPrevious(KeyEntryMap::value_type const& pair);
 
   public:
     // keeps an internal reference to the outerDelta,
@@ -97,18 +113,27 @@ class LedgerDelta
 
     LedgerEntryChanges getChanges() const;
 
+    // Returns a committed copy of this delta, holding its own copies of the
+    // changed entries: it can be read on another thread while this delta
+    // moves on.
+    std::shared_ptr<LedgerDelta const> snapshot() const;
+
     template <typename IterType, typename ValueType>
     class Iterator : public std::iterator<std::input_iterator_tag, ValueType>
     {
         LedgerDelta const& mDelta;
         IterType mIter;
+        IterType mEnd;
 
         mutable std::shared_ptr<ValueType> mValue;
 
         void createValueIfNecessary() const;
+        // skips the entries not in ValueType::STATE
+        void skipOtherStates();
 
       public:
-        Iterator(LedgerDelta const& delta, IterType const& iter);
+        Iterator(LedgerDelta const& delta, IterType const& iter,
+                 IterType const& end);
 
         ValueType const& operator*() const;
         ValueType const* operator->() const;
@@ -133,6 +158,8 @@ class LedgerDelta
 
     struct AddedLedgerEntry
     {
+        static constexpr EntryState STATE = EntryState::NEW;
+
         LedgerKey key;
         EntryFrame::pointer current;
 
@@ -145,6 +172,8 @@ class LedgerDelta
 
     struct ModifiedLedgerEntry
     {
+        static constexpr EntryState STATE = EntryState::MODIFIED;
+
         LedgerKey key;
         EntryFrame::pointer current;
         EntryFrame::pointer previous;
@@ -158,14 +187,15 @@ class LedgerDelta
 
     struct DeletedLedgerEntry
     {
+        static constexpr EntryState STATE = EntryState::DELETED;
+
         LedgerKey key;
         EntryFrame::pointer previous;
 
         explicit DeletedLedgerEntry(LedgerDelta const& delta,
-                                    LedgerKey const& value);
+                                    KeyEntryMap::value_type const& pair);
     };
-    typedef Iterator<std::set<LedgerKey, LedgerEntryIdCmp>::const_iterator,
-                     DeletedLedgerEntry>
+    typedef Iterator<KeyEntryMap::const_iterator, DeletedLedgerEntry>
         DeletedIterator;
     IteratorRange<DeletedIterator> deleted() const;
 };
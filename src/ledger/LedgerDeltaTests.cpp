@@ -76,6 +76,72 @@ TEST_CASE("Ledger delta", "[ledger][ledgerdelta]")
         }
     }
 
+    SECTION("commit into empty delta")
+    {
+        auto aEntries = LedgerTestUtils::generateValidAccountEntries(3);
+        std::vector<AccountFrame::pointer> accounts;
+        for (auto const& a : aEntries)
+        {
+            LedgerEntry le;
+            le.data.type(ACCOUNT);
+            le.data.account() = a;
+            le.lastModifiedLedgerSeq = delta.getHeader().ledgerSeq;
+            accounts.emplace_back(std::make_shared<AccountFrame>(le));
+        }
+
+        {
+            LedgerDelta delta2(delta);
+            delta2.addEntry(*accounts[0]);
+            delta2.recordEntry(*accounts[1]);
+            auto modA = std::make_shared<AccountFrame>(accounts[1]->mEntry);
+            modA->setSeqNum(modA->getSeqNum() + 1);
+            delta2.modEntry(*modA);
+            // only loaded, not part of the changes
+            delta2.recordEntry(*accounts[2]);
+            delta2.commit();
+
+            // committing moved the entries out of delta2
+            REQUIRE(delta2.getChanges().empty());
+
+            auto changes = delta.getChanges();
+            REQUIRE(changes.size() == 3);
+            REQUIRE(changes[0].type() == LEDGER_ENTRY_CREATED);
+            REQUIRE(changes[0].created() == accounts[0]->mEntry);
+            REQUIRE(changes[1].type() == LEDGER_ENTRY_STATE);
+            REQUIRE(changes[1].state() == accounts[1]->mEntry);
+            REQUIRE(changes[2].type() == LEDGER_ENTRY_UPDATED);
+            REQUIRE(changes[2].updated() == modA->mEntry);
+
+            size_t nbModified = 0;
+            for (auto const& m : delta.modified())
+            {
+                REQUIRE(m.previous->mEntry == accounts[1]->mEntry);
+                REQUIRE(m.current->mEntry == modA->mEntry);
+                nbModified++;
+            }
+            REQUIRE(nbModified == 1);
+            REQUIRE(delta.deleted().begin() == delta.deleted().end());
+        }
+
+        {
+            // merged into a delta that already has changes
+            LedgerDelta delta3(delta);
+            delta3.deleteEntry(accounts[0]->getKey());
+            delta3.recordEntry(*accounts[2]);
+            delta3.deleteEntry(accounts[2]->getKey());
+            delta3.commit();
+
+            auto changes = delta.getChanges();
+            REQUIRE(changes.size() == 4);
+            REQUIRE(changes[0].type() == LEDGER_ENTRY_STATE);
+            REQUIRE(changes[1].type() == LEDGER_ENTRY_UPDATED);
+            REQUIRE(changes[2].type() == LEDGER_ENTRY_STATE);
+            REQUIRE(changes[2].state() == accounts[2]->mEntry);
+            REQUIRE(changes[3].type() == LEDGER_ENTRY_REMOVED);
+            REQUIRE(changes[3].removed() == accounts[2]->getKey());
+        }
+    }
+
     SECTION("delta object operations")
     {
         size_t const nbAccounts = 36;
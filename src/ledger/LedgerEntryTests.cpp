@@ -6,9 +6,12 @@
 #include "LedgerDelta.h"
 #include "OfferFrame.h"
 #include "TrustFrame.h"
+#include "bucket/LedgerCmp.h"
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
+#include "ledger/DataFrame.h"
 #include "ledger/LedgerManager.h"
+#include "ledger/LedgerRange.h"
 #include "ledger/LedgerTestUtils.h"
 #include "lib/catch.hpp"
 #include "main/Application.h"
@@ -16,9 +19,15 @@
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
+#include "util/types.h"
 #include "xdrpp/autocheck.h"
 #include "xdrpp/marshal.h"
+#include <algorithm>
+#include <chrono>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <unordered_map>
 #include <utility>
 
@@ -36,6 +45,46 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
     app->start();
     Database& db = app->getDatabase();
 
+    SECTION("signers table is kept in sync with the accounts")
+    {
+        LedgerHeader lh;
+        LedgerDelta delta(lh, db, false);
+
+        LedgerEntry le;
+        le.data.type(ACCOUNT);
+        le.data.account() = LedgerTestUtils::generateValidAccountEntry(5);
+        auto& signers = le.data.account().signers;
+        while (signers.size() < 3)
+        {
+            Signer s;
+            s.key.ed25519() = SecretKey::random().getPublicKey().ed25519();
+            s.weight = 1;
+            signers.push_back(s);
+        }
+        auto id = KeyUtils::toStrKey(le.data.account().accountID);
+
+        auto countSigners = [&]() {
+            size_t n;
+            db.getSession()
+                << "SELECT COUNT(*) FROM signers WHERE accountid = :id",
+                soci::into(n), soci::use(id);
+            return n;
+        };
+
+        auto af = std::make_shared<AccountFrame>(le);
+        af->storeAdd(delta, db);
+        REQUIRE(countSigners() == signers.size());
+
+        af = AccountFrame::loadAccount(af->getID(), db);
+        af->getAccount().signers.pop_back();
+        af->setUpdateSigners();
+        af->storeChange(delta, db);
+        REQUIRE(countSigners() == signers.size() - 1);
+
+        af->storeDelete(delta, db);
+        REQUIRE(countSigners() == 0);
+    }
+
     SECTION("round trip with database")
     {
         std::vector<LedgerEntry> accounts(50);
@@ -274,4 +323,392 @@ TEST_CASE("Ledger Entry tests", "[ledgerentry]")
         app->getLedgerManager().checkDbState();
     }
 }
+
+static Asset
+makeCreditAsset(std::string const& code)
+{
+    Asset asset;
+    asset.type(ASSET_TYPE_CREDIT_ALPHANUM4);
+    strToAssetCode(asset.alphaNum4().assetCode, code);
+    asset.alphaNum4().issuer = SecretKey::random().getPublicKey();
+    return asset;
+}
+
+// Adds @p n offers selling @p selling for @p buying, with few distinct
+// prices so that offer ids break ties.
+static void
+addOffers(Application& app, Asset const& selling, Asset const& buying,
+          size_t n, uint64_t& nextOfferID)
+{
+    auto& db = app.getDatabase();
+    LedgerDelta delta(app.getLedgerManager().getCurrentLedgerHeader(), db,
+                      false);
+    soci::transaction sqltx(db.getSession());
+    for (size_t i = 0; i < n; i++)
+    {
+        LedgerEntry le;
+        le.data.type(OFFER);
+        auto& o = le.data.offer();
+        o = LedgerTestUtils::generateValidOfferEntry(3);
+        o.offerID = nextOfferID++;
+        o.selling = selling;
+        o.buying = buying;
+        o.price.n = 1 + (o.offerID * 7) % 13;
+        o.price.d = 1 + (o.offerID * 3) % 5;
+        std::make_shared<OfferFrame>(le)->storeAdd(delta, db);
+    }
+    sqltx.commit();
+}
+
+// Walks the order book @p selling / @p buying by pages of @p pageSize,
+// calling @p onPage on each page.
+static void
+walkOrderBook(Database& db, Asset const& selling, Asset const& buying,
+              size_t pageSize,
+              std::function<void(std::vector<OfferFrame::pointer>&)> onPage)
+{
+    OfferFrame::pointer last;
+    for (;;)
+    {
+        std::vector<OfferFrame::pointer> page;
+        OfferFrame::loadBestOffers(pageSize, selling, buying, last.get(), page,
+                                   db);
+        if (page.empty())
+        {
+            break;
+        }
+        last = page.back();
+        onPage(page);
+    }
+}
+
+TEST_CASE("order book pages", "[ledgerentry]")
+{
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, getTestConfig(0));
+    app->start();
+    auto& db = app->getDatabase();
+
+    Asset native;
+    native.type(ASSET_TYPE_NATIVE);
+    auto usd = makeCreditAsset("USD");
+    auto eur = makeCreditAsset("EUR");
+
+    uint64_t nextOfferID = 1;
+    addOffers(*app, native, usd, 200, nextOfferID);
+    // other books, which must not show up
+    addOffers(*app, usd, native, 50, nextOfferID);
+    addOffers(*app, eur, usd, 50, nextOfferID);
+    addOffers(*app, native, eur, 50, nextOfferID);
+
+    auto before = [](OfferFrame::pointer const& a,
+                     OfferFrame::pointer const& b) {
+        auto pa = double(a->getPrice().n) / double(a->getPrice().d);
+        auto pb = double(b->getPrice().n) / double(b->getPrice().d);
+        return pa < pb || (pa == pb && a->getOfferID() < b->getOfferID());
+    };
+
+    std::vector<OfferFrame::pointer> seen;
+    SECTION("pages follow each other")
+    {
+        walkOrderBook(db, native, usd, 7,
+                      [&](std::vector<OfferFrame::pointer>& page) {
+                          seen.insert(seen.end(), page.begin(), page.end());
+                      });
+        REQUIRE(seen.size() == 200);
+    }
+    SECTION("taking offers does not shift pages")
+    {
+        LedgerDelta delta(app->getLedgerManager().getCurrentLedgerHeader(),
+                          db, false);
+        walkOrderBook(db, native, usd, 5,
+                      [&](std::vector<OfferFrame::pointer>& page) {
+                          for (auto& o : page)
+                          {
+                              if (o->getOfferID() % 3 == 0)
+                              {
+                                  o->storeDelete(delta, db);
+                              }
+                          }
+                          seen.insert(seen.end(), page.begin(), page.end());
+                      });
+        REQUIRE(seen.size() == 200);
+    }
+
+    REQUIRE(std::is_sorted(seen.begin(), seen.end(), before));
+    for (auto& o : seen)
+    {
+        REQUIRE(o->getSelling() == native);
+        REQUIRE(o->getBuying() == usd);
+    }
+}
+
+TEST_CASE("key-value ledger store", "[ledgerentry]")
+{
+    // the same entries, stored in the SQL tables and in the key-value store
+    VirtualClock clock;
+    Application::pointer sqlApp =
+        createTestApplication(clock, getTestConfig(0));
+    sqlApp->start();
+    Config cfg(getTestConfig(1));
+    cfg.LEDGER_STATE_STORE = "kv";
+    Application::pointer kvApp = createTestApplication(clock, cfg);
+    kvApp->start();
+    auto& sqlDb = sqlApp->getDatabase();
+    auto& kvDb = kvApp->getDatabase();
+    REQUIRE(!sqlDb.getLedgerStore());
+    REQUIRE(kvDb.getLedgerStore());
+
+    auto forBoth = [&](std::function<void(Application&)> f) {
+        f(*sqlApp);
+        f(*kvApp);
+    };
+
+    SECTION("entries round trip")
+    {
+        std::map<LedgerKey, LedgerEntry, LedgerEntryIdCmp> entries;
+        for (auto const& le : LedgerTestUtils::generateValidLedgerEntries(200))
+        {
+            entries.insert(std::make_pair(LedgerEntryKey(le), le));
+        }
+
+        auto loadAll = [&](Database& db) {
+            db.getEntryCache().clear();
+            std::vector<LedgerEntry> loaded;
+            for (auto const& kv : entries)
+            {
+                auto frame = EntryFrame::storeLoad(kv.first, db);
+                if (frame)
+                {
+                    REQUIRE(EntryFrame::exists(db, kv.first));
+                    loaded.push_back(frame->mEntry);
+                }
+                else
+                {
+                    REQUIRE(!EntryFrame::exists(db, kv.first));
+                }
+            }
+            return loaded;
+        };
+        auto counts = [](Database& db) {
+            return std::vector<uint64_t>{
+                AccountFrame::countObjects(db), TrustFrame::countObjects(db),
+                OfferFrame::countObjects(db), DataFrame::countObjects(db)};
+        };
+        auto inflationWinners = [](Database& db) {
+            std::vector<std::pair<int64, AccountID>> winners;
+            AccountFrame::processForInflation(
+                [&](AccountFrame::InflationVotes const& v) {
+                    winners.emplace_back(v.mVotes, v.mInflationDest);
+                    return true;
+                },
+                10, db);
+            return winners;
+        };
+
+        forBoth([&](Application& app) {
+            auto& db = app.getDatabase();
+            LedgerDelta delta(app.getLedgerManager().getCurrentLedgerHeader(),
+                              db, false);
+            for (auto const& kv : entries)
+            {
+                EntryFrame::FromXDR(kv.second)->storeAdd(delta, db);
+            }
+        });
+        REQUIRE(loadAll(kvDb) == loadAll(sqlDb));
+        REQUIRE(loadAll(kvDb).size() == entries.size());
+        REQUIRE(counts(kvDb) == counts(sqlDb));
+        REQUIRE(inflationWinners(kvDb) == inflationWinners(sqlDb));
+
+        // change every other entry, delete the others
+        forBoth([&](Application& app) {
+            auto& db = app.getDatabase();
+            LedgerDelta delta(app.getLedgerManager().getCurrentLedgerHeader(),
+                              db, false);
+            bool change = true;
+            for (auto const& kv : entries)
+            {
+                auto frame = EntryFrame::FromXDR(kv.second);
+                if (change)
+                {
+                    if (kv.first.type() == ACCOUNT)
+                    {
+                        frame->mEntry.data.account().balance /= 2;
+                    }
+                    frame->storeChange(delta, db);
+                }
+                else
+                {
+                    frame->storeDelete(delta, db);
+                }
+                change = !change;
+            }
+        });
+        REQUIRE(loadAll(kvDb) == loadAll(sqlDb));
+        REQUIRE(loadAll(kvDb).size() == (entries.size() + 1) / 2);
+        REQUIRE(counts(kvDb) == counts(sqlDb));
+        REQUIRE(inflationWinners(kvDb) == inflationWinners(sqlDb));
+    }
+
+    SECTION("entries modified since a ledger")
+    {
+        auto entries = LedgerTestUtils::generateValidLedgerEntries(200);
+
+        // entries last modified in ledgers 10, 20 and 30
+        forBoth([&](Application& app) {
+            auto& db = app.getDatabase();
+            auto header = app.getLedgerManager().getCurrentLedgerHeader();
+            for (size_t i = 0; i < entries.size(); i++)
+            {
+                header.ledgerSeq = static_cast<uint32_t>(10 * (1 + i % 3));
+                LedgerDelta delta(header, db, false);
+                auto frame = EntryFrame::FromXDR(entries[i]);
+                if (!EntryFrame::exists(db, frame->getKey()))
+                {
+                    frame->storeAdd(delta, db);
+                }
+            }
+        });
+
+        auto counts = [](Database& db, LedgerRange const& ledgers) {
+            return std::vector<uint64_t>{
+                AccountFrame::countObjects(db, ledgers),
+                TrustFrame::countObjects(db, ledgers),
+                OfferFrame::countObjects(db, ledgers),
+                DataFrame::countObjects(db, ledgers)};
+        };
+        auto total = [](std::vector<uint64_t> const& c) {
+            return std::accumulate(c.begin(), c.end(), uint64_t(0));
+        };
+        REQUIRE(counts(kvDb, {10, 10}) == counts(sqlDb, {10, 10}));
+        REQUIRE(counts(kvDb, {20, 30}) == counts(sqlDb, {20, 30}));
+        REQUIRE(total(counts(kvDb, {10, 30})) > 0);
+
+        forBoth([](Application& app) {
+            auto& db = app.getDatabase();
+            AccountFrame::deleteAccountsModifiedOnOrAfterLedger(db, 20);
+            TrustFrame::deleteTrustLinesModifiedOnOrAfterLedger(db, 20);
+            OfferFrame::deleteOffersModifiedOnOrAfterLedger(db, 20);
+            DataFrame::deleteDataModifiedOnOrAfterLedger(db, 20);
+        });
+        REQUIRE(total(counts(kvDb, {20, 30})) == 0);
+        REQUIRE(counts(kvDb, {10, 10}) == counts(sqlDb, {10, 10}));
+        REQUIRE(total(counts(kvDb, {10, 10})) > 0);
+        for (auto const& le : entries)
+        {
+            auto key = LedgerEntryKey(le);
+            REQUIRE(EntryFrame::exists(kvDb, key) ==
+                    EntryFrame::exists(sqlDb, key));
+        }
+    }
+
+    SECTION("order books")
+    {
+        Asset native;
+        native.type(ASSET_TYPE_NATIVE);
+        auto usd = makeCreditAsset("USD");
+        auto eur = makeCreditAsset("EUR");
+
+        forBoth([&](Application& app) {
+            uint64_t nextOfferID = 1;
+            std::mt19937 gen(1);
+            for (auto const& book : {std::make_pair(native, usd),
+                                     std::make_pair(usd, native),
+                                     std::make_pair(eur, usd)})
+            {
+                auto& db = app.getDatabase();
+                LedgerDelta delta(
+                    app.getLedgerManager().getCurrentLedgerHeader(), db,
+                    false);
+                for (size_t i = 0; i < 100; i++)
+                {
+                    LedgerEntry le;
+                    le.data.type(OFFER);
+                    auto& o = le.data.offer();
+                    o.sellerID = book.first.type() == ASSET_TYPE_NATIVE
+                                     ? usd.alphaNum4().issuer
+                                     : eur.alphaNum4().issuer;
+                    o.offerID = nextOfferID++;
+                    o.selling = book.first;
+                    o.buying = book.second;
+                    o.amount = 1 + gen() % 1000;
+                    o.price.n = 1 + gen() % 13;
+                    o.price.d = 1 + gen() % 5;
+                    std::make_shared<OfferFrame>(le)->storeAdd(delta, db);
+                }
+            }
+        });
+
+        auto walk = [&](Database& db, Asset const& selling,
+                        Asset const& buying) {
+            std::vector<uint64_t> ids;
+            walkOrderBook(db, selling, buying, 7,
+                          [&](std::vector<OfferFrame::pointer>& page) {
+                              for (auto const& o : page)
+                              {
+                                  ids.push_back(o->getOfferID());
+                              }
+                          });
+            return ids;
+        };
+        REQUIRE(walk(kvDb, native, usd) == walk(sqlDb, native, usd));
+        REQUIRE(walk(kvDb, native, usd).size() == 100);
+        REQUIRE(walk(kvDb, usd, native) == walk(sqlDb, usd, native));
+        REQUIRE(walk(kvDb, eur, usd) == walk(sqlDb, eur, usd));
+        REQUIRE(walk(kvDb, native, eur).empty());
+
+        // an offer moving to another price moves in the book
+        auto offer = OfferFrame::loadOffer(usd.alphaNum4().issuer, 1, kvDb);
+        REQUIRE(offer);
+        LedgerDelta delta(kvApp->getLedgerManager().getCurrentLedgerHeader(),
+                          kvDb, false);
+        offer->getOffer().price.n = 1;
+        offer->getOffer().price.d = 100;
+        offer->storeChange(delta, kvDb);
+        REQUIRE(walk(kvDb, native, usd).front() == 1);
+    }
+}
+
+TEST_CASE("order book depth", "[ledgerentry][bench][hide]")
+{
+    auto bench = [](Config::TestDbMode mode, std::string const& name) {
+        VirtualClock clock;
+        Application::pointer app =
+            createTestApplication(clock, getTestConfig(0, mode));
+        app->start();
+        auto& db = app->getDatabase();
+
+        Asset native;
+        native.type(ASSET_TYPE_NATIVE);
+        auto usd = makeCreditAsset("USD");
+        uint64_t nextOfferID = 1;
+        size_t depth = 0;
+        for (size_t n : {1000, 9000, 40000})
+        {
+            addOffers(*app, native, usd, n, nextOfferID);
+            depth += n;
+
+            size_t count = 0;
+            auto start = std::chrono::steady_clock::now();
+            walkOrderBook(db, native, usd, 5,
+                          [&](std::vector<OfferFrame::pointer>& page) {
+                              count += page.size();
+                          });
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                          std::chrono::steady_clock::now() - start)
+                          .count();
+            REQUIRE(count == depth);
+            LOG(INFO) << name << ": walked " << depth << " offers in " << us
+                      << "us (" << us * 5 / depth << "us per page)";
+        }
+    };
+
+    bench(Config::TESTDB_ON_DISK_SQLITE, "sqlite");
+#ifdef USE_POSTGRES
+    if (!force_sqlite)
+    {
+        bench(Config::TESTDB_POSTGRESQL, "postgresql");
+    }
+#endif
+}
 }
@@ -8,6 +8,7 @@
 #include "crypto/Hex.h"
 #include "crypto/SHA.h"
 #include "database/Database.h"
+#include "database/DatabaseUtils.h"
 #include "util/Logging.h"
 #include "util/XDRStream.h"
 #include "util/format.h"
@@ -239,13 +240,12 @@ LedgerHeaderFrame::copyLedgerHeadersToStream(Database& db, soci::session& sess,
     return n;
 }
 
-void
-LedgerHeaderFrame::deleteOldEntries(Database& db, uint32_t ledgerSeq,
+size_t
+LedgerHeaderFrame::deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
                                     uint32_t count)
 {
-    db.getSession() << "DELETE FROM ledgerheaders WHERE ledgerseq IN (SELECT "
-                       "ledgerseq FROM ledgerheaders WHERE ledgerseq <= "
-                    << ledgerSeq << " LIMIT " << count << ")";
+    return DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
+                                                 "ledgerheaders", "ledgerseq");
 }
 
 void
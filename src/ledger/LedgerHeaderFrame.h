@@ -54,8 +54,8 @@ class LedgerHeaderFrame
                                             uint32_t ledgerCount,
                                             XDROutputFileStream& headersOut);
 
-    static void deleteOldEntries(Database& db, uint32_t ledgerSeq,
-                                 uint32_t count);
+    static size_t deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
+                                   uint32_t count);
 
     static void dropAll(Database& db);
 
@@ -6,8 +6,19 @@
 
 #include "catchup/CatchupManager.h"
 #include "history/HistoryManager.h"
+#include "lib/json/json-forwards.h"
 #include <memory>
 
+namespace soci
+{
+class session;
+}
+
+namespace medida
+{
+class Timer;
+}
+
 namespace stellar
 {
 
@@ -178,13 +189,22 @@ class LedgerManager
     // permit testing.
     virtual void closeLedger(LedgerCloseData const& ledgerData) = 0;
 
-    // deletes old entries stored in the database
-    virtual void deleteOldEntries(Database& db, uint32_t ledgerSeq,
-                                  uint32_t count) = 0;
+    // deletes the history of ledgers up to @p ledgerSeq stored in the
+    // database, at most @p count ledgers from each table, and returns the
+    // number of rows deleted
+    virtual size_t deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
+                                    uint32_t count) = 0;
 
     // checks the database for inconsistencies between objects
     virtual void checkDbState() = 0;
 
+    // exports the per-phase timings of the last ledger closes, see
+    // LedgerCloseTracer
+    virtual void dumpCloseTrace(Json::Value& ret) const = 0;
+
+    // timer of the operations of type @p type, ledger.operation.<type>
+    virtual medida::Timer& getOperationTimer(OperationType type) = 0;
+
     virtual ~LedgerManager()
     {
     }
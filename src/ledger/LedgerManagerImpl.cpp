@@ -6,6 +6,8 @@
 #include "DataFrame.h"
 #include "OfferFrame.h"
 #include "TrustFrame.h"
+#include "bucket/Bucket.h"
+#include "bucket/BucketInputIterator.h"
 #include "bucket/BucketManager.h"
 #include "crypto/Hex.h"
 #include "crypto/KeyUtils.h"
@@ -17,6 +19,7 @@
 #include "herder/LedgerCloseData.h"
 #include "herder/TxSetFrame.h"
 #include "herder/Upgrades.h"
+#include "history/CheckpointWriter.h"
 #include "history/HistoryManager.h"
 #include "invariant/InvariantDoesNotHold.h"
 #include "invariant/InvariantManager.h"
@@ -36,8 +39,12 @@
 #include "xdrpp/printer.h"
 #include "xdrpp/types.h"
 
+#include <algorithm>
 #include <chrono>
+#include <future>
+#include <set>
 #include <sstream>
+#include <unordered_set>
 
 /*
 The ledger module:
@@ -125,6 +132,9 @@ LedgerManagerImpl::LedgerManagerImpl(Application& app)
     , mLastStateChange(mApp.getClock().now())
     , mSyncingLedgersSize(
           app.getMetrics().NewCounter({"ledger", "memory", "syncing-ledgers"}))
+    , mPrefetchedEntries(app.getMetrics().NewMeter(
+          {"ledger", "prefetch", "entries"}, "entry"))
+    , mCloseTracer(app)
     , mState(LM_BOOTING_STATE)
 
 {
@@ -713,9 +723,12 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
         throw std::runtime_error("corrupt transaction set");
     }
 
+    mApp.getInvariantManager().startLedgerClose();
     soci::transaction txscope(getDatabase().getSession());
 
     auto ledgerTime = mLedgerClose.TimeScope();
+    mCloseTracer.startLedger(mCurrentLedger->mHeader.ledgerSeq,
+                             ledgerData.getTxSet()->size());
 
     auto const& sv = ledgerData.getValue();
     mCurrentLedger->mHeader.scpValue = sv;
@@ -727,13 +740,29 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     // sorted such that sequence numbers are respected
     vector<TransactionFramePtr> txs = ledgerData.getTxSet()->sortForApply();
 
+    // the batched queries of the prefetch read the SQL tables, which are not
+    // used with a ledger store
+    if (mApp.getConfig().PREFETCH_LEDGER_ENTRIES &&
+        !getDatabase().getLedgerStore())
+    {
+        LedgerCloseTracer::Span span(mCloseTracer, LedgerCloseTracer::PREFETCH);
+        prefetchLedgerEntries(txs);
+    }
+
     // first, charge fees
-    processFeesSeqNums(txs, ledgerDelta);
+    {
+        LedgerCloseTracer::Span span(mCloseTracer, LedgerCloseTracer::FEES);
+        processFeesSeqNums(txs, ledgerDelta);
+    }
 
     TransactionResultSet txResultSet;
     txResultSet.results.reserve(txs.size());
 
-    applyTransactions(txs, ledgerDelta, txResultSet);
+    {
+        LedgerCloseTracer::Span span(mCloseTracer, LedgerCloseTracer::APPLY);
+        applyTransactions(txs, ledgerDelta, txResultSet);
+    }
+    mApp.getInvariantManager().checkOnLedgerClose(ledgerData.getLedgerSeq());
 
     ledgerDelta.getHeader().txSetResultHash =
         sha256(xdr::xdr_to_opaque(txResultSet));
@@ -741,24 +770,37 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
     // apply any upgrades that were decided during consensus
     // this must be done after applying transactions as the txset
     // was validated before upgrades
-    for (size_t i = 0; i < sv.upgrades.size(); i++)
     {
-        LedgerUpgrade lupgrade;
-        try
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::UPGRADES);
+        for (size_t i = 0; i < sv.upgrades.size(); i++)
         {
-            xdr::xdr_from_opaque(sv.upgrades[i], lupgrade);
-            Upgrades::applyTo(lupgrade, ledgerDelta.getHeader());
-        }
-        catch (xdr::xdr_runtime_error)
-        {
-            CLOG(FATAL, "Ledger") << "Unknown upgrade step at index " << i;
-            throw;
+            LedgerUpgrade lupgrade;
+            try
+            {
+                xdr::xdr_from_opaque(sv.upgrades[i], lupgrade);
+                Upgrades::applyTo(lupgrade, ledgerDelta.getHeader());
+            }
+            catch (xdr::xdr_runtime_error)
+            {
+                CLOG(FATAL, "Ledger") << "Unknown upgrade step at index " << i;
+                throw;
+            }
         }
     }
 
     ledgerDelta.commit();
     ledgerClosed(ledgerDelta);
 
+    {
+        // before the checkpoint gets queued for publication, which picks up
+        // its files once complete
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::CHECKPOINT_WRITE);
+        mApp.getHistoryManager().getCheckpointWriter().appendLedger(
+            getLastClosedLedgerHeader(), *ledgerData.getTxSet(), txResultSet);
+    }
+
     // The next 4 steps happen in a relatively non-obvious, subtle order.
     // This is unfortunate and it would be nice if we could make it not
     // be so subtle, but for the time being this is where we are.
@@ -778,62 +820,109 @@ LedgerManagerImpl::closeLedger(LedgerCloseData const& ledgerData)
 
     // step 1
     auto& hm = mApp.getHistoryManager();
-    hm.maybeQueueHistoryCheckpoint();
+    {
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::HISTORY_QUEUE);
+        hm.maybeQueueHistoryCheckpoint();
+    }
 
     // step 2
-    mApp.getDatabase().clearPreparedStatementCache();
-    txscope.commit();
+    {
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::SQL_COMMIT);
+        txscope.commit();
+    }
 
     // step 3
-    hm.publishQueuedHistory();
-    hm.logAndUpdatePublishStatus();
+    {
+        LedgerCloseTracer::Span span(mCloseTracer, LedgerCloseTracer::PUBLISH);
+        hm.publishQueuedHistory();
+        hm.logAndUpdatePublishStatus();
+    }
 
     // step 4
-    mApp.getBucketManager().forgetUnreferencedBuckets();
+    {
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::BUCKET_GC);
+        mApp.getBucketManager().forgetUnreferencedBuckets();
+    }
+    mCloseTracer.finishLedger();
 }
 
-void
-LedgerManagerImpl::deleteOldEntries(Database& db, uint32_t ledgerSeq,
+size_t
+LedgerManagerImpl::deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
                                     uint32_t count)
 {
-    LedgerHeaderFrame::deleteOldEntries(db, ledgerSeq, count);
-    TransactionFrame::deleteOldEntries(db, ledgerSeq, count);
-    HerderPersistence::deleteOldEntries(db, ledgerSeq, count);
+    size_t deleted = 0;
+    deleted += LedgerHeaderFrame::deleteOldEntries(sess, ledgerSeq, count);
+    deleted += TransactionFrame::deleteOldEntries(sess, ledgerSeq, count);
+    deleted += HerderPersistence::deleteOldEntries(sess, ledgerSeq, count);
+    return deleted;
+}
+
+static AccountID const&
+getSubEntryOwner(LedgerEntry const& le)
+{
+    switch (le.data.type())
+    {
+    case TRUSTLINE:
+        return le.data.trustLine().accountID;
+    case OFFER:
+        return le.data.offer().sellerID;
+    case DATA:
+        return le.data.data().accountID;
+    default:
+        throw std::runtime_error("Unexpected sub entry type");
+    }
 }
 
 void
 LedgerManagerImpl::checkDbState()
 {
-    std::unordered_map<AccountID, AccountFrame::pointer> aData =
-        AccountFrame::checkDB(getDatabase());
-    std::unordered_map<AccountID, std::vector<TrustFrame::pointer>> trustLines;
-    trustLines = TrustFrame::loadAllLines(getDatabase());
-    std::unordered_map<AccountID, std::vector<OfferFrame::pointer>> offers;
-    offers = OfferFrame::loadAllOffers(getDatabase());
-    std::unordered_map<AccountID, std::vector<DataFrame::pointer>> datas;
-    datas = DataFrame::loadAllData(getDatabase());
+    using xdr::operator<;
+
+    // read on the main session, that may hold the changes of a ledger close
+    auto snapshot =
+        snapshotDatabase(mApp.getBucketManager(), getDatabase(), false);
 
-    for (auto& i : aData)
+    // sub entries sort by account first, like accounts: the tables are
+    // walked side by side, one account at a time
+    BucketInputIterator accounts(snapshot[0]);
+    std::vector<std::unique_ptr<BucketInputIterator>> subEntries;
+    for (size_t i = 1; i < snapshot.size(); i++)
     {
-        auto const& a = i.second->getAccount();
+        subEntries.emplace_back(make_unique<BucketInputIterator>(snapshot[i]));
+    }
+    char const* const subEntryNames[] = {"trust line", "offer", "data entry"};
+    auto unexpected = [&](size_t i) {
+        auto const& le = (**subEntries[i]).liveEntry();
+        throw std::runtime_error(
+            fmt::format("Unexpected {} found for account {}", subEntryNames[i],
+                        KeyUtils::toStrKey(getSubEntryOwner(le))));
+    };
+
+    for (; accounts; ++accounts)
+    {
+        auto const& a = (*accounts).liveEntry().data.account();
 
         // checks the number of sub entries found in the database
         size_t actualSubEntries = a.signers.size();
-        auto itTL = trustLines.find(i.first);
-        if (itTL != trustLines.end())
+        for (size_t i = 0; i < subEntries.size(); i++)
         {
-            actualSubEntries += itTL->second.size();
-        }
-        auto itOffers = offers.find(i.first);
-        if (itOffers != offers.end())
-        {
-            actualSubEntries += itOffers->second.size();
-        }
-
-        auto itDatas = datas.find(i.first);
-        if (itDatas != datas.end())
-        {
-            actualSubEntries += itDatas->second.size();
+            auto& iter = *subEntries[i];
+            for (; iter; ++iter)
+            {
+                auto const& owner = getSubEntryOwner((*iter).liveEntry());
+                if (owner < a.accountID)
+                {
+                    unexpected(i);
+                }
+                if (a.accountID < owner)
+                {
+                    break;
+                }
+                actualSubEntries++;
+            }
         }
 
         if (a.numSubEntries != (uint32)actualSubEntries)
@@ -841,26 +930,15 @@ LedgerManagerImpl::checkDbState()
             throw std::runtime_error(
                 fmt::format("Mismatch in number of subentries for account {}: "
                             "account says {} but found {}",
-                            KeyUtils::toStrKey(i.first), a.numSubEntries,
+                            KeyUtils::toStrKey(a.accountID), a.numSubEntries,
                             actualSubEntries));
         }
     }
-    for (auto& tl : trustLines)
+    for (size_t i = 0; i < subEntries.size(); i++)
     {
-        if (aData.find(tl.first) == aData.end())
+        if (*subEntries[i])
         {
-            throw std::runtime_error(
-                fmt::format("Unexpected trust line found for account {}",
-                            KeyUtils::toStrKey(tl.first)));
-        }
-    }
-    for (auto& of : offers)
-    {
-        if (aData.find(of.first) == aData.end())
-        {
-            throw std::runtime_error(
-                fmt::format("Unexpected offer found for account {}",
-                            KeyUtils::toStrKey(of.first)));
+            unexpected(i);
         }
     }
 }
@@ -880,6 +958,133 @@ LedgerManagerImpl::advanceLedgerPointers()
                           << mCurrentLedger->mHeader.ledgerSeq;
 }
 
+void
+LedgerManagerImpl::prefetchLedgerEntries(std::vector<TransactionFramePtr>& txs)
+{
+    // the entry cache holds 4096 entries, prefetching more would only evict
+    // what was just loaded
+    size_t const MAX_PREFETCH = 2048;
+    size_t const BATCH_SIZE = 128;
+
+    auto& db = getDatabase();
+    std::set<LedgerKey, LedgerEntryIdCmp> keys;
+    {
+        std::vector<LedgerKey> txKeys;
+        for (auto& tx : txs)
+        {
+            tx->insertLedgerKeysToPrefetch(txKeys);
+        }
+        for (auto const& key : txKeys)
+        {
+            if (keys.size() == MAX_PREFETCH)
+            {
+                break;
+            }
+            if (!EntryFrame::cachedEntryExists(key, db))
+            {
+                keys.insert(key);
+            }
+        }
+    }
+
+    // trust lines are read along with all the lines of their account
+    struct Batch
+    {
+        std::vector<AccountID> mAccounts;
+        std::vector<AccountID> mLineAccounts;
+        std::vector<LedgerEntry> mEntries;
+    };
+    std::vector<Batch> batches(1);
+    std::unordered_set<AccountID> lineAccounts;
+    for (auto const& key : keys)
+    {
+        if (batches.back().mAccounts.size() +
+                batches.back().mLineAccounts.size() ==
+            BATCH_SIZE)
+        {
+            batches.emplace_back();
+        }
+        if (key.type() == ACCOUNT)
+        {
+            batches.back().mAccounts.push_back(key.account().accountID);
+        }
+        else if (lineAccounts.insert(key.trustLine().accountID).second)
+        {
+            batches.back().mLineAccounts.push_back(key.trustLine().accountID);
+        }
+    }
+
+    auto load = [](soci::session& sess, Batch& batch) {
+        AccountFrame::loadAccounts(
+            sess, batch.mAccounts, [&batch](LedgerEntry const& le) {
+                batch.mEntries.push_back(le);
+                auto& signers = batch.mEntries.back().data.account().signers;
+                std::sort(signers.begin(), signers.end(),
+                          &AccountFrame::signerCompare);
+            });
+        TrustFrame::loadLines(sess, batch.mLineAccounts,
+                              [&batch](LedgerEntry const& le) {
+                                  batch.mEntries.push_back(le);
+                              });
+    };
+
+    try
+    {
+        if (batches.size() > 1 && db.canUsePool())
+        {
+            auto& pool = db.getPool();
+            std::vector<std::future<void>> loaded;
+            for (auto& batch : batches)
+            {
+                loaded.emplace_back(
+                    std::async(std::launch::async, [&pool, &batch, &load]() {
+                        soci::session sess(pool);
+                        load(sess, batch);
+                    }));
+            }
+            for (auto& f : loaded)
+            {
+                f.get();
+            }
+        }
+        else
+        {
+            for (auto& batch : batches)
+            {
+                load(db.getSession(), batch);
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        // only a cache warm-up, apply loads whatever is missing
+        CLOG(WARNING, "Ledger") << "Failed to prefetch ledger entries: "
+                                << e.what();
+        return;
+    }
+
+    size_t found = 0;
+    for (auto const& batch : batches)
+    {
+        for (auto const& le : batch.mEntries)
+        {
+            auto key = LedgerEntryKey(le);
+            if (keys.erase(key) != 0)
+            {
+                EntryFrame::putCachedEntry(
+                    key, std::make_shared<LedgerEntry const>(le), db);
+                found++;
+            }
+        }
+    }
+    // the rest does not exist
+    for (auto const& key : keys)
+    {
+        EntryFrame::putCachedEntry(key, nullptr, db);
+    }
+    mPrefetchedEntries.Mark(found);
+}
+
 void
 LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
                                       LedgerDelta& delta)
@@ -893,7 +1098,16 @@ LedgerManagerImpl::processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
         {
             LedgerDelta thisTxDelta(delta);
             tx->processFeeSeqNum(thisTxDelta, *this);
-            tx->storeTransactionFee(*this, thisTxDelta.getChanges(), ++index);
+            {
+                LedgerCloseTracer::Span span(mCloseTracer,
+                                             LedgerCloseTracer::TX_META);
+                ++index;
+                if (mApp.getConfig().STORE_HISTORY_IN_DATABASE)
+                {
+                    tx->storeTransactionFee(*this, thisTxDelta.getChanges(),
+                                            index);
+                }
+            }
             thisTxDelta.commit();
         }
         sqlTx.commit();
@@ -951,17 +1165,34 @@ LedgerManagerImpl::applyTransactions(std::vector<TransactionFramePtr>& txs,
             CLOG(ERROR, "Ledger") << "Unknown exception during tx->apply";
             tx->getResult().result.code(txINTERNAL_ERROR);
         }
-        tx->storeTransaction(*this, tm, ++index, txResultSet);
+        LedgerCloseTracer::Span span(mCloseTracer, LedgerCloseTracer::TX_META);
+        ++index;
+        if (mApp.getConfig().STORE_HISTORY_IN_DATABASE)
+        {
+            tx->storeTransaction(*this, tm, index, txResultSet);
+        }
+        else
+        {
+            txResultSet.results.emplace_back(tx->getResultPair());
+        }
     }
 }
 
 void
 LedgerManagerImpl::storeCurrentLedger()
 {
-    mCurrentLedger->storeInsert(*this);
+    {
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::HEADER_STORE);
+        mCurrentLedger->storeInsert(*this);
 
-    mApp.getPersistentState().setState(PersistentState::kLastClosedLedger,
-                                       binToHex(mCurrentLedger->getHash()));
+        mApp.getPersistentState().setState(
+            PersistentState::kLastClosedLedger,
+            binToHex(mCurrentLedger->getHash()));
+    }
+
+    LedgerCloseTracer::Span span(mCloseTracer,
+                                 LedgerCloseTracer::HAS_SERIALIZE);
 
     // Store the current HAS in the database; this is really just to checkpoint
     // the bucketlist so we can survive a restart and re-attach to the buckets.
@@ -986,12 +1217,47 @@ void
 LedgerManagerImpl::ledgerClosed(LedgerDelta const& delta)
 {
     delta.markMeters(mApp);
-    mApp.getBucketManager().addBatch(mApp, mCurrentLedger->mHeader.ledgerSeq,
-                                     delta.getLiveEntries(),
-                                     delta.getDeadEntries());
+    {
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::BUCKET_ADD);
+        mApp.getBucketManager().addBatch(
+            mApp, mCurrentLedger->mHeader.ledgerSeq, delta.getLiveEntries(),
+            delta.getDeadEntries());
+    }
 
-    mApp.getBucketManager().snapshotLedger(mCurrentLedger->mHeader);
+    {
+        LedgerCloseTracer::Span span(mCloseTracer,
+                                     LedgerCloseTracer::BUCKET_SNAPSHOT);
+        mApp.getBucketManager().snapshotLedger(mCurrentLedger->mHeader);
+    }
     storeCurrentLedger();
     advanceLedgerPointers();
 }
+
+void
+LedgerManagerImpl::dumpCloseTrace(Json::Value& ret) const
+{
+    mCloseTracer.dumpTrace(ret);
+}
+
+medida::Timer&
+LedgerManagerImpl::getOperationTimer(OperationType type)
+{
+    size_t i = static_cast<size_t>(type);
+    if (i >= mOperationTimers.size())
+    {
+        mOperationTimers.resize(i + 1, nullptr);
+    }
+    if (!mOperationTimers[i])
+    {
+        // "MANAGE_OFFER" -> "manage-offer"
+        std::string name = xdr::xdr_traits<OperationType>::enum_name(type);
+        std::transform(name.begin(), name.end(), name.begin(), [](char c) {
+            return c == '_' ? '-' : static_cast<char>(::tolower(c));
+        });
+        mOperationTimers[i] =
+            &mApp.getMetrics().NewTimer({"ledger", "operation", name});
+    }
+    return *mOperationTimers[i];
+}
 }
@@ -6,6 +6,7 @@
 #include "util/asio.h"
 
 #include "history/HistoryManager.h"
+#include "ledger/LedgerCloseTracer.h"
 #include "ledger/LedgerHeaderFrame.h"
 #include "ledger/LedgerManager.h"
 #include "ledger/SyncingLedgerChain.h"
@@ -14,6 +15,7 @@
 #include "util/Timer.h"
 #include "xdr/Stellar-ledger.h"
 #include <string>
+#include <vector>
 
 /*
 Holds the current ledger
@@ -25,6 +27,7 @@ namespace medida
 {
 class Timer;
 class Counter;
+class Meter;
 }
 
 namespace stellar
@@ -49,6 +52,11 @@ class LedgerManagerImpl : public LedgerManager
     VirtualClock::time_point mLastStateChange;
 
     medida::Counter& mSyncingLedgersSize;
+    medida::Meter& mPrefetchedEntries;
+    // indexed by OperationType, filled on first use
+    std::vector<medida::Timer*> mOperationTimers;
+
+    LedgerCloseTracer mCloseTracer;
 
     SyncingLedgerChain mSyncingLedgers;
 
@@ -56,6 +64,7 @@ class LedgerManagerImpl : public LedgerManager
                          CatchupWork::ProgressState progressState,
                          LedgerHeaderHistoryEntry const& lastClosed);
 
+    void prefetchLedgerEntries(std::vector<TransactionFramePtr>& txs);
     void processFeesSeqNums(std::vector<TransactionFramePtr>& txs,
                             LedgerDelta& delta);
     void applyTransactions(std::vector<TransactionFramePtr>& txs,
@@ -105,8 +114,10 @@ class LedgerManagerImpl : public LedgerManager
     verifyCatchupCandidate(LedgerHeaderHistoryEntry const&,
                            bool manualCatchup) const override;
     void closeLedger(LedgerCloseData const& ledgerData) override;
-    void deleteOldEntries(Database& db, uint32_t ledgerSeq,
-                          uint32_t count) override;
+    size_t deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
+                            uint32_t count) override;
     void checkDbState() override;
+    void dumpCloseTrace(Json::Value& ret) const override;
+    medida::Timer& getOperationTimer(OperationType type) override;
 };
 }
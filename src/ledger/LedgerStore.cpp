@@ -0,0 +1,46 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "ledger/LedgerStore.h"
+#include "ledger/EntryFrame.h"
+#include "ledger/LedgerRange.h"
+#include <vector>
+
+namespace stellar
+{
+
+uint64_t
+LedgerStore::countEntries(LedgerEntryType type, LedgerRange const* ledgers)
+{
+    uint64_t count = 0;
+    forEach(type, nullptr, [&](LedgerEntry const& le) {
+        if (!ledgers || (le.lastModifiedLedgerSeq >= ledgers->first() &&
+                         le.lastModifiedLedgerSeq <= ledgers->last()))
+        {
+            count++;
+        }
+        return true;
+    });
+    return count;
+}
+
+void
+LedgerStore::eraseModifiedOnOrAfterLedger(LedgerEntryType type,
+                                          uint32_t oldestLedger)
+{
+    // collect first, erasing while iterating would invalidate the scan
+    std::vector<LedgerKey> keys;
+    forEach(type, nullptr, [&](LedgerEntry const& le) {
+        if (le.lastModifiedLedgerSeq >= oldestLedger)
+        {
+            keys.emplace_back(LedgerEntryKey(le));
+        }
+        return true;
+    });
+    for (auto const& key : keys)
+    {
+        erase(key);
+    }
+}
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "overlay/StellarXDR.h"
+#include "util/NonCopyable.h"
+#include <functional>
+#include <memory>
+
+namespace stellar
+{
+
+class LedgerRange;
+
+/**
+ * Storage of the ledger entries (accounts, trust lines, offers and data) as
+ * key-value pairs, where the key is the LedgerKey of the entry.
+ *
+ * By default ledger entries are stored in their own SQL tables, by the
+ * EntryFrame subclasses, and Database::getLedgerStore returns nullptr. When
+ * LEDGER_STATE_STORE selects another store, the frames route their loads and
+ * stores to it instead, and the SQL tables stay empty.
+ *
+ * Writes go through the same SQL transaction as the rest of the ledger close,
+ * the store must not commit on its own.
+ */
+class LedgerStore : NonMovableOrCopyable
+{
+  public:
+    virtual ~LedgerStore()
+    {
+    }
+
+    // Returns the entry with key @p key, or nullptr.
+    virtual std::shared_ptr<LedgerEntry> load(LedgerKey const& key) = 0;
+    virtual bool exists(LedgerKey const& key) = 0;
+
+    // Raise if the entry already exists (insert) or does not (update).
+    virtual void insert(LedgerEntry const& entry) = 0;
+    virtual void update(LedgerEntry const& entry) = 0;
+
+    // Does nothing if there is no entry with key @p key.
+    virtual void erase(LedgerKey const& key) = 0;
+
+    // Calls @p f on the entries of type @p type, only those of @p account if
+    // not nullptr, in key order, until it returns false.
+    virtual void forEach(LedgerEntryType type, AccountID const* account,
+                         std::function<bool(LedgerEntry const&)> f) = 0;
+
+    // Calls @p f on up to @p numOffers offers selling @p selling for
+    // @p buying, in the order of OfferFrame::loadBestOffers: by price (as
+    // computed by OfferFrame), then offer id, starting after @p after if not
+    // nullptr.
+    virtual void loadBestOffers(size_t numOffers, Asset const& selling,
+                                Asset const& buying, OfferEntry const* after,
+                                std::function<void(LedgerEntry const&)> f) = 0;
+
+    // Number of entries of type @p type, only counting those last modified
+    // in @p ledgers if not nullptr. Scans the entries unless overridden.
+    virtual uint64_t countEntries(LedgerEntryType type,
+                                  LedgerRange const* ledgers = nullptr);
+
+    // Erases the entries of type @p type last modified on or after
+    // @p oldestLedger. Scans the entries unless overridden.
+    virtual void eraseModifiedOnOrAfterLedger(LedgerEntryType type,
+                                              uint32_t oldestLedger);
+};
+}
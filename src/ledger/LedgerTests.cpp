@@ -11,13 +11,21 @@
 #include "lib/catch.hpp"
 #include "main/Application.h"
 #include "main/Config.h"
+#include "test/TestAccount.h"
 #include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
 #include "util/Logging.h"
 #include "util/Timer.h"
 #include "util/types.h"
+#include <set>
 #include <xdrpp/autocheck.h>
 
+#include "lib/json/json.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
 using namespace stellar;
 
 TEST_CASE("Ledger entry db lifecycle", "[ledger]")
@@ -138,3 +146,229 @@ TEST_CASE("DB cache interaction with transactions", "[ledger][dbcache]")
 
     CHECK(balance0 == acc->getAccount().balance);
 }
+
+TEST_CASE("ledger close trace", "[ledger][closetrace]")
+{
+    Config cfg(getTestConfig());
+    cfg.LEDGER_CLOSE_TRACE_SIZE = 2;
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+
+    auto& lm = app->getLedgerManager();
+    for (uint32 seq = 2; seq <= 4; seq++)
+    {
+        txtest::closeLedgerOn(*app, seq, seq, 1, 2017);
+    }
+
+    Json::Value trace;
+    lm.dumpCloseTrace(trace);
+    auto const& events = trace["traceEvents"];
+    REQUIRE(events.isArray());
+
+    // only the last 2 ledgers are kept
+    std::vector<uint32> ledgers;
+    std::set<std::string> phases;
+    for (auto const& ev : events)
+    {
+        REQUIRE(ev["ph"].asString() == "X");
+        if (ev["name"].asString() == "ledger")
+        {
+            ledgers.push_back(ev["args"]["ledger"].asUInt());
+        }
+        else
+        {
+            phases.insert(ev["name"].asString());
+        }
+    }
+    REQUIRE(ledgers == std::vector<uint32>{3, 4});
+    for (auto const& phase : {"fees", "apply", "bucket-add", "header-store",
+                              "has-serialize", "sql-commit"})
+    {
+        REQUIRE(phases.count(phase) == 1);
+    }
+
+    auto& bucketAddTimer =
+        app->getMetrics().NewTimer({"ledger", "close", "bucket-add"});
+    REQUIRE(bucketAddTimer.count() == 3);
+}
+
+TEST_CASE("prefetch ledger entries", "[ledger][prefetch]")
+{
+    // on disk, so that batches are read over the connection pool
+    Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+    cfg.PREFETCH_LEDGER_ENTRIES = true;
+    VirtualClock clock;
+    Application::pointer app = createTestApplication(clock, cfg);
+    app->start();
+
+    auto root = TestAccount::createRoot(*app);
+    auto issuer = root.create("issuer", 1000000000);
+    auto usd = issuer.asset("USD");
+    std::vector<TestAccount> accounts;
+    for (int i = 0; i < 200; i++)
+    {
+        accounts.push_back(root.create("a" + std::to_string(i), 1000000000));
+        accounts.back().changeTrust(usd, 1000000);
+        issuer.pay(accounts.back(), usd, 1000);
+    }
+
+    std::vector<TransactionFramePtr> txs;
+    for (size_t i = 0; i < accounts.size(); i++)
+    {
+        auto const& to = accounts[(i + 1) % accounts.size()];
+        txs.push_back(accounts[i].tx({txtest::payment(to, usd, 10)}));
+    }
+
+    app->getDatabase().getEntryCache().clear();
+    auto results = txtest::closeLedgerOn(*app, 2, 1, 1, 2017, txs);
+    for (auto const& r : results)
+    {
+        REQUIRE(r.first.result.result.code() == txSUCCESS);
+    }
+
+    // the account and trust line of every sender
+    auto& prefetched =
+        app->getMetrics().NewMeter({"ledger", "prefetch", "entries"}, "entry");
+    REQUIRE(prefetched.count() == 400);
+    for (auto const& a : accounts)
+    {
+        REQUIRE(a.loadTrustLine(usd).balance == 1000);
+    }
+}
+
+TEST_CASE("prepared statement reuse", "[ledger][bench][hide]")
+{
+    auto bench = [](Config::TestDbMode mode, std::string const& name) {
+        VirtualClock clock;
+        Application::pointer app =
+            createTestApplication(clock, getTestConfig(0, mode));
+        app->start();
+        auto& db = app->getDatabase();
+        auto& prepared = app->getMetrics().NewMeter(
+            {"database", "statement", "prepare"}, "statement");
+
+        auto root = TestAccount::createRoot(*app);
+        auto issuer = root.create("issuer", 1000000000);
+        auto usd = issuer.asset("USD");
+        std::vector<TestAccount> accounts;
+        for (int i = 0; i < 50; i++)
+        {
+            accounts.push_back(
+                root.create("a" + std::to_string(i), 1000000000));
+            accounts.back().changeTrust(usd, 1000000);
+            issuer.pay(accounts.back(), usd, 1000);
+        }
+
+        uint32_t ledgerSeq = 2;
+        // closes ledgers of payments, purging the prepared statements
+        // before each one as closeLedger used to
+        auto closeLedgers = [&](bool purge) {
+            size_t const n = 50;
+            auto prepared0 = prepared.count();
+            std::chrono::nanoseconds elapsed(0);
+            for (size_t i = 0; i < n; i++)
+            {
+                std::vector<TransactionFramePtr> txs;
+                for (size_t j = 0; j < accounts.size(); j++)
+                {
+                    auto const& to = accounts[(j + 1) % accounts.size()];
+                    txs.push_back(
+                        accounts[j].tx({txtest::payment(to, usd, 1)}));
+                }
+                if (purge)
+                {
+                    db.clearPreparedStatementCache();
+                }
+                db.getEntryCache().clear();
+                auto start = std::chrono::steady_clock::now();
+                txtest::closeLedgerOn(*app, ledgerSeq++, 1, 1, 2018, txs);
+                elapsed += std::chrono::steady_clock::now() - start;
+            }
+            auto us =
+                std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                    .count();
+            LOG(INFO) << name << (purge ? " purging" : " reusing") << ": "
+                      << us / n << "us per ledger, "
+                      << (prepared.count() - prepared0) / n
+                      << " statements prepared per ledger";
+            return us / n;
+        };
+
+        // warm up, then compare
+        closeLedgers(false);
+        auto purging = closeLedgers(true);
+        auto reusing = closeLedgers(false);
+        LOG(INFO) << name << ": reusing statements saves "
+                  << purging - reusing << "us per ledger";
+    };
+
+    bench(Config::TESTDB_ON_DISK_SQLITE, "sqlite");
+#ifdef USE_POSTGRES
+    if (!force_sqlite)
+    {
+        bench(Config::TESTDB_POSTGRESQL, "postgresql");
+    }
+#endif
+}
+
+TEST_CASE("ledger state store close times", "[ledger][bench][hide]")
+{
+    auto bench = [](std::string const& store) {
+        Config cfg(getTestConfig(0, Config::TESTDB_ON_DISK_SQLITE));
+        cfg.LEDGER_STATE_STORE = store;
+        VirtualClock clock;
+        Application::pointer app = createTestApplication(clock, cfg);
+        app->start();
+        auto& db = app->getDatabase();
+
+        auto root = TestAccount::createRoot(*app);
+        auto issuer = root.create("issuer", 1000000000);
+        auto usd = issuer.asset("USD");
+        std::vector<TestAccount> accounts;
+        for (int i = 0; i < 100; i++)
+        {
+            accounts.push_back(
+                root.create("a" + std::to_string(i), 1000000000));
+            accounts.back().changeTrust(usd, 1000000);
+            issuer.pay(accounts.back(), usd, 1000);
+        }
+
+        uint32_t ledgerSeq = 2;
+        // closes ledgers of payments, with a cold entry cache so that
+        // every entry is read from the store
+        auto closeLedgers = [&](size_t n) {
+            std::chrono::nanoseconds elapsed(0);
+            for (size_t i = 0; i < n; i++)
+            {
+                std::vector<TransactionFramePtr> txs;
+                for (size_t j = 0; j < accounts.size(); j++)
+                {
+                    auto const& to = accounts[(j + 1) % accounts.size()];
+                    txs.push_back(accounts[j].tx(
+                        {txtest::payment(to, usd, 1), txtest::payment(to, 1)}));
+                }
+                db.getEntryCache().clear();
+                auto start = std::chrono::steady_clock::now();
+                txtest::closeLedgerOn(*app, ledgerSeq++, 1, 1, 2018, txs);
+                elapsed += std::chrono::steady_clock::now() - start;
+            }
+            auto us =
+                std::chrono::duration_cast<std::chrono::microseconds>(elapsed)
+                    .count();
+            return us / n;
+        };
+
+        // warm up, then measure
+        closeLedgers(10);
+        auto us = closeLedgers(50);
+        LOG(INFO) << store << " store: " << us << "us per ledger of "
+                  << accounts.size() << " transactions";
+        return us;
+    };
+
+    auto sql = bench("sql");
+    auto kv = bench("kv");
+    LOG(INFO) << "key-value store closes ledgers in " << kv * 100 / sql
+              << "% of the time of the SQL tables";
+}
@@ -9,6 +9,7 @@
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerRange.h"
+#include "ledger/LedgerStore.h"
 #include "transactions/ManageOfferOpFrame.h"
 #include "util/types.h"
 
@@ -124,19 +125,35 @@ OfferFrame::loadOffer(AccountID const& sellerID, uint64_t offerID, Database& db,
 {
     OfferFrame::pointer retOffer;
 
-    std::string actIDStrKey = KeyUtils::toStrKey(sellerID);
+    if (auto store = db.getLedgerStore())
+    {
+        LedgerKey key;
+        key.type(OFFER);
+        key.offer().sellerID = sellerID;
+        key.offer().offerID = offerID;
+        auto timer = db.getSelectTimer("offer");
+        auto entry = store->load(key);
+        if (entry)
+        {
+            retOffer = make_shared<OfferFrame>(*entry);
+        }
+    }
+    else
+    {
+        std::string actIDStrKey = KeyUtils::toStrKeyCached(sellerID);
 
-    std::string sql = offerColumnSelector;
-    sql += " WHERE sellerid = :id AND offerid = :offerid";
-    auto prep = db.getPreparedStatement(sql);
-    auto& st = prep.statement();
-    st.exchange(use(actIDStrKey));
-    st.exchange(use(offerID));
+        std::string sql = offerColumnSelector;
+        sql += " WHERE sellerid = :id AND offerid = :offerid";
+        auto prep = db.getPreparedStatement(sql);
+        auto& st = prep.statement();
+        st.exchange(use(actIDStrKey));
+        st.exchange(use(offerID));
 
-    auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffer](LedgerEntry const& offer) {
-        retOffer = make_shared<OfferFrame>(offer);
-    });
+        auto timer = db.getSelectTimer("offer");
+        loadOffers(prep, [&retOffer](LedgerEntry const& offer) {
+            retOffer = make_shared<OfferFrame>(offer);
+        });
+    }
 
     if (delta && retOffer)
     {
@@ -180,7 +197,7 @@ OfferFrame::loadOffers(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        oe.sellerID = KeyUtils::fromStrKey<PublicKey>(actIDStrKey);
+        oe.sellerID = KeyUtils::fromStrKeyCached(actIDStrKey);
         if ((buyingAssetType > ASSET_TYPE_CREDIT_ALPHANUM12) ||
             (sellingAssetType > ASSET_TYPE_CREDIT_ALPHANUM12))
             throw std::runtime_error("bad database state");
@@ -198,14 +215,14 @@ OfferFrame::loadOffers(StatementContext& prep,
             if (sellingAssetType == ASSET_TYPE_CREDIT_ALPHANUM12)
             {
                 oe.selling.alphaNum12().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(sellingIssuerStrKey);
+                    KeyUtils::fromStrKeyCached(sellingIssuerStrKey);
                 strToAssetCode(oe.selling.alphaNum12().assetCode,
                                sellingAssetCode);
             }
             else if (sellingAssetType == ASSET_TYPE_CREDIT_ALPHANUM4)
             {
                 oe.selling.alphaNum4().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(sellingIssuerStrKey);
+                    KeyUtils::fromStrKeyCached(sellingIssuerStrKey);
                 strToAssetCode(oe.selling.alphaNum4().assetCode,
                                sellingAssetCode);
             }
@@ -222,14 +239,14 @@ OfferFrame::loadOffers(StatementContext& prep,
             if (buyingAssetType == ASSET_TYPE_CREDIT_ALPHANUM12)
             {
                 oe.buying.alphaNum12().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(buyingIssuerStrKey);
+                    KeyUtils::fromStrKeyCached(buyingIssuerStrKey);
                 strToAssetCode(oe.buying.alphaNum12().assetCode,
                                buyingAssetCode);
             }
             else if (buyingAssetType == ASSET_TYPE_CREDIT_ALPHANUM4)
             {
                 oe.buying.alphaNum4().issuer =
-                    KeyUtils::fromStrKey<PublicKey>(buyingIssuerStrKey);
+                    KeyUtils::fromStrKeyCached(buyingIssuerStrKey);
                 strToAssetCode(oe.buying.alphaNum4().assetCode,
                                buyingAssetCode);
             }
@@ -241,10 +258,21 @@ OfferFrame::loadOffers(StatementContext& prep,
 }
 
 void
-OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
-                           Asset const& selling, Asset const& buying,
+OfferFrame::loadBestOffers(size_t numOffers, Asset const& selling,
+                           Asset const& buying, OfferFrame const* after,
                            vector<OfferFrame::pointer>& retOffers, Database& db)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = db.getSelectTimer("offer");
+        store->loadBestOffers(
+            numOffers, selling, buying, after ? &after->mOffer : nullptr,
+            [&retOffers](LedgerEntry const& of) {
+                retOffers.emplace_back(make_shared<OfferFrame>(of));
+            });
+        return;
+    }
+
     std::string sql = offerColumnSelector;
 
     std::string sellingAssetCode, sellingIssuerStrKey;
@@ -255,7 +283,8 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
 
     if (selling.type() == ASSET_TYPE_NATIVE)
     {
-        sql += " WHERE sellingassettype = 0 AND sellingissuer IS NULL";
+        sql += " WHERE sellingassetcode IS NULL AND sellingissuer IS NULL"
+               " AND sellingassettype = 0";
     }
     else
     {
@@ -263,13 +292,13 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         {
             assetCodeToStr(selling.alphaNum4().assetCode, sellingAssetCode);
             sellingIssuerStrKey =
-                KeyUtils::toStrKey(selling.alphaNum4().issuer);
+                KeyUtils::toStrKeyCached(selling.alphaNum4().issuer);
         }
         else if (selling.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             assetCodeToStr(selling.alphaNum12().assetCode, sellingAssetCode);
             sellingIssuerStrKey =
-                KeyUtils::toStrKey(selling.alphaNum12().issuer);
+                KeyUtils::toStrKeyCached(selling.alphaNum12().issuer);
         }
         else
         {
@@ -282,19 +311,22 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
 
     if (buying.type() == ASSET_TYPE_NATIVE)
     {
-        sql += " AND buyingassettype = 0 AND buyingissuer IS NULL";
+        sql += " AND buyingassetcode IS NULL AND buyingissuer IS NULL"
+               " AND buyingassettype = 0";
     }
     else
     {
         if (buying.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
         {
             assetCodeToStr(buying.alphaNum4().assetCode, buyingAssetCode);
-            buyingIssuerStrKey = KeyUtils::toStrKey(buying.alphaNum4().issuer);
+            buyingIssuerStrKey =
+                KeyUtils::toStrKeyCached(buying.alphaNum4().issuer);
         }
         else if (buying.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             assetCodeToStr(buying.alphaNum12().assetCode, buyingAssetCode);
-            buyingIssuerStrKey = KeyUtils::toStrKey(buying.alphaNum12().issuer);
+            buyingIssuerStrKey =
+                KeyUtils::toStrKeyCached(buying.alphaNum12().issuer);
         }
         else
         {
@@ -305,9 +337,20 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         sql += " AND buyingassetcode = :gcur AND buyingissuer = :gi";
     }
 
+    // resume after the last offer seen: bestofferindex (schema version 6)
+    // finds it directly where an OFFSET would rescan the offers skipped so far
+    double afterPrice = 0;
+    uint64_t afterOfferID = 0;
+    if (after)
+    {
+        afterPrice = after->computePrice();
+        afterOfferID = after->getOfferID();
+        sql += " AND price >= :p1 AND (price > :p2 OR offerid > :oid)";
+    }
+
     // price is an approximation of the actual n/d (truncated math, 15 digits)
     // ordering by offerid gives precendence to older offers for fairness
-    sql += " ORDER BY price, offerid LIMIT :n OFFSET :o";
+    sql += " ORDER BY price, offerid LIMIT :n";
 
     auto prep = db.getPreparedStatement(sql);
     auto& st = prep.statement();
@@ -324,8 +367,14 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
         st.exchange(use(buyingIssuerStrKey));
     }
 
+    if (after)
+    {
+        st.exchange(use(afterPrice));
+        st.exchange(use(afterPrice));
+        st.exchange(use(afterOfferID));
+    }
+
     st.exchange(use(numOffers));
-    st.exchange(use(offset));
 
     auto timer = db.getSelectTimer("offer");
     loadOffers(prep, [&retOffers](LedgerEntry const& of) {
@@ -333,26 +382,27 @@ OfferFrame::loadBestOffers(size_t numOffers, size_t offset,
     });
 }
 
-std::unordered_map<AccountID, std::vector<OfferFrame::pointer>>
-OfferFrame::loadAllOffers(Database& db)
+void
+OfferFrame::loadAllOffers(
+    soci::session& sess, std::function<void(LedgerEntry const&)> offerProcessor)
 {
-    std::unordered_map<AccountID, std::vector<OfferFrame::pointer>> retOffers;
-    std::string sql = offerColumnSelector;
-    sql += " ORDER BY sellerid";
-    auto prep = db.getPreparedStatement(sql);
-
-    auto timer = db.getSelectTimer("offer");
-    loadOffers(prep, [&retOffers](LedgerEntry const& of) {
-        auto& thisUserOffers = retOffers[of.data.offer().sellerID];
-        thisUserOffers.emplace_back(make_shared<OfferFrame>(of));
-    });
-    return retOffers;
+    auto st = std::make_shared<soci::statement>(sess);
+    st->alloc();
+    st->prepare(offerColumnSelector);
+    StatementContext prep(st);
+    loadOffers(prep, offerProcessor);
 }
 
 bool
 OfferFrame::exists(Database& db, LedgerKey const& key)
 {
-    std::string actIDStrKey = KeyUtils::toStrKey(key.offer().sellerID);
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = db.getSelectTimer("offer-exists");
+        return store->exists(key);
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(key.offer().sellerID);
     int exists = 0;
     auto timer = db.getSelectTimer("offer-exists");
     auto prep =
@@ -368,17 +418,26 @@ OfferFrame::exists(Database& db, LedgerKey const& key)
 }
 
 uint64_t
-OfferFrame::countObjects(soci::session& sess)
+OfferFrame::countObjects(Database& db)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(OFFER);
+    }
     uint64_t count = 0;
-    sess << "SELECT COUNT(*) FROM offers;", into(count);
+    db.getSession() << "SELECT COUNT(*) FROM offers;", into(count);
     return count;
 }
 
 uint64_t
-OfferFrame::countObjects(soci::session& sess, LedgerRange const& ledgers)
+OfferFrame::countObjects(Database& db, LedgerRange const& ledgers)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(OFFER, &ledgers);
+    }
     uint64_t count = 0;
+    auto& sess = db.getSession();
     sess << "SELECT COUNT(*) FROM offers"
             " WHERE lastmodified >= :v1 AND lastmodified <= :v2;",
         into(count), use(ledgers.first()), use(ledgers.last());
@@ -395,6 +454,11 @@ OfferFrame::deleteOffersModifiedOnOrAfterLedger(Database& db,
                    le->lastModifiedLedgerSeq >= oldestLedger;
         });
 
+    if (auto store = db.getLedgerStore())
+    {
+        store->eraseModifiedOnOrAfterLedger(OFFER, oldestLedger);
+    }
+    else
     {
         auto prep = db.getPreparedStatement(
             "DELETE FROM offers WHERE lastmodified >= :v1");
@@ -414,6 +478,16 @@ OfferFrame::storeDelete(LedgerDelta& delta, Database& db) const
 void
 OfferFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        {
+            auto timer = db.getDeleteTimer("offer");
+            store->erase(key);
+        }
+        delta.deleteEntry(key);
+        return;
+    }
+
     auto timer = db.getDeleteTimer("offer");
     auto prep = db.getPreparedStatement("DELETE FROM offers WHERE offerid=:s");
     auto& st = prep.statement();
@@ -446,7 +520,24 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
 {
     touch(delta);
 
-    std::string actIDStrKey = KeyUtils::toStrKey(mOffer.sellerID);
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer =
+            insert ? db.getInsertTimer("offer") : db.getUpdateTimer("offer");
+        if (insert)
+        {
+            store->insert(mEntry);
+            delta.addEntry(*this);
+        }
+        else
+        {
+            store->update(mEntry);
+            delta.modEntry(*this);
+        }
+        return;
+    }
+
+    std::string actIDStrKey = KeyUtils::toStrKeyCached(mOffer.sellerID);
 
     unsigned int sellingType = mOffer.selling.type();
     unsigned int buyingType = mOffer.buying.type();
@@ -457,14 +548,14 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
     if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
         sellingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.selling.alphaNum4().issuer);
+            KeyUtils::toStrKeyCached(mOffer.selling.alphaNum4().issuer);
         assetCodeToStr(mOffer.selling.alphaNum4().assetCode, sellingAssetCode);
         selling_ind = soci::i_ok;
     }
     else if (sellingType == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
         sellingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.selling.alphaNum12().issuer);
+            KeyUtils::toStrKeyCached(mOffer.selling.alphaNum12().issuer);
         assetCodeToStr(mOffer.selling.alphaNum12().assetCode, sellingAssetCode);
         selling_ind = soci::i_ok;
     }
@@ -472,14 +563,14 @@ OfferFrame::storeUpdateHelper(LedgerDelta& delta, Database& db, bool insert)
     if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
         buyingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.buying.alphaNum4().issuer);
+            KeyUtils::toStrKeyCached(mOffer.buying.alphaNum4().issuer);
         assetCodeToStr(mOffer.buying.alphaNum4().assetCode, buyingAssetCode);
         buying_ind = soci::i_ok;
     }
     else if (buyingType == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
         buyingIssuerStrKey =
-            KeyUtils::toStrKey(mOffer.buying.alphaNum12().issuer);
+            KeyUtils::toStrKeyCached(mOffer.buying.alphaNum12().issuer);
         assetCodeToStr(mOffer.buying.alphaNum12().assetCode, buyingAssetCode);
         buying_ind = soci::i_ok;
     }
@@ -79,9 +79,8 @@ class OfferFrame : public EntryFrame
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
     static bool exists(Database& db, LedgerKey const& key);
-    static uint64_t countObjects(soci::session& sess);
-    static uint64_t countObjects(soci::session& sess,
-                                 LedgerRange const& ledgers);
+    static uint64_t countObjects(Database& db);
+    static uint64_t countObjects(Database& db, LedgerRange const& ledgers);
     static void deleteOffersModifiedOnOrAfterLedger(Database& db,
                                                     uint32_t oldestLedger);
 
@@ -89,14 +88,20 @@ class OfferFrame : public EntryFrame
     static pointer loadOffer(AccountID const& accountID, uint64_t offerID,
                              Database& db, LedgerDelta* delta = nullptr);
 
-    static void loadBestOffers(size_t numOffers, size_t offset,
-                               Asset const& pays, Asset const& gets,
+    // Loads up to @p numOffers offers selling @p pays for @p gets, best
+    // first (by price, then offer id). Pages are chained by passing the last
+    // offer of the previous page as @p after, or nullptr for the first page;
+    // offers taken in between do not shift the next page.
+    static void loadBestOffers(size_t numOffers, Asset const& pays,
+                               Asset const& gets, OfferFrame const* after,
                                std::vector<OfferFrame::pointer>& retOffers,
                                Database& db);
 
-    // load all offers from the database (very slow)
-    static std::unordered_map<AccountID, std::vector<OfferFrame::pointer>>
-    loadAllOffers(Database& db);
+    // Loads all the offers of the offers table, in no particular order, on
+    // @p sess, which may be a session of the connection pool.
+    static void
+    loadAllOffers(soci::session& sess,
+                  std::function<void(LedgerEntry const&)> offerProcessor);
 
     static void dropAll(Database& db);
 
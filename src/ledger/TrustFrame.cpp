@@ -9,6 +9,7 @@
 #include "crypto/SecretKey.h"
 #include "database/Database.h"
 #include "ledger/LedgerRange.h"
+#include "ledger/LedgerStore.h"
 #include "util/types.h"
 
 using namespace std;
@@ -66,17 +67,17 @@ void
 TrustFrame::getKeyFields(LedgerKey const& key, std::string& actIDStrKey,
                          std::string& issuerStrKey, std::string& assetCode)
 {
-    actIDStrKey = KeyUtils::toStrKey(key.trustLine().accountID);
+    actIDStrKey = KeyUtils::toStrKeyCached(key.trustLine().accountID);
     if (key.trustLine().asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
     {
         issuerStrKey =
-            KeyUtils::toStrKey(key.trustLine().asset.alphaNum4().issuer);
+            KeyUtils::toStrKeyCached(key.trustLine().asset.alphaNum4().issuer);
         assetCodeToStr(key.trustLine().asset.alphaNum4().assetCode, assetCode);
     }
     else if (key.trustLine().asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
     {
         issuerStrKey =
-            KeyUtils::toStrKey(key.trustLine().asset.alphaNum12().issuer);
+            KeyUtils::toStrKeyCached(key.trustLine().asset.alphaNum12().issuer);
         assetCodeToStr(key.trustLine().asset.alphaNum12().assetCode, assetCode);
     }
 
@@ -147,6 +148,12 @@ TrustFrame::exists(Database& db, LedgerKey const& key)
         return true;
     }
 
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = db.getSelectTimer("trust-exists");
+        return store->exists(key);
+    }
+
     std::string actIDStrKey, issuerStrKey, assetCode;
     getKeyFields(key, actIDStrKey, issuerStrKey, assetCode);
     int exists = 0;
@@ -165,17 +172,26 @@ TrustFrame::exists(Database& db, LedgerKey const& key)
 }
 
 uint64_t
-TrustFrame::countObjects(soci::session& sess)
+TrustFrame::countObjects(Database& db)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(TRUSTLINE);
+    }
     uint64_t count = 0;
-    sess << "SELECT COUNT(*) FROM trustlines;", into(count);
+    db.getSession() << "SELECT COUNT(*) FROM trustlines;", into(count);
     return count;
 }
 
 uint64_t
-TrustFrame::countObjects(soci::session& sess, LedgerRange const& ledgers)
+TrustFrame::countObjects(Database& db, LedgerRange const& ledgers)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        return store->countEntries(TRUSTLINE, &ledgers);
+    }
     uint64_t count = 0;
+    auto& sess = db.getSession();
     sess << "SELECT COUNT(*) FROM trustlines"
             " WHERE lastmodified >= :v1 AND lastmodified <= :v2;",
         into(count), use(ledgers.first()), use(ledgers.last());
@@ -192,6 +208,11 @@ TrustFrame::deleteTrustLinesModifiedOnOrAfterLedger(Database& db,
                    le->lastModifiedLedgerSeq >= oldestLedger;
         });
 
+    if (auto store = db.getLedgerStore())
+    {
+        store->eraseModifiedOnOrAfterLedger(TRUSTLINE, oldestLedger);
+    }
+    else
     {
         auto prep = db.getPreparedStatement(
             "DELETE FROM trustlines WHERE lastmodified >= :v1");
@@ -213,6 +234,16 @@ TrustFrame::storeDelete(LedgerDelta& delta, Database& db, LedgerKey const& key)
 {
     flushCachedEntry(key, db);
 
+    if (auto store = db.getLedgerStore())
+    {
+        {
+            auto timer = db.getDeleteTimer("trust");
+            store->erase(key);
+        }
+        delta.deleteEntry(key);
+        return;
+    }
+
     std::string actIDStrKey, issuerStrKey, assetCode;
     getKeyFields(key, actIDStrKey, issuerStrKey, assetCode);
 
@@ -235,6 +266,16 @@ TrustFrame::storeChange(LedgerDelta& delta, Database& db)
 
     touch(delta);
 
+    if (auto store = db.getLedgerStore())
+    {
+        {
+            auto timer = db.getUpdateTimer("trust");
+            store->update(mEntry);
+        }
+        delta.modEntry(*this);
+        return;
+    }
+
     std::string actIDStrKey, issuerStrKey, assetCode;
     getKeyFields(key, actIDStrKey, issuerStrKey, assetCode);
 
@@ -274,6 +315,16 @@ TrustFrame::storeAdd(LedgerDelta& delta, Database& db)
 
     touch(delta);
 
+    if (auto store = db.getLedgerStore())
+    {
+        {
+            auto timer = db.getInsertTimer("trust");
+            store->insert(mEntry);
+        }
+        delta.addEntry(*this);
+        return;
+    }
+
     std::string actIDStrKey, issuerStrKey, assetCode;
     unsigned int assetType = getKey().trustLine().asset.type();
     getKeyFields(getKey(), actIDStrKey, issuerStrKey, assetCode);
@@ -361,35 +412,47 @@ TrustFrame::loadTrustLine(AccountID const& accountID, Asset const& asset,
         }
     }
 
-    std::string accStr, issuerStr, assetStr;
-
-    accStr = KeyUtils::toStrKey(accountID);
-    if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
+    pointer retLine;
+    if (auto store = db.getLedgerStore())
     {
-        assetCodeToStr(asset.alphaNum4().assetCode, assetStr);
-        issuerStr = KeyUtils::toStrKey(asset.alphaNum4().issuer);
+        auto timer = db.getSelectTimer("trust");
+        auto entry = store->load(key);
+        if (entry)
+        {
+            retLine = make_shared<TrustFrame>(*entry);
+        }
     }
-    else if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
+    else
     {
-        assetCodeToStr(asset.alphaNum12().assetCode, assetStr);
-        issuerStr = KeyUtils::toStrKey(asset.alphaNum12().issuer);
-    }
+        std::string accStr, issuerStr, assetStr;
 
-    auto query = std::string(trustLineColumnSelector);
-    query += (" WHERE accountid = :id "
-              " AND issuer = :issuer "
-              " AND assetcode = :asset");
-    auto prep = db.getPreparedStatement(query);
-    auto& st = prep.statement();
-    st.exchange(use(accStr));
-    st.exchange(use(issuerStr));
-    st.exchange(use(assetStr));
+        accStr = KeyUtils::toStrKeyCached(accountID);
+        if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
+        {
+            assetCodeToStr(asset.alphaNum4().assetCode, assetStr);
+            issuerStr = KeyUtils::toStrKeyCached(asset.alphaNum4().issuer);
+        }
+        else if (asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
+        {
+            assetCodeToStr(asset.alphaNum12().assetCode, assetStr);
+            issuerStr = KeyUtils::toStrKeyCached(asset.alphaNum12().issuer);
+        }
 
-    pointer retLine;
-    auto timer = db.getSelectTimer("trust");
-    loadLines(prep, [&retLine](LedgerEntry const& trust) {
-        retLine = make_shared<TrustFrame>(trust);
-    });
+        auto query = std::string(trustLineColumnSelector);
+        query += (" WHERE accountid = :id "
+                  " AND issuer = :issuer "
+                  " AND assetcode = :asset");
+        auto prep = db.getPreparedStatement(query);
+        auto& st = prep.statement();
+        st.exchange(use(accStr));
+        st.exchange(use(issuerStr));
+        st.exchange(use(assetStr));
+
+        auto timer = db.getSelectTimer("trust");
+        loadLines(prep, [&retLine](LedgerEntry const& trust) {
+            retLine = make_shared<TrustFrame>(trust);
+        });
+    }
 
     if (retLine)
     {
@@ -445,18 +508,18 @@ TrustFrame::loadLines(StatementContext& prep,
     st.execute(true);
     while (st.got_data())
     {
-        tl.accountID = KeyUtils::fromStrKey<PublicKey>(actIDStrKey);
+        tl.accountID = KeyUtils::fromStrKeyCached(actIDStrKey);
         tl.asset.type((AssetType)assetType);
         if (assetType == ASSET_TYPE_CREDIT_ALPHANUM4)
         {
             tl.asset.alphaNum4().issuer =
-                KeyUtils::fromStrKey<PublicKey>(issuerStrKey);
+                KeyUtils::fromStrKeyCached(issuerStrKey);
             strToAssetCode(tl.asset.alphaNum4().assetCode, assetCode);
         }
         else if (assetType == ASSET_TYPE_CREDIT_ALPHANUM12)
         {
             tl.asset.alphaNum12().issuer =
-                KeyUtils::fromStrKey<PublicKey>(issuerStrKey);
+                KeyUtils::fromStrKeyCached(issuerStrKey);
             strToAssetCode(tl.asset.alphaNum12().assetCode, assetCode);
         }
 
@@ -470,8 +533,19 @@ void
 TrustFrame::loadLines(AccountID const& accountID,
                       std::vector<TrustFrame::pointer>& retLines, Database& db)
 {
+    if (auto store = db.getLedgerStore())
+    {
+        auto timer = db.getSelectTimer("trust");
+        store->forEach(TRUSTLINE, &accountID,
+                       [&retLines](LedgerEntry const& cur) {
+                           retLines.emplace_back(make_shared<TrustFrame>(cur));
+                           return true;
+                       });
+        return;
+    }
+
     std::string actIDStrKey;
-    actIDStrKey = KeyUtils::toStrKey(accountID);
+    actIDStrKey = KeyUtils::toStrKeyCached(accountID);
 
     auto query = std::string(trustLineColumnSelector);
     query += (" WHERE accountid = :id ");
@@ -485,21 +559,43 @@ TrustFrame::loadLines(AccountID const& accountID,
     });
 }
 
-std::unordered_map<AccountID, std::vector<TrustFrame::pointer>>
-TrustFrame::loadAllLines(Database& db)
+void
+TrustFrame::loadLines(soci::session& sess,
+                      std::vector<AccountID> const& accountIDs,
+                      std::function<void(LedgerEntry const&)> trustProcessor)
 {
-    std::unordered_map<AccountID, std::vector<TrustFrame::pointer>> retLines;
+    if (accountIDs.empty())
+    {
+        return;
+    }
 
+    // StrKeys only hold base32 characters, so can be inlined
     auto query = std::string(trustLineColumnSelector);
-    query += (" ORDER BY accountid");
-    auto prep = db.getPreparedStatement(query);
+    query += " WHERE accountid IN (";
+    for (size_t i = 0; i < accountIDs.size(); i++)
+    {
+        query += i == 0 ? "'" : ",'";
+        query += KeyUtils::toStrKeyCached(accountIDs[i]);
+        query += "'";
+    }
+    query += ")";
 
-    auto timer = db.getSelectTimer("trust");
-    loadLines(prep, [&retLines](LedgerEntry const& cur) {
-        auto& thisUserLines = retLines[cur.data.trustLine().accountID];
-        thisUserLines.emplace_back(make_shared<TrustFrame>(cur));
-    });
-    return retLines;
+    auto st = std::make_shared<soci::statement>(sess);
+    st->alloc();
+    st->prepare(query);
+    StatementContext prep(st);
+    loadLines(prep, trustProcessor);
+}
+
+void
+TrustFrame::loadAllLines(
+    soci::session& sess, std::function<void(LedgerEntry const&)> trustProcessor)
+{
+    auto st = std::make_shared<soci::statement>(sess);
+    st->alloc();
+    st->prepare(trustLineColumnSelector);
+    StatementContext prep(st);
+    loadLines(prep, trustProcessor);
 }
 
 void
@@ -65,9 +65,8 @@ class TrustFrame : public EntryFrame
     static void storeDelete(LedgerDelta& delta, Database& db,
                             LedgerKey const& key);
     static bool exists(Database& db, LedgerKey const& key);
-    static uint64_t countObjects(soci::session& sess);
-    static uint64_t countObjects(soci::session& sess,
-                                 LedgerRange const& ledgers);
+    static uint64_t countObjects(Database& db);
+    static uint64_t countObjects(Database& db, LedgerRange const& ledgers);
     static void deleteTrustLinesModifiedOnOrAfterLedger(Database& db,
                                                         uint32_t oldestLedger);
 
@@ -85,9 +84,18 @@ class TrustFrame : public EntryFrame
                           std::vector<TrustFrame::pointer>& retLines,
                           Database& db);
 
-    // loads ALL trust lines from the database (very slow!)
-    static std::unordered_map<AccountID, std::vector<TrustFrame::pointer>>
-    loadAllLines(Database& db);
+    // Loads the trust lines of all the accounts of @p accountIDs with a single
+    // query on @p sess, which may be a session of the connection pool. Does
+    // not use the entry cache.
+    static void
+    loadLines(soci::session& sess, std::vector<AccountID> const& accountIDs,
+              std::function<void(LedgerEntry const&)> trustProcessor);
+
+    // Loads all the trust lines of the trustlines table, in no particular
+    // order, on @p sess, which may be a session of the connection pool.
+    static void
+    loadAllLines(soci::session& sess,
+                 std::function<void(LedgerEntry const&)> trustProcessor);
 
     int64_t getBalance() const;
     bool addBalance(int64_t delta);
@@ -36,6 +36,25 @@ validateNetworkPassphrase(Application::pointer app)
     }
 }
 
+void
+validateLedgerStateStore(Application::pointer app)
+{
+    // databases created before LEDGER_STATE_STORE existed use SQL tables
+    std::string prevLedgerStateStore =
+        app->getPersistentState().getState(PersistentState::kLedgerStateStore);
+    if (prevLedgerStateStore.empty())
+    {
+        prevLedgerStateStore = "sql";
+    }
+    if (app->getConfig().LEDGER_STATE_STORE != prevLedgerStateStore)
+    {
+        throw std::invalid_argument(fmt::format(
+            "LEDGER_STATE_STORE \"{}\" does not match the store of the"
+            " database \"{}\", try --newdb",
+            app->getConfig().LEDGER_STATE_STORE, prevLedgerStateStore));
+    }
+}
+
 Application::pointer
 Application::create(VirtualClock& clock, Config const& cfg, bool newDB)
 {
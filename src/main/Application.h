@@ -44,6 +44,7 @@ class StatusManager;
 
 class Application;
 void validateNetworkPassphrase(std::shared_ptr<Application> app);
+void validateLedgerStateStore(std::shared_ptr<Application> app);
 
 /*
  * State of a single instance of the stellar-core application.
@@ -274,6 +275,7 @@ class Application
         if (newDB || cfg.DATABASE.value == "sqlite3://:memory:")
             ret->newDB();
         validateNetworkPassphrase(ret);
+        validateLedgerStateStore(ret);
 
         return ret;
     }
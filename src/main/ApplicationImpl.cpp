@@ -258,10 +258,15 @@ ApplicationImpl::getJsonInfo()
         info["quorum"] = q["slots"];
     }
 
-    Json::Value invariantFailures = getInvariantManager().getInformation();
-    if (!invariantFailures.empty())
+    Json::Value invariants = getInvariantManager().getInformation();
+    if (!invariants["failures"].empty())
     {
-        info["invariant_failures"] = invariantFailures;
+        info["invariant_failures"] = invariants["failures"];
+    }
+    invariants.removeMember("failures");
+    if (!invariants.empty())
+    {
+        info["invariants"] = invariants;
     }
 
     return root;
@@ -725,6 +730,10 @@ ApplicationImpl::enableInvariantsFromConfig()
     {
         mInvariantManager->enableInvariant(name);
     }
+    for (auto const& sampling : mConfig.INVARIANT_SAMPLING)
+    {
+        mInvariantManager->setSamplingPercent(sampling.first, sampling.second);
+    }
 }
 
 std::unique_ptr<Herder>
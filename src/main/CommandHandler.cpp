@@ -78,6 +78,7 @@ CommandHandler::CommandHandler(Application& app) : mApp(app)
     addRoute("generateload", &CommandHandler::generateLoad);
     addRoute("getcursor", &CommandHandler::getcursor);
     addRoute("info", &CommandHandler::info);
+    addRoute("ledgertrace", &CommandHandler::ledgerTrace);
     addRoute("ll", &CommandHandler::ll);
     addRoute("logrotate", &CommandHandler::logRotate);
     addRoute("maintenance", &CommandHandler::maintenance);
@@ -266,6 +267,10 @@ CommandHandler::fileNotFound(std::string const& params, std::string& retStr)
         "</p><p><h1> /info</h1>"
         "returns information about the server in JSON format (sync state, "
         "connected peers, etc)"
+        "</p><p><h1> /ledgertrace</h1>"
+        "returns the time spent in each phase of the last ledger closes in "
+        "the Chrome trace event format; must be used with "
+        "LEDGER_CLOSE_TRACE_SIZE set to a non-zero value"
         "</p><p><h1> /ll?level=L[&partition=P]</h1>"
         "adjust the log level for partition P (or all if no partition is "
         "specified).<br>"
@@ -329,9 +334,9 @@ CommandHandler::fileNotFound(std::string const& params, std::string& retStr)
         "'ID'.  If ID is not defined then all cursors will be returned."
         "</p><p><h1> /maintenance[?queue=true[&count=N]]</h1> Performs "
         "maintenance tasks on the instance."
-        "<ul><li><i>queue</i> performs deletion of queue data. Deletes at most "
-        "count entries from each table (defaults to 50000). See setcursor for "
-        "more information</li></ul>"
+        "<ul><li><i>queue</i> performs deletion of queue data. Deletes the "
+        "data of at most count ledgers from each table (defaults to 50000). "
+        "See setcursor for more information</li></ul>"
         "</p><p><h1> "
         "/unban?node=NODE_ID</h1>"
         "remove ban for PEER_ID"
@@ -490,6 +495,14 @@ CommandHandler::metrics(std::string const& params, std::string& retStr)
     retStr = jr.Report();
 }
 
+void
+CommandHandler::ledgerTrace(std::string const& params, std::string& retStr)
+{
+    Json::Value root;
+    mApp.getLedgerManager().dumpCloseTrace(root);
+    retStr = root.toStyledString();
+}
+
 void
 CommandHandler::logRotate(std::string const& params, std::string& retStr)
 {
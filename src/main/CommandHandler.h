@@ -43,6 +43,7 @@ class CommandHandler
     void dropPeer(std::string const& params, std::string& retStr);
     void generateLoad(std::string const& params, std::string& retStr);
     void info(std::string const& params, std::string& retStr);
+    void ledgerTrace(std::string const& params, std::string& retStr);
     void ll(std::string const& params, std::string& retStr);
     void logRotate(std::string const& params, std::string& retStr);
     void maintenance(std::string const& params, std::string& retStr);
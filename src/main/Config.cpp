@@ -14,6 +14,7 @@
 #include "util/Logging.h"
 #include "util/types.h"
 
+#include <algorithm>
 #include <functional>
 #include <lib/util/format.h>
 #include <sstream>
@@ -42,8 +43,11 @@ Config::Config() : NODE_SEED(SecretKey::random())
     MANUAL_CLOSE = false;
     CATCHUP_COMPLETE = false;
     CATCHUP_RECENT = 0;
+    MERGED_BUCKET_APPLY = false;
     AUTOMATIC_MAINTENANCE_PERIOD = std::chrono::seconds{3600};
     AUTOMATIC_MAINTENANCE_COUNT = 50000;
+    AUTOMATIC_MAINTENANCE_CHUNK_TIME = std::chrono::milliseconds{0};
+    LEDGER_CLOSE_TRACE_SIZE = 0;
     ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING = false;
     ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = false;
     ARTIFICIALLY_SET_CLOSE_TIME_FOR_TESTING = 0;
@@ -55,6 +59,7 @@ Config::Config() : NODE_SEED(SecretKey::random())
 
     LOG_FILE_PATH = "stellar-core.%datetime{%Y.%M.%d-%H:%m:%s}.log";
     BUCKET_DIR_PATH = "buckets";
+    BUCKET_BLOCK_COMPRESSION = false;
 
     TESTING_UPGRADE_DESIRED_FEE = LedgerManager::GENESIS_LEDGER_BASE_FEE;
     TESTING_UPGRADE_RESERVE = LedgerManager::GENESIS_LEDGER_BASE_RESERVE;
@@ -75,7 +80,16 @@ Config::Config() : NODE_SEED(SecretKey::random())
     MINIMUM_IDLE_PERCENT = 0;
 
     MAX_CONCURRENT_SUBPROCESSES = 16;
+    HISTORY_MAX_CONCURRENT_TRANSFERS = 16;
+    WORK_MAX_CONCURRENT_CPU_JOBS = 0;
+    WORK_MAX_CONCURRENT_IO_JOBS = 4;
     NODE_IS_VALIDATOR = false;
+    BACKGROUND_SCP_SIGNATURE_VERIFICATION = false;
+    PREFETCH_LEDGER_ENTRIES = false;
+    STREAM_HISTORY_CHECKPOINTS = false;
+    STORE_HISTORY_IN_DATABASE = true;
+    LEDGER_STATE_STORE = "sql";
+    DEFER_INVARIANT_CHECKS = false;
 
     DATABASE = SecretValue{"sqlite3://:memory:"};
     NTP_SERVER = "pool.ntp.org";
@@ -293,6 +307,10 @@ Config::load(std::string const& filename)
             {
                 CATCHUP_RECENT = readInt<uint32_t>(item, 0, UINT32_MAX - 1);
             }
+            else if (item.first == "MERGED_BUCKET_APPLY")
+            {
+                MERGED_BUCKET_APPLY = readBool(item);
+            }
             else if (item.first == "ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING")
             {
                 ARTIFICIALLY_GENERATE_LOAD_FOR_TESTING = readBool(item);
@@ -319,6 +337,15 @@ Config::load(std::string const& filename)
             {
                 AUTOMATIC_MAINTENANCE_COUNT = readInt<uint32_t>(item);
             }
+            else if (item.first == "AUTOMATIC_MAINTENANCE_CHUNK_TIME")
+            {
+                AUTOMATIC_MAINTENANCE_CHUNK_TIME =
+                    std::chrono::milliseconds{readInt<uint32_t>(item)};
+            }
+            else if (item.first == "LEDGER_CLOSE_TRACE_SIZE")
+            {
+                LEDGER_CLOSE_TRACE_SIZE = readInt<uint32_t>(item);
+            }
             else if (item.first == "MANUAL_CLOSE")
             {
                 MANUAL_CLOSE = readBool(item);
@@ -337,6 +364,10 @@ Config::load(std::string const& filename)
             {
                 BUCKET_DIR_PATH = readString(item);
             }
+            else if (item.first == "BUCKET_BLOCK_COMPRESSION")
+            {
+                BUCKET_BLOCK_COMPRESSION = readBool(item);
+            }
             else if (item.first == "NODE_NAMES")
             {
                 auto names = readStringArray(item);
@@ -355,6 +386,31 @@ Config::load(std::string const& filename)
             {
                 NODE_IS_VALIDATOR = readBool(item);
             }
+            else if (item.first == "BACKGROUND_SCP_SIGNATURE_VERIFICATION")
+            {
+                BACKGROUND_SCP_SIGNATURE_VERIFICATION = readBool(item);
+            }
+            else if (item.first == "PREFETCH_LEDGER_ENTRIES")
+            {
+                PREFETCH_LEDGER_ENTRIES = readBool(item);
+            }
+            else if (item.first == "STREAM_HISTORY_CHECKPOINTS")
+            {
+                STREAM_HISTORY_CHECKPOINTS = readBool(item);
+            }
+            else if (item.first == "STORE_HISTORY_IN_DATABASE")
+            {
+                STORE_HISTORY_IN_DATABASE = readBool(item);
+            }
+            else if (item.first == "LEDGER_STATE_STORE")
+            {
+                LEDGER_STATE_STORE = readString(item);
+                if (LEDGER_STATE_STORE != "sql" && LEDGER_STATE_STORE != "kv")
+                {
+                    throw std::invalid_argument(
+                        "LEDGER_STATE_STORE must be \"sql\" or \"kv\"");
+                }
+            }
             else if (item.first == "TARGET_PEER_CONNECTIONS")
             {
                 TARGET_PEER_CONNECTIONS = readInt<unsigned short>(item, 1);
@@ -411,6 +467,18 @@ Config::load(std::string const& filename)
                 MAX_CONCURRENT_SUBPROCESSES =
                     static_cast<size_t>(readInt<int>(item, 1));
             }
+            else if (item.first == "HISTORY_MAX_CONCURRENT_TRANSFERS")
+            {
+                HISTORY_MAX_CONCURRENT_TRANSFERS = readInt<uint32_t>(item, 1);
+            }
+            else if (item.first == "WORK_MAX_CONCURRENT_CPU_JOBS")
+            {
+                WORK_MAX_CONCURRENT_CPU_JOBS = readInt<uint32_t>(item, 0);
+            }
+            else if (item.first == "WORK_MAX_CONCURRENT_IO_JOBS")
+            {
+                WORK_MAX_CONCURRENT_IO_JOBS = readInt<uint32_t>(item, 1);
+            }
             else if (item.first == "MINIMUM_IDLE_PERCENT")
             {
                 MINIMUM_IDLE_PERCENT = readInt<uint32_t>(item, 0, 100);
@@ -430,6 +498,7 @@ Config::load(std::string const& filename)
                                 "malformed HISTORY config block");
                         }
                         std::string get, put, mkdir;
+                        uint32_t maxConcurrency = 0;
                         for (auto const& c : *tab)
                         {
                             if (c.first == "get")
@@ -444,6 +513,10 @@ Config::load(std::string const& filename)
                             {
                                 mkdir = c.second->as<std::string>()->value();
                             }
+                            else if (c.first == "max_concurrency")
+                            {
+                                maxConcurrency = readInt<uint32_t>(c, 1);
+                            }
                             else
                             {
                                 std::string err(
@@ -455,8 +528,8 @@ Config::load(std::string const& filename)
                             }
                         }
                         HISTORY[archive.first] =
-                            std::make_shared<HistoryArchive>(archive.first, get,
-                                                             put, mkdir);
+                            std::make_shared<HistoryArchive>(
+                                archive.first, get, put, mkdir, maxConcurrency);
                     }
                 }
                 else
@@ -480,6 +553,23 @@ Config::load(std::string const& filename)
             {
                 INVARIANT_CHECKS = readStringArray(item);
             }
+            else if (item.first == "INVARIANT_SAMPLING")
+            {
+                auto sampling = item.second->as_group();
+                if (!sampling)
+                {
+                    throw std::invalid_argument(
+                        "malformed INVARIANT_SAMPLING config block");
+                }
+                for (auto const& s : *sampling)
+                {
+                    INVARIANT_SAMPLING[s.first] = readInt<uint32_t>(s, 0, 100);
+                }
+            }
+            else if (item.first == "DEFER_INVARIANT_CHECKS")
+            {
+                DEFER_INVARIANT_CHECKS = readBool(item);
+            }
             else
             {
                 std::string err("Unknown configuration entry: '");
@@ -527,6 +617,31 @@ Config::load(std::string const& filename)
             static_cast<unsigned short>(MAX_ADDITIONAL_PEER_CONNECTIONS +
                                         TARGET_PEER_CONNECTIONS));
 
+        if (!STORE_HISTORY_IN_DATABASE && !STREAM_HISTORY_CHECKPOINTS)
+        {
+            throw std::invalid_argument("STORE_HISTORY_IN_DATABASE can only be "
+                                        "disabled with "
+                                        "STREAM_HISTORY_CHECKPOINTS");
+        }
+
+        if (LEDGER_STATE_STORE == "kv" &&
+            DATABASE.value.find("sqlite3:") == std::string::npos)
+        {
+            throw std::invalid_argument(
+                "LEDGER_STATE_STORE=\"kv\" requires a SQLite DATABASE");
+        }
+
+        for (auto const& s : INVARIANT_SAMPLING)
+        {
+            if (std::find(INVARIANT_CHECKS.begin(), INVARIANT_CHECKS.end(),
+                          s.first) == INVARIANT_CHECKS.end())
+            {
+                throw std::invalid_argument(fmt::format(
+                    "INVARIANT_SAMPLING of {} requires it in INVARIANT_CHECKS",
+                    s.first));
+            }
+        }
+
         validateConfig();
     }
     catch (cpptoml::toml_parse_exception& ex)
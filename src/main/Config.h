@@ -78,13 +78,27 @@ class Config : public std::enable_shared_from_this<Config>
     // If you want, say, a week of history, set this to 120000.
     uint32_t CATCHUP_RECENT;
 
+    // When applying buckets during catchup, merge all of them into a single
+    // bucket first (on a worker thread) so that each ledger entry is written
+    // to the database once, instead of once per bucket holding it.
+    bool MERGED_BUCKET_APPLY;
+
     // Interval between automatic maintenance executions
     std::chrono::seconds AUTOMATIC_MAINTENANCE_PERIOD;
 
-    // Number of unneeded rows in each table that will be removed during one
-    // maintenance run
+    // Number of unneeded ledgers in each table that will be removed during
+    // one maintenance run
     uint32_t AUTOMATIC_MAINTENANCE_COUNT;
 
+    // Time each chunk of an automatic maintenance run should take; when 0,
+    // chunks are of a fixed number of ledgers (see Maintainer)
+    std::chrono::milliseconds AUTOMATIC_MAINTENANCE_CHUNK_TIME;
+
+    // Number of recent ledger closes whose per-phase timings are kept in
+    // memory for the `ledgertrace` command (0 disables the trace buffer, the
+    // per-phase timers are always updated)
+    uint32_t LEDGER_CLOSE_TRACE_SIZE;
+
     // A config parameter that enables synthetic load generation on demand,
     // using the `generateload` runtime command (see CommandHandler.cpp). This
     // option only exists for stress-testing and should not be enabled in
@@ -139,6 +153,10 @@ class Config : public std::enable_shared_from_this<Config>
     std::string VERSION_STR;
     std::string LOG_FILE_PATH;
     std::string BUCKET_DIR_PATH;
+    // Write new bucket files in blocks of compressed entries (see
+    // BucketBlockFile.h). Bucket hashes and the files published to history
+    // archives are unchanged.
+    bool BUCKET_BLOCK_COMPRESSION;
     uint32_t TESTING_UPGRADE_DESIRED_FEE; // in stroops
     uint32_t TESTING_UPGRADE_RESERVE;     // in stroops
     uint32_t TESTING_UPGRADE_MAX_TX_PER_LEDGER;
@@ -177,13 +195,57 @@ class Config : public std::enable_shared_from_this<Config>
     // process-management config
     size_t MAX_CONCURRENT_SUBPROCESSES;
 
+    // Default upper bound on the number of concurrent transfers to a single
+    // history archive (see HistoryTransferScheduler); the actual limit adapts
+    // to the throughput observed below this bound.
+    uint32_t HISTORY_MAX_CONCURRENT_TRANSFERS;
+
+    // Number of CPU-bound (e.g. hashing, compression) and I/O-bound jobs of
+    // Work that can run on worker threads at the same time (see
+    // WorkManager). 0 for CPU-bound jobs means one less than the number of
+    // worker threads.
+    uint32_t WORK_MAX_CONCURRENT_CPU_JOBS;
+    uint32_t WORK_MAX_CONCURRENT_IO_JOBS;
+
     // SCP config
     SecretKey NODE_SEED;
     bool NODE_IS_VALIDATOR;
     stellar::SCPQuorumSet QUORUM_SET;
 
+    // Verify signatures of SCP envelopes received from peers in batches on
+    // the worker threads, instead of on the main thread from within SCP.
+    bool BACKGROUND_SCP_SIGNATURE_VERIFICATION;
+
+    // Before applying a transaction set, load the accounts and trust lines
+    // its transactions are likely to touch into the entry cache, in batches
+    // read in parallel over the connection pool when there is one.
+    bool PREFETCH_LEDGER_ENTRIES;
+
+    // Write the history files of the current checkpoint as ledgers close
+    // (see CheckpointWriter), instead of reading them back from the database
+    // when publishing.
+    bool STREAM_HISTORY_CHECKPOINTS;
+
+    // Keep transaction and SCP history in the database (txhistory,
+    // txfeehistory, scphistory and scpquorums tables). Can only be turned off
+    // together with STREAM_HISTORY_CHECKPOINTS, in which case checkpoints
+    // whose files could not be written in full (e.g. when streaming was
+    // turned on in the middle of a checkpoint) are not published.
+    bool STORE_HISTORY_IN_DATABASE;
+
+    // Where ledger entries are stored: "sql" for the accounts, trustlines,
+    // offers and accountdata tables, "kv" for KeyValueLedgerStore (SQLite
+    // only). Changing it requires a new database.
+    std::string LEDGER_STATE_STORE;
+
     // Invariants
     std::vector<std::string> INVARIANT_CHECKS;
+    // Percentage of the checks of an invariant that are run, by name, 100 for
+    // the invariants not listed.
+    std::map<std::string, uint32_t> INVARIANT_SAMPLING;
+    // Operation checks of the invariants that only read the ledger delta are
+    // run at the end of the ledger close, on a worker thread.
+    bool DEFER_INVARIANT_CHECKS;
 
     std::map<std::string, std::string> VALIDATOR_NAMES;
 
@@ -151,8 +151,8 @@ ExternalQueue::deleteCursor(std::string const& resid)
     st.execute(true);
 }
 
-void
-ExternalQueue::deleteOldEntries(uint32 count)
+uint32_t
+ExternalQueue::getMaxLedgerToDelete()
 {
     auto& db = mApp.getDatabase();
     int m;
@@ -194,8 +194,15 @@ ExternalQueue::deleteOldEntries(uint32 count)
     CLOG(INFO, "History") << "Trimming history <= ledger " << cmin
                           << " (rmin=" << rmin << ", qmin=" << qmin
                           << ", lmin=" << lmin << ")";
+    return cmin;
+}
 
-    mApp.getLedgerManager().deleteOldEntries(mApp.getDatabase(), cmin, count);
+void
+ExternalQueue::deleteOldEntries(uint32 count)
+{
+    auto cmin = getMaxLedgerToDelete();
+    mApp.getLedgerManager().deleteOldEntries(mApp.getDatabase().getSession(),
+                                             cmin, count);
 }
 
 void
@@ -33,7 +33,11 @@ class ExternalQueue
     // deletes the subscription for the resource
     void deleteCursor(std::string const& resid);
 
-    // safely delete data, maximum count entries from each table
+    // last ledger whose history is neither needed to publish a checkpoint
+    // nor unread by a subscriber, and can be deleted
+    uint32_t getMaxLedgerToDelete();
+
+    // safely delete data, maximum count ledgers from each table
     void deleteOldEntries(uint32 count);
 
   private:
@@ -2,12 +2,17 @@
 // under the Apache License, Version 2.0. See the COPYING file at the root
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
+#include "ledger/LedgerHeaderFrame.h"
 #include "main/Application.h"
 #include "main/CommandHandler.h"
 #include "main/Config.h"
 #include "main/ExternalQueue.h"
+#include "main/Maintainer.h"
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
 #include "simulation/Simulation.h"
 #include "test/TestUtils.h"
+#include "test/TxTests.h"
 #include "test/test.h"
 
 using namespace stellar;
@@ -43,3 +48,42 @@ TEST_CASE("cursors", "[externalqueue]")
         REQUIRE(curMap.size() == 2);
     }
 }
+
+TEST_CASE("incremental maintenance", "[externalqueue]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    cfg.ARTIFICIALLY_ACCELERATE_TIME_FOR_TESTING = true;
+    cfg.AUTOMATIC_MAINTENANCE_CHUNK_TIME = std::chrono::milliseconds{1};
+    Application::pointer app = createTestApplication(clock, cfg);
+
+    app->start();
+
+    for (uint32_t seq = 2; seq <= 30; seq++)
+    {
+        txtest::closeLedgerOn(*app, seq, seq, 1, 2018);
+    }
+
+    auto& db = app->getDatabase();
+    ExternalQueue ps(*app);
+    auto maxLedger = ps.getMaxLedgerToDelete();
+    REQUIRE(maxLedger > 1);
+
+    auto& rowsDeleted = app->getMetrics().NewMeter(
+        {"history", "maintenance", "rows-deleted"}, "row");
+    auto& maintainer = app->getMaintainer();
+    maintainer.performIncrementalMaintenance(50000);
+    REQUIRE(maintainer.isRunning());
+    while (maintainer.isRunning())
+    {
+        clock.crank(false);
+    }
+
+    REQUIRE(rowsDeleted.count() >= maxLedger);
+    for (uint32_t seq = 1; seq <= maxLedger; seq++)
+    {
+        REQUIRE(!LedgerHeaderFrame::loadBySequence(seq, db, db.getSession()));
+    }
+    REQUIRE(!!LedgerHeaderFrame::loadBySequence(maxLedger + 1, db,
+                                                db.getSession()));
+}
@@ -3,14 +3,38 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "main/Maintainer.h"
+#include "database/Database.h"
+#include "ledger/LedgerManager.h"
+#include "main/Application.h"
 #include "main/Config.h"
 #include "main/ExternalQueue.h"
 #include "util/Logging.h"
+#include "work/WorkManager.h"
+
+#include "medida/meter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <algorithm>
+#include <memory>
 
 namespace stellar
 {
 
-Maintainer::Maintainer(Application& app) : mApp{app}, mTimer{mApp}
+// ledgers per chunk of the first incremental run
+static uint32_t const INITIAL_CHUNK_SIZE = 16;
+
+Maintainer::Maintainer(Application& app)
+    : mApp{app}
+    , mTimer{mApp}
+    , mRowsDeleted{app.getMetrics().NewMeter(
+          {"history", "maintenance", "rows-deleted"}, "row")}
+    , mChunkTime{app.getMetrics().NewTimer({"history", "maintenance", "chunk"})}
+    , mRunning{false}
+    , mMaxLedger{0}
+    , mRemaining{0}
+    , mChunkSize{INITIAL_CHUNK_SIZE}
+    , mSelf{std::make_shared<Maintainer*>(this)}
 {
 }
 
@@ -32,7 +56,7 @@ Maintainer::scheduleMaintenance()
 void
 Maintainer::tick()
 {
-    performMaintenance(mApp.getConfig().AUTOMATIC_MAINTENANCE_COUNT);
+    performIncrementalMaintenance(mApp.getConfig().AUTOMATIC_MAINTENANCE_COUNT);
     scheduleMaintenance();
 }
 
@@ -41,6 +65,144 @@ Maintainer::performMaintenance(uint32_t count)
 {
     LOG(INFO) << "Performing maintenance";
     ExternalQueue ps{mApp};
-    ps.deleteOldEntries(count);
+    auto maxLedger = ps.getMaxLedgerToDelete();
+    auto& sess = mApp.getDatabase().getSession();
+    // same chunks as incremental runs, so that no single statement deletes
+    // more than a chunk worth of ledgers
+    while (count > 0)
+    {
+        auto chunk = std::min(mChunkSize, count);
+        auto start = std::chrono::steady_clock::now();
+        auto deleted =
+            mApp.getLedgerManager().deleteOldEntries(sess, maxLedger, chunk);
+        auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start);
+        mChunkTime.Update(elapsed);
+        mRowsDeleted.Mark(deleted);
+        adaptChunkSize(elapsed);
+        count -= chunk;
+        if (deleted == 0)
+        {
+            break;
+        }
+    }
+}
+
+void
+Maintainer::performIncrementalMaintenance(uint32_t count)
+{
+    if (mRunning)
+    {
+        LOG(INFO) << "Previous maintenance still running, skipping";
+        return;
+    }
+
+    LOG(INFO) << "Performing incremental maintenance";
+    ExternalQueue ps{mApp};
+    mMaxLedger = ps.getMaxLedgerToDelete();
+    mRemaining = count;
+    mRunning = true;
+    deleteNextChunk();
+}
+
+bool
+Maintainer::isRunning() const
+{
+    return mRunning;
+}
+
+void
+Maintainer::deleteNextChunk()
+{
+    auto& db = mApp.getDatabase();
+    auto& lm = mApp.getLedgerManager();
+    auto chunk = std::min(mChunkSize, mRemaining);
+    auto maxLedger = mMaxLedger;
+
+    // SQLite only has one writer: deleting from another connection would
+    // just wait for (or fail on) the lock held by the main one
+    bool background = db.canUsePool() && !db.isSqlite();
+    auto pool = background ? &db.getPool() : nullptr;
+
+    auto deleted = std::make_shared<size_t>(0);
+    auto elapsed = std::make_shared<std::chrono::nanoseconds>(0);
+    auto job = [&db, &lm, pool, maxLedger, chunk, deleted, elapsed]() {
+        auto start = std::chrono::steady_clock::now();
+        if (pool)
+        {
+            soci::session sess(*pool);
+            *deleted = lm.deleteOldEntries(sess, maxLedger, chunk);
+        }
+        else
+        {
+            *deleted = lm.deleteOldEntries(db.getSession(), maxLedger, chunk);
+        }
+        *elapsed = std::chrono::steady_clock::now() - start;
+        return asio::error_code();
+    };
+
+    std::weak_ptr<Maintainer*> weak(mSelf);
+    mApp.getWorkManager().runInBackground(
+        background ? Work::WORK_EXECUTION_IO_BOUND
+                   : Work::WORK_EXECUTION_MAIN_THREAD,
+        WORK_PRIORITY_LOW, job,
+        [weak, chunk, deleted, elapsed](asio::error_code const& ec) {
+            // the work manager still runs handlers after we are gone
+            auto self = weak.lock();
+            if (!self)
+            {
+                return;
+            }
+            (*self)->chunkDone(ec, chunk, *deleted, *elapsed);
+        });
+}
+
+void
+Maintainer::chunkDone(asio::error_code const& ec, uint32_t chunk,
+                      size_t deleted, std::chrono::nanoseconds elapsed)
+{
+    if (ec)
+    {
+        CLOG(WARNING, "History") << "Maintenance failed: " << ec.message();
+        mRunning = false;
+        return;
+    }
+
+    mChunkTime.Update(elapsed);
+    mRowsDeleted.Mark(deleted);
+    adaptChunkSize(elapsed);
+    mRemaining -= chunk;
+    // a chunk always deletes the oldest ledger of a table that has some to
+    // delete
+    if (deleted == 0 || mRemaining == 0)
+    {
+        CLOG(DEBUG, "History") << "Maintenance done";
+        mRunning = false;
+        return;
+    }
+    deleteNextChunk();
+}
+
+void
+Maintainer::adaptChunkSize(std::chrono::nanoseconds elapsed)
+{
+    auto const& cfg = mApp.getConfig();
+    std::chrono::nanoseconds budget = cfg.AUTOMATIC_MAINTENANCE_CHUNK_TIME;
+    if (budget.count() == 0)
+    {
+        // fixed chunks
+        return;
+    }
+    uint64_t size = mChunkSize;
+    if (elapsed > budget)
+    {
+        size = size * budget.count() / elapsed.count();
+    }
+    else if (elapsed < budget / 2)
+    {
+        size *= 2;
+    }
+    size = std::min<uint64_t>(size, cfg.AUTOMATIC_MAINTENANCE_COUNT);
+    mChunkSize = static_cast<uint32_t>(std::max<uint64_t>(size, 1));
 }
 }
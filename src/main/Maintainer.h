@@ -6,13 +6,36 @@
 
 #include "util/Timer.h"
 
+#include <chrono>
 #include <cstdint>
+#include <memory>
+
+namespace medida
+{
+class Meter;
+class Timer;
+}
 
 namespace stellar
 {
 
 class Application;
 
+/**
+ * Deletes the history that is no longer needed (see ExternalQueue) from the
+ * database, every AUTOMATIC_MAINTENANCE_PERIOD.
+ *
+ * Automatic maintenance runs incrementally: each chunk deletes the oldest
+ * ledgers of each table, as a low priority job. When
+ * AUTOMATIC_MAINTENANCE_CHUNK_TIME is set, the number of ledgers per chunk is
+ * adapted so that a chunk takes about that long; otherwise chunks are of a
+ * fixed number of ledgers. On PostgreSQL the
+ * chunks run on a worker thread with a session of their own, so that the
+ * deletes do not stall the main thread; on SQLite, which has a single writer,
+ * they run on the main thread between other work.
+ *
+ * Rows deleted and time spent are recorded in "history.maintenance.*".
+ */
 class Maintainer
 {
   public:
@@ -21,14 +44,39 @@ class Maintainer
     // start automatic mainanining according to app.getConfig()
     void start();
 
-    // removes maximum count entries from tables like txhistory or scphistory
+    // removes maximum count ledgers from tables like txhistory or scphistory,
+    // right away, a chunk at a time
     void performMaintenance(uint32_t count);
 
+    // removes maximum count ledgers from each table, in chunks; does
+    // nothing if a previous run is still in progress
+    void performIncrementalMaintenance(uint32_t count);
+
+    // whether an incremental maintenance run is in progress
+    bool isRunning() const;
+
   private:
     Application& mApp;
     VirtualTimer mTimer;
+    medida::Meter& mRowsDeleted;
+    medida::Timer& mChunkTime;
+
+    bool mRunning;
+    // last ledger to delete and number of ledgers left to delete from each
+    // table in the current run
+    uint32_t mMaxLedger;
+    uint32_t mRemaining;
+    // ledgers deleted from each table by the next chunk
+    uint32_t mChunkSize;
+    // handed as a weak pointer to background jobs, which must not call us
+    // back once we are destroyed
+    std::shared_ptr<Maintainer*> mSelf;
 
     void scheduleMaintenance();
     void tick();
+    void deleteNextChunk();
+    void chunkDone(asio::error_code const& ec, uint32_t chunk, size_t deleted,
+                   std::chrono::nanoseconds elapsed);
+    void adaptChunkSize(std::chrono::nanoseconds elapsed);
 };
 }
@@ -24,6 +24,7 @@ class PersistentState
         kDatabaseSchema,
         kNetworkPassphrase,
         kLedgerUpgrades,
+        kLedgerStateStore,
         kLastEntry,
     };
 
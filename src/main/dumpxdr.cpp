@@ -1,4 +1,5 @@
 #include "main/dumpxdr.h"
+#include "bucket/BucketBlockFile.h"
 #include "crypto/SecretKey.h"
 #include "transactions/SignatureUtils.h"
 #include "util/Fs.h"
@@ -48,6 +49,19 @@ dumpstream(XDRInputFileStream& in)
     }
 }
 
+void
+dumpBucketBlocks(std::string const& filename)
+{
+    BucketBlockReader in;
+    in.open(filename);
+    BucketEntry tmp;
+    while (in.readOne(tmp))
+    {
+        std::cout << xdr::xdr_to_string(tmp) << std::endl;
+    }
+    in.close();
+}
+
 void
 dumpxdr(std::string const& filename)
 {
@@ -56,6 +70,12 @@ dumpxdr(std::string const& filename)
     std::smatch sm;
     if (std::regex_match(filename, sm, rx))
     {
+        if (sm[1] == "bucket" && isBucketBlockFile(filename))
+        {
+            dumpBucketBlocks(filename);
+            return;
+        }
+
         XDRInputFileStream in;
         in.open(filename);
 
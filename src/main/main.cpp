@@ -49,6 +49,7 @@ enum opttag
     OPT_CATCHUP_COMPLETE,
     OPT_CATCHUP_RECENT,
     OPT_CATCHUP_TO,
+    OPT_CHECKDB,
     OPT_CMD,
     OPT_CONF,
     OPT_CONVERTID,
@@ -83,6 +84,7 @@ static const struct option stellar_core_options[] = {
     {"catchup-complete", no_argument, nullptr, OPT_CATCHUP_COMPLETE},
     {"catchup-recent", required_argument, nullptr, OPT_CATCHUP_RECENT},
     {"catchup-to", required_argument, nullptr, OPT_CATCHUP_TO},
+    {"checkdb", no_argument, nullptr, OPT_CHECKDB},
     {"c", required_argument, nullptr, OPT_CMD},
     {"conf", required_argument, nullptr, OPT_CONF},
     {"convertid", required_argument, nullptr, OPT_CONVERTID},
@@ -131,6 +133,8 @@ usage(int err = 1)
           "                           Use current as SEQ to catchup to "
           "'current'"
           "history checkpoint\n"
+          "      --checkdb            Check the database against the "
+          "bucket list, then quit\n"
           "      --c                  Send a command to local stellar-core. "
           "try "
           "'--c help' for more information\n"
@@ -503,6 +507,45 @@ setForceSCPFlag(Config const& cfg, bool isOn)
     }
 }
 
+static int
+checkDB(Config const& cfg)
+{
+    VirtualClock clock(VirtualClock::REAL_TIME);
+    Application::pointer app = Application::create(clock, cfg, false);
+    if (!checkInitialized(app))
+    {
+        return 1;
+    }
+
+    auto done = false;
+    app->getLedgerManager().loadLastKnownLedger(
+        [&done](asio::error_code const& ec) {
+            if (ec)
+            {
+                throw std::runtime_error(
+                    "Unable to restore last-known ledger state");
+            }
+
+            done = true;
+        });
+    while (!done && app->getClock().crank(true))
+        ;
+
+    try
+    {
+        checkDBAgainstBuckets(app->getMetrics(), app->getBucketManager(),
+                              app->getDatabase(),
+                              app->getBucketManager().getBucketList());
+    }
+    catch (std::runtime_error const& e)
+    {
+        LOG(ERROR) << "CheckDB failed: " << e.what();
+        return 1;
+    }
+    LOG(INFO) << "CheckDB succeeded";
+    return 0;
+}
+
 static void
 showOfflineInfo(Config const& cfg)
 {
@@ -685,6 +728,7 @@ main(int argc, char* const* argv)
     uint32_t catchupRecentCount = 0;
     bool doCatchupTo = false;
     uint32_t catchupToTarget = 0;
+    bool doCheckDB = false;
     bool inferQuorum = false;
     bool checkQuorum = false;
     bool graphQuorum = false;
@@ -720,6 +764,9 @@ main(int argc, char* const* argv)
             doCatchupTo = true;
             catchupToTarget = parseLedger(optarg);
             break;
+        case OPT_CHECKDB:
+            doCheckDB = true;
+            break;
         case 'c':
         case OPT_CMD:
             command = optarg;
@@ -850,7 +897,7 @@ main(int argc, char* const* argv)
         if (forceSCP || newDB || getOfflineInfo || !loadXdrBucket.empty() ||
             inferQuorum || graphQuorum || checkQuorum || doCatchupAt ||
             doCatchupComplete || doCatchupRecent || doCatchupTo ||
-            doReportLastHistoryCheckpoint)
+            doCheckDB || doReportLastHistoryCheckpoint)
         {
             auto result = 0;
             setNoListen(cfg);
@@ -881,6 +928,8 @@ main(int argc, char* const* argv)
                 if (!catchupInfo.isNull())
                     writeCatchupInfo(catchupInfo, outputFile);
             }
+            if ((result == 0) && doCheckDB)
+                result = checkDB(cfg);
             if ((result == 0) && forceSCP)
                 setForceSCPFlag(cfg, *forceSCP);
             if ((result == 0) && getOfflineInfo)
@@ -824,7 +824,7 @@ Peer::recvSCPMessage(StellarMessage const& msg)
                                 ? mRecvSCPExternalizeTimer.TimeScope()
                                 : (mRecvSCPNominateTimer.TimeScope()))));
 
-    mApp.getHerder().recvSCPEnvelope(envelope);
+    mApp.getHerder().recvSCPEnvelopeFromPeer(envelope);
 }
 
 void
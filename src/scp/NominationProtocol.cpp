@@ -24,7 +24,11 @@ using xdr::operator<;
 using namespace std::placeholders;
 
 NominationProtocol::NominationProtocol(Slot& slot)
-    : mSlot(slot), mRoundNumber(0), mNominationStarted(false)
+    : mSlot(slot)
+    , mRoundNumber(0)
+    , mNominationStarted(false)
+    , mHashCacheHits(0)
+    , mHashCacheMisses(0)
 {
 }
 
@@ -236,20 +240,55 @@ NominationProtocol::updateRoundLeaders()
         }
 }
 
+void
+NominationProtocol::clearHashCache()
+{
+    mNodeHashCache.clear();
+    mValueHashCache.clear();
+}
+
 uint64
 NominationProtocol::hashNode(bool isPriority, NodeID const& nodeID)
 {
     dbgAssert(!mPreviousValue.empty());
-    return mSlot.getSCPDriver().computeHashNode(
-        mSlot.getSlotIndex(), mPreviousValue, isPriority, mRoundNumber, nodeID);
+    auto key = std::make_pair(isPriority, nodeID);
+    auto it = mNodeHashCache.find(key);
+    bool hit = it != mNodeHashCache.end();
+    if (hit)
+    {
+        mHashCacheHits++;
+    }
+    else
+    {
+        mHashCacheMisses++;
+        uint64 h = mSlot.getSCPDriver().computeHashNode(
+            mSlot.getSlotIndex(), mPreviousValue, isPriority, mRoundNumber,
+            nodeID);
+        it = mNodeHashCache.emplace(key, h).first;
+    }
+    mSlot.getSCPDriver().nominationHashLookup(mSlot.getSlotIndex(), hit);
+    return it->second;
 }
 
 uint64
 NominationProtocol::hashValue(Value const& value)
 {
     dbgAssert(!mPreviousValue.empty());
-    return mSlot.getSCPDriver().computeValueHash(
-        mSlot.getSlotIndex(), mPreviousValue, mRoundNumber, value);
+    auto it = mValueHashCache.find(value);
+    bool hit = it != mValueHashCache.end();
+    if (hit)
+    {
+        mHashCacheHits++;
+    }
+    else
+    {
+        mHashCacheMisses++;
+        uint64 h = mSlot.getSCPDriver().computeValueHash(
+            mSlot.getSlotIndex(), mPreviousValue, mRoundNumber, value);
+        it = mValueHashCache.emplace(value, h).first;
+    }
+    mSlot.getSCPDriver().nominationHashLookup(mSlot.getSlotIndex(), hit);
+    return it->second;
 }
 
 uint64
@@ -460,6 +499,8 @@ NominationProtocol::nominate(Value const& value, Value const& previousValue,
     mPreviousValue = previousValue;
 
     mRoundNumber++;
+    // hashes are a function of the round and previous value
+    clearHashCache();
     updateRoundLeaders();
 
     Value nominatingValue;
@@ -528,6 +569,9 @@ NominationProtocol::dumpInfo(Json::Value& ret)
     Json::Value& nomState = ret["nomination"];
     nomState["roundnumber"] = mRoundNumber;
     nomState["started"] = mNominationStarted;
+    nomState["hashcache"]["hits"] = static_cast<Json::UInt64>(mHashCacheHits);
+    nomState["hashcache"]["misses"] =
+        static_cast<Json::UInt64>(mHashCacheMisses);
 
     int counter = 0;
     for (auto const& v : mVotes)
@@ -39,6 +39,15 @@ class NominationProtocol
     // the value from the previous slot
     Value mPreviousValue;
 
+    // memoized results of hashNode and hashValue, only valid for the current
+    // (mRoundNumber, mPreviousValue): cleared when either changes
+    std::map<std::pair<bool, NodeID>, uint64> mNodeHashCache;
+    std::map<Value, uint64> mValueHashCache;
+    uint64 mHashCacheHits;
+    uint64 mHashCacheMisses;
+
+    void clearHashCache();
+
     bool isNewerStatement(NodeID const& nodeID, SCPNomination const& st);
     static bool isNewerStatement(SCPNomination const& oldst,
                                  SCPNomination const& st);
@@ -161,6 +161,15 @@ class SCPDriver
     {
     }
 
+    // `nominationHashLookup` is called every time the nomination protocol
+    // needs a node or value hash; `cached` is true when the hash was served
+    // from the slot's memo table instead of calling computeHashNode or
+    // computeValueHash
+    virtual void
+    nominationHashLookup(uint64 slotIndex, bool cached)
+    {
+    }
+
     // `ballotDidHearFromQuorum` is called when we received messages related to
     // the current `mBallot` from a set of node that is a transitive quorum for
     // the local node.
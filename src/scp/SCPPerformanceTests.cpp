@@ -0,0 +1,376 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "crypto/SHA.h"
+#include "crypto/SecretKey.h"
+#include "lib/catch.hpp"
+#include "lib/util/format.h"
+#include "medida/stats/snapshot.h"
+#include "medida/timer.h"
+#include "scp/SCP.h"
+#include "util/Logging.h"
+#include "util/types.h"
+#include "xdrpp/marshal.h"
+
+#include <chrono>
+
+// Benchmarks for the SCP library in isolation: an in-process driver is fed
+// synthetic envelopes for a single local validator, for a range of
+// network sizes and quorum shapes. Run them with
+//
+//     --test [scpbench]
+
+namespace stellar
+{
+
+using xdr::operator<;
+using xdr::operator==;
+
+namespace
+{
+
+class BenchSCPDriver : public SCPDriver
+{
+  public:
+    std::map<Hash, SCPQuorumSetPtr> mQuorumSets;
+
+    void
+    signEnvelope(SCPEnvelope&) override
+    {
+    }
+
+    bool
+    verifyEnvelope(SCPEnvelope const& envelope) override
+    {
+        return true;
+    }
+
+    Hash
+    storeQuorumSet(SCPQuorumSet const& qSet)
+    {
+        Hash qSetHash = sha256(xdr::xdr_to_opaque(qSet));
+        mQuorumSets[qSetHash] = std::make_shared<SCPQuorumSet>(qSet);
+        return qSetHash;
+    }
+
+    SCPQuorumSetPtr
+    getQSet(Hash const& qSetHash) override
+    {
+        auto it = mQuorumSets.find(qSetHash);
+        return it == mQuorumSets.end() ? SCPQuorumSetPtr() : it->second;
+    }
+
+    SCPDriver::ValidationLevel
+    validateValue(uint64 slotIndex, Value const& value,
+                  bool nomination) override
+    {
+        return SCPDriver::kFullyValidatedValue;
+    }
+
+    void
+    emitEnvelope(SCPEnvelope const& envelope) override
+    {
+    }
+
+    Value
+    combineCandidates(uint64 slotIndex,
+                      std::set<Value> const& candidates) override
+    {
+        return *candidates.begin();
+    }
+
+    void
+    setupTimer(uint64 slotIndex, int timerID, std::chrono::milliseconds timeout,
+               std::function<void()> cb) override
+    {
+    }
+};
+
+// Synthetic network: node 0 is the local node, every node has a quorum set
+// (possibly shared) and statements are generated on behalf of all of them.
+struct BenchTopology
+{
+    std::string mName;
+    std::vector<SecretKey> mKeys;
+    std::vector<SCPQuorumSet> mQSets;
+};
+
+std::vector<SecretKey>
+makeKeys(size_t n)
+{
+    std::vector<SecretKey> keys;
+    keys.reserve(n);
+    for (size_t i = 0; i < n; i++)
+    {
+        keys.emplace_back(
+            SecretKey::fromSeed(sha256(fmt::format("NODE_SEED_{:d}", i))));
+    }
+    return keys;
+}
+
+uint32
+twoThirds(size_t n)
+{
+    return static_cast<uint32>(1 + (2 * n) / 3);
+}
+
+// every node trusts a 67% threshold of all validators
+BenchTopology
+flatTopology(size_t n)
+{
+    BenchTopology t;
+    t.mName = "flat";
+    t.mKeys = makeKeys(n);
+    SCPQuorumSet qSet;
+    qSet.threshold = twoThirds(n);
+    for (auto const& k : t.mKeys)
+    {
+        qSet.validators.emplace_back(k.getPublicKey());
+    }
+    t.mQSets.assign(n, qSet);
+    return t;
+}
+
+// validators are grouped into organizations of `orgSize` (themselves grouped
+// into regions of `orgsPerRegion`), using the maximum nesting depth allowed
+// by isQuorumSetSane
+BenchTopology
+hierarchicalTopology(size_t n, size_t orgSize = 4, size_t orgsPerRegion = 8)
+{
+    BenchTopology t;
+    t.mName = "hierarchical";
+    t.mKeys = makeKeys(n);
+
+    SCPQuorumSet top;
+    SCPQuorumSet region;
+    SCPQuorumSet org;
+    auto flushOrg = [&]() {
+        if (!org.validators.empty())
+        {
+            org.threshold = twoThirds(org.validators.size());
+            region.innerSets.emplace_back(org);
+            org = SCPQuorumSet{};
+        }
+    };
+    auto flushRegion = [&]() {
+        flushOrg();
+        if (!region.innerSets.empty())
+        {
+            region.threshold = twoThirds(region.innerSets.size());
+            top.innerSets.emplace_back(region);
+            region = SCPQuorumSet{};
+        }
+    };
+    for (auto const& k : t.mKeys)
+    {
+        org.validators.emplace_back(k.getPublicKey());
+        if (org.validators.size() == orgSize)
+        {
+            flushOrg();
+            if (region.innerSets.size() == orgsPerRegion)
+            {
+                flushRegion();
+            }
+        }
+    }
+    flushRegion();
+    top.threshold = twoThirds(top.innerSets.size());
+    t.mQSets.assign(n, top);
+    return t;
+}
+
+// a core of `coreSize` validators (organizations of 3) trusting each other,
+// every other validator trusts the core only
+BenchTopology
+tieredTopology(size_t n, size_t coreSize = 21)
+{
+    BenchTopology t;
+    t.mName = "tiered";
+    t.mKeys = makeKeys(n);
+    coreSize = std::min(coreSize, n);
+
+    SCPQuorumSet core;
+    for (size_t i = 0; i < coreSize; i += 3)
+    {
+        SCPQuorumSet org;
+        for (size_t j = i; j < std::min(i + 3, coreSize); j++)
+        {
+            org.validators.emplace_back(t.mKeys[j].getPublicKey());
+        }
+        org.threshold = twoThirds(org.validators.size());
+        core.innerSets.emplace_back(org);
+    }
+    core.threshold = twoThirds(core.innerSets.size());
+
+    SCPQuorumSet leaf;
+    leaf.threshold = 1;
+    leaf.innerSets.emplace_back(core);
+
+    t.mQSets.assign(coreSize, core);
+    t.mQSets.resize(n, leaf);
+    return t;
+}
+
+SCPEnvelope
+makeEnvelope(SecretKey const& key, uint64 slotIndex, SCPStatement const& st)
+{
+    SCPEnvelope envelope;
+    envelope.statement = st;
+    envelope.statement.nodeID = key.getPublicKey();
+    envelope.statement.slotIndex = slotIndex;
+    // signatures are not checked by BenchSCPDriver, see [crypto-bench] for the
+    // cost of verification
+    return envelope;
+}
+
+// builds the sequence of statements a well-behaved network emits for a slot
+// externalizing `v`: vote, accept, prepare, confirm, externalize
+std::vector<SCPEnvelope>
+makeSlotEnvelopes(BenchTopology const& t, std::vector<Hash> const& qSetHashes,
+                  uint64 slotIndex, Value const& v)
+{
+    std::vector<SCPEnvelope> res;
+    size_t const n = t.mKeys.size();
+    res.reserve(5 * n);
+    SCPBallot b(1, v);
+
+    for (size_t i = 1; i < n; i++)
+    {
+        SCPStatement st;
+        st.pledges.type(SCP_ST_NOMINATE);
+        st.pledges.nominate().quorumSetHash = qSetHashes[i];
+        st.pledges.nominate().votes.emplace_back(v);
+        res.emplace_back(makeEnvelope(t.mKeys[i], slotIndex, st));
+    }
+    for (size_t i = 1; i < n; i++)
+    {
+        SCPStatement st;
+        st.pledges.type(SCP_ST_NOMINATE);
+        st.pledges.nominate().quorumSetHash = qSetHashes[i];
+        st.pledges.nominate().votes.emplace_back(v);
+        st.pledges.nominate().accepted.emplace_back(v);
+        res.emplace_back(makeEnvelope(t.mKeys[i], slotIndex, st));
+    }
+    for (size_t i = 1; i < n; i++)
+    {
+        SCPStatement st;
+        st.pledges.type(SCP_ST_PREPARE);
+        auto& p = st.pledges.prepare();
+        p.ballot = b;
+        p.quorumSetHash = qSetHashes[i];
+        p.prepared.activate() = b;
+        res.emplace_back(makeEnvelope(t.mKeys[i], slotIndex, st));
+    }
+    for (size_t i = 1; i < n; i++)
+    {
+        SCPStatement st;
+        st.pledges.type(SCP_ST_CONFIRM);
+        auto& c = st.pledges.confirm();
+        c.ballot = b;
+        c.nPrepared = 1;
+        c.nCommit = 1;
+        c.nH = 1;
+        c.quorumSetHash = qSetHashes[i];
+        res.emplace_back(makeEnvelope(t.mKeys[i], slotIndex, st));
+    }
+    for (size_t i = 1; i < n; i++)
+    {
+        SCPStatement st;
+        st.pledges.type(SCP_ST_EXTERNALIZE);
+        auto& e = st.pledges.externalize();
+        e.commit = b;
+        e.nH = 1;
+        e.commitQuorumSetHash = qSetHashes[i];
+        res.emplace_back(makeEnvelope(t.mKeys[i], slotIndex, st));
+    }
+    return res;
+}
+
+void
+runSCPBenchmark(BenchTopology const& t, uint64 nbSlots)
+{
+    BenchSCPDriver driver;
+    std::vector<Hash> qSetHashes;
+    for (auto const& q : t.mQSets)
+    {
+        qSetHashes.emplace_back(driver.storeQuorumSet(q));
+    }
+    SCP scp(driver, t.mKeys[0].getPublicKey(), true, t.mQSets[0]);
+
+    medida::Timer envelopeTimer;
+    std::chrono::nanoseconds total{0};
+    size_t nbEnvelopes = 0;
+    size_t nbValid = 0;
+    size_t retainedBytes = 0;
+    size_t retainedStatements = 0;
+    size_t externalized = 0;
+
+    Value prev = xdr::xdr_to_opaque(sha256("BENCH_VALUE_0"));
+    for (uint64 slotIndex = 1; slotIndex <= nbSlots; slotIndex++)
+    {
+        Value v = xdr::xdr_to_opaque(
+            sha256(fmt::format("BENCH_VALUE_{:d}", slotIndex)));
+        auto envs = makeSlotEnvelopes(t, qSetHashes, slotIndex, v);
+
+        scp.nominate(slotIndex, v, prev);
+        for (auto const& e : envs)
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto r = scp.receiveEnvelope(e);
+            auto elapsed = std::chrono::steady_clock::now() - start;
+            envelopeTimer.Update(elapsed);
+            total += elapsed;
+            nbEnvelopes++;
+            if (r == SCP::VALID)
+            {
+                nbValid++;
+                retainedBytes += xdr::xdr_size(e);
+            }
+        }
+        if (!scp.getExternalizingState(slotIndex).empty())
+        {
+            externalized++;
+        }
+        retainedStatements += scp.getCumulativeStatemtCount();
+        scp.purgeSlots(slotIndex);
+        prev = v;
+    }
+
+    auto snap = envelopeTimer.GetSnapshot();
+    double secs = std::chrono::duration<double>(total).count();
+    LOG(INFO) << fmt::format(
+        "scp bench {:s} nodes={:d} slots={:d} externalized={:d} "
+        "envelopes={:d} valid={:d} env/s={:.0f} "
+        "latency(ms) p50={:.4f} p95={:.4f} p99={:.4f} p999={:.4f} "
+        "max={:.4f} statements/slot={:.1f} bytes/slot={:.0f}",
+        t.mName, t.mKeys.size(), nbSlots, externalized, nbEnvelopes, nbValid,
+        secs > 0 ? nbEnvelopes / secs : 0.0, snap.getMedian(),
+        snap.get95thPercentile(), snap.get99thPercentile(),
+        snap.get999thPercentile(), envelopeTimer.max(),
+        double(retainedStatements) / nbSlots, double(retainedBytes) / nbSlots);
+
+    REQUIRE(externalized == nbSlots);
+}
+}
+
+TEST_CASE("SCP envelope processing scaling", "[scp][scpbench][bench][hide]")
+{
+    uint64 const nbSlots = 5;
+    for (size_t n : {10, 30, 100, 300, 1000})
+    {
+        SECTION(fmt::format("flat {:d}", n))
+        {
+            runSCPBenchmark(flatTopology(n), nbSlots);
+        }
+        SECTION(fmt::format("hierarchical {:d}", n))
+        {
+            runSCPBenchmark(hierarchicalTopology(n), nbSlots);
+        }
+        SECTION(fmt::format("tiered {:d}", n))
+        {
+            runSCPBenchmark(tieredTopology(n), nbSlots);
+        }
+    }
+}
+}
@@ -160,8 +160,16 @@ class TestSCP : public SCPDriver
         return mHashValueCalculator(value);
     }
 
+    void
+    nominationHashLookup(uint64 slotIndex, bool cached) override
+    {
+        (cached ? mHashCacheHits : mHashCacheMisses)++;
+    }
+
     std::function<uint64(NodeID const&)> mPriorityLookup;
     std::function<uint64(Value const&)> mHashValueCalculator;
+    size_t mHashCacheHits{0};
+    size_t mHashCacheMisses{0};
 
     std::map<Hash, SCPQuorumSetPtr> mQuorumSets;
     std::vector<SCPEnvelope> mEnvs;
@@ -2478,6 +2486,31 @@ TEST_CASE("nomination tests core5", "[scp][nominationprotocol]")
                                votesX);
             }
         }
+        SECTION("hashes are memoized within a round")
+        {
+            REQUIRE(!scp.nominate(0, xValue, false));
+            REQUIRE(scp.mHashCacheHits == 0);
+            auto misses = scp.mHashCacheMisses;
+
+            // votes for 'y', hashing 'x' and 'y'
+            scp.receiveEnvelope(nom1);
+            REQUIRE(scp.mEnvs.size() == 1);
+            REQUIRE(scp.mHashCacheHits == 0);
+            REQUIRE(scp.mHashCacheMisses == misses + 2);
+
+            // 'x' was already hashed this round, only 'z' is new
+            std::vector<Value> votesXYZ{xValue, yValue, zValue};
+            scp.receiveEnvelope(
+                makeNominate(v1SecretKey, qSetHash, 0, votesXYZ, emptyV));
+            REQUIRE(scp.mHashCacheHits == 1);
+            REQUIRE(scp.mHashCacheMisses == misses + 3);
+
+            SECTION("new round invalidates the cache")
+            {
+                REQUIRE(scp.nominate(0, xValue, true));
+                REQUIRE(scp.mHashCacheHits == 1);
+            }
+        }
         SECTION("v1 dead, timeout")
         {
             REQUIRE(!scp.nominate(0, xValue, false));
@@ -59,8 +59,8 @@ BucketListDepthModifier::~BucketListDepthModifier()
 }
 }
 
-TestInvariantManager::TestInvariantManager(medida::MetricsRegistry& registry)
-    : InvariantManagerImpl(registry)
+TestInvariantManager::TestInvariantManager(Application& app)
+    : InvariantManagerImpl(app)
 {
 }
 
@@ -79,7 +79,7 @@ TestApplication::TestApplication(VirtualClock& clock, Config const& cfg)
 std::unique_ptr<InvariantManager>
 TestApplication::createInvariantManager()
 {
-    return make_unique<TestInvariantManager>(getMetrics());
+    return make_unique<TestInvariantManager>(*this);
 }
 
 time_t
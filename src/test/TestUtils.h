@@ -38,7 +38,7 @@ class BucketListDepthModifier
 class TestInvariantManager : public InvariantManagerImpl
 {
   public:
-    TestInvariantManager(medida::MetricsRegistry& registry);
+    TestInvariantManager(Application& app);
 
   private:
     virtual void
@@ -141,4 +141,24 @@ AllowTrustOpFrame::doCheckValid(Application& app)
 
     return true;
 }
+
+void
+AllowTrustOpFrame::insertLedgerKeysToPrefetch(
+    std::vector<LedgerKey>& keys) const
+{
+    OperationFrame::insertLedgerKeysToPrefetch(keys);
+    Asset ci;
+    ci.type(mAllowTrust.asset.type());
+    if (mAllowTrust.asset.type() == ASSET_TYPE_CREDIT_ALPHANUM4)
+    {
+        ci.alphaNum4().assetCode = mAllowTrust.asset.assetCode4();
+        ci.alphaNum4().issuer = getSourceID();
+    }
+    else if (mAllowTrust.asset.type() == ASSET_TYPE_CREDIT_ALPHANUM12)
+    {
+        ci.alphaNum12().assetCode = mAllowTrust.asset.assetCode12();
+        ci.alphaNum12().issuer = getSourceID();
+    }
+    addTrustLineKey(keys, mAllowTrust.trustor, ci);
+}
 }
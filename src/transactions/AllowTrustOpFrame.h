@@ -27,6 +27,9 @@ class AllowTrustOpFrame : public OperationFrame
                  LedgerManager& ledgerManager) override;
     bool doCheckValid(Application& app) override;
 
+    void
+    insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys) const override;
+
     static AllowTrustResultCode
     getInnerCode(OperationResult const& res)
     {
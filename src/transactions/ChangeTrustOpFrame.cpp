@@ -162,4 +162,16 @@ ChangeTrustOpFrame::doCheckValid(Application& app)
     }
     return true;
 }
+
+void
+ChangeTrustOpFrame::insertLedgerKeysToPrefetch(
+    std::vector<LedgerKey>& keys) const
+{
+    OperationFrame::insertLedgerKeysToPrefetch(keys);
+    addTrustLineKey(keys, getSourceID(), mChangeTrust.line);
+    if (mChangeTrust.line.type() != ASSET_TYPE_NATIVE)
+    {
+        addAccountKey(keys, getIssuer(mChangeTrust.line));
+    }
+}
 }
@@ -26,6 +26,9 @@ class CreateAccountOpFrame : public OperationFrame
                  LedgerManager& ledgerManager) override;
     bool doCheckValid(Application& app) override;
 
+    void
+    insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys) const override;
+
     static CreateAccountResultCode
     getInnerCode(OperationResult const& res)
     {
@@ -485,4 +485,13 @@ ManageOfferOpFrame::buildOffer(AccountID const& account,
     o.flags = flags;
     return o;
 }
+
+void
+ManageOfferOpFrame::insertLedgerKeysToPrefetch(
+    std::vector<LedgerKey>& keys) const
+{
+    OperationFrame::insertLedgerKeysToPrefetch(keys);
+    addTrustLineKey(keys, getSourceID(), mManageOffer.selling);
+    addTrustLineKey(keys, getSourceID(), mManageOffer.buying);
+}
 }
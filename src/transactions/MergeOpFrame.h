@@ -26,6 +26,9 @@ class MergeOpFrame : public OperationFrame
                  LedgerManager& ledgerManager) override;
     bool doCheckValid(Application& app) override;
 
+    void
+    insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys) const override;
+
     static AccountMergeResultCode
     getInnerCode(OperationResult const& res)
     {
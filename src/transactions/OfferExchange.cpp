@@ -262,16 +262,19 @@ OfferExchange::convertWithOffers(
 
     Database& db = mLedgerManager.getDatabase();
 
-    size_t offerOffset = 0;
+    OfferFrame::pointer lastOffer;
 
     bool needMore = (maxWheatReceive > 0 && maxSheepSend > 0);
 
     while (needMore)
     {
         std::vector<OfferFrame::pointer> retList;
-        OfferFrame::loadBestOffers(5, offerOffset, wheat, sheep, retList, db);
-
-        offerOffset += retList.size();
+        OfferFrame::loadBestOffers(5, wheat, sheep, lastOffer.get(), retList,
+                                   db);
+        if (!retList.empty())
+        {
+            lastOffer = retList.back();
+        }
 
         for (auto& wheatOffer : retList)
         {
@@ -304,8 +307,6 @@ OfferExchange::convertWithOffers(
             switch (cor)
             {
             case eOfferTaken:
-                assert(offerOffset > 0);
-                offerOffset--; // adjust offset as an offer was deleted
                 break;
             case eOfferPartial:
                 break;
@@ -25,6 +25,7 @@
 
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
 
 namespace stellar
 {
@@ -97,6 +98,10 @@ bool
 OperationFrame::apply(SignatureChecker& signatureChecker, LedgerDelta& delta,
                       Application& app)
 {
+    auto opTime = app.getLedgerManager()
+                      .getOperationTimer(mOperation.body.type())
+                      .TimeScope();
+
     bool res;
     res = checkValid(signatureChecker, app, &delta);
     if (res)
@@ -122,6 +127,37 @@ OperationFrame::checkSignature(SignatureChecker& signatureChecker) const
                                     neededThreshold);
 }
 
+void
+OperationFrame::addAccountKey(std::vector<LedgerKey>& keys,
+                              AccountID const& accountID)
+{
+    LedgerKey key;
+    key.type(ACCOUNT);
+    key.account().accountID = accountID;
+    keys.push_back(key);
+}
+
+void
+OperationFrame::addTrustLineKey(std::vector<LedgerKey>& keys,
+                                AccountID const& accountID, Asset const& asset)
+{
+    if (asset.type() == ASSET_TYPE_NATIVE || getIssuer(asset) == accountID)
+    {
+        return;
+    }
+    LedgerKey key;
+    key.type(TRUSTLINE);
+    key.trustLine().accountID = accountID;
+    key.trustLine().asset = asset;
+    keys.push_back(key);
+}
+
+void
+OperationFrame::insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys) const
+{
+    addAccountKey(keys, getSourceID());
+}
+
 AccountID const&
 OperationFrame::getSourceID() const
 {
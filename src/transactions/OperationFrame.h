@@ -9,6 +9,7 @@
 #include "overlay/StellarXDR.h"
 #include "util/types.h"
 #include <memory>
+#include <vector>
 
 namespace medida
 {
@@ -46,6 +47,12 @@ class OperationFrame
                          LedgerManager& ledgerManager) = 0;
     virtual ThresholdLevel getThresholdLevel() const;
 
+    static void addAccountKey(std::vector<LedgerKey>& keys,
+                              AccountID const& accountID);
+    // no-op for native assets and issuers, which have no trust line
+    static void addTrustLineKey(std::vector<LedgerKey>& keys,
+                                AccountID const& accountID, Asset const& asset);
+
   public:
     static std::shared_ptr<OperationFrame>
     makeHelper(Operation const& op, OperationResult& res,
@@ -90,6 +97,10 @@ class OperationFrame
     bool apply(SignatureChecker& signatureChecker, LedgerDelta& delta,
                Application& app);
 
+    // Adds the keys of the ledger entries applying this operation is likely
+    // to load, which get prefetched before the transaction set is applied.
+    virtual void insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys) const;
+
     Operation const&
     getOperation() const
     {
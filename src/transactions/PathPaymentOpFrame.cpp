@@ -386,4 +386,14 @@ PathPaymentOpFrame::doCheckValid(Application& app)
     }
     return true;
 }
+
+void
+PathPaymentOpFrame::insertLedgerKeysToPrefetch(
+    std::vector<LedgerKey>& keys) const
+{
+    OperationFrame::insertLedgerKeysToPrefetch(keys);
+    addAccountKey(keys, mPathPayment.destination);
+    addTrustLineKey(keys, getSourceID(), mPathPayment.sendAsset);
+    addTrustLineKey(keys, mPathPayment.destination, mPathPayment.destAsset);
+}
 }
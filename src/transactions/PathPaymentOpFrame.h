@@ -26,6 +26,9 @@ class PathPaymentOpFrame : public OperationFrame
                  LedgerManager& ledgerManager) override;
     bool doCheckValid(Application& app) override;
 
+    void
+    insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys) const override;
+
     static PathPaymentResultCode
     getInnerCode(OperationResult const& res)
     {
@@ -171,4 +171,13 @@ PaymentOpFrame::doCheckValid(Application& app)
     }
     return true;
 }
+
+void
+PaymentOpFrame::insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys) const
+{
+    OperationFrame::insertLedgerKeysToPrefetch(keys);
+    addAccountKey(keys, mPayment.destination);
+    addTrustLineKey(keys, getSourceID(), mPayment.asset);
+    addTrustLineKey(keys, mPayment.destination, mPayment.asset);
+}
 }
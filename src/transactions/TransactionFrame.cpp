@@ -9,6 +9,7 @@
 #include "crypto/SHA.h"
 #include "crypto/SignerKey.h"
 #include "database/Database.h"
+#include "database/DatabaseUtils.h"
 #include "herder/TxSetFrame.h"
 #include "invariant/InvariantManager.h"
 #include "ledger/LedgerDelta.h"
@@ -185,6 +186,24 @@ TransactionFrame::loadAccount(int ledgerProtocolVersion, LedgerDelta* delta,
     return !!mSigningAccount;
 }
 
+void
+TransactionFrame::insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys)
+{
+    LedgerKey key;
+    key.type(ACCOUNT);
+    key.account().accountID = getSourceID();
+    keys.push_back(key);
+
+    // the operations are only inspected, their results are thrown away
+    std::vector<OperationResult> results(mEnvelope.tx.operations.size());
+    for (size_t i = 0; i < mEnvelope.tx.operations.size(); i++)
+    {
+        OperationFrame::makeHelper(mEnvelope.tx.operations[i], results[i],
+                                   *this)
+            ->insertLedgerKeysToPrefetch(keys);
+    }
+}
+
 void
 TransactionFrame::resetResults()
 {
@@ -837,15 +856,13 @@ TransactionFrame::dropAll(Database& db)
     db.getSession() << "CREATE INDEX histfeebyseq ON txfeehistory (ledgerseq);";
 }
 
-void
-TransactionFrame::deleteOldEntries(Database& db, uint32_t ledgerSeq,
+size_t
+TransactionFrame::deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
                                    uint32_t count)
 {
-    db.getSession() << "DELETE FROM txhistory WHERE ledgerseq IN (SELECT "
-                       "ledgerseq FROM txhistory WHERE ledgerseq <= "
-                    << ledgerSeq << " LIMIT " << count << ")";
-    db.getSession() << "DELETE FROM txfeehistory WHERE ledgerseq IN (SELECT "
-                       "ledgerseq FROM txfeehistory WHERE ledgerseq <= "
-                    << ledgerSeq << " LIMIT " << count << ")";
+    return DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
+                                                 "txhistory", "ledgerseq") +
+           DatabaseUtils::deleteOldEntriesHelper(sess, ledgerSeq, count,
+                                                 "txfeehistory", "ledgerseq");
 }
 }
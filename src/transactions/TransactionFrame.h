@@ -152,6 +152,10 @@ class TransactionFrame
     // version without meta
     bool apply(LedgerDelta& delta, Application& app);
 
+    // Adds the keys of the ledger entries applying this transaction is likely
+    // to load (see OperationFrame::insertLedgerKeysToPrefetch).
+    void insertLedgerKeysToPrefetch(std::vector<LedgerKey>& keys);
+
     StellarMessage toStellarMessage() const;
 
     AccountFrame::pointer loadAccount(int ledgerProtocolVersion,
@@ -185,7 +189,7 @@ class TransactionFrame
                                            XDROutputFileStream& txResultOut);
     static void dropAll(Database& db);
 
-    static void deleteOldEntries(Database& db, uint32_t ledgerSeq,
-                                 uint32_t count);
+    static size_t deleteOldEntries(soci::session& sess, uint32_t ledgerSeq,
+                                   uint32_t count);
 };
 }
@@ -0,0 +1,284 @@
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include "util/Gzip.h"
+#include "util/Logging.h"
+
+#include <algorithm>
+#include <fstream>
+#include <limits>
+#include <utility>
+#include <vector>
+#include <zlib.h>
+
+namespace stellar
+{
+
+namespace
+{
+// buffer used by zlib on each side of the (de)compressor, and size of the
+// chunks we copy in and out of files
+size_t const GZIP_BUFFER_SIZE = 256 * 1024;
+
+void
+throwGzipError(std::string const& what, std::string const& filename,
+               gzFile file = nullptr)
+{
+    std::string msg = what + " " + filename;
+    if (file)
+    {
+        int errnum = Z_OK;
+        char const* zmsg = gzerror(file, &errnum);
+        if (errnum != Z_OK && zmsg)
+        {
+            msg += ", reason: ";
+            msg += zmsg;
+        }
+    }
+    CLOG(ERROR, "Fs") << msg;
+    throw std::runtime_error(msg);
+}
+
+gzFile
+openGzip(std::string const& filename, char const* mode)
+{
+    gzFile f = gzopen(filename.c_str(), mode);
+    if (!f)
+    {
+        throwGzipError("failed to open gzip file", filename);
+    }
+    gzbuffer(f, static_cast<unsigned>(GZIP_BUFFER_SIZE));
+    return f;
+}
+}
+
+GzipInputFile::GzipInputFile(GzipInputFile&& other)
+{
+    *this = std::move(other);
+}
+
+GzipInputFile&
+GzipInputFile::operator=(GzipInputFile&& other)
+{
+    std::swap(mFile, other.mFile);
+    std::swap(mGood, other.mGood);
+    std::swap(mFilename, other.mFilename);
+    return *this;
+}
+
+GzipInputFile::~GzipInputFile()
+{
+    if (mFile)
+    {
+        // errors are reported by an explicit close()
+        gzclose_r(mFile);
+    }
+}
+
+void
+GzipInputFile::open(std::string const& filename)
+{
+    close();
+    mFilename = filename;
+    mFile = openGzip(filename, "rb");
+    mGood = true;
+}
+
+void
+GzipInputFile::close()
+{
+    if (!mFile)
+    {
+        mGood = false;
+        return;
+    }
+    auto f = mFile;
+    bool atEOF = !mGood;
+    mFile = nullptr;
+    mGood = false;
+    int res = gzclose_r(f);
+    // Z_BUF_ERROR only means that reading stopped in the middle of the
+    // stream, an error if we got there by reaching the end of the file
+    if (res != Z_OK && (res != Z_BUF_ERROR || atEOF))
+    {
+        throwGzipError("failed to read gzip file", mFilename);
+    }
+}
+
+size_t
+GzipInputFile::readSome(char* buf, size_t size)
+{
+    if (!mGood)
+    {
+        return 0;
+    }
+    size = std::min(size, static_cast<size_t>(
+                              std::numeric_limits<unsigned int>::max()));
+    int n = gzread(mFile, buf, static_cast<unsigned int>(size));
+    if (n < 0)
+    {
+        mGood = false;
+        throwGzipError("failed to read gzip file", mFilename, mFile);
+    }
+    if (n == 0)
+    {
+        mGood = false;
+        // a truncated file also ends with a 0 read, gzerror tells them apart
+        int errnum = Z_OK;
+        gzerror(mFile, &errnum);
+        if (errnum != Z_OK && errnum != Z_STREAM_END)
+        {
+            throwGzipError("failed to read gzip file", mFilename, mFile);
+        }
+    }
+    return static_cast<size_t>(n);
+}
+
+bool
+GzipInputFile::isCompressed() const
+{
+    return mFile && gzdirect(mFile) == 0;
+}
+
+bool
+GzipInputFile::read(char* buf, size_t size)
+{
+    while (size > 0)
+    {
+        auto n = readSome(buf, size);
+        if (n == 0)
+        {
+            return false;
+        }
+        buf += n;
+        size -= n;
+    }
+    return true;
+}
+
+GzipOutputFile::GzipOutputFile(GzipOutputFile&& other)
+{
+    *this = std::move(other);
+}
+
+GzipOutputFile&
+GzipOutputFile::operator=(GzipOutputFile&& other)
+{
+    std::swap(mFile, other.mFile);
+    std::swap(mGood, other.mGood);
+    std::swap(mFilename, other.mFilename);
+    return *this;
+}
+
+GzipOutputFile::~GzipOutputFile()
+{
+    if (mFile)
+    {
+        // errors are reported by an explicit close()
+        gzclose_w(mFile);
+    }
+}
+
+void
+GzipOutputFile::open(std::string const& filename)
+{
+    close();
+    mFilename = filename;
+    mFile = openGzip(filename, "wb");
+    mGood = true;
+}
+
+void
+GzipOutputFile::close()
+{
+    if (!mFile)
+    {
+        return;
+    }
+    auto f = mFile;
+    mFile = nullptr;
+    mGood = false;
+    if (gzclose_w(f) != Z_OK)
+    {
+        throwGzipError("failed to write gzip file", mFilename);
+    }
+}
+
+bool
+GzipOutputFile::write(char const* buf, size_t size)
+{
+    while (mGood && size > 0)
+    {
+        auto chunk = std::min(size, GZIP_BUFFER_SIZE);
+        int n = gzwrite(mFile, buf, static_cast<unsigned int>(chunk));
+        if (n <= 0)
+        {
+            mGood = false;
+            break;
+        }
+        buf += n;
+        size -= n;
+    }
+    return mGood;
+}
+
+void
+gzipFile(std::string const& in, std::string const& out)
+{
+    std::ifstream inFile(in, std::ifstream::binary);
+    if (!inFile)
+    {
+        throwGzipError("failed to open file", in);
+    }
+    GzipOutputFile outFile;
+    outFile.open(out);
+
+    std::vector<char> buf(GZIP_BUFFER_SIZE);
+    while (inFile)
+    {
+        inFile.read(buf.data(), buf.size());
+        if (!outFile.write(buf.data(), inFile.gcount()))
+        {
+            throwGzipError("failed to write gzip file", out);
+        }
+    }
+    if (inFile.bad())
+    {
+        throwGzipError("failed to read file", in);
+    }
+    outFile.close();
+}
+
+void
+gunzipFile(std::string const& in, std::string const& out)
+{
+    GzipInputFile inFile;
+    inFile.open(in);
+    std::ofstream outFile(out, std::ofstream::binary | std::ofstream::trunc);
+    if (!outFile)
+    {
+        throwGzipError("failed to open file", out);
+    }
+
+    std::vector<char> buf(GZIP_BUFFER_SIZE);
+    size_t n;
+    while ((n = inFile.readSome(buf.data(), buf.size())) != 0)
+    {
+        if (!inFile.isCompressed())
+        {
+            throwGzipError("not in gzip format:", in);
+        }
+        if (!outFile.write(buf.data(), n))
+        {
+            throwGzipError("failed to write file", out);
+        }
+    }
+    inFile.close();
+    outFile.close();
+    if (!outFile)
+    {
+        throwGzipError("failed to write file", out);
+    }
+}
+}
@@ -0,0 +1,97 @@
+#pragma once
+
+// Copyright 2018 Stellar Development Foundation and contributors. Licensed
+// under the Apache License, Version 2.0. See the COPYING file at the root
+// of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
+
+#include <cstddef>
+#include <string>
+
+// zlib's gzFile is a pointer to this
+struct gzFile_s;
+
+namespace stellar
+{
+
+////
+// In-process gzip support (zlib), used for history files instead of running
+// the gzip binary. All functions raise std::runtime_error on failure.
+////
+
+/**
+ * Sequential reader of a gzip file. Files that are not compressed are read
+ * as-is.
+ */
+class GzipInputFile
+{
+    gzFile_s* mFile{nullptr};
+    bool mGood{false};
+    std::string mFilename;
+
+  public:
+    GzipInputFile() = default;
+    GzipInputFile(GzipInputFile&& other);
+    GzipInputFile& operator=(GzipInputFile&& other);
+    GzipInputFile(GzipInputFile const&) = delete;
+    GzipInputFile& operator=(GzipInputFile const&) = delete;
+    ~GzipInputFile();
+
+    void open(std::string const& filename);
+    // raises if the file turned out to be corrupt, files closed before the
+    // end are not checked further
+    void close();
+
+    // reads exactly @p size bytes, returns false on EOF or short read
+    bool read(char* buf, size_t size);
+
+    // reads at most @p size bytes, returns the number of bytes read (0 on
+    // EOF), raises if the file is corrupt or truncated
+    size_t readSome(char* buf, size_t size);
+
+    // false if the file turned out not to be gzip-compressed (only
+    // meaningful after the first read)
+    bool isCompressed() const;
+
+    bool
+    good() const
+    {
+        return mGood;
+    }
+};
+
+/**
+ * Sequential writer of a gzip file.
+ */
+class GzipOutputFile
+{
+    gzFile_s* mFile{nullptr};
+    bool mGood{false};
+    std::string mFilename;
+
+  public:
+    GzipOutputFile() = default;
+    GzipOutputFile(GzipOutputFile&& other);
+    GzipOutputFile& operator=(GzipOutputFile&& other);
+    GzipOutputFile(GzipOutputFile const&) = delete;
+    GzipOutputFile& operator=(GzipOutputFile const&) = delete;
+    ~GzipOutputFile();
+
+    void open(std::string const& filename);
+    // flushes and closes the file, raises if the file could not be completed
+    void close();
+
+    bool write(char const* buf, size_t size);
+
+    bool
+    good() const
+    {
+        return mGood;
+    }
+};
+
+// gzip @p in into @p out
+void gzipFile(std::string const& in, std::string const& out);
+
+// gunzip @p in into @p out
+void gunzipFile(std::string const& in, std::string const& out);
+}
@@ -6,68 +6,199 @@
 
 #include "crypto/ByteSlice.h"
 #include "crypto/SHA.h"
+#include "util/Gzip.h"
 #include "util/Logging.h"
 #include "xdrpp/marshal.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 #include <fstream>
 #include <string>
 #include <vector>
 
+#ifdef __linux__
+#include <fcntl.h>
+#endif
+
 namespace stellar
 {
 
+inline bool
+isGzipFilename(std::string const& filename)
+{
+    return filename.size() > 3 &&
+           filename.compare(filename.size() - 3, 3, ".gz") == 0;
+}
+
+// Default size of the buffers of XDR file streams.
+size_t const XDR_FILE_BUFFER_SIZE = 256 * 1024;
+
 /**
  * Helper for loading a sequence of XDR objects from a file one at a time,
- * rather than all at once.
+ * rather than all at once. Files with a ".gz" suffix are decompressed on the
+ * fly.
+ *
+ * The file is read ahead in large chunks and objects are decoded in place
+ * from the read-ahead buffer, instead of issuing two reads per object.
  */
 class XDRInputFileStream
 {
-    std::ifstream mIn;
+    std::FILE* mFile{nullptr};
+    GzipInputFile mGzIn;
+    bool mGzip{false};
+    bool mGood{false};
+    // read-ahead buffer, holding the bytes from mBegin to mEnd. It starts at
+    // the beginning of an object after every refill, objects are multiples
+    // of 4 bytes so they get decoded from aligned memory.
     std::vector<char> mBuf;
+    size_t mBufferSize;
+    size_t mBegin{0};
+    size_t mEnd{0};
     unsigned int mSizeLimit;
 
+    size_t
+    readSome(char* buf, size_t size)
+    {
+        if (mGzip)
+        {
+            return mGzIn.readSome(buf, size);
+        }
+        return std::fread(buf, 1, size, mFile);
+    }
+
+    // Makes sure at least @p size bytes are buffered, false on EOF.
+    bool
+    fill(size_t size)
+    {
+        if (!mGood)
+        {
+            return false;
+        }
+        if (mEnd - mBegin >= size)
+        {
+            return true;
+        }
+        if (mBegin > 0)
+        {
+            std::memmove(mBuf.data(), mBuf.data() + mBegin, mEnd - mBegin);
+            mEnd -= mBegin;
+            mBegin = 0;
+        }
+        if (mBuf.size() < size)
+        {
+            mBuf.resize(size);
+        }
+        while (mEnd < size)
+        {
+            auto n = readSome(mBuf.data() + mEnd, mBuf.size() - mEnd);
+            if (n == 0)
+            {
+                mGood = false;
+                return false;
+            }
+            mEnd += n;
+        }
+        return true;
+    }
+
   public:
-    XDRInputFileStream(unsigned int sizeLimit = 0) : mSizeLimit{sizeLimit}
+    XDRInputFileStream(unsigned int sizeLimit = 0,
+                       size_t bufferSize = XDR_FILE_BUFFER_SIZE)
+        : mBufferSize{std::max<size_t>(4, bufferSize)}, mSizeLimit{sizeLimit}
+    {
+    }
+
+    XDRInputFileStream(XDRInputFileStream&& other)
+        : mFile{other.mFile}
+        , mGzIn{std::move(other.mGzIn)}
+        , mGzip{other.mGzip}
+        , mGood{other.mGood}
+        , mBuf{std::move(other.mBuf)}
+        , mBufferSize{other.mBufferSize}
+        , mBegin{other.mBegin}
+        , mEnd{other.mEnd}
+        , mSizeLimit{other.mSizeLimit}
+    {
+        other.mFile = nullptr;
+        other.mGood = false;
+    }
+
+    XDRInputFileStream(XDRInputFileStream const&) = delete;
+    XDRInputFileStream& operator=(XDRInputFileStream const&) = delete;
+
+    ~XDRInputFileStream()
     {
+        // mGzIn closes itself, without raising
+        if (mFile)
+        {
+            std::fclose(mFile);
+        }
     }
 
     void
     close()
     {
-        mIn.close();
+        if (mGzip)
+        {
+            mGzIn.close();
+        }
+        else if (mFile)
+        {
+            std::fclose(mFile);
+            mFile = nullptr;
+        }
+        mGood = false;
+        mBegin = mEnd = 0;
     }
 
     void
     open(std::string const& filename)
     {
-        mIn.open(filename, std::ifstream::binary);
-        if (!mIn)
+        close();
+        mGzip = isGzipFilename(filename);
+        if (mGzip)
         {
-            std::string msg("failed to open XDR file: ");
-            msg += filename;
-            msg += ", reason: ";
-            msg += std::to_string(errno);
-            CLOG(ERROR, "Fs") << msg;
-            throw std::runtime_error(msg);
+            mGzIn.open(filename);
+        }
+        else
+        {
+            mFile = std::fopen(filename.c_str(), "rb");
+            if (!mFile)
+            {
+                std::string msg("failed to open XDR file: ");
+                msg += filename;
+                msg += ", reason: ";
+                msg += std::to_string(errno);
+                CLOG(ERROR, "Fs") << msg;
+                throw std::runtime_error(msg);
+            }
+            // we do our own buffering
+            std::setvbuf(mFile, nullptr, _IONBF, 0);
+#ifdef __linux__
+            posix_fadvise(fileno(mFile), 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
         }
+        mBuf.resize(mBufferSize);
+        mGood = true;
     }
 
     operator bool() const
     {
-        return mIn.good();
+        return mGood;
     }
 
     template <typename T>
     bool
     readOne(T& out)
     {
-        char szBuf[4];
-        if (!mIn.read(szBuf, 4))
+        if (!fill(4))
         {
             return false;
         }
 
         // Read 4 bytes of size, big-endian, with XDR 'continuation' bit cleared
         // (high bit of high byte).
+        char const* szBuf = mBuf.data() + mBegin;
         uint32_t sz = 0;
         sz |= static_cast<uint8_t>(szBuf[0] & '\x7f');
         sz <<= 8;
@@ -76,41 +207,74 @@ class XDRInputFileStream
         sz |= static_cast<uint8_t>(szBuf[2]);
         sz <<= 8;
         sz |= static_cast<uint8_t>(szBuf[3]);
+        mBegin += 4;
 
         if (mSizeLimit != 0 && sz > mSizeLimit)
         {
             return false;
         }
-        if (sz > mBuf.size())
-        {
-            mBuf.resize(sz);
-        }
-        if (!mIn.read(mBuf.data(), sz))
+        if (!fill(sz))
         {
             throw xdr::xdr_runtime_error("malformed XDR file");
         }
-        xdr::xdr_get g(mBuf.data(), mBuf.data() + sz);
+        xdr::xdr_get g(mBuf.data() + mBegin, mBuf.data() + mBegin + sz);
+        mBegin += sz;
         xdr::xdr_argpack_archive(g, out);
         return true;
     }
 };
 
+/**
+ * Writes a sequence of XDR objects to a file; files with a ".gz" suffix are
+ * compressed on the fly. Uncompressed files are written through a buffer of
+ * @p bufferSize bytes.
+ */
 class XDROutputFileStream
 {
     std::ofstream mOut;
+    GzipOutputFile mGzOut;
+    bool mGzip{false};
     std::vector<char> mBuf;
+    std::vector<char> mOutBuf;
 
   public:
+    XDROutputFileStream(size_t bufferSize = XDR_FILE_BUFFER_SIZE)
+        : mOutBuf(bufferSize)
+    {
+    }
+
     void
     close()
     {
-        mOut.close();
+        if (mGzip)
+        {
+            mGzOut.close();
+        }
+        else
+        {
+            mOut.close();
+        }
     }
 
+    // @p append is only supported on uncompressed files
     void
-    open(std::string const& filename)
+    open(std::string const& filename, bool append = false)
     {
-        mOut.open(filename, std::ofstream::binary | std::ofstream::trunc);
+        mGzip = isGzipFilename(filename);
+        if (mGzip)
+        {
+            assert(!append);
+            mGzOut.open(filename);
+            return;
+        }
+        if (!mOutBuf.empty())
+        {
+            // only honored before the file is opened
+            mOut.rdbuf()->pubsetbuf(mOutBuf.data(), mOutBuf.size());
+        }
+        mOut.open(filename,
+                  std::ofstream::binary |
+                      (append ? std::ofstream::app : std::ofstream::trunc));
         if (!mOut)
         {
             std::string msg("failed to open XDR file: ");
@@ -124,7 +288,15 @@ class XDROutputFileStream
 
     operator bool() const
     {
-        return mOut.good();
+        return mGzip ? mGzOut.good() : mOut.good();
+    }
+
+    // hands buffered data to the OS (uncompressed files only)
+    bool
+    flush()
+    {
+        assert(!mGzip);
+        return static_cast<bool>(mOut.flush());
     }
 
     template <typename T>
@@ -149,7 +321,8 @@ class XDROutputFileStream
         xdr::xdr_put p(mBuf.data() + 4, mBuf.data() + 4 + sz);
         xdr_argpack_archive(p, t);
 
-        if (!mOut.write(mBuf.data(), sz + 4))
+        if (mGzip ? !mGzOut.write(mBuf.data(), sz + 4)
+                  : !mOut.write(mBuf.data(), sz + 4))
         {
             return false;
         }
@@ -30,6 +30,7 @@ Work::Work(Application& app, WorkParent& parent, std::string uniqueName,
     : WorkParent(app)
     , mParent(parent.shared_from_this())
     , mUniqueName(uniqueName)
+    , mPriority(parent.getPriority())
     , mMaxRetries(maxRetries)
 {
 }
@@ -105,6 +106,24 @@ Work::getMaxRetries() const
     return mMaxRetries;
 }
 
+Work::ExecutionClass
+Work::getExecutionClass() const
+{
+    return WORK_EXECUTION_MAIN_THREAD;
+}
+
+WorkPriority
+Work::getPriority() const
+{
+    return mPriority;
+}
+
+void
+Work::setPriority(WorkPriority priority)
+{
+    mPriority = priority;
+}
+
 std::string
 Work::stateName(State st)
 {
@@ -154,7 +173,7 @@ Work::scheduleRun()
         std::static_pointer_cast<Work>(shared_from_this()));
     CLOG(DEBUG, "Work") << "scheduling run of " << getUniqueName();
     mScheduled = true;
-    mApp.getClock().getIOService().post([weak]() {
+    mApp.getWorkManager().post(getPriority(), [weak]() {
         auto self = weak.lock();
         if (!self)
         {
@@ -177,7 +196,7 @@ Work::scheduleComplete(CompleteResult result)
         std::static_pointer_cast<Work>(shared_from_this()));
     CLOG(DEBUG, "Work") << "scheduling completion of " << getUniqueName();
     mScheduled = true;
-    mApp.getClock().getIOService().post([weak, result]() {
+    mApp.getWorkManager().post(getPriority(), [weak, result]() {
         auto self = weak.lock();
         if (!self)
         {
@@ -188,6 +207,14 @@ Work::scheduleComplete(CompleteResult result)
     });
 }
 
+void
+Work::scheduleBackground(std::function<asio::error_code()> job)
+{
+    CLOG(DEBUG, "Work") << "scheduling background job of " << getUniqueName();
+    mApp.getWorkManager().runInBackground(getExecutionClass(), getPriority(),
+                                          job, callComplete());
+}
+
 void
 Work::scheduleRetry()
 {
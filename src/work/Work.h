@@ -28,6 +28,12 @@ class WorkParent;
  * copies of each of these facets of work-management. 'Work' is an attempt
  * to make those facets uniform, systematic, and out-of-the-way of the
  * logic of each piece of work.
+ *
+ * Steps of Work run on the main thread, through the run queue of the
+ * WorkManager: a Work is scheduled at the priority it inherits from its
+ * parent, so that e.g. a long catchup yields to consensus. Work that does its
+ * heavy lifting off the main thread declares it with getExecutionClass() and
+ * hands the job to scheduleBackground().
  */
 
 class Work : public WorkParent
@@ -57,6 +63,15 @@ class Work : public WorkParent
         WORK_COMPLETE_FATAL
     };
 
+    // Where the jobs given to scheduleBackground() run. Each class of jobs
+    // has its own concurrency limit (see WorkManager::runInBackground).
+    enum ExecutionClass
+    {
+        WORK_EXECUTION_MAIN_THREAD,
+        WORK_EXECUTION_CPU_BOUND,
+        WORK_EXECUTION_IO_BOUND
+    };
+
     Work(Application& app, WorkParent& parent, std::string uniqueName,
          size_t maxRetries = RETRY_A_FEW);
 
@@ -66,8 +81,14 @@ class Work : public WorkParent
     virtual std::string getStatus() const;
     virtual VirtualClock::duration getRetryDelay() const;
     virtual size_t getMaxRetries() const;
+    virtual ExecutionClass getExecutionClass() const;
     uint64_t getRetryETA() const;
 
+    // Defaults to the priority of the parent at construction time. Children
+    // added afterwards inherit the new priority.
+    WorkPriority getPriority() const override;
+    void setPriority(WorkPriority priority);
+
     // Customize work behavior via these callbacks. onReset is called
     // before any work starts (on addition, or retry). onStart is called
     // when transitioning from WORK_PENDING -> WORK_RUNNING; onRun is
@@ -101,6 +122,7 @@ class Work : public WorkParent
   protected:
     std::weak_ptr<WorkParent> mParent;
     std::string mUniqueName;
+    WorkPriority mPriority{WORK_PRIORITY_NORMAL};
     size_t mMaxRetries{RETRY_A_FEW};
     size_t mRetries{0};
     State mState{WORK_PENDING};
@@ -114,6 +136,9 @@ class Work : public WorkParent
     void scheduleComplete(CompleteResult result = WORK_COMPLETE_OK);
     void scheduleRetry();
     void scheduleRun();
+    // Runs @p job according to getExecutionClass() and completes with the
+    // error code it returns (or a failure if it throws).
+    void scheduleBackground(std::function<asio::error_code()> job);
     void
     scheduleSuccess()
     {
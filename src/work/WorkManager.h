@@ -8,6 +8,7 @@
 #include "util/Timer.h"
 #include "work/Work.h"
 #include "work/WorkParent.h"
+#include <functional>
 #include <string>
 
 namespace stellar
@@ -18,6 +19,21 @@ namespace stellar
  * dependencies between asynchronous or long-running activities that each
  * might soft-fail and require retrying, or require breaking up into pieces
  * to avoid monopolizing the main thread for too long.
+ *
+ * It also schedules the execution of Work:
+ *
+ *  - Steps of Work (runs and completions) go through a run queue on the main
+ *    thread, one queue per WorkPriority. The whole queue takes a single slot
+ *    in the main io_service at a time and runs one step per turn, highest
+ *    priority first, so any number of pending Work interleaves with the rest
+ *    of the node (SCP, overlay) instead of crowding it out.
+ *
+ *  - Background jobs run on the worker threads, with a concurrency limit per
+ *    execution class (WORK_MAX_CONCURRENT_CPU_JOBS and
+ *    WORK_MAX_CONCURRENT_IO_JOBS). Jobs over the limit wait, highest priority
+ *    first.
+ *
+ * Time spent waiting is recorded in "work.wait-<class>.<priority>" timers.
  */
 class WorkManager : public WorkParent
 {
@@ -27,6 +43,17 @@ class WorkManager : public WorkParent
     static std::shared_ptr<WorkManager> create(Application& app);
     virtual void notify(std::string const& changed) = 0;
 
+    // Queues @p handler to run on the main thread at @p priority.
+    virtual void post(WorkPriority priority, std::function<void()> handler) = 0;
+
+    // Runs @p job according to @p executionClass and calls @p done on the
+    // main thread with the error code it returned. A job that throws fails
+    // with an I/O error.
+    virtual void
+    runInBackground(Work::ExecutionClass executionClass, WorkPriority priority,
+                    std::function<asio::error_code()> job,
+                    std::function<void(asio::error_code const&)> done) = 0;
+
     template <typename T, typename... Args>
     std::shared_ptr<T>
     executeWork(bool block, Args&&... args)
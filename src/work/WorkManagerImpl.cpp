@@ -8,11 +8,17 @@
 #include "work/WorkParent.h"
 
 #include "lib/util/format.h"
+#include "main/Config.h"
 #include "util/Logging.h"
 #include "util/make_unique.h"
 
+#include "medida/counter.h"
 #include "medida/meter.h"
 #include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <algorithm>
+#include <thread>
 
 namespace stellar
 {
@@ -25,8 +31,38 @@ WorkManager::~WorkManager()
 {
 }
 
+namespace
+{
+char const* const EXECUTION_CLASS_NAMES[] = {"main", "cpu", "io"};
+char const* const PRIORITY_NAMES[] = {"low", "normal", "high"};
+}
+
 WorkManagerImpl::WorkManagerImpl(Application& app) : WorkManager(app)
 {
+    auto const& cfg = app.getConfig();
+    auto& cpu = mBackground[Work::WORK_EXECUTION_CPU_BOUND];
+    cpu.mLimit = cfg.WORK_MAX_CONCURRENT_CPU_JOBS;
+    if (cpu.mLimit == 0)
+    {
+        // leave a worker thread to the rest of the node (e.g. verification
+        // of SCP signatures)
+        auto threads = std::thread::hardware_concurrency();
+        cpu.mLimit = std::max(1u, threads > 1 ? threads - 1 : threads);
+    }
+    mBackground[Work::WORK_EXECUTION_IO_BOUND].mLimit =
+        cfg.WORK_MAX_CONCURRENT_IO_JOBS;
+
+    for (size_t c = 0; c < NUM_EXECUTION_CLASSES; ++c)
+    {
+        std::string name = EXECUTION_CLASS_NAMES[c];
+        mBackground[c].mRunningCounter =
+            &app.getMetrics().NewCounter({"work", "running", name});
+        for (size_t p = 0; p < NUM_PRIORITIES; ++p)
+        {
+            mWaitTimes[c][p] = &app.getMetrics().NewTimer(
+                {"work", "wait-" + name, PRIORITY_NAMES[p]});
+        }
+    }
 }
 
 WorkManagerImpl::~WorkManagerImpl()
@@ -65,6 +101,148 @@ WorkManagerImpl::notify(std::string const& child)
     advanceChildren();
 }
 
+void
+WorkManagerImpl::post(WorkPriority priority, std::function<void()> handler)
+{
+    mRunQueue[priority].emplace_back(
+        QueuedHandler{std::move(handler), clock::now()});
+    scheduleRunQueue();
+}
+
+void
+WorkManagerImpl::scheduleRunQueue()
+{
+    if (mRunQueueScheduled)
+    {
+        return;
+    }
+
+    std::weak_ptr<WorkManagerImpl> weak(
+        std::static_pointer_cast<WorkManagerImpl>(shared_from_this()));
+    mRunQueueScheduled = true;
+    mApp.getClock().getIOService().post([weak]() {
+        auto self = weak.lock();
+        if (!self)
+        {
+            return;
+        }
+        self->mRunQueueScheduled = false;
+        self->runOne();
+    });
+}
+
+void
+WorkManagerImpl::runOne()
+{
+    for (size_t p = NUM_PRIORITIES; p-- > 0;)
+    {
+        auto& queue = mRunQueue[p];
+        if (queue.empty())
+        {
+            continue;
+        }
+
+        auto handler = std::move(queue.front());
+        queue.pop_front();
+        mWaitTimes[Work::WORK_EXECUTION_MAIN_THREAD][p]->Update(
+            clock::now() - handler.mQueued);
+        if (std::any_of(mRunQueue.begin(), mRunQueue.end(),
+                        [](std::deque<QueuedHandler> const& q) {
+                            return !q.empty();
+                        }))
+        {
+            // go back to the end of the main io_service queue
+            scheduleRunQueue();
+        }
+        handler.mHandler();
+        return;
+    }
+}
+
+void
+WorkManagerImpl::runInBackground(
+    Work::ExecutionClass executionClass, WorkPriority priority,
+    std::function<asio::error_code()> job,
+    std::function<void(asio::error_code const&)> done)
+{
+    if (executionClass == Work::WORK_EXECUTION_MAIN_THREAD)
+    {
+        post(priority, [job, done]() {
+            asio::error_code ec;
+            try
+            {
+                ec = job();
+            }
+            catch (std::exception const& e)
+            {
+                CLOG(WARNING, "Work") << "Job failed: " << e.what();
+                ec = std::make_error_code(std::errc::io_error);
+            }
+            done(ec);
+        });
+        return;
+    }
+
+    mBackground[executionClass].mJobs[priority].emplace_back(
+        QueuedJob{std::move(job), std::move(done), clock::now()});
+    startBackgroundJobs(executionClass);
+}
+
+void
+WorkManagerImpl::startBackgroundJobs(Work::ExecutionClass executionClass)
+{
+    auto& queue = mBackground[executionClass];
+    std::weak_ptr<WorkManagerImpl> weak(
+        std::static_pointer_cast<WorkManagerImpl>(shared_from_this()));
+    asio::io_service& mainIO = mApp.getClock().getIOService();
+
+    while (queue.mRunning < queue.mLimit)
+    {
+        auto jobs = std::find_if(queue.mJobs.rbegin(), queue.mJobs.rend(),
+                                 [](std::deque<QueuedJob> const& q) {
+                                     return !q.empty();
+                                 });
+        if (jobs == queue.mJobs.rend())
+        {
+            break;
+        }
+        auto priority = std::distance(jobs, queue.mJobs.rend()) - 1;
+        auto job = std::move(jobs->front());
+        jobs->pop_front();
+        mWaitTimes[executionClass][priority]->Update(clock::now() -
+                                                     job.mQueued);
+        queue.mRunning++;
+        queue.mRunningCounter->inc();
+
+        auto run = job.mJob;
+        auto done = job.mDone;
+        mApp.getWorkerIOService().post(
+            [weak, executionClass, run, done, &mainIO]() {
+                asio::error_code ec;
+                try
+                {
+                    ec = run();
+                }
+                catch (std::exception const& e)
+                {
+                    CLOG(WARNING, "Work") << "Job failed: " << e.what();
+                    ec = std::make_error_code(std::errc::io_error);
+                }
+                mainIO.post([weak, executionClass, done, ec]() {
+                    auto self = weak.lock();
+                    if (self)
+                    {
+                        auto& q = self->mBackground[executionClass];
+                        q.mRunning--;
+                        q.mRunningCounter->dec();
+                        self->startBackgroundJobs(executionClass);
+                    }
+                    done(ec);
+                });
+            });
+    }
+}
+
 std::shared_ptr<WorkManager>
 WorkManager::create(Application& app)
 {
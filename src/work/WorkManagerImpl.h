@@ -3,6 +3,15 @@
 // of this distribution or at http://www.apache.org/licenses/LICENSE-2.0
 
 #include "work/WorkManager.h"
+#include <array>
+#include <chrono>
+#include <deque>
+
+namespace medida
+{
+class Counter;
+class Timer;
+}
 
 namespace stellar
 {
@@ -13,5 +22,52 @@ class WorkManagerImpl : public WorkManager
     WorkManagerImpl(Application& app);
     virtual ~WorkManagerImpl();
     virtual void notify(std::string const&) override;
+
+    virtual void post(WorkPriority priority,
+                      std::function<void()> handler) override;
+    virtual void
+    runInBackground(Work::ExecutionClass executionClass, WorkPriority priority,
+                    std::function<asio::error_code()> job,
+                    std::function<void(asio::error_code const&)> done) override;
+
+  private:
+    using clock = std::chrono::steady_clock;
+
+    static size_t const NUM_PRIORITIES = WORK_PRIORITY_HIGH + 1;
+    static size_t const NUM_EXECUTION_CLASSES =
+        Work::WORK_EXECUTION_IO_BOUND + 1;
+
+    struct QueuedHandler
+    {
+        std::function<void()> mHandler;
+        clock::time_point mQueued;
+    };
+
+    struct QueuedJob
+    {
+        std::function<asio::error_code()> mJob;
+        std::function<void(asio::error_code const&)> mDone;
+        clock::time_point mQueued;
+    };
+
+    struct BackgroundQueue
+    {
+        size_t mLimit{1};
+        size_t mRunning{0};
+        std::array<std::deque<QueuedJob>, NUM_PRIORITIES> mJobs;
+        medida::Counter* mRunningCounter{nullptr};
+    };
+
+    std::array<std::deque<QueuedHandler>, NUM_PRIORITIES> mRunQueue;
+    bool mRunQueueScheduled{false};
+    // indexed by execution class, main thread unused
+    std::array<BackgroundQueue, NUM_EXECUTION_CLASSES> mBackground;
+    std::array<std::array<medida::Timer*, NUM_PRIORITIES>,
+               NUM_EXECUTION_CLASSES>
+        mWaitTimes;
+
+    void scheduleRunQueue();
+    void runOne();
+    void startBackgroundJobs(Work::ExecutionClass executionClass);
 };
 }
@@ -108,4 +108,10 @@ WorkParent::app() const
 {
     return mApp;
 }
+
+WorkPriority
+WorkParent::getPriority() const
+{
+    return WORK_PRIORITY_NORMAL;
+}
 }
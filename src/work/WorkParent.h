@@ -16,6 +16,15 @@ namespace stellar
 class Application;
 class Work;
 
+// Order in which the main thread runs scheduled steps of Work, and worker
+// threads pick up background jobs (see WorkManager::post).
+enum WorkPriority
+{
+    WORK_PRIORITY_LOW,
+    WORK_PRIORITY_NORMAL,
+    WORK_PRIORITY_HIGH
+};
+
 /**
  * WorkParent is a class of things-that-hold Work, and are notified by work
  * when it completes. This is an abstract base that's implemented by both
@@ -46,6 +55,9 @@ class WorkParent : public std::enable_shared_from_this<WorkParent>,
 
     Application& app() const;
 
+    // Priority given to the children of this parent when they are created.
+    virtual WorkPriority getPriority() const;
+
     template <typename T, typename... Args>
     std::shared_ptr<T>
     addWork(Args&&... args)
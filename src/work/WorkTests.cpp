@@ -11,9 +11,15 @@
 #include "util/Fs.h"
 #include "work/WorkManager.h"
 
+#include "medida/counter.h"
+#include "medida/metrics_registry.h"
+#include "medida/timer.h"
+
+#include <atomic>
 #include <cstdio>
 #include <fstream>
 #include <random>
+#include <thread>
 #include <xdrpp/autocheck.h>
 
 using namespace stellar;
@@ -254,3 +260,116 @@ TEST_CASE("sub-subwork items succed at the same time", "[work]")
 
     REQUIRE(!work1->mCalledSuccessWithPendingSubwork);
 }
+
+class RecordingWork : public Work
+{
+    std::vector<std::string>& mRuns;
+
+  public:
+    RecordingWork(Application& app, WorkParent& parent,
+                  std::string const& uniqueName, std::vector<std::string>& runs)
+        : Work(app, parent, uniqueName), mRuns(runs)
+    {
+    }
+
+    virtual void
+    onRun() override
+    {
+        mRuns.push_back(getUniqueName());
+        scheduleSuccess();
+    }
+};
+
+TEST_CASE("work runs by priority", "[work]")
+{
+    VirtualClock clock;
+    auto const& cfg = getTestConfig();
+    auto app = createTestApplication(clock, cfg);
+    auto& wm = app->getWorkManager();
+    std::vector<std::string> runs;
+
+    // advanced first, but runs last
+    auto low = wm.addWork<Work>("a-low");
+    low->setPriority(WORK_PRIORITY_LOW);
+    auto low1 = low->addWork<RecordingWork>("low-1", runs);
+    low->addWork<RecordingWork>("low-2", runs);
+    REQUIRE(low1->getPriority() == WORK_PRIORITY_LOW);
+
+    auto high = wm.addWork<Work>("b-high");
+    high->setPriority(WORK_PRIORITY_HIGH);
+    high->addWork<RecordingWork>("high-1", runs);
+    high->addWork<RecordingWork>("high-2", runs);
+
+    wm.advanceChildren();
+    while (!wm.allChildrenDone())
+    {
+        clock.crank();
+    }
+
+    REQUIRE(runs == std::vector<std::string>{"high-1", "high-2", "low-1",
+                                             "low-2"});
+    REQUIRE(app->getMetrics()
+                .NewTimer({"work", "wait-main", "high"})
+                .count() > 0);
+    REQUIRE(app->getMetrics()
+                .NewTimer({"work", "wait-main", "low"})
+                .count() > 0);
+}
+
+TEST_CASE("background jobs run within their concurrency limit", "[work]")
+{
+    VirtualClock clock;
+    Config cfg(getTestConfig());
+    cfg.WORK_MAX_CONCURRENT_CPU_JOBS = 2;
+    auto app = createTestApplication(clock, cfg);
+    auto& wm = app->getWorkManager();
+
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+    size_t succeeded = 0;
+    size_t failed = 0;
+    auto done = [&](asio::error_code const& ec) {
+        if (ec)
+        {
+            failed++;
+        }
+        else
+        {
+            succeeded++;
+        }
+    };
+
+    for (int i = 0; i < 10; ++i)
+    {
+        wm.runInBackground(Work::WORK_EXECUTION_CPU_BOUND,
+                           WORK_PRIORITY_NORMAL,
+                           [&]() {
+                               int n = ++running;
+                               int m = maxRunning;
+                               while (n > m &&
+                                      !maxRunning.compare_exchange_weak(m, n))
+                               {
+                               }
+                               std::this_thread::sleep_for(
+                                   std::chrono::milliseconds(5));
+                               --running;
+                               return asio::error_code();
+                           },
+                           done);
+    }
+    wm.runInBackground(Work::WORK_EXECUTION_CPU_BOUND, WORK_PRIORITY_HIGH,
+                       []() -> asio::error_code {
+                           throw std::runtime_error("job failed");
+                       },
+                       done);
+
+    while (succeeded + failed < 11)
+    {
+        clock.crank();
+    }
+    REQUIRE(succeeded == 10);
+    REQUIRE(failed == 1);
+    REQUIRE(maxRunning <= 2);
+    REQUIRE(app->getMetrics().NewCounter({"work", "running", "cpu"}).count() ==
+            0);
+}